@@ -0,0 +1,36 @@
+/*
+ * boot_slots.h
+ *
+ * A/B slot selection with trial boots and rollback, see boot_control.h.
+ */
+
+#ifndef INC_BOOT_SLOTS_H_
+#define INC_BOOT_SLOTS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "boot_control.h"
+
+typedef struct {
+    uint32_t address;
+    uint32_t imageSize; // the slot without its trailer
+    const char* name;
+} BootSlot;
+
+extern const BootSlot boot_slots[BOOT_SLOT_COUNT];
+
+// Slot for a normal boot, -1 when neither holds a valid image. A slot on
+// trial uses up one attempt here; one out of attempts is rejected and the
+// other slot is tried.
+int boot_select(void);
+
+// Slot the bootloader's own update writes to: the one a normal boot would
+// not pick, so the running image stays as the fallback
+int boot_update_slot(void);
+
+// Makes a freshly written and verified slot the next to boot, on trial
+bool boot_activate(int slot);
+
+void boot_print_slots(void);
+
+#endif /* INC_BOOT_SLOTS_H_ */
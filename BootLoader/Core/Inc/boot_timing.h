@@ -0,0 +1,99 @@
+/*
+ * boot_timing.h
+ *
+ * Boot phase timestamps, shared by the bootloader and the application.
+ */
+
+#ifndef INC_BOOT_TIMING_H_
+#define INC_BOOT_TIMING_H_
+
+#include <stdint.h>
+#include "stm32f4xx.h"
+
+// The record sits in the top BOOT_TIMING_SIZE bytes of RAM, which both
+// linker scripts leave out of RAM, so it survives the jump and the
+// application's startup code. The bootloader starts it at reset; each
+// phase is stamped from the DWT cycle counter, which keeps running across
+// the jump.
+#define BOOT_TIMING_ADDRESS 0x2001FFC0
+#define BOOT_TIMING_SIZE 0x40
+#define BOOT_TIMING_MAGIC 0xB0071111
+
+#define BOOT_TIMING_FAST 0x01 // the bootloader took the fast path
+
+typedef enum {
+    BOOT_PHASE_RESET,        // bootloader main, time 0
+    BOOT_PHASE_LOADER_INIT,  // bootloader clocks and peripherals ready
+    BOOT_PHASE_VERIFIED,     // slot picked and its image checked
+    BOOT_PHASE_JUMP,         // bootloader hands over
+    BOOT_PHASE_SYSTEM_INIT,  // application SystemInit
+    BOOT_PHASE_APP_INIT,     // Application::init done
+    BOOT_PHASE_FIRST_SAMPLE, // first valid sensor sample
+    BOOT_PHASE_COUNT
+} BootPhase;
+
+// Cycles are converted at the core clock they ran at. An interval that
+// spans a clock switch is converted at the clock it started with, so code
+// calls boot_timing_clock right after switching.
+typedef struct {
+    uint32_t magic;
+    uint32_t marked;     // bit per BootPhase
+    uint32_t flags;      // BOOT_TIMING_*
+    uint32_t lastCycles;
+    uint32_t clockHz;    // since lastCycles
+    uint32_t elapsedUs;  // at lastCycles
+    uint32_t us[BOOT_PHASE_COUNT];
+} BootTiming;
+
+#define BOOT_TIMING ((volatile BootTiming*)BOOT_TIMING_ADDRESS)
+
+static inline int boot_timing_valid(void){
+    return BOOT_TIMING->magic == BOOT_TIMING_MAGIC;
+}
+
+// Time 0, BOOT_PHASE_RESET, is now
+static inline void boot_timing_start(uint32_t clockHz){
+    volatile BootTiming* t = BOOT_TIMING;
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    t->us[BOOT_PHASE_RESET] = 0;
+    t->marked = 1u << BOOT_PHASE_RESET;
+    t->flags = 0;
+    t->lastCycles = DWT->CYCCNT;
+    t->clockHz = clockHz;
+    t->elapsedUs = 0;
+    t->magic = BOOT_TIMING_MAGIC;
+}
+
+// Nothing after this is boot time, e.g. someone sitting in the menu
+static inline void boot_timing_stop(void){
+    BOOT_TIMING->magic = 0;
+}
+
+// The core clock is clockHz from now on
+static inline void boot_timing_clock(uint32_t clockHz){
+    volatile BootTiming* t = BOOT_TIMING;
+    if(t->magic != BOOT_TIMING_MAGIC){
+        return;
+    }
+    uint32_t now = DWT->CYCCNT;
+    uint32_t cyclesPerUs = t->clockHz / 1000000;
+    t->elapsedUs += (now - t->lastCycles) / (cyclesPerUs ? cyclesPerUs : 1);
+    t->lastCycles = now;
+    t->clockHz = clockHz;
+}
+
+static inline void boot_timing_mark(BootPhase phase, uint32_t clockHz){
+    volatile BootTiming* t = BOOT_TIMING;
+    boot_timing_clock(clockHz);
+    if(t->magic == BOOT_TIMING_MAGIC){
+        t->us[phase] = t->elapsedUs;
+        t->marked |= 1u << phase;
+    }
+}
+
+static inline void boot_timing_flag(uint32_t flag){
+    BOOT_TIMING->flags |= flag;
+}
+
+#endif /* INC_BOOT_TIMING_H_ */
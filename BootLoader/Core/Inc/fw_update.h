@@ -0,0 +1,97 @@
+/*
+ * fw_update.h
+ *
+ * Firmware update over USART2, driven by Tools/fw_upload.py.
+ */
+
+#ifndef INC_FW_UPDATE_H_
+#define INC_FW_UPDATE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Frame: [SYNC][type][seq u16][len u16][payload][crc32], little-endian.
+// The CRC is the STM32 CRC over type..payload (see image_header.h).
+// The host keeps up to FWU_WINDOW DATA blocks in flight. Blocks are
+// programmed as they arrive, in any order, and each one is acknowledged
+// with the first missing block and a bitmap of the ones received after
+// it, so the host resends only what was lost. Reception runs on circular
+// DMA: the next blocks keep arriving while the CPU is stalled programming
+// flash. Every sector the image needs is erased on START, before any data.
+#define FWU_SYNC 0x5A
+#define FWU_HEADER_SIZE 6
+#define FWU_CRC_SIZE 4
+#define FWU_BLOCK_SIZE 1024
+#define FWU_WINDOW 4
+#define FWU_DEFAULT_BAUD 115200
+#define FWU_BAUD_CONFIRM_MS 1000 // a new baud rate reverts unless the host repeats BAUD at it in time
+#define FWU_IDLE_TIMEOUT_MS 30000
+#define FWU_PROTOCOL_VERSION 1
+
+typedef enum {
+    FWU_HELLO  = 0x01, // any payload, answered by INFO; the host sends full blocks to test a baud rate
+    FWU_BAUD   = 0x02, // u32 baud; ACKed at the old rate, then switched; repeated at the new rate to keep it
+    FWU_START  = 0x03, // u32 image length; erases the whole slot, then ACK 0
+    FWU_DATA   = 0x04, // seq = block number, FWU_BLOCK_SIZE bytes except the last block
+    FWU_END    = 0x05, // verifies the image and makes it the next to boot, answered by RESULT
+    FWU_BOOT   = 0x06, // ACK, then reset into the bootloader's normal boot
+    FWU_ACK    = 0x81, // seq = first missing block; during a transfer u32 bitmap of seq+1..seq+32
+    FWU_NAK    = 0x82, // seq = first missing block, u8 reason
+    FWU_INFO   = 0x83,
+    FWU_RESULT = 0x84
+} FwuType;
+
+typedef enum {
+    FWU_NAK_SEQUENCE = 1, // block beyond the acknowledgement bitmap
+    FWU_NAK_LENGTH,
+    FWU_NAK_STATE,
+    FWU_NAK_BAUD,
+    FWU_NAK_FLASH
+} FwuNakReason;
+
+typedef struct __attribute__((packed)) {
+    uint16_t protocolVersion;
+    uint16_t blockSize;
+    uint8_t window;
+    uint8_t reserved[3];
+    uint32_t maxBaud;
+    uint32_t slotAddress;
+    uint32_t slotSize;
+} FwuInfo;
+
+typedef struct __attribute__((packed)) {
+    uint8_t status;    // ImageStatus of the written image
+    uint8_t reserved[3];
+    uint32_t length;
+    uint32_t eraseMs;
+    uint32_t transferMs; // START acknowledged to last block programmed
+    uint32_t crcErrors;  // frames dropped, the host resends them
+} FwuResult;
+
+// Receives an image into the slot; slotSize excludes the boot trailer.
+// Returns on idle timeout, resets after BOOT.
+void fw_update_run(uint32_t slotAddress, uint32_t slotSize);
+
+// fw_update_run in steps, for the host simulation (Tests/fwu_sim_port.c):
+// each poll handles what one read returns and is false once idle too long
+void fw_update_open(uint32_t slotAddress, uint32_t slotSize);
+bool fw_update_poll(void);
+void fw_update_close(void);
+
+// Provided by fw_update_port.c
+void fwu_port_open(void);
+void fwu_port_close(void);
+size_t fwu_port_read(uint8_t* data, size_t size);
+void fwu_port_write(const uint8_t* data, size_t length);
+uint32_t fwu_port_max_baud(void);
+bool fwu_port_set_baud(uint32_t baud);
+uint32_t fwu_port_millis(void);
+uint32_t fwu_port_crc(const uint8_t* data, size_t length);
+bool fwu_port_erase(uint32_t address, uint32_t length);
+bool fwu_port_program(uint32_t address, const uint32_t* words, size_t count);
+uint8_t fwu_port_verify(uint32_t address, uint32_t slotSize);
+bool fwu_port_activate(uint32_t address);
+void fwu_port_reset(void);
+
+#endif /* INC_FW_UPDATE_H_ */
@@ -0,0 +1,32 @@
+/*
+ * image_check.h
+ *
+ * Verifies a firmware image in flash before the bootloader jumps to it.
+ */
+
+#ifndef INC_IMAGE_CHECK_H_
+#define INC_IMAGE_CHECK_H_
+
+#include <stdint.h>
+#include "image_header.h"
+
+typedef enum {
+    IMAGE_OK = 0,
+    IMAGE_NO_HEADER,   // erased slot or an image built without a header
+    IMAGE_BAD_LENGTH,  // not stamped, or larger than the slot
+    IMAGE_BAD_STACK,   // initial stack pointer outside RAM
+    IMAGE_BAD_ENTRY,   // entry differs from the vector table or lies outside the image
+    IMAGE_BAD_CRC
+} ImageStatus;
+
+typedef struct {
+    ImageStatus status;
+    uint32_t version;
+    uint32_t length;
+    uint32_t crcTimeUs; // time the CRC of the whole image took
+} ImageCheck;
+
+ImageCheck image_verify(uint32_t address, uint32_t slotSize);
+const char* image_status_name(ImageStatus status);
+
+#endif /* INC_IMAGE_CHECK_H_ */
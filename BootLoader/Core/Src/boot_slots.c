@@ -0,0 +1,148 @@
+/*
+ * boot_slots.c
+ *
+ * The boot state lives in the slot trailers; every change here is one
+ * flash word programmed from erased, nothing is ever erased.
+ */
+
+#include "boot_slots.h"
+#include "image_check.h"
+#include "main.h"
+#include <stdio.h>
+
+const BootSlot boot_slots[BOOT_SLOT_COUNT] = {
+	{BOOT_SLOT_A_ADDRESS, BOOT_SLOT_A_SIZE - BOOT_TRAILER_SIZE, "A"},
+	{BOOT_SLOT_B_ADDRESS, BOOT_SLOT_B_SIZE - BOOT_TRAILER_SIZE, "B"},
+};
+
+static const volatile BootTrailer* trailer_of(int slot){
+	return BOOT_TRAILER(boot_slots[slot].address, boot_slots[slot].imageSize + BOOT_TRAILER_SIZE);
+}
+
+static bool sequence_valid(const volatile BootTrailer* trailer){
+	return trailer->sequence != BOOT_WORD_ERASED && trailer->sequenceCheck == ~trailer->sequence;
+}
+
+// A word counts once any bit of it is programmed, so a write cut short by
+// power loss still counts
+static bool is_set(uint32_t word){
+	return word != BOOT_WORD_ERASED;
+}
+
+static bool on_trial(const volatile BootTrailer* trailer){
+	return sequence_valid(trailer) && !is_set(trailer->confirmed);
+}
+
+static int attempts_used(const volatile BootTrailer* trailer){
+	int used = 0;
+	while(used < BOOT_MAX_ATTEMPTS && is_set(trailer->attempts[used])){
+		used++;
+	}
+	return used;
+}
+
+static bool program_word(const volatile uint32_t* word, uint32_t value){
+	HAL_FLASH_Unlock();
+	bool ok = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, (uint32_t)word, value) == HAL_OK;
+	HAL_FLASH_Lock();
+	return ok;
+}
+
+// Highest sequence first, an unsequenced slot last, A before B on a tie
+static int best_slot(const bool* excluded){
+	int best = -1;
+	uint64_t bestRank = 0;
+	for(int slot = 0; slot < BOOT_SLOT_COUNT; slot++){
+		const volatile BootTrailer* trailer = trailer_of(slot);
+		if(excluded[slot] || is_set(trailer->rejected)){
+			continue;
+		}
+		uint64_t rank = sequence_valid(trailer) ? (uint64_t)trailer->sequence + 1 : 0;
+		if(best < 0 || rank > bestRank){
+			best = slot;
+			bestRank = rank;
+		}
+	}
+	return best;
+}
+
+static bool image_valid(int slot){
+	ImageStatus status = image_verify(boot_slots[slot].address, boot_slots[slot].imageSize).status;
+	if(status != IMAGE_OK){
+		printf("Slot %s: %s\n", boot_slots[slot].name, image_status_name(status));
+	}
+	return status == IMAGE_OK;
+}
+
+int boot_select(void){
+	bool excluded[BOOT_SLOT_COUNT] = {false};
+	int slot;
+	while((slot = best_slot(excluded)) >= 0){
+		excluded[slot] = true;
+		if(!image_valid(slot)){
+			continue;
+		}
+
+		const volatile BootTrailer* trailer = trailer_of(slot);
+		if(!on_trial(trailer)){
+			return slot;
+		}
+		// Counted before the jump: a hang or a watchdog reset still uses it up
+		int used = attempts_used(trailer);
+		if(used < BOOT_MAX_ATTEMPTS){
+			program_word(&trailer->attempts[used], BOOT_MARK);
+			printf("Slot %s: trial boot %d of %d\n", boot_slots[slot].name, used + 1, BOOT_MAX_ATTEMPTS);
+			return slot;
+		}
+		program_word(&trailer->rejected, BOOT_MARK);
+		printf("Slot %s: not confirmed after %d boots, rolling back\n", boot_slots[slot].name, BOOT_MAX_ATTEMPTS);
+	}
+	return -1;
+}
+
+int boot_update_slot(void){
+	bool excluded[BOOT_SLOT_COUNT] = {false};
+	int slot;
+	while((slot = best_slot(excluded)) >= 0){
+		if(image_verify(boot_slots[slot].address, boot_slots[slot].imageSize).status == IMAGE_OK){
+			return 1 - slot;
+		}
+		excluded[slot] = true;
+	}
+	return 0;
+}
+
+bool boot_activate(int slot){
+	const volatile BootTrailer* trailer = trailer_of(slot);
+	if(is_set(trailer->sequence) || is_set(trailer->sequenceCheck)){
+		return false; // the update did not erase the trailer
+	}
+
+	uint32_t sequence = 1;
+	for(int other = 0; other < BOOT_SLOT_COUNT; other++){
+		const volatile BootTrailer* otherTrailer = trailer_of(other);
+		if(other != slot && sequence_valid(otherTrailer) && otherTrailer->sequence >= sequence){
+			sequence = otherTrailer->sequence + 1;
+		}
+	}
+	// The check word makes the sequence valid: the switch is this one write
+	return program_word(&trailer->sequence, sequence) && program_word(&trailer->sequenceCheck, ~sequence);
+}
+
+void boot_print_slots(void){
+	for(int slot = 0; slot < BOOT_SLOT_COUNT; slot++){
+		const volatile BootTrailer* trailer = trailer_of(slot);
+		printf("Slot %s: ", boot_slots[slot].name);
+		if(!sequence_valid(trailer)){
+			printf("no sequence");
+		}else{
+			printf("sequence %lu", trailer->sequence);
+		}
+		if(is_set(trailer->rejected)){
+			printf(", rejected");
+		}else if(on_trial(trailer)){
+			printf(", on trial, %d of %d boots used", attempts_used(trailer), BOOT_MAX_ATTEMPTS);
+		}
+		printf("\n");
+	}
+}
@@ -0,0 +1,267 @@
+/*
+ * fw_update.c
+ *
+ * Update protocol state machine. Hardware access goes through the
+ * fwu_port_* functions, see fw_update_port.c.
+ */
+
+#include "fw_update.h"
+#include "image_check.h"
+#include <string.h>
+
+typedef enum { PARSE_NONE, PARSE_FRAME, PARSE_BAD_CRC } ParseResult;
+
+typedef struct {
+	uint32_t slotAddress;
+	uint32_t slotSize;
+	uint32_t length;      // image being received, 0 before START
+	uint16_t expected;    // first block not yet programmed
+	uint32_t received;    // bit i: block expected + 1 + i programmed
+	uint32_t baud;
+	bool baudPending;     // new rate not yet committed by the host
+	uint32_t baudDeadline;
+	uint32_t startMs;
+	FwuResult result;
+} FwuState;
+
+// Frame without SYNC. The type at byte 3 puts the payload on a word
+// boundary, so DATA blocks are programmed straight from here.
+static uint32_t frameWords[(3 + FWU_HEADER_SIZE - 1 + FWU_BLOCK_SIZE + FWU_CRC_SIZE + 3) / 4];
+#define FRAME ((uint8_t*)frameWords + 3)
+static size_t frameLength;
+static bool inFrame;
+
+static FwuState state;
+static uint32_t lastFrame;
+
+static ParseResult parse(uint8_t byte){
+	if(!inFrame){
+		if(byte == FWU_SYNC){
+			inFrame = true;
+			frameLength = 0;
+		}
+		return PARSE_NONE;
+	}
+
+	FRAME[frameLength++] = byte;
+	if(frameLength < FWU_HEADER_SIZE - 1){
+		return PARSE_NONE;
+	}
+	size_t length = FRAME[3] | FRAME[4] << 8;
+	if(length > FWU_BLOCK_SIZE){
+		inFrame = false;
+		return PARSE_NONE;
+	}
+	if(frameLength < FWU_HEADER_SIZE - 1 + length + FWU_CRC_SIZE){
+		return PARSE_NONE;
+	}
+
+	inFrame = false;
+	uint32_t crc;
+	memcpy(&crc, &FRAME[FWU_HEADER_SIZE - 1 + length], sizeof(crc));
+	return crc == fwu_port_crc(FRAME, FWU_HEADER_SIZE - 1 + length) ? PARSE_FRAME : PARSE_BAD_CRC;
+}
+
+static void send(uint8_t type, uint16_t seq, const void* payload, uint16_t length){
+	uint8_t out[FWU_HEADER_SIZE + sizeof(FwuResult) + FWU_CRC_SIZE];
+	out[0] = FWU_SYNC;
+	out[1] = type;
+	out[2] = seq & 0xFF;
+	out[3] = seq >> 8;
+	out[4] = length & 0xFF;
+	out[5] = length >> 8;
+	memcpy(&out[FWU_HEADER_SIZE], payload, length);
+	uint32_t crc = fwu_port_crc(&out[1], FWU_HEADER_SIZE - 1 + length);
+	memcpy(&out[FWU_HEADER_SIZE + length], &crc, sizeof(crc));
+	fwu_port_write(out, FWU_HEADER_SIZE + length + FWU_CRC_SIZE);
+}
+
+static void nak(FwuState* s, uint8_t reason){
+	send(FWU_NAK, s->expected, &reason, 1);
+}
+
+static void ack_blocks(FwuState* s){
+	send(FWU_ACK, s->expected, &s->received, sizeof(s->received));
+}
+
+static void handle_start(FwuState* s, const uint8_t* payload, uint16_t length){
+	uint32_t imageLength = 0;
+	if(length == sizeof(imageLength)){
+		memcpy(&imageLength, payload, sizeof(imageLength));
+	}
+	s->length = 0;
+	s->expected = 0;
+	s->received = 0;
+	memset(&s->result, 0, sizeof(s->result));
+	if(imageLength == 0 || imageLength > s->slotSize || (imageLength & 3) != 0){
+		nak(s, FWU_NAK_LENGTH);
+		return;
+	}
+
+	// Erase everything now: an erase stalls the CPU for hundreds of
+	// milliseconds, longer than the receive ring covers at speed. The whole
+	// slot, so the boot state after the image starts out erased as well.
+	uint32_t eraseStart = fwu_port_millis();
+	if(!fwu_port_erase(s->slotAddress, s->slotSize)){
+		nak(s, FWU_NAK_FLASH);
+		return;
+	}
+	s->length = imageLength;
+	s->result.length = imageLength;
+	s->startMs = fwu_port_millis();
+	s->result.eraseMs = s->startMs - eraseStart;
+	send(FWU_ACK, 0, NULL, 0);
+}
+
+static void handle_data(FwuState* s, uint16_t seq, const uint8_t* payload, uint16_t length){
+	if(s->length == 0){
+		nak(s, FWU_NAK_STATE);
+		return;
+	}
+	uint32_t ahead = (uint32_t)seq - s->expected; // wraps for blocks already programmed
+	if(seq < s->expected || (ahead > 0 && ahead <= 32 && (s->received >> (ahead - 1)) & 1)){
+		// Resent after a lost ACK
+		ack_blocks(s);
+		return;
+	}
+	if(ahead > 32){
+		nak(s, FWU_NAK_SEQUENCE);
+		return;
+	}
+
+	uint32_t offset = (uint32_t)seq * FWU_BLOCK_SIZE;
+	bool last = offset + length == s->length;
+	if(offset + length > s->length || (length != FWU_BLOCK_SIZE && !last) || (length & 3) != 0){
+		nak(s, FWU_NAK_LENGTH);
+		return;
+	}
+	if(!fwu_port_program(s->slotAddress + offset, (const uint32_t*)payload, length / 4)){
+		nak(s, FWU_NAK_FLASH);
+		return;
+	}
+
+	// Blocks after a gap are kept; the bitmap tells the host which one to resend
+	if(ahead == 0){
+		s->expected++;
+		while(s->received & 1){
+			s->received >>= 1;
+			s->expected++;
+		}
+		s->received >>= 1;
+	}else{
+		s->received |= 1u << (ahead - 1);
+	}
+	if((uint32_t)s->expected * FWU_BLOCK_SIZE >= s->length){
+		s->result.transferMs = fwu_port_millis() - s->startMs;
+	}
+	ack_blocks(s);
+}
+
+static void handle_frame(FwuState* s){
+	uint8_t type = FRAME[0];
+	uint16_t seq = FRAME[1] | FRAME[2] << 8;
+	uint16_t length = FRAME[3] | FRAME[4] << 8;
+	const uint8_t* payload = &FRAME[FWU_HEADER_SIZE - 1];
+
+	switch(type){
+		case FWU_HELLO: {
+			FwuInfo info = {FWU_PROTOCOL_VERSION, FWU_BLOCK_SIZE, FWU_WINDOW, {0},
+			                fwu_port_max_baud(), s->slotAddress, s->slotSize};
+			send(FWU_INFO, seq, &info, sizeof(info));
+			break;
+		}
+		case FWU_BAUD: {
+			uint32_t baud = 0;
+			if(length == sizeof(baud)){
+				memcpy(&baud, payload, sizeof(baud));
+			}
+			if(baud == s->baud){
+				// Repeated at the new rate: the host can talk at it, keep it
+				s->baudPending = false;
+				send(FWU_ACK, seq, NULL, 0);
+				break;
+			}
+			if(baud < FWU_DEFAULT_BAUD || baud > fwu_port_max_baud()){
+				nak(s, FWU_NAK_BAUD);
+				break;
+			}
+			send(FWU_ACK, seq, NULL, 0);
+			if(fwu_port_set_baud(baud)){
+				s->baud = baud;
+				s->baudPending = baud != FWU_DEFAULT_BAUD;
+				s->baudDeadline = fwu_port_millis() + FWU_BAUD_CONFIRM_MS;
+			}
+			break;
+		}
+		case FWU_START:
+			handle_start(s, payload, length);
+			break;
+		case FWU_DATA:
+			handle_data(s, seq, payload, length);
+			break;
+		case FWU_END:
+			if(s->length == 0 || (uint32_t)s->expected * FWU_BLOCK_SIZE < s->length){
+				nak(s, FWU_NAK_STATE);
+				break;
+			}
+			s->result.status = fwu_port_verify(s->slotAddress, s->slotSize);
+			if(s->result.status == IMAGE_OK && !fwu_port_activate(s->slotAddress)){
+				nak(s, FWU_NAK_FLASH);
+				break;
+			}
+			send(FWU_RESULT, seq, &s->result, sizeof(s->result));
+			break;
+		case FWU_BOOT:
+			send(FWU_ACK, seq, NULL, 0);
+			fwu_port_reset();
+			break;
+		default:
+			break;
+	}
+}
+
+void fw_update_open(uint32_t slotAddress, uint32_t slotSize){
+	memset(&state, 0, sizeof(state));
+	state.slotAddress = slotAddress;
+	state.slotSize = slotSize;
+	state.baud = FWU_DEFAULT_BAUD;
+	inFrame = false;
+
+	fwu_port_open();
+	lastFrame = fwu_port_millis();
+}
+
+bool fw_update_poll(void){
+	FwuState* s = &state;
+	uint8_t chunk[64];
+	size_t count = fwu_port_read(chunk, sizeof(chunk));
+	for(size_t i = 0; i < count; i++){
+		ParseResult result = parse(chunk[i]);
+		if(result == PARSE_FRAME){
+			lastFrame = fwu_port_millis();
+			handle_frame(s);
+		}else if(result == PARSE_BAD_CRC){
+			s->result.crcErrors++;
+		}
+	}
+
+	// The host did not commit the new rate
+	if(s->baudPending && (int32_t)(fwu_port_millis() - s->baudDeadline) >= 0){
+		fwu_port_set_baud(FWU_DEFAULT_BAUD);
+		s->baud = FWU_DEFAULT_BAUD;
+		s->baudPending = false;
+	}
+	return fwu_port_millis() - lastFrame < FWU_IDLE_TIMEOUT_MS;
+}
+
+void fw_update_close(void){
+	fwu_port_set_baud(FWU_DEFAULT_BAUD);
+	fwu_port_close();
+}
+
+void fw_update_run(uint32_t slotAddress, uint32_t slotSize){
+	fw_update_open(slotAddress, slotSize);
+	while(fw_update_poll()){
+	}
+	fw_update_close();
+}
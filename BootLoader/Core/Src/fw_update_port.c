@@ -0,0 +1,180 @@
+/*
+ * fw_update_port.c
+ *
+ * USART2, flash and CRC access for fw_update.c.
+ */
+
+#include "fw_update.h"
+#include "image_check.h"
+#include "boot_slots.h"
+#include "main.h"
+#include <string.h>
+
+#define RX_RING_SIZE 8192 // twice the window of blocks in flight
+
+extern UART_HandleTypeDef huart2;
+
+static uint8_t rxRing[RX_RING_SIZE];
+static uint32_t rxTail;
+static DMA_HandleTypeDef hdma_usart2_rx;
+
+static uint32_t lastCycles;
+static uint64_t totalCycles;
+
+void fwu_port_open(void){
+	// Circular DMA straight from USART2: bytes keep arriving while the CPU
+	// is stalled on a flash write, and no UART interrupt is involved
+	__HAL_RCC_DMA1_CLK_ENABLE();
+	hdma_usart2_rx.Instance = DMA1_Stream5;
+	hdma_usart2_rx.Init.Channel = DMA_CHANNEL_4;
+	hdma_usart2_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_usart2_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_usart2_rx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_usart2_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_usart2_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_usart2_rx.Init.Mode = DMA_CIRCULAR;
+	hdma_usart2_rx.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+	hdma_usart2_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+	HAL_DMA_Init(&hdma_usart2_rx);
+
+	rxTail = 0;
+	__HAL_UART_CLEAR_OREFLAG(&huart2);
+	HAL_DMA_Start(&hdma_usart2_rx, (uint32_t)&USART2->DR, (uint32_t)rxRing, RX_RING_SIZE);
+	SET_BIT(USART2->CR3, USART_CR3_DMAR);
+
+	// The tick misses interrupts while an erase stalls the bus, the cycle counter does not
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	lastCycles = DWT->CYCCNT;
+}
+
+void fwu_port_close(void){
+	CLEAR_BIT(USART2->CR3, USART_CR3_DMAR);
+	HAL_DMA_Abort(&hdma_usart2_rx);
+	HAL_DMA_DeInit(&hdma_usart2_rx);
+}
+
+size_t fwu_port_read(uint8_t* data, size_t size){
+	uint32_t head = RX_RING_SIZE - __HAL_DMA_GET_COUNTER(&hdma_usart2_rx);
+	if(head == RX_RING_SIZE){
+		head = 0;
+	}
+	size_t count = 0;
+	while(rxTail != head && count < size){
+		data[count++] = rxRing[rxTail];
+		rxTail = (rxTail + 1) % RX_RING_SIZE;
+	}
+	return count;
+}
+
+void fwu_port_write(const uint8_t* data, size_t length){
+	HAL_UART_Transmit(&huart2, (uint8_t*)data, length, 100);
+}
+
+uint32_t fwu_port_max_baud(void){
+	return HAL_RCC_GetPCLK1Freq() / 16;
+}
+
+bool fwu_port_set_baud(uint32_t baud){
+	// Oversampling by 16: BRR holds USARTDIV in sixteenths, PCLK1 / baud
+	uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+	uint32_t brr = (pclk + baud / 2) / baud;
+	if(brr < 16 || brr > 0xFFFF){
+		return false;
+	}
+	uint32_t actual = pclk / brr;
+	uint32_t error = actual > baud ? actual - baud : baud - actual;
+	if(error > baud / 50){
+		return false;
+	}
+
+	while(!__HAL_UART_GET_FLAG(&huart2, UART_FLAG_TC)){
+	}
+	CLEAR_BIT(USART2->CR1, USART_CR1_UE);
+	USART2->BRR = brr;
+	SET_BIT(USART2->CR1, USART_CR1_UE);
+	huart2.Init.BaudRate = baud;
+	return true;
+}
+
+uint32_t fwu_port_millis(void){
+	uint32_t now = DWT->CYCCNT;
+	totalCycles += now - lastCycles;
+	lastCycles = now;
+	return (uint32_t)(totalCycles / (SystemCoreClock / 1000));
+}
+
+uint32_t fwu_port_crc(const uint8_t* data, size_t length){
+	__HAL_RCC_CRC_CLK_ENABLE();
+	CRC->CR = CRC_CR_RESET;
+	size_t words = length / 4;
+	for(size_t i = 0; i < words; i++){
+		uint32_t word;
+		memcpy(&word, &data[i * 4], 4);
+		CRC->DR = word;
+	}
+	size_t tail = length & 3;
+	if(tail > 0){
+		uint32_t word = 0;
+		memcpy(&word, &data[words * 4], tail);
+		CRC->DR = word;
+	}
+	return CRC->DR;
+}
+
+// STM32F411: sectors 0-3 are 16K, 4 is 64K, 5-7 are 128K
+static uint32_t sector_of(uint32_t address){
+	uint32_t offset = address - FLASH_BASE;
+	if(offset < 0x10000){
+		return offset / 0x4000;
+	}
+	if(offset < 0x20000){
+		return 4;
+	}
+	return 5 + (offset - 0x20000) / 0x20000;
+}
+
+bool fwu_port_erase(uint32_t address, uint32_t length){
+	FLASH_EraseInitTypeDef erase = {0};
+	erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+	erase.Sector = sector_of(address);
+	erase.NbSectors = sector_of(address + length - 1) - erase.Sector + 1;
+	erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+
+	uint32_t failedSector;
+	HAL_FLASH_Unlock();
+	bool ok = HAL_FLASHEx_Erase(&erase, &failedSector) == HAL_OK;
+	HAL_FLASH_Lock();
+	return ok;
+}
+
+bool fwu_port_program(uint32_t address, const uint32_t* words, size_t count){
+	bool ok = true;
+	HAL_FLASH_Unlock();
+	for(size_t i = 0; i < count && ok; i++){
+		ok = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address + i * 4, words[i]) == HAL_OK;
+	}
+	HAL_FLASH_Lock();
+	return ok;
+}
+
+uint8_t fwu_port_verify(uint32_t address, uint32_t slotSize){
+	// The data cache may still hold words read before they were programmed
+	__HAL_FLASH_DATA_CACHE_DISABLE();
+	__HAL_FLASH_DATA_CACHE_RESET();
+	__HAL_FLASH_DATA_CACHE_ENABLE();
+	return (uint8_t)image_verify(address, slotSize).status;
+}
+
+bool fwu_port_activate(uint32_t address){
+	for(int slot = 0; slot < BOOT_SLOT_COUNT; slot++){
+		if(boot_slots[slot].address == address){
+			return boot_activate(slot);
+		}
+	}
+	return false;
+}
+
+void fwu_port_reset(void){
+	NVIC_SystemReset();
+}
@@ -0,0 +1,126 @@
+/*
+ * image_check.c
+ *
+ * The CRC unit is fed by DMA2 in memory-to-memory mode straight from flash,
+ * about 1 ms per 100 KB, so a full check adds little to the boot time.
+ */
+
+#include "image_check.h"
+#include "main.h"
+#include <stdbool.h>
+
+#define RAM_START 0x20000000
+#define RAM_END   0x20020000
+#define DMA_MAX_WORDS 0xFFFF // NDTR is 16 bits
+
+static DMA_HandleTypeDef hdma_crc;
+
+static void crc_dma_init(void){
+	__HAL_RCC_CRC_CLK_ENABLE();
+	__HAL_RCC_DMA2_CLK_ENABLE(); // only DMA2 can do memory-to-memory
+
+	// In memory-to-memory mode the "peripheral" side is the source
+	hdma_crc.Instance = DMA2_Stream0;
+	hdma_crc.Init.Channel = DMA_CHANNEL_0;
+	hdma_crc.Init.Direction = DMA_MEMORY_TO_MEMORY;
+	hdma_crc.Init.PeriphInc = DMA_PINC_ENABLE;
+	hdma_crc.Init.MemInc = DMA_MINC_DISABLE; // every word goes to CRC->DR
+	hdma_crc.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+	hdma_crc.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+	hdma_crc.Init.Mode = DMA_NORMAL;
+	hdma_crc.Init.Priority = DMA_PRIORITY_HIGH;
+	hdma_crc.Init.FIFOMode = DMA_FIFOMODE_ENABLE; // direct mode is not allowed memory-to-memory
+	hdma_crc.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+	hdma_crc.Init.MemBurst = DMA_MBURST_SINGLE;
+	hdma_crc.Init.PeriphBurst = DMA_PBURST_SINGLE;
+	HAL_DMA_Init(&hdma_crc);
+}
+
+static bool crc_dma_feed(uint32_t address, uint32_t words){
+	while(words > 0){
+		uint32_t chunk = words > DMA_MAX_WORDS ? DMA_MAX_WORDS : words;
+		if(HAL_DMA_Start(&hdma_crc, address, (uint32_t)&CRC->DR, chunk) != HAL_OK ||
+		   HAL_DMA_PollForTransfer(&hdma_crc, HAL_DMA_FULL_TRANSFER, 100) != HAL_OK){
+			return false;
+		}
+		address += chunk * 4;
+		words -= chunk;
+	}
+	return true;
+}
+
+static bool image_crc(uint32_t address, uint32_t length, uint32_t* crc){
+	crc_dma_init();
+	CRC->CR = CRC_CR_RESET;
+
+	// Everything but the header, whose crc field can't cover itself
+	uint32_t headerEnd = IMAGE_HEADER_OFFSET + sizeof(ImageHeader);
+	bool ok = crc_dma_feed(address, IMAGE_HEADER_OFFSET / 4) &&
+	          crc_dma_feed(address + headerEnd, (length - headerEnd) / 4);
+
+	*crc = CRC->DR;
+	HAL_DMA_DeInit(&hdma_crc);
+	__HAL_RCC_DMA2_CLK_DISABLE();
+	__HAL_RCC_CRC_CLK_DISABLE();
+	return ok;
+}
+
+static uint32_t cycles_to_us(uint32_t cycles){
+	return (uint32_t)((uint64_t)cycles * 1000000 / SystemCoreClock);
+}
+
+ImageCheck image_verify(uint32_t address, uint32_t slotSize){
+	const ImageHeader* header = (const ImageHeader*)(address + IMAGE_HEADER_OFFSET);
+	const uint32_t* vectors = (const uint32_t*)address;
+	ImageCheck result = {IMAGE_OK, 0, 0, 0};
+
+	if(header->magic != IMAGE_MAGIC){
+		result.status = IMAGE_NO_HEADER;
+		return result;
+	}
+	result.version = header->version;
+	result.length = header->length;
+
+	if(header->length < IMAGE_HEADER_OFFSET + sizeof(ImageHeader) ||
+	   header->length > slotSize || (header->length & 3) != 0){
+		result.status = IMAGE_BAD_LENGTH;
+		return result;
+	}
+	// A full descending stack may start at the very end of RAM
+	if(vectors[0] <= RAM_START || vectors[0] > RAM_END || (vectors[0] & 3) != 0){
+		result.status = IMAGE_BAD_STACK;
+		return result;
+	}
+	// Thumb code: bit 0 set, address inside the image
+	uint32_t entry = header->entry & ~1u;
+	if(header->entry != vectors[1] || (header->entry & 1) == 0 ||
+	   entry < address + IMAGE_HEADER_OFFSET + sizeof(ImageHeader) || entry >= address + header->length){
+		result.status = IMAGE_BAD_ENTRY;
+		return result;
+	}
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	uint32_t start = DWT->CYCCNT;
+
+	uint32_t crc;
+	bool ok = image_crc(address, header->length, &crc);
+
+	result.crcTimeUs = cycles_to_us(DWT->CYCCNT - start);
+	if(!ok || crc != header->crc){
+		result.status = IMAGE_BAD_CRC;
+	}
+	return result;
+}
+
+const char* image_status_name(ImageStatus status){
+	switch(status){
+		case IMAGE_OK:         return "ok";
+		case IMAGE_NO_HEADER:  return "no image header";
+		case IMAGE_BAD_LENGTH: return "bad length";
+		case IMAGE_BAD_STACK:  return "bad stack pointer";
+		case IMAGE_BAD_ENTRY:  return "bad entry point";
+		case IMAGE_BAD_CRC:    return "CRC mismatch";
+	}
+	return "unknown";
+}
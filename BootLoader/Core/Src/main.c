@@ -24,6 +24,10 @@
 /* USER CODE BEGIN Includes */
 #include "stdbool.h"
 #include "stdio.h"
+#include "image_check.h"
+#include "fw_update.h"
+#include "boot_slots.h"
+#include "boot_timing.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -35,19 +39,17 @@ typedef void(*func_ptr)(void);
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
 #define SECTOR0_BASE_ADDRESS 0x08000000/* BootLoader Sector*/
-#define SECTOR1_BASE_ADDRESS 0x08004000/* Default Application Sector*/
-#define SECTOR2_BASE_ADDRESS 0x08008000/* Factory Application Sector*/
-#define SECTOR3_BASE_ADDRESS 0x0800C000/* EXPAND Application Sector*/
 
 #define BOOTLOADER_APP_ADDRESS SECTOR0_BASE_ADDRESS
-#define DEFAULT_APP_ADDRESS    SECTOR1_BASE_ADDRESS
-#define FACTORY_APP_ADDRESS    SECTOR2_BASE_ADDRESS
-#define EXPAND_APP_ADDRESS    SECTOR3_BASE_ADDRESS
-
-#define MSP_VERIFY_MASK 0x2FFE0000 /* main stack pointer mask */
+/* Application slots A (sectors 1-4) and B (sector 5): see boot_control.h */
+/* Sectors 6/7 hold the app config */
 
 #define BUTTON_USER_Pin GPIO_PIN_1
 #define BUTTON_USER_GPIO_Port GPIOA
+
+/* 1: a normal boot initializes only the button, no console, USB, I2S, I2C or SPI
+   0: full init and messages before every boot, for bring-up */
+#define BOOT_FAST 1
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -66,7 +68,7 @@ SPI_HandleTypeDef hspi1;
 UART_HandleTypeDef huart2;
 
 /* USER CODE BEGIN PV */
-unsigned char g_key;
+
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -87,7 +89,9 @@ void MX_USB_HOST_Process(void);
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
 static bool get_button_state(void);
+static bool boot_app(int slot);
 static void jump_to_app(uint32_t address);
+static void run_btldr_menu(void);
 static void process_btldr_cmds(char key);
 /* USER CODE END 0 */
 
@@ -99,7 +103,7 @@ int main(void)
 {
 
   /* USER CODE BEGIN 1 */
-
+  boot_timing_start(SystemCoreClock);
   /* USER CODE END 1 */
 
   /* MCU Configuration--------------------------------------------------------*/
@@ -118,7 +122,21 @@ int main(void)
   PeriphCommonClock_Config();
 
   /* USER CODE BEGIN SysInit */
-
+  boot_timing_clock(SystemCoreClock);
+#if BOOT_FAST
+  /* Straight to the newest valid image. Only when there is none does the
+     full init below run, for the messages and the menu. */
+  MX_GPIO_Init();
+  if(!get_button_state()){
+	  boot_timing_mark(BOOT_PHASE_LOADER_INIT, SystemCoreClock);
+	  int slot = boot_select();
+	  if(slot >= 0){
+		  boot_timing_flag(BOOT_TIMING_FAST);
+		  boot_timing_mark(BOOT_PHASE_VERIFIED, SystemCoreClock);
+		  jump_to_app(boot_slots[slot].address);
+	  }
+  }
+#endif
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
@@ -130,33 +148,19 @@ int main(void)
   MX_USB_HOST_Init();
   MX_USART2_UART_Init();
   /* USER CODE BEGIN 2 */
+  boot_timing_mark(BOOT_PHASE_LOADER_INIT, SystemCoreClock);
   if(get_button_state()){
 		//button is pressed
 		printf("DBG: button is pressed");
-
-		printf("===========================\n");
-		printf("===========================\n");
-		printf("===========================\n");
-		printf("===========================\n");
-
-		printf("===========================\n");
-		printf("\n");
-		printf("BootLoader Menu\n");
-		printf("\n");
-		printf("===========================\n");
-		printf("===========================\n");
-		printf("===========================\n");
-
-		printf("Available commands: \n");
-		printf("f ==> Factory App");
-		printf("Any Key ==> run Default App");
-
-		while(1){
-			process_btldr_cmds(g_key);
-		}
+		run_btldr_menu();
   }else {
-	  //button isn't pressed
-	  jump_to_app(DEFAULT_APP_ADDRESS);
+	  //button isn't pressed, boot the newest image; an unconfirmed one rolls back to the other slot
+	  int slot = boot_select();
+	  if(slot >= 0){
+		  boot_app(slot);
+	  }
+	  printf("No valid application, staying in bootloader\n");
+	  run_btldr_menu();
   }
   /* USER CODE END 2 */
 
@@ -503,46 +507,113 @@ bool get_button_state(void){
 	return HAL_GPIO_ReadPin(BUTTON_USER_GPIO_Port, BUTTON_USER_Pin) == GPIO_PIN_RESET;//pin config: pull up
 }
 
+bool boot_app(int slot){
+	const BootSlot* app = &boot_slots[slot];
+	ImageCheck check = image_verify(app->address, app->imageSize);
+	if(check.status != IMAGE_OK){
+		printf("Slot %s App invalid: %s\n", app->name, image_status_name(check.status));
+		return false;
+	}
+	printf("Slot %s App v%lu.%lu.%lu, %lu bytes, CRC checked in %lu us\n", app->name,
+	       check.version >> 16, (check.version >> 8) & 0xFF, check.version & 0xFF,
+	       check.length, check.crcTimeUs);
+	boot_timing_mark(BOOT_PHASE_VERIFIED, SystemCoreClock);
+	jump_to_app(app->address);
+	return false;
+}
+
 void jump_to_app(uint32_t address){
-	uint32_t app_start_address;
-	func_ptr jump_to_app_ptr;
-
-	printf("Boot loader started \n");
-	HAL_Delay(300);
-
-    if(((*(uint32_t*)address & MSP_VERIFY_MASK) == 0x20020000) && (*(uint32_t*)address != 0xFFFFFFFF))
-	{
-	    printf("Starting Application\n");
-	    app_start_address = *(uint32_t*) (address + 4);
-	    jump_to_app_ptr = (func_ptr)(app_start_address);
-
-	    /* initialize main stack pointer */
-	    __set_MSP(*(uint32_t*)address);
-
-	    /* jump */
-	    jump_to_app_ptr();
-    }else {
-    	printf("No Application Found!!!\n");
-    }
+	func_ptr jump_to_app_ptr = (func_ptr)(*(uint32_t*)(address + 4));
+
+	boot_timing_mark(BOOT_PHASE_JUMP, SystemCoreClock);
+
+	/* hand over in the reset state: HSI clock with the PLL and HSE off, so the
+	   application's SystemClock_Config starts from what it expects */
+	HAL_RCC_DeInit();
+	boot_timing_clock(SystemCoreClock);
+
+	/* leave no timer or interrupt running into the application */
+	__disable_irq();
+	SysTick->CTRL = 0;
+	SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+	HAL_DeInit();
+	for(uint32_t i = 0; i < sizeof(NVIC->ICER) / sizeof(NVIC->ICER[0]); i++){
+		NVIC->ICER[i] = 0xFFFFFFFF;
+		NVIC->ICPR[i] = 0xFFFFFFFF;
+	}
+
+	/* a fault before the application's SystemInit already uses its table */
+	SCB->VTOR = address;
+	__DSB();
+	__ISB();
+
+	/* initialize main stack pointer */
+	__set_MSP(*(uint32_t*)address);
+	__enable_irq();
+
+	/* jump */
+	jump_to_app_ptr();
+}
+
+void run_btldr_menu(void){
+	boot_timing_stop(); /* time at the menu is not boot time */
+	printf("===========================\n");
+	printf("===========================\n");
+	printf("===========================\n");
+	printf("===========================\n");
+
+	printf("===========================\n");
+	printf("\n");
+	printf("BootLoader Menu\n");
+	printf("\n");
+	printf("===========================\n");
+	printf("===========================\n");
+	printf("===========================\n");
+
+	boot_print_slots();
+	printf("Available commands: \n");
+	printf("a ==> Slot A App\n");
+	printf("b ==> Slot B App\n");
+	printf("u ==> Firmware update into slot %s (Tools/fw_upload.py)\n", boot_slots[boot_update_slot()].name);
+	printf("Any Key ==> normal boot\n");
+
+	while(1){
+		uint8_t key;
+		if(HAL_UART_Receive(&huart2, &key, 1, 10) == HAL_OK){
+			/* returns only when the selected image is invalid or the update ends */
+			process_btldr_cmds((char)key);
+		}
+		MX_USB_HOST_Process();
+	}
 }
 
 void process_btldr_cmds(char key){
 	switch(key){
-		case 'f':
-			printf("Factory App selected\n");
-			jump_to_app(FACTORY_APP_ADDRESS);
+		case 'a':
+		case 'b':
+			/* as selected, no trial accounting */
+			boot_app(key - 'a');
 			break;
-		case 'E':
-			printf("Expand App selected\n");
-			jump_to_app(EXPAND_APP_ADDRESS);
+		case 'u': {
+			int slot = boot_update_slot();
+			printf("Firmware update into slot %s, waiting for the host\n", boot_slots[slot].name);
+			fw_update_run(boot_slots[slot].address, boot_slots[slot].imageSize);
+			printf("Firmware update timed out\n");
 			break;
-		default :
-			jump_to_app(DEFAULT_APP_ADDRESS);
+		}
+		default : {
+			int slot = boot_select();
+			if(slot >= 0){
+				boot_app(slot);
+			}
+		}
 	}
 }
 
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart){
-	HAL_UART_Receive_IT(huart, &g_key, 1);
+int __io_putchar(int ch){
+	uint8_t c = (uint8_t)ch;
+	HAL_UART_Transmit(&huart2, &c, 1, 10);
+	return ch;
 }
 
 
@@ -3,6 +3,7 @@
 
 #include<vector>
 #include<string>
+#include "high_res_clock.hpp"
 enum class SensorType {
 	TEMPERATURE,
 	HUMIDITY,
@@ -27,34 +28,28 @@ enum class SystemState{
 
 struct SensorData {
 	SensorType type;
-	uint32_t timestamp;
+	uint64_t timestamp; // microseconds since boot, from HighResClock::nowUs()
 	float value;
 	uint8_t sensorId;
 	bool isValid;
 
 	SensorData():type(SensorType::TEMPERATURE), timestamp(0), value(0.0), sensorId(0), isValid(false){}
-    SensorData(SensorType t, uint32_t ts, float v, uint8_t id)
+    SensorData(SensorType t, uint64_t ts, float v, uint8_t id)
         : type(t), timestamp(ts), value(v), sensorId(id), isValid(true) {}
+    // Catches a stamp passed as uint32_t only; narrower arithmetic such as
+    // HAL_GetTick() * 1000 still converts, so producers stamp with nowUs()
+    SensorData(SensorType t, uint32_t ts, float v, uint8_t id) = delete;
 };
 
 struct LogMessage{
 	LogLevel level;
-	uint32_t timestamp;
+	uint64_t timestamp; // microseconds since boot
 	std::string message;
 	std::string module;
 
     LogMessage() : level(LogLevel::info), timestamp(0) {}
     LogMessage(LogLevel l, const std::string& msg, const std::string& mod)
-        : level(l), timestamp(HAL_GetTick()), message(msg), module(mod) {}
-};
-
-struct CLICommand{
-	std::string command;
-	std::vector<std::string> parameters;
-	uint32_t timestamp;
-
-	CLICommand() : timestamp(0) {}
-	CLICommand(const std::string& cmd) : command(cmd), timestamp(HAL_GetTick()) {}
+        : level(l), timestamp(HighResClock::nowUs()), message(msg), module(mod) {}
 };
 
 struct SystemStatus{
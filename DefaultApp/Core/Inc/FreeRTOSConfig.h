@@ -51,6 +51,15 @@
 #if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
   #include <stdint.h>
   extern uint32_t SystemCoreClock;
+/* USER CODE BEGIN 0 */
+  extern void configureTimerForRunTimeStats(void);
+  extern unsigned long getRunTimeCounterValue(void);
+  extern void heapTraceMalloc(void *pvAddress, size_t uiSize);
+  extern void heapTraceFree(void *pvAddress, size_t uiSize);
+  extern void traceRecord(uint8_t event, uint8_t task, uint16_t arg);
+  extern void traceRecordIsr(uint8_t event);
+  extern unsigned long traceQueueCreated(void *queue);
+/* USER CODE END 0 */
 #endif
 #define configENABLE_FPU                         0
 #define configENABLE_MPU                         0
@@ -60,11 +69,15 @@
 #define configSUPPORT_DYNAMIC_ALLOCATION         1
 #define configUSE_IDLE_HOOK                      0
 #define configUSE_TICK_HOOK                      0
+#define configUSE_MALLOC_FAILED_HOOK             1
+#define configGENERATE_RUN_TIME_STATS            1
+#define configUSE_TRACE_FACILITY                 1
+#define configCHECK_FOR_STACK_OVERFLOW           2
 #define configCPU_CLOCK_HZ                       ( SystemCoreClock )
 #define configTICK_RATE_HZ                       ((TickType_t)1000)
 #define configMAX_PRIORITIES                     ( 7 )
 #define configMINIMAL_STACK_SIZE                 ((uint16_t)128)
-#define configTOTAL_HEAP_SIZE                    ((size_t)15360)
+#define configTOTAL_HEAP_SIZE                    ((size_t)30720)
 #define configMAX_TASK_NAME_LEN                  ( 16 )
 #define configUSE_16_BIT_TICKS                   0
 #define configUSE_MUTEXES                        1
@@ -80,6 +93,12 @@
 #define configUSE_CO_ROUTINES                    0
 #define configMAX_CO_ROUTINE_PRIORITIES          ( 2 )
 
+/* Software timer definitions. */
+#define configUSE_TIMERS                         1
+#define configTIMER_TASK_PRIORITY                ( 5 )
+#define configTIMER_QUEUE_LENGTH                 10
+#define configTIMER_TASK_STACK_DEPTH             512
+
 /* The following flag must be enabled only when using newlib */
 #define configUSE_NEWLIB_REENTRANT          1
 
@@ -93,6 +112,9 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelayUntil              0
 #define INCLUDE_vTaskDelay                   1
 #define INCLUDE_xTaskGetSchedulerState       1
+#define INCLUDE_xTaskGetIdleTaskHandle       1
+#define INCLUDE_xTimerGetTimerDaemonTaskHandle 1
+#define INCLUDE_uxTaskGetStackHighWaterMark  1
 
 /* Cortex-M specific definitions. */
 #ifdef __NVIC_PRIO_BITS
@@ -135,8 +157,36 @@ standard names. */
 
 #define xPortSysTickHandler SysTick_Handler
 
+/* USER CODE BEGIN 2 */
+/* Definitions needed when configGENERATE_RUN_TIME_STATS is on */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS configureTimerForRunTimeStats
+#define portGET_RUN_TIME_COUNTER_VALUE getRunTimeCounterValue
+/* USER CODE END 2 */
+
 /* USER CODE BEGIN Defines */
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+/* heap_4 accounting, see heap_stats.hpp */
+#define traceMALLOC(pvAddress, uiSize) heapTraceMalloc(pvAddress, uiSize)
+#define traceFREE(pvAddress, uiSize) heapTraceFree(pvAddress, uiSize)
+
+/* Event trace recorder, see trace_recorder.hpp; codes match TraceEvent */
+#define TRACE_RECORDER_ENABLED 1
+#if TRACE_RECORDER_ENABLED
+#define traceTASK_SWITCHED_IN() traceRecord(1, (uint8_t)pxCurrentTCB->uxTCBNumber, 0)
+#define traceTASK_SWITCHED_OUT() traceRecord(2, (uint8_t)pxCurrentTCB->uxTCBNumber, 0)
+#define traceQUEUE_CREATE(pxNewQueue) ((pxNewQueue)->uxQueueNumber = traceQueueCreated(pxNewQueue))
+#define traceQUEUE_SEND(pxQueue) traceRecord(3, 0, (uint16_t)(pxQueue)->uxQueueNumber)
+#define traceQUEUE_SEND_FAILED(pxQueue) traceRecord(4, 0, (uint16_t)(pxQueue)->uxQueueNumber)
+#define traceQUEUE_RECEIVE(pxQueue) traceRecord(5, 0, (uint16_t)(pxQueue)->uxQueueNumber)
+#define traceQUEUE_RECEIVE_FAILED(pxQueue) traceRecord(6, 0, (uint16_t)(pxQueue)->uxQueueNumber)
+#define traceQUEUE_SEND_FROM_ISR(pxQueue) traceRecord(7, 0, (uint16_t)(pxQueue)->uxQueueNumber)
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue) traceRecord(8, 0, (uint16_t)(pxQueue)->uxQueueNumber)
+#define TRACE_ISR_ENTER() traceRecordIsr(9)
+#define TRACE_ISR_EXIT() traceRecordIsr(10)
+#else
+#define TRACE_ISR_ENTER()
+#define TRACE_ISR_EXIT()
+#endif
 /* USER CODE END Defines */
 
 #endif /* FREERTOS_CONFIG_H */
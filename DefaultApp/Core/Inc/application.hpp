@@ -8,16 +8,23 @@
 #include "system_monitor.hpp"
 #include "config_manager.hpp"
 #include "data_buffer.hpp"
+#include "binary_protocol.hpp"
+#include "sensor_streamer.hpp"
+#include "uart_tx_service.hpp"
 
 class Application {
 private:
     // Core components
+    std::unique_ptr<UartTxService> cliTx;
+    std::unique_ptr<UartTxService> logTx;
     std::unique_ptr<SystemLogger> logger;
     std::unique_ptr<SensorManager> sensorManager;
     std::unique_ptr<CLIManager> cliManager;
     std::unique_ptr<SystemMonitor> systemMonitor;
     std::unique_ptr<ConfigManager> configManager;
     std::unique_ptr<DataStorage> dataStorage;
+    std::unique_ptr<BinaryProtocol> binaryProtocol;
+    std::unique_ptr<SensorStreamer> sensorStreamer;
 
     // Hardware handles
     SPI_HandleTypeDef* hspi;
@@ -42,16 +49,22 @@ public:
     void stop();
 
     // Interrupt handlers
-    void handleUARTInterrupt(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size);
+    void handleUARTRxEvent(UART_HandleTypeDef* huart, uint16_t position);
+    void handleUARTTxComplete(UART_HandleTypeDef* huart);
+    void handleUARTError(UART_HandleTypeDef* huart);
     void handleSPIInterrupt(SPI_HandleTypeDef* hspi);
 
     // Getters for components
+    UartTxService* getCLITx() const { return cliTx.get(); }
+    UartTxService* getLogTx() const { return logTx.get(); }
     SystemLogger* getLogger() const { return logger.get(); }
     SensorManager* getSensorManager() const { return sensorManager.get(); }
     CLIManager* getCLIManager() const { return cliManager.get(); }
     SystemMonitor* getSystemMonitor() const { return systemMonitor.get(); }
     ConfigManager* getConfigManager() const { return configManager.get(); }
     DataStorage* getDataStorage() const { return dataStorage.get(); }
+    BinaryProtocol* getBinaryProtocol() const { return binaryProtocol.get(); }
+    SensorStreamer* getSensorStreamer() const { return sensorStreamer.get(); }
 };
 
 
@@ -0,0 +1,268 @@
+#ifndef INC_BINARY_PROTOCOL_HPP_
+#define INC_BINARY_PROTOCOL_HPP_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "cmsis_os.h"
+#ifdef __cplusplus
+}
+#endif
+
+#include<stdint.h>
+#include<stddef.h>
+#include "DataStructure.hpp"
+#include "cobs.hpp"
+#include "common_variables.hpp"
+#include "firmware_update.hpp"
+
+class CLIManager;
+class SensorManager;
+class ConfigManager;
+class DataStorage;
+
+// Binary protocol multiplexed with the text CLI on the same UART.
+//
+// Wire format: 0x00 <COBS(frame)> 0x00, where frame is
+//   [type:1][sequence:1][payload:0..PROTOCOL_MAX_PAYLOAD][crc32:4, little-endian]
+// and the CRC (see HwCrc) covers type, sequence and payload. The leading
+// 0x00 switches the CLI input from text to frame mode, the trailing one ends
+// the frame; text never contains 0x00. Responses echo the request sequence
+// number, pushes carry their own counter so the host can detect gaps.
+// All multi-byte fields are little-endian.
+enum class MessageType : uint8_t {
+    // Requests (host -> device)
+    PING = 0x01,
+    GET_STATUS = 0x02,
+    GET_SENSORS = 0x03,
+    GET_HISTORY = 0x04,
+    GET_CONFIG = 0x05,
+    SET_CONFIG = 0x06,
+    GET_METRICS = 0x07,
+    GET_BOOT = 0x08,
+    UPDATE_BEGIN = 0x09,
+    UPDATE_DATA = 0x0A,
+    UPDATE_END = 0x0B,
+
+    // Responses (device -> host)
+    PONG = 0x81,
+    STATUS = 0x82,
+    SENSOR_SAMPLES = 0x83,
+    HISTORY = 0x84,
+    CONFIG = 0x85,
+    METRICS = 0x86,
+    BOOT_STATE = 0x87,
+    UPDATE_STATUS = 0x88,
+
+    // Unsolicited (device -> host)
+    SENSOR_PUSH = 0xC0,
+
+    NACK = 0xFF
+};
+
+enum class NackReason : uint8_t {
+    BAD_CRC = 1,
+    UNKNOWN_TYPE = 2,
+    BAD_LENGTH = 3,
+    BAD_VALUE = 4,
+    BUSY = 5
+};
+
+// The CONFIG_SCHEMA tags of the numeric settings
+enum class ConfigKey : uint8_t {
+    SENSOR_READ_INTERVAL = 1,
+    LOG_LEVEL = 2,
+    WATCHDOG_TIMEOUT = 3,
+    MAX_SENSORS = 4,
+    AUTO_START = 5
+};
+
+#pragma pack(push, 1)
+struct WireSample {
+    uint8_t sensorId;
+    uint8_t type;       // SensorType
+    uint8_t flags;      // bit 0: valid
+    uint8_t reserved;
+    uint64_t timestamp; // microseconds since boot
+    float value;
+};
+
+struct WireStatus {
+    uint8_t state;      // SystemState
+    uint8_t cpuUsage;   // percent
+    uint16_t reserved;
+    uint32_t upTime;    // ms
+    uint32_t freeHeap;
+    uint32_t totalSensors;
+    uint32_t activeSensors;
+    uint32_t errorCount;
+    uint32_t rxBytes;
+    uint32_t rxDropped;
+    uint32_t rxOverruns;
+    uint32_t framesReceived;
+    uint32_t frameErrors;
+};
+
+// GET_HISTORY payload; the reply is one or more HISTORY frames, each a
+// WireHistoryHeader followed by up to HISTORY_SAMPLES_PER_FRAME samples.
+// Every stored sample has a sequence number; an interrupted export resumes
+// by asking again from the last nextSequence received.
+struct WireHistoryRequest {
+    uint32_t fromSequence; // older than the oldest stored = start at the oldest
+    uint32_t maxEntries;   // 0 = everything stored
+    uint8_t sensorId;      // DataStorage::ALL_SENSORS = every sensor
+};
+
+struct WireHistoryHeader {
+    uint32_t firstSequence; // first sample looked at for this block
+    uint32_t nextSequence;  // resume point after this block
+    uint8_t flags;          // HISTORY_FLAG_LAST on the final block
+};
+
+static const uint8_t HISTORY_FLAG_LAST = 0x01;
+
+struct WireConfig {
+    uint32_t sensorReadInterval;
+    uint32_t logLevel;
+    uint32_t watchdogTimeout;
+    uint32_t maxSensors;
+    uint8_t autoStart;
+    char deviceName[16]; // NUL-padded
+};
+
+struct WireConfigSet {
+    uint8_t key;         // ConfigKey
+    uint32_t value;
+};
+
+// GET_METRICS payload; the reply is one or more METRICS frames, each a
+// WireMetricsHeader followed by Metrics::encode records. A host describes
+// once for names and bounds, then polls values; records are in
+// registration order, so the index matches.
+struct WireMetricsRequest {
+    uint8_t firstIndex;
+    uint8_t flags;       // METRICS_FLAG_DESCRIBE
+};
+
+struct WireMetricsHeader {
+    uint8_t firstIndex;
+    uint8_t count;       // records in this frame
+    uint8_t total;       // metrics registered
+    uint8_t flags;       // METRICS_FLAG_DESCRIBE as requested, METRICS_FLAG_LAST on the final frame
+};
+
+static const uint8_t METRICS_FLAG_DESCRIBE = 0x01;
+static const uint8_t METRICS_FLAG_LAST = 0x80;
+
+// BOOT_STATE payload, see FirmwareUpdate
+struct WireSlotState {
+    uint32_t version;    // 0 without an image header
+    uint32_t sequence;   // 0 without a valid sequence
+    uint8_t flags;       // SLOT_FLAG_*
+    uint8_t attempts;    // trial boots used
+    uint16_t reserved;
+};
+
+struct WireBootState {
+    uint8_t runningSlot; // 0 = A, 1 = B
+    uint8_t updateState; // UpdateState
+    uint16_t reserved;
+    uint32_t nextOffset; // update bytes received
+    WireSlotState slots[BOOT_SLOT_COUNT];
+};
+
+static const uint8_t SLOT_FLAG_IMAGE = 0x01;
+static const uint8_t SLOT_FLAG_SEQUENCED = 0x02;
+static const uint8_t SLOT_FLAG_CONFIRMED = 0x04;
+static const uint8_t SLOT_FLAG_REJECTED = 0x08;
+
+// Update into the slot not running: UPDATE_BEGIN with the u32 image length
+// erases it, UPDATE_DATA carries [offset:4][data, multiple of 4], in order,
+// UPDATE_END with WireUpdateEnd checks the image and makes it the next to
+// boot. Each is answered by UPDATE_STATUS; after BAD_OFFSET the host
+// resumes from nextOffset.
+struct WireUpdateEnd {
+    uint8_t flags;       // UPDATE_FLAG_REBOOT: reset once the status is sent
+};
+
+struct WireUpdateStatus {
+    uint8_t result;      // UpdateResult
+    uint8_t slot;        // being written
+    uint16_t reserved;
+    uint32_t nextOffset;
+};
+
+static const uint8_t UPDATE_FLAG_REBOOT = 0x01;
+#pragma pack(pop)
+
+static_assert(sizeof(WireSample) == 16, "WireSample layout is part of the protocol");
+
+struct ProtocolStats {
+    uint32_t framesReceived;
+    uint32_t framesSent;
+    uint32_t crcErrors;
+    uint32_t malformedFrames; // bad COBS, too short or too long
+
+    ProtocolStats() : framesReceived(0), framesSent(0), crcErrors(0), malformedFrames(0) {}
+};
+
+class BinaryProtocol {
+public:
+    static const size_t HEADER_SIZE = 2;
+    static const size_t CRC_SIZE = 4;
+    static const size_t MAX_FRAME_SIZE = HEADER_SIZE + PROTOCOL_MAX_PAYLOAD + CRC_SIZE;
+    static_assert(MAX_FRAME_SIZE == PROTOCOL_MAX_FRAME_SIZE, "CLI command queue sized for another frame layout");
+    static const size_t MAX_ENCODED_SIZE = Cobs::maxEncodedSize(MAX_FRAME_SIZE);
+    static const size_t SAMPLES_PER_FRAME = PROTOCOL_MAX_PAYLOAD / sizeof(WireSample);
+    static const size_t HISTORY_SAMPLES_PER_FRAME = (PROTOCOL_MAX_PAYLOAD - sizeof(WireHistoryHeader)) / sizeof(WireSample);
+
+private:
+    CLIManager* cliManager;
+    SensorManager* sensorManager;
+    ConfigManager* configManager;
+    DataStorage* dataStorage;
+
+    // Frames are built in these buffers under frameMutex, so responses from
+    // the CLI command task and pushes from other tasks do not interleave
+    osSemaphoreId frameMutex;
+    uint8_t txFrame[MAX_FRAME_SIZE];
+    uint8_t txEncoded[MAX_ENCODED_SIZE + 2];
+    uint8_t pushSequence;
+    ProtocolStats stats;
+
+    void sendNack(uint8_t sequence, NackReason reason);
+    void sendStatus(uint8_t sequence);
+    void sendSensors(uint8_t sequence);
+    void handleHistoryRequest(uint8_t sequence, const uint8_t* payload, size_t length);
+    void sendConfig(uint8_t sequence);
+    void setConfig(uint8_t sequence, const uint8_t* payload, size_t length);
+    void handleMetricsRequest(uint8_t sequence, const uint8_t* payload, size_t length);
+    void sendBootState(uint8_t sequence);
+    void handleUpdate(MessageType type, uint8_t sequence, const uint8_t* payload, size_t length);
+
+public:
+    BinaryProtocol(CLIManager* cli, SensorManager* sensorMgr, ConfigManager* configMgr, DataStorage* storage);
+    ~BinaryProtocol();
+
+    // One frame with COBS and delimiters removed, decoded by the CLI input
+    // task and run on the CLI command task
+    void handleFrame(const uint8_t* frame, size_t frameLength);
+
+    bool sendFrame(MessageType type, uint8_t sequence, const void* payload, size_t length);
+
+    // HISTORY blocks straight from DataStorage; returns the resume sequence
+    uint32_t sendHistory(uint8_t sequence, const WireHistoryRequest& request);
+
+    // METRICS frames from the registry
+    void sendMetrics(uint8_t sequence, const WireMetricsRequest& request);
+
+    // Unsolicited samples, at most SAMPLES_PER_FRAME per call; any task
+    bool publishSamples(const SensorData* samples, size_t count);
+
+    static void toWire(const SensorData& data, WireSample& sample);
+
+    const ProtocolStats& getStats() const { return stats; }
+};
+
+
+#endif /* INC_BINARY_PROTOCOL_HPP_ */
@@ -0,0 +1,54 @@
+/*
+ * boot_control.h
+ *
+ * A/B slot layout and boot state, shared by the bootloader and the application.
+ */
+
+#ifndef INC_BOOT_CONTROL_H_
+#define INC_BOOT_CONTROL_H_
+
+#include <stdint.h>
+
+// Two application slots. An image is linked for one of them (the vector
+// table holds absolute addresses), so each release is built twice, once per
+// linker script. The application runs from one slot and writes an update
+// into the other; the bootloader picks the slot on every reset.
+#define BOOT_SLOT_COUNT 2
+#define BOOT_SLOT_A_ADDRESS 0x08004000 // sectors 1-4
+#define BOOT_SLOT_A_SIZE 0x1C000
+#define BOOT_SLOT_B_ADDRESS 0x08020000 // sector 5
+#define BOOT_SLOT_B_SIZE 0x20000
+
+// The last BOOT_TRAILER_SIZE bytes of each slot hold its BootTrailer, the
+// rest is for the image. Both builds are limited to what fits in slot A.
+#define BOOT_TRAILER_SIZE 0x100
+#define BOOT_IMAGE_MAX_SIZE (BOOT_SLOT_A_SIZE - BOOT_TRAILER_SIZE)
+
+#define BOOT_MAX_ATTEMPTS 3 // unconfirmed boots of a new image before rolling back
+#define BOOT_WORD_ERASED 0xFFFFFFFF
+#define BOOT_MARK 0x00000000
+
+// Boot state of one slot. Every field is a flash word written once, from
+// erased to its final value, so each state change is a single word
+// program and power loss leaves either the old or the new state. Erasing
+// the slot for the next image clears it.
+//
+// The updater writes sequence, one higher than the running slot's, once
+// the image is complete and verified; sequenceCheck goes second and is the
+// switch. The bootloader boots the slot with the highest sequence that is
+// not rejected. Until the application sets confirmed, each boot of it uses
+// up one attempts word; with none left the bootloader sets rejected and
+// boots the other slot. A slot without a valid sequence (flashed by a
+// debugger) ranks below any sequenced one and is never on trial.
+typedef struct {
+    uint32_t sequence;
+    uint32_t sequenceCheck; // ~sequence
+    uint32_t confirmed;     // BOOT_MARK once the application ran healthy
+    uint32_t rejected;      // BOOT_MARK once the bootloader gave up on the image
+    uint32_t attempts[BOOT_MAX_ATTEMPTS];
+} BootTrailer;
+
+#define BOOT_TRAILER(slotAddress, slotSize) \
+    ((const volatile BootTrailer*)((slotAddress) + (slotSize) - BOOT_TRAILER_SIZE))
+
+#endif /* INC_BOOT_CONTROL_H_ */
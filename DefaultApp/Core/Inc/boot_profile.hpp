@@ -0,0 +1,43 @@
+#ifndef INC_BOOT_PROFILE_HPP_
+#define INC_BOOT_PROFILE_HPP_
+
+#include<stdint.h>
+#include<stddef.h>
+#include "boot_timing.h"
+#include "metrics.hpp"
+#include "response_writer.hpp"
+
+// Reset to first sample, read from the boot_timing.h record that the
+// bootloader starts and SystemInit continues. The application stamps
+// BOOT_PHASE_APP_INIT and BOOT_PHASE_FIRST_SAMPLE; SystemMonitor logs the
+// result once the first sample is in.
+class BootProfile {
+public:
+    // Registers the boot time gauge
+    static void init();
+
+    // Stamps a phase the first time only, so it can sit on a hot path
+    static void mark(BootPhase phase) {
+        if (!marked(phase)) {
+            stamp(phase);
+        }
+    }
+    static bool marked(BootPhase phase) {
+        return boot_timing_valid() && (BOOT_TIMING->marked & (1u << phase));
+    }
+    static uint32_t phaseUs(BootPhase phase) { return BOOT_TIMING->us[phase]; }
+    static bool fastBoot() { return (BOOT_TIMING->flags & BOOT_TIMING_FAST) != 0; }
+    static const char* phaseName(BootPhase phase);
+
+    // One line for the log, e.g. "Boot to first sample 38.2 ms, bootloader 3.1 ms (fast)"
+    static void summarize(char* buffer, size_t size);
+    static void describe(ResponseWriter& out);
+
+private:
+    static Gauge bootTimeUs;
+
+    static void stamp(BootPhase phase);
+};
+
+
+#endif /* INC_BOOT_PROFILE_HPP_ */
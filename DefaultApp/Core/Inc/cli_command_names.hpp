@@ -0,0 +1,14 @@
+#ifndef INC_CLI_COMMAND_NAMES_HPP_
+#define INC_CLI_COMMAND_NAMES_HPP_
+
+#include<string_view>
+
+// Every command the CLI can dispatch. The dispatch table is a perfect hash
+// over this list computed at compile time; a new command must be added here
+// before it can be registered.
+constexpr std::string_view CLI_COMMAND_NAMES[] = {
+    "help", "status", "reset", "sensors", "stream", "history", "top", "stack", "heap", "latency", "trace", "crash", "metrics", "queues", "config", "boot"
+};
+
+
+#endif /* INC_CLI_COMMAND_NAMES_HPP_ */
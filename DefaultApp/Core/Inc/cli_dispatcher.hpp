@@ -0,0 +1,72 @@
+#ifndef INC_CLI_DISPATCHER_HPP_
+#define INC_CLI_DISPATCHER_HPP_
+
+#include<stdint.h>
+#include<stddef.h>
+#include<string_view>
+#include<memory>
+#include<atomic>
+#include<iterator>
+#include "cli_parser.hpp"
+#include "cli_command_names.hpp"
+#include "response_writer.hpp"
+#include "metrics.hpp"
+
+// Commands write their output as they produce it; the writer flushes it to
+// the UART in CLI_RESPONSE_CHUNK_SIZE pieces
+class ICLICommand {
+public:
+    virtual ~ICLICommand() = default;
+    virtual void execute(const CommandArgs& parameters, ResponseWriter& out) = 0;
+    virtual std::string_view getHelp() const = 0;
+};
+
+// One command line from text to output: tokenized in place, looked up in the
+// perfect hash over CLI_COMMAND_NAMES and run into the caller's
+// ResponseWriter. Nothing here touches the RTOS or the UART, so the host
+// benchmark in Tests runs this same path.
+class CommandDispatcher {
+private:
+    static constexpr PerfectHash<std::size(CLI_COMMAND_NAMES)> commandTable{CLI_COMMAND_NAMES};
+    static_assert(commandTable.valid(), "no perfect hash seed for CLI_COMMAND_NAMES");
+
+    // Registration may run while the command task dispatches, so a slot is
+    // published with a single store. Commands are never replaced or removed,
+    // so the pointer stays valid while the command writes its output.
+    std::unique_ptr<ICLICommand> owned[commandTable.TABLE_SIZE];
+    std::atomic<ICLICommand*> commands[commandTable.TABLE_SIZE];
+    CommandLine commandLine; // dispatching task only
+    Counter commandCount;
+    Histogram commandTime;
+
+public:
+    CommandDispatcher();
+
+    // False when the name is not in CLI_COMMAND_NAMES or already taken
+    bool registerCommand(std::string_view name, std::unique_ptr<ICLICommand> command);
+    // Runs one line and writes the prompt after it; one caller at a time
+    void dispatch(std::string_view line, ResponseWriter& out);
+    void writeHelp(ResponseWriter& out) const;
+
+    Counter& getCommandCount() { return commandCount; }
+    Histogram& getCommandTime() { return commandTime; }
+};
+
+class HelpCommand : public ICLICommand {
+private:
+    const CommandDispatcher* dispatcher;
+
+public:
+    HelpCommand(const CommandDispatcher* commandDispatcher) : dispatcher(commandDispatcher) {}
+
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+        dispatcher->writeHelp(out);
+    }
+
+    std::string_view getHelp() const override {
+        return "help - Show available commands\r\n";
+    }
+};
+
+
+#endif /* INC_CLI_DISPATCHER_HPP_ */
@@ -5,116 +5,142 @@
 extern "C" {
 #endif
 #include "stm32f4xx_hal.h"
+#include "cmsis_os.h"
+#include "stream_buffer.h"
 #ifdef __cplusplus
 }
 #endif
 
 #include<string>
+#include<string_view>
 #include<vector>
 #include<memory>
-#include<map>
+#include<iterator>
 #include "IObserver.hpp"
 #include "sensor_manager.hpp"
+#include "cli_dispatcher.hpp"
+#include "status_command.hpp"
+#include "config_command.hpp"
+#include "response_writer.hpp"
+#include "common_variables.hpp"
+#include "cobs.hpp"
+#include "sensor_streamer.hpp"
+#include "uart_tx_service.hpp"
+#include "uart_stats.hpp"
+#include "data_buffer.hpp"
+#include "monitored_queue.hpp"
+#include "task_stats.hpp"
+#include "stack_monitor.hpp"
+#include "heap_stats.hpp"
+#include "watchdog_supervisor.hpp"
+#include "latency_trace.hpp"
+#include "trace_recorder.hpp"
+#include "crash_dump.hpp"
+#include "metrics.hpp"
+#include "config_manager.hpp"
+#include "firmware_update.hpp"
+#include "boot_profile.hpp"
 
-class ICLICommand {
-public:
-    virtual ~ICLICommand() = default;
-    virtual std::string execute(const std::vector<std::string>& parameters) = 0;
-    virtual std::string getHelp() const = 0;
+class BinaryProtocol;
+
+// A complete input line or decoded binary frame waiting for the command task
+struct CommandRequest {
+    enum class Kind : uint8_t { LINE, FRAME };
+    Kind kind;
+    uint16_t length;
+    uint8_t data[CLI_MAX_LINE_LENGTH > PROTOCOL_MAX_FRAME_SIZE ? CLI_MAX_LINE_LENGTH : PROTOCOL_MAX_FRAME_SIZE];
 };
 
-class CLIManager : public IObserver<SensorData> {
+class CLIManager : public IObserver<SensorData>, public IByteSink, public IStatusSource {
 private:
-    std::map<std::string, std::unique_ptr<ICLICommand>> commands;
-    osMessageQId cliCommandQueue;
-    osSemaphoreId cliMutex;
+    CommandDispatcher dispatcher; // command task only, apart from registration
     osThreadId cliTaskId;
+    osThreadId commandTaskId;
+    int watchdogId;
+    int commandWatchdogId;
+    const Counter* systemErrors; // owned by SystemMonitor, found on first use
     UART_HandleTypeDef* huart;
+    UartTxService* txService;
     SensorManager* sensorManager;
     SystemStatus systemStatus;
 
-    std::string rxBuffer;
-    std::string inputBuffer;
-    static const size_t MAX_INPUT_LENGTH = 256;
+    // DMA writes into dmaRxBuffer circularly; the interrupt callbacks move
+    // new bytes into rxStream and the CLI task assembles lines and frames
+    // from there. Commands and binary requests run on their own task, so a
+    // long one (history, metrics, a slot erase) never stops the CLI task
+    // draining rxStream.
+    uint8_t dmaRxBuffer[CLI_RX_DMA_BUFFER_SIZE];
+    uint16_t dmaReadPosition;
+    StreamBufferHandle_t rxStream;
+    UartRxStats rxStats;
+
+    char inputBuffer[CLI_MAX_LINE_LENGTH];
+    size_t inputLength;
+    bool inputOverflow;
+    MonitoredQueue<CommandRequest> commandQueue;
+
+    // Binary frames share the input stream; 0x00 starts and ends one. A lost
+    // closing 0x00 must not leave the CLI in frame mode, so a frame is given
+    // up when it overflows or input goes idle for CLI_FRAME_IDLE_TIMEOUT_MS.
+    // The rest of an overflowed frame is discarded up to its 0x00, never
+    // read as text, where a stray CR or LF would queue a garbage line.
+    enum class FrameState : uint8_t { TEXT, FRAME, DISCARD };
+    static const size_t FRAME_BUFFER_SIZE = Cobs::maxEncodedSize(PROTOCOL_MAX_FRAME_SIZE);
+    BinaryProtocol* frameHandler;
+    uint8_t frameBuffer[FRAME_BUFFER_SIZE];
+    size_t frameLength;
+    FrameState frameState;
+    uint32_t lastInputTick;
 
     static void cliTask(const void* parameter);
-    void processCommand(const std::string& commandLine);
-    std::vector<std::string> parseCommand(const std::string& commandLine);
-    void sendResponse(const std::string& response);
+    static void commandTask(const void* parameter);
+    void startReception();
+    void processInput(const uint8_t* data, size_t size);
+    bool processFrameByte(uint8_t byte);
+    void expireFrame(uint32_t now);
+    void queueCommand(std::string_view line);
+    void queueFrame();
+    void processCommand(std::string_view line);
+    void sendResponse(std::string_view response);
+    void echo(std::string_view text);
     void updateSystemStatus();
 
 public:
-    CLIManager(UART_HandleTypeDef* uart, SensorManager* sensorMgr);
+    CLIManager(UART_HandleTypeDef* uart, UartTxService* tx, SensorManager* sensorMgr);
     ~CLIManager();
 
     void init();
-    void registerCommand(const std::string& name, std::unique_ptr<ICLICommand> command);
-    void handleUARTData(uint8_t* data, uint16_t size);
+    bool registerCommand(std::string_view name, std::unique_ptr<ICLICommand> command);
     void update(const SensorData& data) override;
+    void setFrameHandler(BinaryProtocol* handler) { frameHandler = handler; }
 
-    const SystemStatus& getSystemStatus() const { return systemStatus; }
-};
-
-// CLI Commands
-class HelpCommand : public ICLICommand {
-private:
-    CLIManager* cliManager;
+    // Raw bytes to the CLI UART; serialized against other writers
+    void transmit(const uint8_t* data, size_t size) override;
 
-public:
-    HelpCommand(CLIManager* manager) : cliManager(manager) {}
+    // Interrupt context
+    void handleRxEvent(uint16_t position);
+    void handleRxError();
 
-    std::string execute(const std::vector<std::string>& parameters) override {
-        return "Available commands: help, status, reset, sensors, log, version\r\n";
-    }
-
-    std::string getHelp() const override {
-        return "help - Show available commands\r\n";
-    }
-};
-
-class StatusCommand : public ICLICommand {
-private:
-    CLIManager* cliManager;
-
-public:
-    StatusCommand(CLIManager* manager) : cliManager(manager) {}
-
-    std::string execute(const std::vector<std::string>& parameters) override {
-        const SystemStatus& status = cliManager->getSystemStatus();
-        char buffer[512];
-        snprintf(buffer, sizeof(buffer),
-                "System Status:\r\n"
-                "  State: %s\r\n"
-                "  Uptime: %lu ms\r\n"
-                "  Free Heap: %lu bytes\r\n"
-                "  Active Sensors: %lu/%lu\r\n"
-                "  Error Count: %lu\r\n"
-                "  CPU Usage: %d%%\r\n",
-                status.state == SystemState::RUNNING ? "RUNNING" : "IDLE",
-                status.upTime,
-                status.freeHeap,
-                status.activeSensors,
-                status.totalSensors,
-                (int)status.errorCount,
-                status.cpuUsage);
-        return std::string(buffer);
-    }
-
-    std::string getHelp() const override {
-        return "status - Show system status information\r\n";
+    const SystemStatus& getSystemStatus() const override { return systemStatus; }
+    const UartRxStats& getRxStats() const override { return rxStats; }
+    UartTxStats getTxStats() const override { return txService->getStats(); }
+    const WatchdogResetRecord* getLastWatchdogReset() const override {
+        return WatchdogSupervisor::wasWatchdogReset() ? &WatchdogSupervisor::getLastReset() : nullptr;
     }
 };
 
+// CLI Commands
 class ResetCommand : public ICLICommand {
 public:
-    std::string execute(const std::vector<std::string>& parameters) override {
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+        out.write("Resetting system...\r\n");
+        out.flush();
         SystemLogger::getInstance()->log(LogLevel::info, "System reset requested via CLI", "CLI");
         HAL_Delay(100); // Allow log to be sent
         HAL_NVIC_SystemReset();
-        return "Resetting system...\r\n";
     }
 
-    std::string getHelp() const override {
+    std::string_view getHelp() const override {
         return "reset - Reset the system\r\n";
     }
 };
@@ -126,38 +152,454 @@ private:
 public:
     SensorsCommand(SensorManager* manager) : sensorManager(manager) {}
 
-    std::string execute(const std::vector<std::string>& parameters) override {
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
         if (parameters.empty()) {
             // Show all sensor data
             std::vector<SensorData> allData = sensorManager->getAllSensorData();
-            std::string result = "Sensor Data:\r\n";
+            out.write("Sensor Data:\r\n");
 
             for (const auto& data : allData) {
-                char buffer[128];
-                snprintf(buffer, sizeof(buffer),
-                        "  Sensor %d (%s): %d [%lu]\r\n",
+                out.print("  Sensor %d (%s): %d [%lu.%06lu]\r\n",
                         data.sensorId,
                         data.type == SensorType::TEMPERATURE ? "TEMP" : "UNKNOWN",
-                        data.value,
-                        data.timestamp);
-                result += buffer;
+                        (int)data.value,
+                        (unsigned long)(data.timestamp / 1000000),
+                        (unsigned long)(data.timestamp % 1000000));
             }
-            return result;
         } else if (parameters[0] == "test") {
             bool testResult = sensorManager->performSelfTest();
-            return testResult ? "Sensor self-test: PASSED\r\n" : "Sensor self-test: FAILED\r\n";
+            out.write(testResult ? "Sensor self-test: PASSED\r\n" : "Sensor self-test: FAILED\r\n");
         } else if (parameters[0] == "reset") {
             sensorManager->resetAllSensors();
-            return "All sensors reset\r\n";
+            out.write("All sensors reset\r\n");
+        } else {
+            out.write("Usage: sensors [test|reset]\r\n");
         }
-
-        return "Usage: sensors [test|reset]\r\n";
     }
 
-    std::string getHelp() const override {
+    std::string_view getHelp() const override {
         return "sensors [test|reset] - Show sensor data or perform operations\r\n";
     }
 };
 
+class StreamCommand : public ICLICommand {
+private:
+    SensorStreamer* streamer;
+
+    static bool parseSensorIds(std::string_view text, uint32_t& mask) {
+        if (text == "all") {
+            mask = 0xFFFFFFFF;
+            return true;
+        }
+        mask = 0;
+        while (!text.empty()) {
+            size_t comma = text.find(',');
+            uint32_t id;
+            if (!CommandArgs::parseUint(text.substr(0, comma), id) || id >= SensorStreamer::MAX_SENSOR_ID) {
+                return false;
+            }
+            mask |= 1UL << id;
+            text = comma == std::string_view::npos ? std::string_view() : text.substr(comma + 1);
+        }
+        return mask != 0;
+    }
+
+    void showStatus(ResponseWriter& out) {
+        const StreamStats& stats = streamer->getStats();
+        StreamSubscription sub = streamer->getSubscription();
+        out.print("Stream: %s, sensors 0x%08lx, %s %lu, batch %u, %s, %s\r\n",
+                streamer->isActive() ? "ON" : "OFF",
+                sub.sensorMask,
+                sub.mode == StreamMode::RATE ? "rate Hz" : "on-change, deadband milli",
+                sub.mode == StreamMode::RATE ? sub.rateHz : (uint32_t)(sub.deadband * 1000.0f),
+                sub.batchSize,
+                sub.format == StreamFormat::BINARY ? "bin" : "text",
+                sub.policy == BackPressurePolicy::DROP ? "drop" : "aggregate");
+        out.print("  In: %lu, filtered: %lu, sent: %lu in %lu frames, dropped: %lu, aggregated: %lu\r\n",
+                stats.samplesIn,
+                stats.samplesFiltered,
+                stats.samplesSent,
+                stats.framesSent,
+                stats.samplesDropped,
+                stats.samplesAggregated);
+    }
+
+public:
+    StreamCommand(SensorStreamer* sensorStreamer) : streamer(sensorStreamer) {}
+
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+        if (parameters.empty()) {
+            showStatus(out);
+            return;
+        }
+        if (parameters[0] == "off") {
+            streamer->unsubscribe();
+            out.write("Streaming stopped\r\n");
+            return;
+        }
+
+        StreamSubscription sub;
+        if (parameters.size() < 2 || !parseSensorIds(parameters[0], sub.sensorMask)) {
+            out.write(getHelp());
+            return;
+        }
+
+        if (parameters[1] == "change") {
+            sub.mode = StreamMode::ON_CHANGE;
+        } else if (!parameters.getUint(1, sub.rateHz) || sub.rateHz == 0) {
+            out.write(getHelp());
+            return;
+        }
+
+        for (size_t i = 2; i < parameters.size(); i++) {
+            uint32_t value;
+            if (parameters[i] == "batch" && parameters.getUint(i + 1, value)) {
+                sub.batchSize = value > BinaryProtocol::SAMPLES_PER_FRAME ? BinaryProtocol::SAMPLES_PER_FRAME : value;
+                i++;
+            } else if (parameters[i] == "deadband" && parameters.getUint(i + 1, value)) {
+                sub.deadband = value / 1000.0f;
+                i++;
+            } else if (parameters[i] == "text") {
+                sub.format = StreamFormat::TEXT;
+            } else if (parameters[i] == "bin") {
+                sub.format = StreamFormat::BINARY;
+            } else if (parameters[i] == "drop") {
+                sub.policy = BackPressurePolicy::DROP;
+            } else if (parameters[i] == "aggregate") {
+                sub.policy = BackPressurePolicy::AGGREGATE;
+            } else {
+                out.write(getHelp());
+                return;
+            }
+        }
+
+        streamer->subscribe(sub);
+        out.write("Streaming started\r\n");
+    }
+
+    std::string_view getHelp() const override {
+        return "stream [off | <ids|all> <hz|change> [batch N] [deadband milli] [text|bin] [drop|aggregate]]"
+               " - Push sensor samples as they are read\r\n";
+    }
+};
+
+class HistoryCommand : public ICLICommand {
+private:
+    DataStorage* dataStorage;
+    BinaryProtocol* protocol;
+
+    static const size_t BLOCK_SIZE = 8;
+
+    uint32_t writeCsv(ResponseWriter& out, uint32_t position, uint8_t sensorId, uint32_t maxEntries) {
+        SensorData samples[BLOCK_SIZE];
+        uint32_t sequences[BLOCK_SIZE];
+        uint32_t remaining = maxEntries > 0 ? maxEntries : UINT32_MAX;
+
+        out.write("seq,sensor,type,time_s,value\r\n");
+        while (remaining > 0 && position != dataStorage->getSensorNextSequence()) {
+            uint32_t before = position;
+            size_t wanted = remaining < BLOCK_SIZE ? remaining : BLOCK_SIZE;
+            size_t count = dataStorage->readSensorHistory(position, sensorId, samples, sequences, wanted);
+            if (position == before) break; // storage busy
+
+            for (size_t i = 0; i < count; i++) {
+                // Fixed point, printf float support is not linked in
+                int32_t milli = (int32_t)(samples[i].value * 1000.0f);
+                uint32_t absMilli = milli < 0 ? -milli : milli;
+                out.print("%lu,%u,%u,%lu.%06lu,%s%lu.%03lu\r\n",
+                        sequences[i],
+                        samples[i].sensorId,
+                        (unsigned)samples[i].type,
+                        (unsigned long)(samples[i].timestamp / 1000000),
+                        (unsigned long)(samples[i].timestamp % 1000000),
+                        milli < 0 ? "-" : "",
+                        (unsigned long)(absMilli / 1000),
+                        (unsigned long)(absMilli % 1000));
+            }
+            remaining -= count;
+        }
+        return position;
+    }
+
+public:
+    HistoryCommand(DataStorage* storage, BinaryProtocol* binaryProtocol) : dataStorage(storage), protocol(binaryProtocol) {}
+
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+        bool binary = false;
+        WireHistoryRequest request;
+        request.fromSequence = dataStorage->getSensorFirstSequence();
+        request.maxEntries = 0;
+        request.sensorId = DataStorage::ALL_SENSORS;
+
+        for (size_t i = 0; i < parameters.size(); i++) {
+            uint32_t value;
+            if (parameters[i] == "csv") {
+                binary = false;
+            } else if (parameters[i] == "bin") {
+                binary = true;
+            } else if (parameters[i] == "sensor" && parameters.getUint(i + 1, value) && value < DataStorage::ALL_SENSORS) {
+                request.sensorId = (uint8_t)value;
+                i++;
+            } else if (parameters[i] == "from" && parameters.getUint(i + 1, value)) {
+                request.fromSequence = value;
+                i++;
+            } else if (parameters[i] == "count" && parameters.getUint(i + 1, value)) {
+                request.maxEntries = value;
+                i++;
+            } else {
+                out.write(getHelp());
+                return;
+            }
+        }
+
+        uint32_t next;
+        if (binary) {
+            // HISTORY frames, CRC per block; sequence 0 marks a CLI-initiated export
+            next = protocol->sendHistory(0, request);
+        } else {
+            next = writeCsv(out, request.fromSequence, request.sensorId, request.maxEntries);
+        }
+        out.print("# next %lu\r\n", next);
+    }
+
+    std::string_view getHelp() const override {
+        return "history [csv|bin] [sensor <id>] [from <seq>] [count <n>] - Export stored sensor samples\r\n";
+    }
+};
+
+class TopCommand : public ICLICommand {
+private:
+    static char stateLetter(eTaskState state) {
+        switch (state) {
+            case eRunning:   return 'X';
+            case eReady:     return 'R';
+            case eBlocked:   return 'B';
+            case eSuspended: return 'S';
+            case eDeleted:   return 'D';
+            default:         return '?';
+        }
+    }
+
+public:
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+        TaskLoad loads[TaskStats::MAX_TASKS];
+        size_t count = TaskStats::snapshot(loads, TaskStats::MAX_TASKS);
+
+        uint16_t shortLoad = TaskStats::getShortCpuLoad();
+        uint16_t longLoad = TaskStats::getLongCpuLoad();
+        out.print("CPU %u.%u%% (%us)  %u.%u%% (%us)\r\n",
+                shortLoad / 10, shortLoad % 10, TASK_STATS_SHORT_WINDOW,
+                longLoad / 10, longLoad % 10, TASK_STATS_LONG_WINDOW);
+        out.print("%-16s S PRI STACK   %2us%%  %2us%%\r\n", "TASK", TASK_STATS_SHORT_WINDOW, TASK_STATS_LONG_WINDOW);
+
+        for (size_t i = 0; i < count; i++) {
+            const TaskLoad& load = loads[i];
+            out.print("%-16s %c %3lu %5lu %3u.%u %3u.%u\r\n",
+                    load.name, stateLetter(load.state),
+                    (unsigned long)load.priority, (unsigned long)load.stackFreeBytes,
+                    load.shortLoad / 10, load.shortLoad % 10,
+                    load.longLoad / 10, load.longLoad % 10);
+        }
+    }
+
+    std::string_view getHelp() const override {
+        return "top - Per-task CPU load, free stack (bytes) and state\r\n";
+    }
+};
+
+class StackCommand : public ICLICommand {
+public:
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+        StackBudget budgets[STACK_MONITOR_MAX_TASKS];
+        size_t count = StackMonitor::report(budgets, STACK_MONITOR_MAX_TASKS);
+
+        int32_t reclaimable = 0;
+        out.print("%-16s %6s %6s %6s  (words)\r\n", "TASK", "SIZE", "PEAK", "RECOMM");
+        for (size_t i = 0; i < count; i++) {
+            const StackBudget& budget = budgets[i];
+            out.print("%-16s %6lu %6lu %6lu\r\n", budget.name,
+                    (unsigned long)budget.stackWords,
+                    (unsigned long)(budget.stackWords - budget.minFreeWords),
+                    (unsigned long)budget.recommendedWords);
+            reclaimable += (int32_t)budget.stackWords - (int32_t)budget.recommendedWords;
+        }
+        out.print("Reclaimable: %ld bytes\r\n", (long)(reclaimable * (int32_t)sizeof(StackType_t)));
+    }
+
+    std::string_view getHelp() const override {
+        return "stack - Peak stack use and recommended sizes per task\r\n";
+    }
+};
+
+class HeapCommand : public ICLICommand {
+private:
+    static void writeUsage(ResponseWriter& out, const char* name, const HeapUsage& usage) {
+        out.print("%-9s %7lu %7lu %7lu %7lu\r\n", name,
+                (unsigned long)usage.liveBytes, (unsigned long)usage.peakBytes,
+                (unsigned long)usage.allocations, (unsigned long)usage.frees);
+    }
+
+public:
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+        out.print("%-9s %7s %7s %7s %7s\r\n", "MODULE", "LIVE", "PEAK", "ALLOCS", "FREES");
+        for (size_t i = 0; i < (size_t)HeapModule::COUNT; i++) {
+            HeapUsage usage = HeapStats::getModule((HeapModule)i);
+            if (usage.allocations > 0) {
+                writeUsage(out, HeapStats::moduleName((HeapModule)i), usage);
+            }
+        }
+        writeUsage(out, "new total", HeapStats::getTotal());
+
+        RtosHeapUsage rtos = HeapStats::getRtosHeap();
+        writeUsage(out, "rtos", rtos.usage);
+        out.print("RTOS heap: %lu free, %lu min ever, largest block %lu in %lu blocks\r\n",
+                (unsigned long)rtos.freeBytes, (unsigned long)rtos.minimumEverFree,
+                (unsigned long)rtos.largestFreeBlock, (unsigned long)rtos.freeBlocks);
+        out.print("Failures: %lu  Corrupt frees: %lu\r\n",
+                (unsigned long)HeapStats::getFailures(), (unsigned long)HeapStats::getCorruptions());
+    }
+
+    std::string_view getHelp() const override {
+        return "heap - Heap use per module and RTOS heap fragmentation\r\n";
+    }
+};
+
+class LatencyCommand : public ICLICommand {
+public:
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+#if LATENCY_TRACE_ENABLED
+        if (parameters[0] == "reset") {
+            LatencyTrace::reset();
+            out.write("Latency histograms cleared\r\n");
+            return;
+        }
+
+        out.print("%-15s %8s %8s %8s %8s  (us)\r\n", "STAGE", "COUNT", "P50", "P99", "MAX");
+        for (size_t i = 0; i < (size_t)LatencyStage::COUNT; i++) {
+            LatencySummary summary = LatencyTrace::summarize((LatencyStage)i);
+            out.print("%-15s %8lu %8lu %8lu %8lu\r\n", LatencyTrace::stageName((LatencyStage)i),
+                    (unsigned long)summary.count, (unsigned long)summary.p50Us,
+                    (unsigned long)summary.p99Us, (unsigned long)summary.maxUs);
+        }
+#else
+        out.write("Latency tracing is compiled out (LATENCY_TRACE_ENABLED 0)\r\n");
+#endif
+    }
+
+    std::string_view getHelp() const override {
+        return "latency [reset] - Sample pipeline latency per stage\r\n";
+    }
+};
+
+class TraceCommand : public ICLICommand {
+public:
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+        if (parameters[0] == "start") {
+            bool oneShot = parameters[1] == "oneshot";
+            TraceRecorder::start(oneShot);
+            out.print("Tracing (%s)\r\n", oneShot ? "one-shot" : "ring");
+        } else if (parameters[0] == "stop") {
+            TraceRecorder::stop();
+            out.print("Stopped, %u events\r\n", (unsigned)TraceRecorder::getCount());
+        } else if (parameters[0] == "dump") {
+            TraceRecorder::dump(out);
+        } else if (parameters.empty()) {
+            out.print("%s, %u events, %lu lost\r\n", TraceRecorder::isRunning() ? "Running" : "Stopped",
+                    (unsigned)TraceRecorder::getCount(), (unsigned long)TraceRecorder::getLost());
+        } else {
+            out.write(getHelp());
+        }
+    }
+
+    std::string_view getHelp() const override {
+        return "trace [start [oneshot]|stop|dump] - Kernel event trace, see Tools/trace_to_chrome.py\r\n";
+    }
+};
+
+class CrashCommand : public ICLICommand {
+public:
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+        if (parameters[0] == "clear") {
+            CrashDump::clear();
+            out.write("Crash record cleared\r\n");
+        } else if (parameters.empty()) {
+            CrashDump::write(out);
+        } else {
+            out.write(getHelp());
+        }
+    }
+
+    std::string_view getHelp() const override {
+        return "crash [clear] - Show or clear the crash dump kept from a previous boot\r\n";
+    }
+};
+
+class BootCommand : public ICLICommand {
+public:
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+        if (parameters[0] == "confirm") {
+            out.write(FirmwareUpdate::confirm() ? "Running image confirmed\r\n" : "Confirm failed\r\n");
+        } else if (parameters.empty()) {
+            FirmwareUpdate::describe(out);
+            BootProfile::describe(out);
+        } else {
+            out.write(getHelp());
+        }
+    }
+
+    std::string_view getHelp() const override {
+        return "boot [confirm] - A/B slots, trial state, update progress and boot phase times; confirm keeps a trial image\r\n";
+    }
+};
+
+class MetricsCommand : public ICLICommand {
+private:
+    BinaryProtocol* protocol;
+
+public:
+    MetricsCommand(BinaryProtocol* binaryProtocol) : protocol(binaryProtocol) {}
+
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+        if (parameters.empty() || parameters[0] == "text") {
+            Metrics::writeText(out);
+        } else if (parameters[0] == "bin") {
+            // Names and bounds, then values; sequence 0 marks CLI-initiated frames
+            WireMetricsRequest request = {0, METRICS_FLAG_DESCRIBE};
+            protocol->sendMetrics(0, request);
+            request.flags = 0;
+            protocol->sendMetrics(0, request);
+        } else {
+            out.write(getHelp());
+        }
+    }
+
+    std::string_view getHelp() const override {
+        return "metrics [text|bin] - Counters, gauges and histograms in Prometheus text or METRICS frames\r\n";
+    }
+};
+
+class QueuesCommand : public ICLICommand {
+public:
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+        QueueHealth queues[QUEUE_MONITOR_MAX];
+        size_t count = QueueMonitor::report(queues, QUEUE_MONITOR_MAX);
+
+        out.print("%-12s %7s %4s %8s %6s %8s %9s %9s\r\n",
+                "QUEUE", "USED", "PEAK", "SENT", "FAIL", "RECV", "RESID_US", "BLOCK_MS");
+        for (size_t i = 0; i < count; i++) {
+            const QueueHealth& queue = queues[i];
+            out.print("%-12s %3lu/%-3lu %4lu %8lu %6lu %8lu %9lu %9lu%s\r\n", queue.name,
+                    (unsigned long)queue.waiting, (unsigned long)queue.capacity,
+                    (unsigned long)queue.highWater, (unsigned long)queue.sent,
+                    (unsigned long)queue.sendFailures, (unsigned long)queue.received,
+                    (unsigned long)queue.residencyUs, (unsigned long)(queue.blockedUs / 1000),
+                    queue.saturated ? "  SATURATED" : "");
+        }
+    }
+
+    std::string_view getHelp() const override {
+        return "queues - Depth, peak, failures and residency of each RTOS queue\r\n";
+    }
+};
 
 #endif /* INC_CLI_MANAGER_HPP_ */
@@ -0,0 +1,142 @@
+#ifndef INC_CLI_PARSER_HPP_
+#define INC_CLI_PARSER_HPP_
+
+#include<stdint.h>
+#include<stddef.h>
+#include<string_view>
+
+// Arguments of one command line. The views point into the line buffer owned
+// by the caller, so nothing here allocates and nothing outlives the line.
+class CommandArgs {
+private:
+    const std::string_view* tokens;
+    size_t count;
+
+public:
+    CommandArgs(const std::string_view* argTokens, size_t argCount) : tokens(argTokens), count(argCount) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    std::string_view operator[](size_t index) const {
+        return index < count ? tokens[index] : std::string_view();
+    }
+
+    static bool parseUint(std::string_view text, uint32_t& value) {
+        if (text.empty()) return false;
+        uint32_t result = 0;
+        for (char ch : text) {
+            if (ch < '0' || ch > '9') return false;
+            uint32_t digit = (uint32_t)(ch - '0');
+            if (result > (UINT32_MAX - digit) / 10) return false; // overflow
+            result = result * 10 + digit;
+        }
+        value = result;
+        return true;
+    }
+
+    bool getUint(size_t index, uint32_t& value) const {
+        return index < count && parseUint(tokens[index], value);
+    }
+};
+
+// In-place tokenizer: splits a line on spaces/tabs into views of that line
+class CommandLine {
+public:
+    // The longest documented command, "stream <ids> change batch <n>
+    // deadband <milli> text aggregate", has 9 tokens
+    static const size_t MAX_TOKENS = 16;
+
+private:
+    std::string_view tokens[MAX_TOKENS];
+    size_t count;
+    bool overflow;
+
+public:
+    CommandLine() : count(0), overflow(false) {}
+
+    // Returns the number of tokens. A line with more than MAX_TOKENS keeps
+    // the first MAX_TOKENS and sets overflowed(); callers reject it rather
+    // than run a command with arguments missing.
+    size_t tokenize(std::string_view line) {
+        count = 0;
+        overflow = false;
+        size_t pos = 0;
+        while (pos < line.size()) {
+            while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t')) pos++;
+            size_t start = pos;
+            while (pos < line.size() && line[pos] != ' ' && line[pos] != '\t') pos++;
+            if (pos > start) {
+                if (count == MAX_TOKENS) {
+                    overflow = true;
+                    break;
+                }
+                tokens[count++] = line.substr(start, pos - start);
+            }
+        }
+        return count;
+    }
+
+    bool overflowed() const { return overflow; }
+    bool empty() const { return count == 0; }
+    std::string_view name() const { return count > 0 ? tokens[0] : std::string_view(); }
+    CommandArgs args() const { return count > 1 ? CommandArgs(tokens + 1, count - 1) : CommandArgs(nullptr, 0); }
+};
+
+// Perfect hash over a fixed set of names, built entirely at compile time:
+// the constructor searches for a seed under which no two names share a slot,
+// so a lookup is one hash and one string compare.
+template<size_t N>
+class PerfectHash {
+public:
+    static constexpr size_t tableSizeFor(size_t n) {
+        size_t size = 1;
+        while (size < n * 2) size <<= 1;
+        return size;
+    }
+    static constexpr size_t TABLE_SIZE = tableSizeFor(N);
+
+    static constexpr uint32_t hash(std::string_view key, uint32_t seed) {
+        uint32_t h = 2166136261u ^ seed; // FNV-1a
+        for (char ch : key) {
+            h ^= (uint8_t)ch;
+            h *= 16777619u;
+        }
+        return h ^ (h >> 15);
+    }
+
+    constexpr explicit PerfectHash(const std::string_view (&names)[N]) : seed(0), keys{} {
+        for (uint32_t candidate = 1; candidate < 100000; candidate++) {
+            bool used[TABLE_SIZE] = {};
+            bool collision = false;
+            for (size_t i = 0; i < N && !collision; i++) {
+                size_t s = hash(names[i], candidate) & (TABLE_SIZE - 1);
+                collision = used[s];
+                used[s] = true;
+            }
+            if (!collision) {
+                seed = candidate;
+                break;
+            }
+        }
+        for (size_t i = 0; i < N; i++) {
+            keys[slot(names[i])] = names[i];
+        }
+    }
+
+    constexpr size_t slot(std::string_view key) const { return hash(key, seed) & (TABLE_SIZE - 1); }
+
+    // Slot index of key, or -1 when key is not one of the names
+    constexpr int lookup(std::string_view key) const {
+        size_t s = slot(key);
+        return (!key.empty() && keys[s] == key) ? (int)s : -1;
+    }
+
+    constexpr bool valid() const { return seed != 0; }
+
+private:
+    uint32_t seed;
+    std::string_view keys[TABLE_SIZE];
+};
+
+
+#endif /* INC_CLI_PARSER_HPP_ */
@@ -0,0 +1,62 @@
+#ifndef INC_COBS_HPP_
+#define INC_COBS_HPP_
+
+#include<stdint.h>
+#include<stddef.h>
+
+// Consistent Overhead Byte Stuffing: removes every 0x00 from a buffer at a
+// cost of one byte per 254, so 0x00 can delimit frames on the wire.
+class Cobs {
+public:
+    static constexpr size_t maxEncodedSize(size_t length) {
+        return length + length / 254 + 1;
+    }
+
+    // output must hold maxEncodedSize(length) bytes; no delimiter is added
+    static size_t encode(const uint8_t* input, size_t length, uint8_t* output) {
+        size_t write = 1;
+        size_t codePosition = 0;
+        uint8_t code = 1;
+
+        for (size_t i = 0; i < length; i++) {
+            if (input[i] == 0) {
+                output[codePosition] = code;
+                codePosition = write++;
+                code = 1;
+            } else {
+                output[write++] = input[i];
+                if (++code == 0xFF) {
+                    output[codePosition] = code;
+                    codePosition = write++;
+                    code = 1;
+                }
+            }
+        }
+        output[codePosition] = code;
+        return write;
+    }
+
+    // Decoding may be done in place (output == input). Returns the decoded
+    // length, or 0 when the input is not valid COBS.
+    static size_t decode(const uint8_t* input, size_t length, uint8_t* output) {
+        size_t read = 0;
+        size_t write = 0;
+
+        while (read < length) {
+            uint8_t code = input[read++];
+            if (code == 0 || read + code - 1 > length) {
+                return 0;
+            }
+            for (uint8_t i = 1; i < code; i++) {
+                output[write++] = input[read++];
+            }
+            if (code != 0xFF && read < length) {
+                output[write++] = 0;
+            }
+        }
+        return write;
+    }
+};
+
+
+#endif /* INC_COBS_HPP_ */
@@ -3,7 +3,63 @@
 #define INC_COMMON_VARIABLES_HPP_
 
 
-#define CLI_CMD_QUEUE_SIZE 20
+#define CLI_MAX_LINE_LENGTH 128
+#define CLI_RX_DMA_BUFFER_SIZE 256 // circular, half/full/idle events flush it
+#define CLI_RX_STREAM_SIZE 1024
+#define CLI_FRAME_IDLE_TIMEOUT_MS 50 // a binary frame that stalls this long is abandoned
+#define CLI_COMMAND_QUEUE_SIZE 4 // lines and binary requests waiting while a command runs
+#define CLI_RESPONSE_CHUNK_SIZE 128 // command output is flushed in chunks of this size
+#define PROTOCOL_MAX_PAYLOAD 240 // binary frame payload, before COBS
+#define PROTOCOL_MAX_FRAME_SIZE (2 + PROTOCOL_MAX_PAYLOAD + 4) // type, sequence, payload, CRC-32
+#define CLI_TX_INTERACTIVE_SIZE 256 // echo and prompts, sent ahead of bulk output
+#define CLI_TX_BULK_SIZE 1024
+#define CLI_TX_TIMEOUT_MS 1000 // command output waits this long for ring space
+#define LOG_TX_INTERACTIVE_SIZE 64
+#define LOG_TX_BULK_SIZE 2048
+#define LOG_UART_FLOW_CONTROL 0 // RTS/CTS on PA1/PA0; PA0 is the user button on the Discovery board
+#define UART_TX_DMA_CHUNK_SIZE 128 // bounds how long bulk output delays interactive bytes
 #define SENSOR_DATA_QUEUE_SIZE 20
+#define LOG_QUEUE_SIZE 10
+#define LOG_QUEUE_WAIT_MS 10 // log() waits this long for space, then the line is dropped and counted
+#define LOG_MESSAGE_LENGTH 80 // queued log text, longer messages are truncated
+#define LOG_MODULE_LENGTH 12
+#define QUEUE_MONITOR_MAX 8 // one per configQUEUE_REGISTRY_SIZE entry
+#define QUEUE_SATURATION_PERCENT 90
+#define QUEUE_SATURATION_SECONDS 3 // full or rejecting this long raises an alarm
+#define STREAM_QUEUE_SIZE 16
+#define STREAM_BATCH_TIMEOUT_MS 50 // a partial batch waits at most this long
+#define TASK_STATS_MAX_TASKS 12
+#define TASK_STATS_SHORT_WINDOW 1 // in SystemMonitor samples, one per second
+#define TASK_STATS_LONG_WINDOW 10
+// Task stacks in words; the `stack` command reports what each one really needs
+#define SENSOR_TASK_STACK_WORDS 512
+#define CLI_TASK_STACK_WORDS 512
+#define CLI_COMMAND_STACK_WORDS 512
+#define MONITOR_TASK_STACK_WORDS 512
+#define LOGGER_TASK_STACK_WORDS 256
+#define STREAM_TASK_STACK_WORDS 256
+#define CONFIG_TASK_STACK_WORDS 256
+#define STACK_MONITOR_MAX_TASKS 10
+#define STACK_WARN_PERCENT 15 // warn when less than this much of a stack was ever free
+#define STACK_MARGIN_WORDS 32 // added to the observed peak in recommendations
+#define WATCHDOG_MAX_TASKS 8
+#define WATCHDOG_SUPERVISE_WORST_MS 2000 // longest gap between IWDG refreshes: 1 s monitor period plus up to 1 s waiting for its mutex
+#define WATCHDOG_MIN_TIMEOUT_MS (2 * WATCHDOG_SUPERVISE_WORST_MS) // shorter periods expire between healthy refreshes
+#define WATCHDOG_TIMEOUT_MS 4000 // IWDG period once supervision stops refreshing, until config sets it
+#define WATCHDOG_MAX_TIMEOUT_MS 32000 // longest IWDG period: LSI / 256, 12-bit reload
+#define FLASH_SLOT_ERASE_WORST_MS 2600 // datasheet maximum at x32: slot A 3 x 500 ms + 1100 ms, slot B 2000 ms
+#define WATCHDOG_ERASE_TIMEOUT_MS (2 * (WATCHDOG_SUPERVISE_WORST_MS + FLASH_SLOT_ERASE_WORST_MS)) // IWDG period held while an update erases a slot
+#define WATCHDOG_TASK_DEADLINE_MS 2000 // longest a supervised task may go without a check-in
+#define LATENCY_TRACE_ENABLED 1 // 0 compiles the pipeline trace points out
+#define LATENCY_MAX_OCTAVE 22 // histograms cover up to 2^22 us (~4 s)
+#define TRACE_BUFFER_EVENTS 1024 // 8 bytes each, power of two; a few seconds of activity
+#define TRACE_MAX_QUEUES 16 // queues, semaphores and mutexes named in dumps
+#define CONFIG_STORE_MAX_PAYLOAD 256 // bytes per config record
+#define CONFIG_STORE_MAX_DELTAS 7 // delta records before the next checkpoint
+#define CONFIG_MAX_SUBSCRIBERS 8
+#define METRICS_MAX 32
+#define METRICS_MAX_BUCKETS 8 // histogram bounds; one more bucket catches the overflow
+#define FIRMWARE_VERSION 0x010000 // major << 16 | minor << 8 | patch, linked into the image header
+#define BOOT_CONFIRM_DELAY_MS 10000 // a new image confirms itself after running this long without errors
 
 #endif /* INC_COMMON_VARIABLES_HPP_ */
@@ -0,0 +1,57 @@
+#ifndef INC_CONFIG_CODEC_HPP_
+#define INC_CONFIG_CODEC_HPP_
+
+#include<stdint.h>
+#include<stddef.h>
+#include "config_schema.hpp"
+
+// Flash encoding of SystemConfig, generated from CONFIG_SCHEMA:
+//   [FORMAT_MARKER][schema version] then one [tag][length][value] per field
+// U32 values are little-endian in as few bytes as they need, BOOL is one
+// byte, TEXT is the characters without the NUL. Encoding against a base
+// config writes only the fields that differ, so a partial update costs a
+// few bytes. Decoding applies the fields present on top of the config
+// given, which is how deltas and missing (newer) fields work; unknown tags
+// from a newer schema are skipped and values out of range are rejected.
+//
+// Schema versions:
+//   0  packed struct written by the first flash store, no marker; decoded
+//      by position and rewritten as TLV on the next save
+//   1  TLV
+// Each older version has its own decoder that maps it onto the current
+// SystemConfig, through the same range checks as a TLV field.
+#define CONFIG_ENCODED_U32(max) 4
+#define CONFIG_ENCODED_BOOL(max) 1
+#define CONFIG_ENCODED_TEXT(max) (max)
+#define CONFIG_ENCODED_SIZE(tag, name, type, value, min, max) + 2 + CONFIG_ENCODED_##type(max)
+
+struct ConfigDecodeResult {
+    bool ok;            // false: malformed, config untouched
+    uint8_t version;
+    uint8_t applied;
+    uint8_t skipped;    // unknown tags
+    uint8_t rejected;   // known tags with a bad length or value
+};
+
+class ConfigCodec {
+public:
+    static const uint8_t FORMAT_MARKER = 0xC5;
+    static const uint8_t SCHEMA_VERSION = 1;
+    static const size_t HEADER_SIZE = 2;
+    static const size_t MAX_SIZE = HEADER_SIZE CONFIG_SCHEMA(CONFIG_ENCODED_SIZE);
+
+    // Returns the encoded length, 0 if it does not fit. With a base, only
+    // fields that differ from it are written; HEADER_SIZE means none did.
+    static size_t encode(const SystemConfig& config, uint8_t* buffer, size_t size,
+                         const SystemConfig* base = nullptr);
+
+    static ConfigDecodeResult decode(const uint8_t* data, size_t length, SystemConfig& config);
+
+private:
+    static bool decodeTlv(const uint8_t* data, size_t length, SystemConfig& config, ConfigDecodeResult& result);
+    static bool decodeVersion0(const uint8_t* data, size_t length, SystemConfig& config, ConfigDecodeResult& result);
+    static bool applyField(SystemConfig& config, const ConfigField& field, const uint8_t* value, size_t length);
+};
+
+
+#endif /* INC_CONFIG_CODEC_HPP_ */
@@ -0,0 +1,100 @@
+#ifndef INC_CONFIG_COMMAND_HPP_
+#define INC_CONFIG_COMMAND_HPP_
+
+#include "cli_dispatcher.hpp"
+#include "config_editor.hpp"
+
+class ConfigCommand : public ICLICommand {
+private:
+    IConfigEditor* configManager;
+
+    static void writeValue(ResponseWriter& out, const SystemConfig& config, const ConfigField& field) {
+        if (field.type == ConfigType::TEXT) {
+            out.print("%s", ConfigSchema::getText(config, field));
+        } else {
+            out.print("%lu", (unsigned long)ConfigSchema::getNumber(config, field));
+        }
+    }
+
+    static void writeField(ResponseWriter& out, const SystemConfig& config, const ConfigField& field) {
+        out.print("%-20s ", field.name);
+        writeValue(out, config, field);
+        out.write("\r\n");
+    }
+
+    void set(const ConfigField& field, std::string_view value, ResponseWriter& out) {
+        uint32_t number;
+        bool applied = field.type == ConfigType::TEXT
+                ? configManager->setText(field, value.data(), value.size())
+                : CommandArgs::parseUint(value, number) && configManager->setValue(field, number);
+        if (!applied) {
+            out.print("Invalid value for %s, range %lu..%lu%s\r\n", field.name, (unsigned long)field.min,
+                    (unsigned long)field.max, field.type == ConfigType::TEXT ? " characters" : "");
+            return;
+        }
+        writeField(out, configManager->getConfig(), field);
+    }
+
+    void diff(ResponseWriter& out) {
+        SystemConfig running = configManager->getConfig();
+        SystemConfig saved = configManager->getSavedConfig();
+        size_t count;
+        const ConfigField* fields = ConfigSchema::fields(count);
+        bool changed = false;
+        for (size_t i = 0; i < count; i++) {
+            if (ConfigSchema::equal(running, saved, fields[i])) continue;
+            out.print("%-20s ", fields[i].name);
+            writeValue(out, saved, fields[i]);
+            out.write(" -> ");
+            writeValue(out, running, fields[i]);
+            out.write("\r\n");
+            changed = true;
+        }
+        if (!changed) {
+            out.write("No unsaved changes\r\n");
+        }
+    }
+
+public:
+    ConfigCommand(IConfigEditor* manager) : configManager(manager) {}
+
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+        std::string_view action = parameters[0];
+        const ConfigField* field = nullptr;
+        if (parameters.size() > 1) {
+            field = ConfigSchema::find(parameters[1]);
+            if (!field) {
+                out.print("Unknown key '%.*s'\r\n", (int)parameters[1].size(), parameters[1].data());
+                return;
+            }
+        }
+
+        if ((action.empty() || action == "get") && parameters.size() <= 2) {
+            SystemConfig config = configManager->getConfig();
+            if (field) {
+                writeField(out, config, *field);
+            } else {
+                size_t count;
+                const ConfigField* fields = ConfigSchema::fields(count);
+                for (size_t i = 0; i < count; i++) {
+                    writeField(out, config, fields[i]);
+                }
+            }
+        } else if (action == "set" && field && parameters.size() == 3) {
+            set(*field, parameters[2], out);
+        } else if (action == "save" && parameters.size() == 1) {
+            out.write(configManager->saveConfig() ? "Configuration saved\r\n" : "Configuration save failed\r\n");
+        } else if (action == "diff" && parameters.size() == 1) {
+            diff(out);
+        } else {
+            out.write(getHelp());
+        }
+    }
+
+    std::string_view getHelp() const override {
+        return "config [get [key]|set <key> <value>|save|diff] - Settings; set applies at once, save keeps them, diff shows unsaved\r\n";
+    }
+};
+
+
+#endif /* INC_CONFIG_COMMAND_HPP_ */
@@ -0,0 +1,24 @@
+#ifndef INC_CONFIG_EDITOR_HPP_
+#define INC_CONFIG_EDITOR_HPP_
+
+#include<stdint.h>
+#include<stddef.h>
+#include "config_schema.hpp"
+
+// The part of ConfigManager the config command uses, so the command builds
+// without the RTOS and the host benchmark can run it
+class IConfigEditor {
+public:
+    virtual ~IConfigEditor() = default;
+    // Consistent copy, safe from any task or ISR
+    virtual SystemConfig getConfig() const = 0;
+    // The config a reboot would load
+    virtual SystemConfig getSavedConfig() = 0;
+    // Range-checked through the schema; false leaves the config unchanged
+    virtual bool setValue(const ConfigField& field, uint32_t value) = 0;
+    virtual bool setText(const ConfigField& field, const char* text, size_t length) = 0;
+    virtual bool saveConfig() = 0;
+};
+
+
+#endif /* INC_CONFIG_EDITOR_HPP_ */
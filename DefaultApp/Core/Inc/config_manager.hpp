@@ -11,40 +11,71 @@ extern "C" {
 #endif
 
 #include<string>
+#include<vector>
+#include<algorithm>
+#include "IObserver.hpp"
+#include "flash_device.hpp"
+#include "config_store.hpp"
+#include "config_schema.hpp"
+#include "config_codec.hpp"
+#include "snapshot.hpp"
+#include "config_editor.hpp"
 
-struct SystemConfig {
-    uint32_t sensorReadInterval;
-    uint32_t logLevel;
-    uint32_t watchdogTimeout;
-    uint32_t maxSensors;
-    bool autoStart;
-    std::string deviceName;
-
-    SystemConfig() : sensorReadInterval(1000), logLevel(2), watchdogTimeout(5000),
-                    maxSensors(10), autoStart(true), deviceName("SensorGateway") {}
-};
-
-class ConfigManager {
+// Readers get a copy through a lock-free Snapshot and never wait; writers
+// change the working copy under configMutex and publish it. Components
+// that apply settings while running subscribe to their keys; the config
+// task wakes on each publish and tells them, outside any lock, what changed
+// since it last looked. Changes made in quick succession arrive together.
+class ConfigManager : public IConfigEditor {
 private:
-    SystemConfig config;
+    SystemConfig config;        // working copy, under configMutex
+    Snapshot<SystemConfig> snapshot;
+    SystemConfig persisted;     // what the store replays to; deltas are against it
+    bool checkpointDue;         // stored records are in an older schema version
     osSemaphoreId configMutex;
 
-    static const uint32_t CONFIG_FLASH_ADDRESS = 0x08060000; // Last sector
+    struct Subscription {
+        IObserver<ConfigChange>* observer;
+        uint32_t keys;
+    };
+    Subscription subscriptions[CONFIG_MAX_SUBSCRIBERS];
+    size_t subscriptionCount;
+    osThreadId configTaskId;
+    int watchdogId;
+    SystemConfig delivered;     // config task only
+
+    // Sectors 6 and 7, 128 KB each, used as a ping-pong pair; the
+    // application image is linked below them
+    static const uint32_t CONFIG_FLASH_ADDRESS = 0x08040000;
+    static const uint32_t CONFIG_SECTOR_SIZE = 0x20000;
+
+    InternalFlash flash;
+    ConfigStore store;
 
     bool saveToFlash();
     bool loadFromFlash();
-    uint32_t calculateChecksum(const SystemConfig& cfg);
+    void publish();
+
+    static void configTask(const void* parameter);
+    void deliverChanges(uint32_t forcedKeys);
 
 public:
     ConfigManager();
     ~ConfigManager();
 
     void init();
-    const SystemConfig& getConfig() const;
+    // Starts the config task; its first pass delivers every subscribed key
+    // so components pick up the loaded config
+    void start();
+    // Before start(); keys is a mask of ConfigKeys
+    bool subscribe(IObserver<ConfigChange>* observer, uint32_t keys);
+    SystemConfig getConfig() const override;
+    uint32_t getConfigVersion() const { return snapshot.getVersion(); }
     void setConfig(const SystemConfig& newConfig);
     void resetToDefault();
-    bool saveConfig();
+    bool saveConfig() override;
     bool loadConfig();
+    const ConfigStoreStats& getStoreStats() const { return store.getStats(); }
 
     // Individual parameter setters
     void setSensorReadInterval(uint32_t interval);
@@ -53,6 +84,10 @@ public:
     void setMaxSensors(uint32_t maxSensors);
     void setAutoStart(bool autoStart);
     void setDeviceName(const std::string& name);
+
+    bool setValue(const ConfigField& field, uint32_t value) override;
+    bool setText(const ConfigField& field, const char* text, size_t length) override;
+    SystemConfig getSavedConfig() override;
 };
 
 
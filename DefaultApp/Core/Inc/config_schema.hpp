@@ -0,0 +1,86 @@
+#ifndef INC_CONFIG_SCHEMA_HPP_
+#define INC_CONFIG_SCHEMA_HPP_
+
+#include<stdint.h>
+#include<stddef.h>
+#include<string_view>
+#include "common_variables.hpp"
+
+// Every persisted setting, in one place: SystemConfig, its defaults, the
+// field table and the flash encoding (ConfigCodec) are generated from it.
+// The tag is stored in flash and is the ConfigKey of the binary protocol,
+// so tags are never renumbered or reused; a setting that changes meaning
+// gets a new tag.
+//   X(tag, name, type, default, min, max)
+// For TEXT, min and max bound the length and max is the capacity.
+#define CONFIG_SCHEMA(X) \
+    X(1, sensorReadInterval, U32,  1000,            1,   3600000) \
+    X(2, logLevel,           U32,  1,               0,   4) \
+    X(3, watchdogTimeout,    U32,  WATCHDOG_TIMEOUT_MS, WATCHDOG_MIN_TIMEOUT_MS, WATCHDOG_MAX_TIMEOUT_MS) \
+    X(4, maxSensors,         U32,  10,              1,   255) \
+    X(5, autoStart,          BOOL, 1,               0,   1) \
+    X(6, deviceName,         TEXT, "SensorGateway", 1,   16)
+
+enum class ConfigType : uint8_t {
+    U32,
+    BOOL,
+    TEXT
+};
+
+#define CONFIG_MEMBER_U32(name, max) uint32_t name;
+#define CONFIG_MEMBER_BOOL(name, max) bool name;
+#define CONFIG_MEMBER_TEXT(name, max) char name[(max) + 1];
+#define CONFIG_MEMBER(tag, name, type, value, min, max) CONFIG_MEMBER_##type(name, max)
+
+struct SystemConfig {
+    CONFIG_SCHEMA(CONFIG_MEMBER)
+
+    SystemConfig();
+};
+
+// One bit per tag, for subscribing to and reporting changed settings:
+// ConfigKeys::logLevel | ConfigKeys::watchdogTimeout
+#define CONFIG_KEY_BIT(tag, name, type, value, min, max) name = 1u << (tag),
+struct ConfigKeys {
+    enum : uint32_t {
+        CONFIG_SCHEMA(CONFIG_KEY_BIT)
+    };
+};
+
+// Delivered by the config task after one or more changes; changedKeys has
+// the ConfigKeys bit of each setting that differs from the last delivery
+struct ConfigChange {
+    SystemConfig config;
+    uint32_t changedKeys;
+};
+
+struct ConfigField {
+    uint8_t tag;
+    ConfigType type;
+    uint16_t offset;    // in SystemConfig
+    uint16_t size;
+    uint32_t min;
+    uint32_t max;
+    const char* name;
+};
+
+class ConfigSchema {
+public:
+    static const ConfigField* find(uint8_t tag);
+    static const ConfigField* find(std::string_view name);
+    static const ConfigField* fields(size_t& count);
+
+    // Range-checked; false leaves config unchanged
+    static bool setNumber(SystemConfig& config, const ConfigField& field, uint32_t value);
+    static bool setText(SystemConfig& config, const ConfigField& field, const char* text, size_t length);
+
+    static uint32_t getNumber(const SystemConfig& config, const ConfigField& field);
+    static const char* getText(const SystemConfig& config, const ConfigField& field);
+
+    static bool equal(const SystemConfig& a, const SystemConfig& b, const ConfigField& field);
+    // ConfigKeys bits of the settings that differ
+    static uint32_t diff(const SystemConfig& a, const SystemConfig& b);
+};
+
+
+#endif /* INC_CONFIG_SCHEMA_HPP_ */
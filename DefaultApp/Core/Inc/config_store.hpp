@@ -0,0 +1,137 @@
+#ifndef INC_CONFIG_STORE_HPP_
+#define INC_CONFIG_STORE_HPP_
+
+#include<stdint.h>
+#include<stddef.h>
+#include "flash_device.hpp"
+#include "common_variables.hpp"
+
+struct ConfigStoreStats {
+    int activeSector;       // 0 or 1, -1 before the first write
+    uint32_t usedBytes;     // of the active sector, header included
+    uint32_t sectorSize;
+    uint32_t records;       // complete records in the active sector
+    uint32_t sequence;      // of the latest record
+    uint32_t deltas;        // records replayed after the checkpoint
+    uint32_t eraseCount[2];
+};
+
+// Append-only record log over two flash sectors used as a ping-pong pair,
+// so a save programs a few words instead of erasing a sector.
+//
+// Sector: [header][record][record]...[erased]
+//   header: magic, generation, erase count, CRC of the three; the sector
+//           with the newer generation is active
+//   record: [magic:16 | delta:1 | length:15][sequence][payload, 0xFF padded to words][crc]
+// The CRC is the hardware CRC (HwCrc) over everything before it and is
+// programmed last, so a record cut short by power loss never validates.
+// When the active sector is full the new record goes into the other one,
+// which is erased first and only becomes active once its header is
+// programmed after the record; until then the old sector still holds the
+// previous config.
+//
+// A record is either a checkpoint, holding the whole config, or a delta
+// holding only what changed since the record before it. Loading replays
+// the newest valid checkpoint and the records after it; the first record
+// of a sector is always a checkpoint. Writers keep chains under
+// CONFIG_STORE_MAX_DELTAS so the scan window always reaches the
+// checkpoint before the newest one.
+class ConfigStore {
+public:
+    ConfigStore(IFlashDevice& device, uint32_t firstSector, uint32_t secondSector, uint32_t sectorSize);
+
+    // Finds the active sector and the newest valid checkpoint; true when
+    // there is one
+    bool mount();
+
+    // Calls apply(payload, length) for the checkpoint and each valid record
+    // after it, oldest first; returns how many were applied
+    template<typename Apply>
+    size_t replay(Apply apply) const;
+
+    // A delta is refused when it would need a new sector (see fits), or
+    // when there is no checkpoint to apply it to
+    bool write(const void* payload, size_t length, bool delta = false);
+
+    // True when a record of this length still fits in the active sector
+    bool fits(size_t length) const;
+
+    // Erases both sectors
+    bool format();
+
+    const ConfigStoreStats& getStats() const { return stats; }
+
+private:
+    struct SectorHeader {
+        uint32_t magic;
+        uint32_t generation;
+        uint32_t eraseCount;
+        uint32_t crc;
+    };
+
+    static const uint32_t SECTOR_MAGIC = 0x53474643; // "CFGS"
+    static const uint16_t RECORD_MAGIC = 0xC0F1;
+    static const uint32_t RECORD_DELTA = 0x8000;     // in the length half-word
+    static const uint32_t LENGTH_MASK = 0x7FFF;
+    static const uint32_t ERASED = 0xFFFFFFFF;
+    static const size_t RECORD_OVERHEAD = 12;        // first word, sequence, crc
+    static const size_t SCAN_HISTORY = 2 * (CONFIG_STORE_MAX_DELTAS + 1);
+
+    // Records [from, to) of one sector are part of the replay. There are
+    // two when the active sector's checkpoint is corrupt: the chain in the
+    // previous sector, then what was appended after the bad checkpoint.
+    struct Segment {
+        int sector;
+        uint32_t from;
+        uint32_t to;
+    };
+
+    IFlashDevice& flash;
+    uint32_t sectors[2];
+    uint32_t sectorSize;
+
+    int32_t generation;
+    uint32_t writeOffset;   // next free byte in the active sector
+    Segment segments[2];
+    size_t segmentCount;    // 0 until there is a checkpoint
+    ConfigStoreStats stats;
+
+    uint32_t word(int sector, uint32_t offset) const;
+    bool readHeader(int sector, SectorHeader& header) const;
+    bool recordValid(int sector, uint32_t offset) const;
+    uint32_t recordLength(int sector, uint32_t offset) const { return (word(sector, offset) >> 16) & LENGTH_MASK; }
+    static uint32_t recordSize(size_t length) { return RECORD_OVERHEAD + ((length + 3) & ~3u); }
+
+    struct ScanResult {
+        uint32_t checkpoint;    // offset of the newest valid checkpoint, 0 if none
+        uint32_t freeOffset;
+        uint32_t records;       // complete records
+        uint32_t after;         // complete records after the checkpoint
+        uint32_t sequence;      // of the newest complete record
+    };
+
+    void scan(int sector, ScanResult& result) const;
+
+    bool appendRecord(int sector, uint32_t offset, const void* payload, size_t length, uint32_t sequence, bool delta);
+    bool commitHeader(int sector, uint32_t eraseCount);
+};
+
+template<typename Apply>
+size_t ConfigStore::replay(Apply apply) const {
+    size_t applied = 0;
+    for (size_t i = 0; i < segmentCount; i++) {
+        const Segment& segment = segments[i];
+        for (uint32_t offset = segment.from; offset < segment.to; offset += recordSize(recordLength(segment.sector, offset))) {
+            if ((word(segment.sector, offset) & 0xFFFF) != RECORD_MAGIC) break;
+            // Skips corrupt records; later ones were written on top of the
+            // config that was loaded without them
+            if (!recordValid(segment.sector, offset)) continue;
+            apply(flash.data(sectors[segment.sector] + offset + 8), (size_t)recordLength(segment.sector, offset));
+            applied++;
+        }
+    }
+    return applied;
+}
+
+
+#endif /* INC_CONFIG_STORE_HPP_ */
@@ -0,0 +1,84 @@
+#ifndef INC_CRASH_DUMP_HPP_
+#define INC_CRASH_DUMP_HPP_
+
+#include<stdint.h>
+
+// Included from stm32f4xx_it.c, so the part above the class stays plain C
+
+#define CRASH_STACK_WORDS 16
+
+typedef enum {
+    CRASH_NONE = 0,
+    CRASH_FAULT,          // HardFault, MemManage, BusFault or UsageFault; see exception
+    CRASH_MALLOC_FAILED,
+    CRASH_STACK_OVERFLOW
+} CrashReason;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t reason;     // CrashReason
+    uint32_t exception;  // IPSR: 3 HardFault, 4 MemManage, 5 BusFault, 6 UsageFault
+    uint32_t r0, r1, r2, r3, r12, lr, pc, xpsr; // stacked by the core
+    uint32_t excReturn;
+    uint32_t sp;         // stack pointer of the faulting context, after stacking
+    uint32_t cfsr, hfsr, mmfar, bfar;
+    uint32_t upTimeMs;
+    uint32_t crashCount; // crashes since the dump was last cleared
+    char task[16];
+    uint32_t stack[CRASH_STACK_WORDS]; // words above the exception frame
+    uint32_t checksum;
+} CrashRecord;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void crashDumpFault(uint32_t* frame, uint32_t excReturn) __attribute__((noreturn));
+void crashDumpSoftware(CrashReason reason, const char* task) __attribute__((noreturn));
+#ifdef __cplusplus
+}
+#endif
+
+// First statement of a fault handler: picks the stack the core pushed the
+// exception frame onto and tail-branches to crashDumpFault, which resets.
+// LR still holds EXC_RETURN because nothing has been called yet.
+#define CRASH_DUMP_FAULT_ENTRY() __asm volatile( \
+        "tst lr, #4        \n" \
+        "ite eq            \n" \
+        "mrseq r0, msp     \n" \
+        "mrsne r0, psp     \n" \
+        "mov r1, lr        \n" \
+        "b crashDumpFault  \n")
+
+#ifdef __cplusplus
+
+#include "response_writer.hpp"
+
+// Fault capture into .noinit RAM, a fixed window below the boot timing
+// record that the bootloader's linker script keeps out of its RAM. The
+// fault handlers and the FreeRTOS malloc-failed and stack-overflow hooks
+// write a CrashRecord and reset; the record survives the reset and stays
+// until `crash clear`, so a dump taken in the field can be read out on any
+// later boot.
+class CrashDump {
+public:
+    // Validates the retained record and enables the configurable fault
+    // handlers so faults are not all escalated to HardFault
+    static void init();
+
+    static bool available() { return valid; }
+    static const CrashRecord& get();
+    static void clear();
+
+    static void summarize(char* buffer, size_t size);
+    static void write(ResponseWriter& out);
+
+    static const char* exceptionName(uint32_t exception);
+
+private:
+    static bool valid;
+};
+
+#endif
+
+
+#endif /* INC_CRASH_DUMP_HPP_ */
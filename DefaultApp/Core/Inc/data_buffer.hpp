@@ -1,6 +1,9 @@
 #ifndef INC_DATA_BUFFER_HPP_
 #define INC_DATA_BUFFER_HPP_
 
+#include "DataStructure.hpp"
+#include "IObserver.hpp"
+#include "latency_trace.hpp"
 
 template<typename T>
 class CircularBuffer {
@@ -10,10 +13,11 @@ private:
     size_t tail;
     size_t count;
     size_t capacity;
+    uint32_t pushed; // sequence number of the next item
     SemaphoreHandle_t bufferMutex;
 
 public:
-    CircularBuffer(size_t size) : head(0), tail(0), count(0), capacity(size) {
+    CircularBuffer(size_t size) : head(0), tail(0), count(0), capacity(size), pushed(0) {
         buffer.resize(size);
         bufferMutex = xSemaphoreCreateMutex();
     }
@@ -26,6 +30,7 @@ public:
         if (xSemaphoreTake(bufferMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
             buffer[head] = item;
             head = (head + 1) % capacity;
+            pushed++;
 
             if (count < capacity) {
                 count++;
@@ -65,6 +70,47 @@ public:
         return count == capacity;
     }
 
+    // Every item pushed gets the next sequence number; items older than
+    // firstSequence() have been overwritten
+    uint32_t firstSequence() const { return pushed - count; }
+    uint32_t nextSequence() const { return pushed; }
+
+    // Copies up to maxItems items accepted by filter, starting at sequence,
+    // and looks at no more than maxScan items so the mutex is held briefly.
+    // sequence is moved past the items looked at (and forward to the oldest
+    // item if it pointed at overwritten ones); sequences receives each copied
+    // item's number when not null.
+    template<typename Filter>
+    size_t copyFrom(uint32_t& sequence, T* out, uint32_t* sequences, size_t maxItems, size_t maxScan, Filter filter) {
+        size_t copied = 0;
+        if (xSemaphoreTake(bufferMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
+            uint32_t first = pushed - count;
+            if ((int32_t)(sequence - first) < 0) sequence = first;
+            if ((int32_t)(sequence - pushed) > 0) sequence = pushed;
+
+            while (copied < maxItems && maxScan > 0 && sequence != pushed) {
+                const T& item = buffer[(tail + (sequence - first)) % capacity];
+                if (filter(item)) {
+                    out[copied] = item;
+                    if (sequences != nullptr) sequences[copied] = sequence;
+                    copied++;
+                }
+                sequence++;
+                maxScan--;
+            }
+            xSemaphoreGive(bufferMutex);
+        }
+        return copied;
+    }
+
+    void clear() {
+        if (xSemaphoreTake(bufferMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+            tail = head;
+            count = 0;
+            xSemaphoreGive(bufferMutex);
+        }
+    }
+
     std::vector<T> getAll() {
         std::vector<T> result;
         if (xSemaphoreTake(bufferMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
@@ -80,7 +126,7 @@ public:
     }
 };
 
-class DataStorage {
+class DataStorage : public IObserver<SensorData> {
 private:
     CircularBuffer<SensorData> sensorDataBuffer;
     CircularBuffer<LogMessage> logBuffer;
@@ -90,6 +136,8 @@ private:
     static const size_t LOG_BUFFER_SIZE = 500;
 
 public:
+    static const uint8_t ALL_SENSORS = 0xFF;
+
     DataStorage() : sensorDataBuffer(SENSOR_BUFFER_SIZE), logBuffer(LOG_BUFFER_SIZE) {
         storageMutex = xSemaphoreCreateMutex();
     }
@@ -102,18 +150,27 @@ public:
         sensorDataBuffer.push(data);
     }
 
+    void update(const SensorData& data) override {
+        LATENCY_SAMPLE(STORAGE_UPDATE, data);
+        storeSensorData(data);
+    }
+
     void storeLogMessage(const LogMessage& msg) {
         logBuffer.push(msg);
     }
 
-    std::vector<SensorData> getSensorHistory(uint32_t maxEntries = 0) {
-        std::vector<SensorData> history = sensorDataBuffer.getAll();
-        if (maxEntries > 0 && history.size() > maxEntries) {
-            history.erase(history.begin(), history.end() - maxEntries);
-        }
-        return history;
+    // Streams history in caller-sized blocks straight from the ring; call
+    // repeatedly with the updated sequence until it reaches
+    // getSensorNextSequence()
+    size_t readSensorHistory(uint32_t& sequence, uint8_t sensorId, SensorData* out, uint32_t* sequences, size_t maxItems) {
+        return sensorDataBuffer.copyFrom(sequence, out, sequences, maxItems, 64, [sensorId](const SensorData& data) {
+            return sensorId == ALL_SENSORS || data.sensorId == sensorId;
+        });
     }
 
+    uint32_t getSensorFirstSequence() const { return sensorDataBuffer.firstSequence(); }
+    uint32_t getSensorNextSequence() const { return sensorDataBuffer.nextSequence(); }
+
     std::vector<LogMessage> getLogHistory(uint32_t maxEntries = 0) {
         std::vector<LogMessage> history = logBuffer.getAll();
         if (maxEntries > 0 && history.size() > maxEntries) {
@@ -123,12 +180,12 @@ public:
     }
 
     void clearSensorHistory() {
-        // Clear by creating new buffer
-        sensorDataBuffer = CircularBuffer<SensorData>(SENSOR_BUFFER_SIZE);
+        // Sequence numbers keep counting, so a resumed export sees the gap
+        sensorDataBuffer.clear();
     }
 
     void clearLogHistory() {
-        logBuffer = CircularBuffer<LogMessage>(LOG_BUFFER_SIZE);
+        logBuffer.clear();
     }
 };
 
@@ -0,0 +1,93 @@
+#ifndef INC_FIRMWARE_UPDATE_HPP_
+#define INC_FIRMWARE_UPDATE_HPP_
+
+#include<stdint.h>
+#include<stddef.h>
+#include "boot_control.h"
+#include "flash_device.hpp"
+#include "response_writer.hpp"
+#include "common_variables.hpp"
+
+enum class UpdateResult : uint8_t {
+    OK = 0,
+    BAD_STATE = 1,   // nothing begun, or the running image is still on trial
+    BAD_LENGTH = 2,
+    BAD_OFFSET = 3,  // not the next chunk; the host resumes from nextOffset
+    FLASH_ERROR = 4,
+    BAD_IMAGE = 5    // header, vectors or CRC wrong, or linked for the other slot
+};
+
+enum class UpdateState : uint8_t {
+    IDLE = 0,
+    RECEIVING = 1,
+    READY = 2        // verified, boots on the next reset
+};
+
+struct SlotInfo {
+    bool hasImage;       // image header present, not checked further
+    uint32_t version;
+    bool sequenced;
+    uint32_t sequence;
+    bool confirmed;
+    bool rejected;
+    uint32_t attempts;   // trial boots used
+};
+
+// A/B update while the gateway keeps running. The application runs from one
+// slot and receives the next image into the other, then makes it the next
+// to boot with a single flash word (see boot_control.h), so the update
+// costs one reset. The bootloader boots the new image on trial; it confirms
+// itself through SystemMonitor after BOOT_CONFIRM_DELAY_MS without errors,
+// otherwise the bootloader goes back to this slot after BOOT_MAX_ATTEMPTS
+// boots. begin, write and finish are called from the CLI task only.
+class FirmwareUpdate {
+public:
+    // Finds the running slot from the vector table; call once at boot
+    static void init();
+
+    static int getRunningSlot() { return runningSlot; }
+    static int getTargetSlot() { return 1 - runningSlot; }
+    static const char* slotName(int slot) { return slot == 0 ? "A" : "B"; }
+
+    static bool isTrial();
+    // Marks the running image good; the bootloader stops counting attempts
+    static bool confirm();
+    static void readSlot(int slot, SlotInfo& info);
+
+    // Erases the target slot. Refused while the running image is on trial:
+    // the target slot then holds the image to roll back to.
+    static UpdateResult begin(uint32_t imageLength);
+    // Chunks in order, multiples of 4 bytes; a chunk already written is
+    // accepted again, so a host can resend after a lost reply
+    static UpdateResult write(uint32_t offset, const uint8_t* data, size_t size);
+    // Checks the image like the bootloader does and makes it the next to boot
+    static UpdateResult finish();
+
+    static UpdateState getState() { return state; }
+    static uint32_t getNextOffset() { return nextOffset; }
+    static uint32_t getLength() { return length; }
+    static const char* resultName(UpdateResult result);
+
+    static void describe(ResponseWriter& out);
+
+private:
+    static InternalFlash flash;
+    static int runningSlot;
+    static UpdateState state;
+    static uint32_t length;
+    static uint32_t nextOffset;
+
+    static uint32_t slotAddress(int slot) { return slot == 0 ? BOOT_SLOT_A_ADDRESS : BOOT_SLOT_B_ADDRESS; }
+    static uint32_t slotSize(int slot) { return slot == 0 ? BOOT_SLOT_A_SIZE : BOOT_SLOT_B_SIZE; }
+    static const volatile BootTrailer* trailer(int slot) { return BOOT_TRAILER(slotAddress(slot), slotSize(slot)); }
+    static bool sequenceValid(const volatile BootTrailer* t) {
+        return t->sequence != BOOT_WORD_ERASED && t->sequenceCheck == ~t->sequence;
+    }
+
+    static bool eraseSlot(int slot);
+    static bool programWord(const volatile uint32_t* word, uint32_t value);
+    static bool imageValid(int slot);
+};
+
+
+#endif /* INC_FIRMWARE_UPDATE_HPP_ */
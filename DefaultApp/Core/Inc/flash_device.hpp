@@ -0,0 +1,36 @@
+#ifndef INC_FLASH_DEVICE_HPP_
+#define INC_FLASH_DEVICE_HPP_
+
+#include<stdint.h>
+#include<stddef.h>
+
+// NOR flash as the config store sees it: erasing sets a whole sector to
+// 0xFF, programming can only clear bits and works in 32-bit words, reads
+// are memory mapped. A host build can put a simulated device behind this.
+class IFlashDevice {
+public:
+    virtual ~IFlashDevice() = default;
+
+    virtual bool eraseSector(uint32_t sectorAddress) = 0;
+    virtual bool program(uint32_t address, const uint32_t* words, size_t count) = 0;
+    virtual const uint8_t* data(uint32_t address) const = 0;
+};
+
+// STM32F411 internal flash, 2.7-3.6 V range. The part has a single bank,
+// so the CPU stalls on instruction fetch while a sector erases (~1 s for
+// 128 KB) or a word programs.
+class InternalFlash : public IFlashDevice {
+public:
+    bool eraseSector(uint32_t sectorAddress) override;
+    bool program(uint32_t address, const uint32_t* words, size_t count) override;
+    const uint8_t* data(uint32_t address) const override {
+        return reinterpret_cast<const uint8_t*>(address);
+    }
+
+private:
+    static int sectorNumber(uint32_t sectorAddress);
+    static void flushDataCache();
+};
+
+
+#endif /* INC_FLASH_DEVICE_HPP_ */
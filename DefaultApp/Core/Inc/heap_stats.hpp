@@ -0,0 +1,93 @@
+#ifndef INC_HEAP_STATS_HPP_
+#define INC_HEAP_STATS_HPP_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include<stdint.h>
+#include<stddef.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#ifdef __cplusplus
+}
+#endif
+
+// Owner of an allocation. A task is tagged with its module when it is
+// created; allocations made before the scheduler starts go to the module
+// set with setInitModule().
+enum class HeapModule : uint8_t {
+    other,
+    app,
+    sensor,
+    cli,
+    logger,
+    protocol,
+    stream,
+    storage,
+    config,
+    monitor,
+    COUNT
+};
+
+struct HeapUsage {
+    uint32_t liveBytes;
+    uint32_t peakBytes;
+    uint32_t allocations; // total since boot
+    uint32_t frees;
+};
+
+struct RtosHeapUsage {
+    HeapUsage usage;             // heap_4 block sizes, headers included
+    uint32_t freeBytes;
+    uint32_t minimumEverFree;
+    uint32_t largestFreeBlock;
+    uint32_t freeBlocks;
+};
+
+// Accounting for both heaps: global operator new/delete (newlib malloc,
+// used by every std container) with an 8-byte header naming the owning
+// module, and the FreeRTOS heap_4 through its traceMALLOC/traceFREE hooks.
+// heap_4 blocks carry no owner, so the RTOS heap is accounted as a whole.
+class HeapStats {
+public:
+    static const char* moduleName(HeapModule module);
+
+    static void tagTask(TaskHandle_t task, HeapModule module);
+    static void setInitModule(HeapModule module) { initModule = module; }
+
+    static HeapUsage getTotal();
+    static HeapUsage getModule(HeapModule module);
+    static RtosHeapUsage getRtosHeap();
+    static uint32_t getFailures() { return failures; }
+    static uint32_t getCorruptions() { return corruptions; }
+
+    // Called from operator new/delete and the FreeRTOS trace hooks
+    static void* allocate(size_t size);
+    static void release(void* pointer);
+    static void rtosAllocated(void* pointer, size_t blockSize);
+    static void rtosFreed(void* pointer, size_t blockSize);
+
+private:
+    struct AllocationHeader {
+        uint32_t size;
+        uint16_t module;
+        uint16_t magic;
+    };
+    static_assert(sizeof(AllocationHeader) == 8, "header must keep 8-byte alignment");
+
+    static const uint16_t HEADER_MAGIC = 0xA110;
+
+    static HeapUsage total;
+    static HeapUsage modules[(size_t)HeapModule::COUNT];
+    static HeapUsage rtos;
+    static HeapModule initModule;
+    static uint32_t failures;
+    static uint32_t corruptions;
+
+    static HeapModule currentModule();
+    static void add(HeapUsage& usage, uint32_t size);
+    static void remove(HeapUsage& usage, uint32_t size);
+};
+
+
+#endif /* INC_HEAP_STATS_HPP_ */
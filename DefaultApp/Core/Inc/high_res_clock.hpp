@@ -0,0 +1,43 @@
+#ifndef INC_HIGH_RES_CLOCK_HPP_
+#define INC_HIGH_RES_CLOCK_HPP_
+
+#include<stdint.h>
+
+// Sub-microsecond time base built on the Cortex-M4 DWT cycle counter.
+// CYCCNT is 32 bits and wraps every ~44 s at 96 MHz, so now() extends it to
+// 64 bits in software. A call per wrap period keeps the extension exact
+// (SystemMonitor calls every second); wraps missed over a longer gap are
+// counted from the millisecond tick, which only has to be right to within
+// half a wrap period.
+class HighResClock {
+public:
+    typedef uint32_t (*CycleSource)();
+    typedef uint32_t (*MillisSource)();
+
+    static void init();
+
+    // Replace the DWT counter with another free-running 32-bit source,
+    // e.g. a host stand-in clock or a 32-bit timer (TIM2/TIM5). Without a
+    // millisecond source a gap of a wrap period or more loses time.
+    static void setSource(CycleSource cycleSource, uint32_t frequencyHz, MillisSource millisSource = nullptr);
+
+    // Raw 32-bit count, good for intervals shorter than one wrap period
+    static uint32_t cycles() { return source(); }
+    static uint64_t now();
+    static uint64_t nowUs() { return now() / cyclesPerUs; }
+
+    static uint32_t cyclesToUs(uint32_t cycleCount) { return cycleCount / cyclesPerUs; }
+    static uint32_t getFrequency() { return frequency; }
+
+private:
+    static CycleSource source;
+    static MillisSource millis;
+    static uint32_t frequency;
+    static uint32_t cyclesPerUs;
+    static uint32_t lastCycles;
+    static uint32_t lastMillis;
+    static uint64_t total;
+};
+
+
+#endif /* INC_HIGH_RES_CLOCK_HPP_ */
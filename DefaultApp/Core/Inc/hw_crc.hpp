@@ -0,0 +1,24 @@
+#ifndef INC_HW_CRC_HPP_
+#define INC_HW_CRC_HPP_
+
+#include<stdint.h>
+#include<stddef.h>
+
+// CRC-32 on the STM32 CRC unit: polynomial 0x04C11DB7, init 0xFFFFFFFF,
+// no reflection, no final xor. The unit only takes 32-bit words, so data is
+// fed as little-endian words and a trailing partial word is zero-padded.
+// Tools/gateway_protocol.py implements the same algorithm for the host.
+class HwCrc {
+public:
+    static void init();
+    static uint32_t compute(const uint8_t* data, size_t length);
+    // With [skipOffset, skipOffset + skipLength) left out, as for the image
+    // header; skipOffset and skipLength are multiples of 4
+    static uint32_t compute(const uint8_t* data, size_t length, size_t skipOffset, size_t skipLength);
+
+private:
+    static void feed(const uint8_t* data, size_t length);
+};
+
+
+#endif /* INC_HW_CRC_HPP_ */
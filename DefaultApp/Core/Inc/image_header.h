@@ -0,0 +1,29 @@
+/*
+ * image_header.h
+ *
+ * Firmware image header, shared by the bootloader and the application.
+ */
+
+#ifndef INC_IMAGE_HEADER_H_
+#define INC_IMAGE_HEADER_H_
+
+#include <stdint.h>
+
+// The header sits IMAGE_HEADER_OFFSET bytes into the image, just past the
+// vector table. The application links it with magic and version filled in;
+// Tools/image_tool.py stamps length, CRC and entry into the .bin afterwards.
+// The CRC is the STM32 hardware CRC over the first `length` bytes of the
+// image with the header itself left out.
+#define IMAGE_HEADER_OFFSET 0x200
+#define IMAGE_MAGIC 0x4D494753 // "SGIM"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;     // major << 16 | minor << 8 | patch
+    uint32_t length;      // bytes from the start of the image, multiple of 4
+    uint32_t crc;
+    uint32_t entry;       // reset handler, must match the vector table
+    uint32_t reserved[3];
+} ImageHeader;
+
+#endif /* INC_IMAGE_HEADER_H_ */
@@ -0,0 +1,77 @@
+#ifndef INC_LATENCY_TRACE_HPP_
+#define INC_LATENCY_TRACE_HPP_
+
+#include<stdint.h>
+#include<stddef.h>
+#include "common_variables.hpp"
+#include "high_res_clock.hpp"
+
+// Stages of the sample pipeline. SENSOR_READ is the duration of the SPI
+// read itself; every later stage is the age of the sample, measured from
+// the end of its read (SensorData::timestamp), when it reaches that point.
+enum class LatencyStage : uint8_t {
+    SENSOR_READ,
+    ENQUEUE,        // posted to the SensorManager queue
+    DEQUEUE,        // taken off it by the sensor task
+    CLI_UPDATE,     // observers, in registration order
+    STREAM_UPDATE,
+    STORAGE_UPDATE,
+    STREAM_TX,      // handed to the UART TX service by the streamer
+    COUNT
+};
+
+struct LatencySummary {
+    uint32_t count;
+    uint32_t p50Us; // percentiles are bucket upper bounds, within 25%
+    uint32_t p99Us;
+    uint32_t maxUs;
+};
+
+// Per-stage log-linear histograms of microsecond latencies: four buckets per
+// power of two up to 2^LATENCY_MAX_OCTAVE us. Recording is a bucket lookup
+// and two increments with interrupts masked.
+class LatencyTrace {
+public:
+    static void record(LatencyStage stage, uint32_t us);
+
+    static void recordSpan(LatencyStage stage, uint32_t startCycles) {
+        record(stage, HighResClock::cyclesToUs(HighResClock::cycles() - startCycles));
+    }
+
+    static void recordSinceSample(LatencyStage stage, uint64_t sampleTimestampUs) {
+        uint64_t now = HighResClock::nowUs();
+        record(stage, now > sampleTimestampUs ? (uint32_t)(now - sampleTimestampUs) : 0);
+    }
+
+    static LatencySummary summarize(LatencyStage stage);
+    static const char* stageName(LatencyStage stage);
+    static void reset();
+
+private:
+    static const size_t SUB_BUCKETS = 4;
+    static const size_t BUCKETS = SUB_BUCKETS + (LATENCY_MAX_OCTAVE - 1) * SUB_BUCKETS;
+
+    struct Histogram {
+        uint32_t buckets[BUCKETS];
+        uint32_t count;
+        uint32_t maxUs;
+    };
+
+    static Histogram histograms[(size_t)LatencyStage::COUNT];
+
+    static size_t bucketOf(uint32_t us);
+    static uint32_t bucketUpperBound(size_t bucket);
+};
+
+#if LATENCY_TRACE_ENABLED
+#define LATENCY_BEGIN(name) uint32_t name = HighResClock::cycles()
+#define LATENCY_SPAN(stage, name) LatencyTrace::recordSpan(LatencyStage::stage, name)
+#define LATENCY_SAMPLE(stage, data) LatencyTrace::recordSinceSample(LatencyStage::stage, (data).timestamp)
+#else
+#define LATENCY_BEGIN(name)
+#define LATENCY_SPAN(stage, name) ((void)0)
+#define LATENCY_SAMPLE(stage, data) ((void)0)
+#endif
+
+
+#endif /* INC_LATENCY_TRACE_HPP_ */
@@ -0,0 +1,105 @@
+#ifndef INC_METRICS_HPP_
+#define INC_METRICS_HPP_
+
+#include<stdint.h>
+#include<stddef.h>
+#include<atomic>
+#include "common_variables.hpp"
+#include "response_writer.hpp"
+
+// Updates are relaxed atomics: one LDREX/STREX loop, safe from any task or
+// ISR and never blocking. Readers see each value whole but not a consistent
+// snapshot across metrics.
+
+class Counter {
+public:
+    void inc(uint32_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    uint32_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint32_t> value{0};
+};
+
+class Gauge {
+public:
+    void set(int32_t newValue) { value.store(newValue, std::memory_order_relaxed); }
+    void add(int32_t delta) { value.fetch_add(delta, std::memory_order_relaxed); }
+    int32_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int32_t> value{0};
+};
+
+// Fixed buckets: bounds are ascending inclusive upper limits, one more bucket
+// takes everything above the last. observe() is two atomic adds, the bucket
+// and the sum.
+class Histogram {
+public:
+    Histogram(const uint32_t* upperBounds, size_t count)
+        : bounds(upperBounds), boundCount(count < METRICS_MAX_BUCKETS ? count : METRICS_MAX_BUCKETS) {}
+
+    void observe(uint32_t value) {
+        size_t i = 0;
+        while (i < boundCount && value > bounds[i]) i++;
+        buckets[i].fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    size_t getBoundCount() const { return boundCount; }
+    uint32_t getBound(size_t i) const { return bounds[i]; }
+    uint32_t getBucket(size_t i) const { return buckets[i].load(std::memory_order_relaxed); } // not cumulative
+    uint32_t getSum() const { return sum.load(std::memory_order_relaxed); }
+
+private:
+    const uint32_t* bounds;
+    size_t boundCount;
+    std::atomic<uint32_t> buckets[METRICS_MAX_BUCKETS + 1] = {};
+    std::atomic<uint32_t> sum{0};
+};
+
+enum class MetricType : uint8_t {
+    COUNTER = 0,
+    GAUGE = 1,
+    HISTOGRAM = 2
+};
+
+// Registry of statically allocated metrics. Modules register theirs at init;
+// names follow Prometheus conventions (snake_case, counters end in _total).
+//
+// Binary form (see BinaryProtocol GET_METRICS), one record per metric in
+// registration order, little-endian:
+//   values:   [type:1][n:1][n x uint32] - counter or gauge: the value;
+//             histogram: every bucket, then the sum
+//   describe: [type:1][n:1][n x uint32 bounds][nameLength:1][name]
+class Metrics {
+public:
+    static bool add(const char* name, const char* help, Counter& counter);
+    static bool add(const char* name, const char* help, Gauge& gauge);
+    static bool add(const char* name, const char* help, Histogram& histogram);
+
+    static size_t getCount() { return count; }
+    static const Counter* findCounter(const char* name);
+
+    // Prometheus text exposition, ends with "# EOF"
+    static void writeText(ResponseWriter& out);
+
+    // Packs whole records from index on into buffer and advances index;
+    // returns the bytes used
+    static size_t encode(size_t& index, bool describe, uint8_t* buffer, size_t size);
+
+private:
+    struct Entry {
+        const char* name;
+        const char* help;
+        MetricType type;
+        void* metric;
+    };
+
+    static Entry entries[METRICS_MAX];
+    static size_t count;
+
+    static bool add(const char* name, const char* help, MetricType type, void* metric);
+};
+
+
+#endif /* INC_METRICS_HPP_ */
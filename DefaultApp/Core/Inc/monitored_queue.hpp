@@ -0,0 +1,122 @@
+#ifndef INC_MONITORED_QUEUE_HPP_
+#define INC_MONITORED_QUEUE_HPP_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include<stdint.h>
+#include<stddef.h>
+#include "FreeRTOS.h"
+#include "queue.h"
+#ifdef __cplusplus
+}
+#endif
+
+#include<atomic>
+#include<type_traits>
+#include "high_res_clock.hpp"
+#include "common_variables.hpp"
+
+struct QueueHealth {
+    const char* name;
+    uint32_t capacity;
+    uint32_t waiting;
+    uint32_t highWater;
+    uint32_t sent;
+    uint32_t sendFailures;  // full, item dropped or the wait timed out
+    uint32_t received;
+    uint32_t blockedUs;     // total time senders spent waiting for space
+    uint32_t residencyUs;   // average over the last check() window
+    bool saturated;
+};
+
+// Health of one FreeRTOS queue. The queue is added to the kernel queue
+// registry under its name, so debuggers and trace dumps show it too.
+// Counters are atomics updated by senders and receivers; check(), called
+// once a second by SystemMonitor, turns them into per-window figures and
+// raises an alarm when a queue stays nearly full or keeps rejecting items
+// for QUEUE_SATURATION_SECONDS.
+class QueueMonitor {
+public:
+    // Returns the number of queues that newly became saturated
+    static size_t check();
+
+    static size_t report(QueueHealth* out, size_t maxQueues);
+
+    QueueHandle_t getHandle() const { return handle; }
+    size_t waiting() const { return uxQueueMessagesWaiting(handle); }
+
+protected:
+    QueueHandle_t handle;
+
+    QueueMonitor(const char* queueName, uint32_t queueCapacity, size_t slotSize);
+    ~QueueMonitor();
+
+    void recordSend(bool sent, uint32_t blockedCycles);
+    void recordReceive(uint32_t enqueuedCycles);
+
+private:
+    const char* name;
+    uint32_t capacity;
+
+    std::atomic<uint32_t> highWater;
+    std::atomic<uint32_t> sentCount;
+    std::atomic<uint32_t> failureCount;
+    std::atomic<uint32_t> receivedCount;
+    std::atomic<uint32_t> blockedUs;
+    std::atomic<uint32_t> residencyUs;
+
+    // check() state, monitor task only
+    uint32_t lastReceived;
+    uint32_t lastResidencyUs;
+    uint32_t lastFailures;
+    uint32_t windowResidencyUs;
+    uint32_t fullSeconds;
+    bool saturated;
+
+    static QueueMonitor* monitors[QUEUE_MONITOR_MAX];
+    static size_t count;
+
+    void checkOne(size_t& newlySaturated);
+};
+
+// Typed queue; items are copied in with the cycle count they were sent at,
+// which gives the time they spent queued
+template<typename T>
+class MonitoredQueue : public QueueMonitor {
+    static_assert(std::is_trivially_copyable<T>::value, "FreeRTOS copies queue items bytewise");
+
+    struct Slot {
+        T item;
+        uint32_t enqueuedCycles;
+    };
+
+public:
+    MonitoredQueue(const char* name, uint32_t capacity) : QueueMonitor(name, capacity, sizeof(Slot)) {}
+
+    bool send(const T& item, TickType_t wait) {
+        uint32_t started = HighResClock::cycles();
+        Slot slot = {item, started};
+        bool sent = xQueueSend(handle, &slot, wait) == pdTRUE;
+        recordSend(sent, wait > 0 ? HighResClock::cycles() - started : 0);
+        return sent;
+    }
+
+    bool sendFromIsr(const T& item, BaseType_t* higherPriorityTaskWoken) {
+        Slot slot = {item, HighResClock::cycles()};
+        bool sent = xQueueSendFromISR(handle, &slot, higherPriorityTaskWoken) == pdTRUE;
+        recordSend(sent, 0);
+        return sent;
+    }
+
+    bool receive(T& item, TickType_t wait) {
+        Slot slot;
+        if (xQueueReceive(handle, &slot, wait) != pdTRUE) return false;
+        item = slot.item;
+        recordReceive(slot.enqueuedCycles);
+        return true;
+    }
+};
+
+
+#endif /* INC_MONITORED_QUEUE_HPP_ */
@@ -0,0 +1,80 @@
+#ifndef INC_RESPONSE_WRITER_HPP_
+#define INC_RESPONSE_WRITER_HPP_
+
+#include<stdint.h>
+#include<stddef.h>
+#include<stdio.h>
+#include<stdarg.h>
+#include<string.h>
+#include<string_view>
+#include "common_variables.hpp"
+
+// Destination of raw output bytes (a UART, a test buffer)
+class IByteSink {
+public:
+    virtual ~IByteSink() = default;
+    virtual void transmit(const uint8_t* data, size_t size) = 0;
+};
+
+// Bounded output sink for command responses. Output is staged in a fixed
+// chunk and handed to the sink whenever the chunk fills, so memory use does
+// not depend on the response size and the first bytes leave early.
+class ResponseWriter {
+private:
+    IByteSink& sink;
+    char chunk[CLI_RESPONSE_CHUNK_SIZE];
+    size_t length;
+    size_t total;
+
+public:
+    explicit ResponseWriter(IByteSink& output) : sink(output), length(0), total(0) {}
+    ~ResponseWriter() { flush(); }
+
+    ResponseWriter(const ResponseWriter&) = delete;
+    ResponseWriter& operator=(const ResponseWriter&) = delete;
+
+    void write(std::string_view text) {
+        while (!text.empty()) {
+            size_t count = sizeof(chunk) - length;
+            if (count > text.size()) count = text.size();
+            memcpy(&chunk[length], text.data(), count);
+            length += count;
+            text.remove_prefix(count);
+            if (length == sizeof(chunk)) flush();
+        }
+    }
+
+    // One formatted piece must fit in a chunk; longer output is truncated
+    void print(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, format);
+        va_list retry;
+        va_copy(retry, args);
+
+        int needed = vsnprintf(&chunk[length], sizeof(chunk) - length, format, args);
+        if (needed >= 0 && (size_t)needed >= sizeof(chunk) - length && length > 0) {
+            // Did not fit behind what is already staged; send that and redo
+            flush();
+            needed = vsnprintf(chunk, sizeof(chunk), format, retry);
+        }
+        if (needed > 0) {
+            length += (size_t)needed < sizeof(chunk) - length ? (size_t)needed : sizeof(chunk) - 1 - length;
+        }
+
+        va_end(retry);
+        va_end(args);
+    }
+
+    void flush() {
+        if (length > 0) {
+            sink.transmit((const uint8_t*)chunk, length);
+            total += length;
+            length = 0;
+        }
+    }
+
+    size_t bytesWritten() const { return total + length; }
+};
+
+
+#endif /* INC_RESPONSE_WRITER_HPP_ */
@@ -13,6 +13,9 @@ extern "C" {
 #include "DataStructure.hpp"
 #include "system_logger.hpp"
 #include "IObserver.hpp"
+#include "metrics.hpp"
+#include "monitored_queue.hpp"
+#include "config_schema.hpp"
 #include<memory>
 
 class ISensor{
@@ -71,18 +74,23 @@ public:
     void reset() override;
 };
 
-class SensorManager: public Observable<SensorData>{
+class SensorManager: public Observable<SensorData>, public IObserver<ConfigChange> {
 
     std::vector<std::unique_ptr<ISensor>> sensors;
-    osMessageQId sensorDataQueue;
+    MonitoredQueue<SensorData> sensorDataQueue;
     osSemaphoreId sensorMutex;
     osThreadId sensorTaskId;
     TimerHandle_t sensorTimer;
     SPI_HandleTypeDef* hspi;
     uint32_t readInterval;
     bool isRunning;
+    int taskWatchdogId;
+    int readWatchdogId; // sampling runs in the timer task
 
-    static void sensorTask(void* parameter);
+    Counter samplesRead;
+    Counter readErrors;
+
+    static void sensorTask(const void* parameter);
     static void sensorTimerCallback(TimerHandle_t xTimer);
     void processSensorData();
 
@@ -97,12 +105,15 @@ public:
     void removeSensor(uint8_t sensorId);
     std::vector<SensorData> getAllSensorData();
     SensorData getSensorData(uint8_t sensorId);
+    // Retimes the running sensor timer; the read watchdog deadline follows
     void setReadInterval(uint32_t interval);
+    uint32_t getReadInterval() const { return readInterval; }
+    void update(const ConfigChange& change) override;
     uint32_t getActiveSensorCount();
     bool performSelfTest();
     void resetAllSensors();
 
-    QueueHandle_t getSensorDataQueue() const { return sensorDataQueue; }
+    QueueHandle_t getSensorDataQueue() const { return sensorDataQueue.getHandle(); }
 };
 
 
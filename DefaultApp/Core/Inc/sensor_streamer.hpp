@@ -0,0 +1,122 @@
+#ifndef INC_SENSOR_STREAMER_HPP_
+#define INC_SENSOR_STREAMER_HPP_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "cmsis_os.h"
+#include "queue.h"
+#ifdef __cplusplus
+}
+#endif
+
+#include "DataStructure.hpp"
+#include "IObserver.hpp"
+#include "binary_protocol.hpp"
+#include "common_variables.hpp"
+#include "metrics.hpp"
+#include "monitored_queue.hpp"
+
+class CLIManager;
+
+enum class StreamMode {
+    RATE,      // at most rateHz samples per second per sensor
+    ON_CHANGE  // only when the value moved by more than the deadband
+};
+
+enum class StreamFormat {
+    BINARY,    // SENSOR_PUSH frames
+    TEXT
+};
+
+// What happens to samples the link cannot keep up with
+enum class BackPressurePolicy {
+    DROP,      // newest samples are discarded
+    AGGREGATE  // folded per sensor into one averaged sample
+};
+
+struct StreamSubscription {
+    uint32_t sensorMask;    // bit n = sensor id n
+    StreamMode mode;
+    uint32_t rateHz;
+    float deadband;
+    uint8_t batchSize;      // samples per frame, 1..SAMPLES_PER_FRAME
+    StreamFormat format;
+    BackPressurePolicy policy;
+
+    StreamSubscription() : sensorMask(0xFFFFFFFF), mode(StreamMode::RATE), rateHz(1), deadband(0.0f),
+                           batchSize(1), format(StreamFormat::BINARY), policy(BackPressurePolicy::DROP) {}
+};
+
+struct StreamStats {
+    uint32_t samplesIn;
+    uint32_t samplesFiltered;
+    uint32_t samplesSent;
+    uint32_t framesSent;
+    uint32_t samplesDropped;
+    uint32_t samplesAggregated;
+
+    StreamStats() : samplesIn(0), samplesFiltered(0), samplesSent(0), framesSent(0),
+                    samplesDropped(0), samplesAggregated(0) {}
+};
+
+// Pushes sensor samples to the CLI link as they are produced. update() runs
+// in the sensor timer's context, so it only filters and queues; the stream
+// task batches and transmits, and a slow link shows up as a full queue.
+class SensorStreamer : public IObserver<SensorData> {
+public:
+    static const uint8_t MAX_SENSOR_ID = 32;
+
+private:
+    struct SensorState {
+        uint64_t lastTimestamp;
+        float lastValue;
+        bool hasSent;
+        // Overflow aggregate, AGGREGATE policy only
+        float overflowSum;
+        uint32_t overflowCount;
+        SensorData overflowLatest;
+    };
+
+    CLIManager* cliManager;
+    BinaryProtocol* protocol;
+    MonitoredQueue<SensorData> sampleQueue;
+    osThreadId streamTaskId;
+    int watchdogId;
+    Histogram frameSamples;
+
+    // Written by the CLI task, read by update(); both sides use a critical section
+    StreamSubscription subscription;
+    bool active;
+    uint32_t rateIntervalUs;
+    SensorState sensorState[MAX_SENSOR_ID];
+    StreamStats stats;
+
+    // Stream task only
+    SensorData batch[BinaryProtocol::SAMPLES_PER_FRAME];
+    size_t batchCount;
+    TickType_t batchStarted;
+
+    static void streamTask(const void* parameter);
+    bool accept(const SensorData& data);
+    void drainAggregates();
+    void addToBatch(const SensorData& data, const StreamSubscription& current);
+    void flushBatch(const StreamSubscription& current);
+    void sendText(const SensorData* samples, size_t count);
+
+public:
+    SensorStreamer(CLIManager* cli, BinaryProtocol* binaryProtocol);
+    ~SensorStreamer();
+
+    void init();
+    void subscribe(const StreamSubscription& newSubscription);
+    void unsubscribe();
+    void update(const SensorData& data) override;
+
+    bool isActive() const { return active; }
+    StreamSubscription getSubscription() const;
+    const StreamStats& getStats() const { return stats; }
+};
+
+
+#endif /* INC_SENSOR_STREAMER_HPP_ */
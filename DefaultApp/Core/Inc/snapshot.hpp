@@ -0,0 +1,63 @@
+#ifndef INC_SNAPSHOT_HPP_
+#define INC_SNAPSHOT_HPP_
+
+#include<stdint.h>
+#include<string.h>
+#include<atomic>
+#include<type_traits>
+
+// Lock-free snapshots of a small struct for many readers and a rare writer.
+// Two buffers: publish() fills the one readers are not using, then flips
+// the version with a release store. read() copies the current buffer and
+// retries if the version moved at all meanwhile. One publish alone writes
+// the other buffer, but the next one starts overwriting the buffer being
+// copied before its version store, so a reader seeing a single step cannot
+// tell the two apart. Retries are as rare as publishes during a copy.
+//
+// A seqlock would make a reader spin while a write is in progress; on one
+// core a higher priority reader would then spin forever over the writer
+// it preempted. Here a reader never waits for a writer, so read() is safe
+// from any task or ISR. Writers must be serialized by the caller.
+template<typename T>
+class Snapshot {
+    static_assert(std::is_trivially_copyable<T>::value, "snapshots are copied with memcpy");
+
+public:
+    explicit Snapshot(const T& initial = T()) : version(0), retries(0) {
+        buffers[0] = initial;
+        buffers[1] = initial;
+    }
+
+    T read() const {
+        T copy;
+        for (;;) {
+            uint32_t before = version.load(std::memory_order_acquire);
+            memcpy(static_cast<void*>(&copy), &buffers[before & 1], sizeof(T));
+            // The copy must complete before the version is checked again
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (version.load(std::memory_order_relaxed) == before) return copy;
+            retries.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void publish(const T& value) {
+        uint32_t current = version.load(std::memory_order_relaxed);
+        // The previous version flip must be visible before this buffer
+        // changes, or a reader still copying it could miss the flip
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(static_cast<void*>(&buffers[(current + 1) & 1]), &value, sizeof(T));
+        version.store(current + 1, std::memory_order_release);
+    }
+
+    // Changes with every publish; cheap to poll for changes
+    uint32_t getVersion() const { return version.load(std::memory_order_acquire); }
+    uint32_t getRetries() const { return retries.load(std::memory_order_relaxed); }
+
+private:
+    T buffers[2];
+    std::atomic<uint32_t> version;
+    mutable std::atomic<uint32_t> retries;
+};
+
+
+#endif /* INC_SNAPSHOT_HPP_ */
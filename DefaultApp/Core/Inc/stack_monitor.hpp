@@ -0,0 +1,53 @@
+#ifndef INC_STACK_MONITOR_HPP_
+#define INC_STACK_MONITOR_HPP_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include<stdint.h>
+#include<stddef.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#ifdef __cplusplus
+}
+#endif
+
+#include "common_variables.hpp"
+
+struct StackBudget {
+    const char* name;
+    uint32_t stackWords;       // as passed to osThreadDef
+    uint32_t minFreeWords;     // least free ever seen
+    uint32_t recommendedWords; // peak use plus margin
+};
+
+// Stack headroom of every task that registers its stack size at creation.
+// SystemMonitor calls check() periodically; it samples the high-water marks,
+// keeps the minimum, and warns once per task when free space drops below
+// STACK_WARN_PERCENT. The report recommends sizes from the observed peak, so
+// it is only as good as the run that exercised the tasks.
+class StackMonitor {
+public:
+    static void watch(TaskHandle_t task, uint32_t stackWords);
+
+    // Returns the number of tasks newly below the warning threshold
+    static size_t check();
+
+    static size_t report(StackBudget* out, size_t maxTasks);
+
+private:
+    struct WatchedStack {
+        TaskHandle_t task;
+        uint32_t stackWords;
+        uint32_t minFreeWords;
+        bool warned;
+    };
+
+    static WatchedStack stacks[STACK_MONITOR_MAX_TASKS];
+    static size_t count;
+
+    static uint32_t recommend(uint32_t stackWords, uint32_t minFreeWords);
+};
+
+
+#endif /* INC_STACK_MONITOR_HPP_ */
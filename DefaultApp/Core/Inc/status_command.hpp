@@ -0,0 +1,73 @@
+#ifndef INC_STATUS_COMMAND_HPP_
+#define INC_STATUS_COMMAND_HPP_
+
+#include "cli_dispatcher.hpp"
+#include "uart_stats.hpp"
+#include "DataStructure.hpp"
+#include "watchdog_supervisor.hpp"
+
+// What the status command reports; CLIManager provides it on the target
+class IStatusSource {
+public:
+    virtual ~IStatusSource() = default;
+    virtual const SystemStatus& getSystemStatus() const = 0;
+    virtual const UartRxStats& getRxStats() const = 0;
+    virtual UartTxStats getTxStats() const = 0;
+    // nullptr unless the previous run ended in a watchdog reset
+    virtual const WatchdogResetRecord* getLastWatchdogReset() const = 0;
+};
+
+class StatusCommand : public ICLICommand {
+private:
+    const IStatusSource* source;
+
+public:
+    StatusCommand(const IStatusSource* statusSource) : source(statusSource) {}
+
+    void execute(const CommandArgs& parameters, ResponseWriter& out) override {
+        const SystemStatus& status = source->getSystemStatus();
+        const UartRxStats& rx = source->getRxStats();
+        out.write("System Status:\r\n");
+        out.print("  State: %s\r\n", status.state == SystemState::RUNNING ? "RUNNING" : "IDLE");
+        out.print("  Uptime: %lu ms\r\n", status.upTime);
+        out.print("  Free Heap: %lu bytes\r\n", status.freeHeap);
+        out.print("  Active Sensors: %lu/%lu\r\n", status.activeSensors, status.totalSensors);
+        out.print("  Error Count: %lu\r\n", status.errorCount);
+        out.print("  CPU Usage: %d%%\r\n", (int)status.cpuUsage);
+        const WatchdogResetRecord* reset = source->getLastWatchdogReset();
+        if (reset != nullptr) {
+            out.print("  Last reset: watchdog, task %s overdue %lu ms (%lu in a row)\r\n",
+                    reset->task, reset->overdueMs, reset->resetCount);
+        }
+        out.print("  CLI RX: %lu bytes, %lu dropped, %lu overruns, %lu framing, %lu noise, %lu long lines, %lu long frames, %lu unterminated frames\r\n",
+                rx.bytesReceived,
+                rx.droppedBytes,
+                rx.hardwareOverruns,
+                rx.framingErrors,
+                rx.noiseErrors,
+                rx.lineOverflows,
+                rx.frameOverflows,
+                rx.frameTimeouts);
+        out.print("  CLI commands: %lu dropped while busy\r\n", rx.commandsDropped);
+
+        UartTxStats tx = source->getTxStats();
+        for (int i = 0; i < 2; i++) {
+            out.print("  CLI TX %s: %lu queued, %lu dropped, peak %lu B, latency avg %lu us max %lu us\r\n",
+                    i == (int)TxPriority::INTERACTIVE ? "interactive" : "bulk",
+                    tx.bytesQueued[i],
+                    tx.bytesDropped[i],
+                    tx.peakDepth[i],
+                    tx.latencySamples[i] > 0 ? tx.totalLatencyUs[i] / tx.latencySamples[i] : 0,
+                    tx.maxLatencyUs[i]);
+        }
+        out.print("  CLI TX: %lu bytes sent in %lu DMA transfers, %lu errors\r\n",
+                tx.bytesSent, tx.dmaTransfers, tx.errors);
+    }
+
+    std::string_view getHelp() const override {
+        return "status - Show system status information\r\n";
+    }
+};
+
+
+#endif /* INC_STATUS_COMMAND_HPP_ */
@@ -12,27 +12,47 @@ extern "C" {
 
 #include<string>
 #include <string.h>
+#include<vector>
+#include<algorithm>
 #include "DataStructure.hpp"
+#include "uart_tx_service.hpp"
+#include "metrics.hpp"
+#include "monitored_queue.hpp"
+#include "IObserver.hpp"
+#include "config_schema.hpp"
 
+// Queued by value, so log() may return before the line is printed; text
+// longer than the fields is truncated
+struct LogRecord {
+	LogLevel level;
+	uint64_t timestamp; // microseconds since boot
+	char module[LOG_MODULE_LENGTH];
+	char message[LOG_MESSAGE_LENGTH];
+};
 
-class SystemLogger{
+class SystemLogger : public IObserver<ConfigChange> {
 private:
 	osSemaphoreId logMutex;
-	UART_HandleTypeDef* huart;
-	osMessageQId logQueue;
+	UartTxService* txService;
+	MonitoredQueue<LogRecord> logQueue;
 	static SystemLogger* instance;//singleton parten=>> assure only one SystemLogger existing in system
 	//and can access from everywhere
 	osThreadId loggerTaskHandle;
+	int watchdogId;
+	Counter messagesLogged;
+	volatile LogLevel minLevel;	// lower levels are dropped in log()
 
 	static void loggerTask(const void* parameter);//must be static for task of thread
-	void processLogMessage(const LogMessage& message);
-	std::string formatLogMessage(const LogMessage& msg);
+	void processLogMessage(const LogRecord& message);
+	std::string formatLogMessage(const LogRecord& msg);
 public:
 	SystemLogger();
-	SystemLogger(UART_HandleTypeDef* huart);
 	static SystemLogger* getInstance();
-	void init(UART_HandleTypeDef* uart);
+	void init(UartTxService* tx);
 	void log(LogLevel level, const std::string& message, const std::string& module = "SYSTEM");
+	void setLevel(LogLevel level) { minLevel = level; }
+	LogLevel getLevel() const { return minLevel; }
+	void update(const ConfigChange& change) override;
 };
 
 
@@ -20,29 +20,42 @@ extern "C" {
 #include "sensor_manager.hpp"
 #include "cli_manager.hpp"
 #include "system_logger.hpp"
+#include "task_stats.hpp"
+#include "stack_monitor.hpp"
+#include "watchdog_supervisor.hpp"
+#include "heap_stats.hpp"
+#include "crash_dump.hpp"
+#include "metrics.hpp"
+#include "monitored_queue.hpp"
+#include "firmware_update.hpp"
+#include "boot_profile.hpp"
 #include<string>
 
-class SystemMonitor {
+class SystemMonitor : public IObserver<ConfigChange> {
 private:
     osThreadId watchdogTaskHandle;
     osMutexId systemMutex;
-    osTimerId watchdogTimer;// monitor status of system, reset system when failing
+    int watchdogId;
 
     SensorManager* sensorManager;
     CLIManager* cliManager;
     SystemLogger* logger;
 
-    uint32_t errorCount;
-    uint32_t lastHeartbeat;
+    Counter errorCount;
+    Gauge freeHeap;
+    Gauge minFreeHeap;
+    Gauge cpuLoad;
 
     bool systemHealthy;//status of system
+    bool bootConfirmTried;
+    bool bootTimeReported;
 
     static void watchdogTask(const void* parameter);
-    static void watchdogTimerCallback(const void* parameter);
 
     void checkSystemHealth();
-    void handleSystemError();
-    void resetSystem();
+    void reportErrorLocked(const std::string& error);
+    void confirmBoot(bool supervised);
+    void reportBootTime();
 
 public:
     SystemMonitor(SensorManager* sensorMgr, CLIManager* cliMgr);
@@ -51,10 +64,10 @@ public:
     void init();
     void start();
     void stop();
-    void heartbeat();
     void reportError(const std::string& error);
+    void update(const ConfigChange& change) override;
     bool isSystemHealthy() const { return systemHealthy; }
-    uint32_t getErrorCount() const { return errorCount; }
+    uint32_t getErrorCount() const { return errorCount.get(); }
 };
 
 
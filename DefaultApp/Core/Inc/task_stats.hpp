@@ -0,0 +1,69 @@
+#ifndef INC_TASK_STATS_HPP_
+#define INC_TASK_STATS_HPP_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include<stdint.h>
+#include<stddef.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#ifdef __cplusplus
+}
+#endif
+
+#include "common_variables.hpp"
+
+struct TaskLoad {
+    char name[configMAX_TASK_NAME_LEN];
+    eTaskState state;
+    UBaseType_t priority;
+    uint32_t stackFreeBytes; // high-water mark, least free since the task started
+    uint16_t shortLoad;      // per mille of CPU over TASK_STATS_SHORT_WINDOW samples
+    uint16_t longLoad;       // per mille of CPU over TASK_STATS_LONG_WINDOW samples
+};
+
+// Per-task CPU load from the FreeRTOS run-time counters, which are driven by
+// the DWT cycle counter (see configureTimerForRunTimeStats in freertos.c).
+// sample() is called once a second by SystemMonitor and keeps the last
+// TASK_STATS_LONG_WINDOW counter readings per task; loads are the share of
+// all cycles counted over the window, so the sampling period does not need
+// to be exact. Windows must stay under one CYCCNT wrap (~44 s at 96 MHz).
+class TaskStats {
+public:
+    static const size_t MAX_TASKS = TASK_STATS_MAX_TASKS;
+
+    static void sample();
+
+    // Copies the loads computed by the last sample(); returns the task count
+    static size_t snapshot(TaskLoad* out, size_t maxTasks);
+
+    // Non-idle share in per mille
+    static uint16_t getShortCpuLoad() { return shortCpuLoad; }
+    static uint16_t getLongCpuLoad() { return longCpuLoad; }
+
+private:
+    static const size_t HISTORY = TASK_STATS_LONG_WINDOW + 1;
+
+    struct TaskHistory {
+        UBaseType_t taskNumber; // 0 = free slot
+        uint32_t counters[HISTORY];
+    };
+
+    static TaskStatus_t status[MAX_TASKS];
+    static TaskHistory history[MAX_TASKS];
+    static uint32_t totals[HISTORY];
+    static size_t head;
+    static size_t samples;
+
+    static TaskLoad loads[MAX_TASKS];
+    static size_t loadCount;
+    static uint16_t shortCpuLoad;
+    static uint16_t longCpuLoad;
+
+    static TaskHistory* findHistory(UBaseType_t taskNumber);
+    static uint16_t perMille(uint32_t part, uint32_t whole);
+};
+
+
+#endif /* INC_TASK_STATS_HPP_ */
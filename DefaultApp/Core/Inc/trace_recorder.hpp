@@ -0,0 +1,59 @@
+#ifndef INC_TRACE_RECORDER_HPP_
+#define INC_TRACE_RECORDER_HPP_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include<stdint.h>
+#include<stddef.h>
+#include "FreeRTOS.h"
+#include "queue.h"
+#ifdef __cplusplus
+}
+#endif
+
+#include "common_variables.hpp"
+#include "response_writer.hpp"
+
+// Event codes; must match Tools/trace_to_chrome.py
+enum class TraceEvent : uint8_t {
+    TASK_SWITCHED_IN = 1,      // task = TCB number
+    TASK_SWITCHED_OUT,
+    QUEUE_SEND,                // arg = queue number, for every queue, semaphore and mutex
+    QUEUE_SEND_FAILED,
+    QUEUE_RECEIVE,
+    QUEUE_RECEIVE_FAILED,
+    QUEUE_SEND_FROM_ISR,
+    QUEUE_RECEIVE_FROM_ISR,
+    ISR_ENTER,                 // arg = IRQ number
+    ISR_EXIT
+};
+
+struct TraceRecord {
+    uint32_t cycles; // DWT CYCCNT; the host unwraps it
+    uint8_t event;
+    uint8_t task;
+    uint16_t arg;
+};
+static_assert(sizeof(TraceRecord) == 8, "trace records are 8 bytes");
+
+// RAM ring of kernel events written from the FreeRTOS trace macros (see the
+// USER CODE Defines in FreeRTOSConfig.h) and from the interrupt handlers.
+// A record is one counter read and two stores with interrupts masked for a
+// handful of instructions. In ring mode the oldest events are overwritten;
+// in one-shot mode recording stops when the buffer is full. Dumps are text,
+// Tools/trace_to_chrome.py turns them into a Chrome trace (chrome://tracing).
+class TraceRecorder {
+public:
+    static void start(bool oneShot);
+    static void stop();
+    static bool isRunning();
+    static size_t getCount();
+    static uint32_t getLost();
+
+    // Stops recording for the duration of the dump
+    static void dump(ResponseWriter& out);
+};
+
+
+#endif /* INC_TRACE_RECORDER_HPP_ */
@@ -0,0 +1,44 @@
+#ifndef INC_UART_STATS_HPP_
+#define INC_UART_STATS_HPP_
+
+#include<stdint.h>
+
+enum class TxPriority : uint8_t {
+    INTERACTIVE = 0, // echo, prompts
+    BULK = 1         // command output, logs, streams
+};
+
+struct UartTxStats {
+    uint32_t bytesQueued[2];
+    uint32_t bytesDropped[2];   // no room before the timeout
+    uint32_t bytesSent;
+    uint32_t dmaTransfers;
+    uint32_t errors;
+    uint32_t peakDepth[2];      // bytes waiting, high-water mark
+    uint32_t maxLatencyUs[2];   // write() to last byte on the wire
+    uint32_t totalLatencyUs[2];
+    uint32_t latencySamples[2];
+
+    UartTxStats() : bytesQueued{}, bytesDropped{}, bytesSent(0), dmaTransfers(0), errors(0),
+                    peakDepth{}, maxLatencyUs{}, totalLatencyUs{}, latencySamples{} {}
+};
+
+// Receive-path counters, updated from the UART/DMA interrupts
+struct UartRxStats {
+    uint32_t bytesReceived;
+    uint32_t droppedBytes;     // RX stream full, CLI task fell behind
+    uint32_t hardwareOverruns; // ORE, a byte was lost before DMA read it
+    uint32_t framingErrors;
+    uint32_t noiseErrors;
+    uint32_t lineOverflows;    // line longer than CLI_MAX_LINE_LENGTH
+    uint32_t frameOverflows;   // binary frame longer than the frame buffer
+    uint32_t frameTimeouts;    // binary frame never closed, input went idle
+    uint32_t commandsDropped;  // line arrived with CLI_COMMAND_QUEUE_SIZE already waiting
+
+    UartRxStats() : bytesReceived(0), droppedBytes(0), hardwareOverruns(0),
+                    framingErrors(0), noiseErrors(0), lineOverflows(0), frameOverflows(0), frameTimeouts(0),
+                    commandsDropped(0) {}
+};
+
+
+#endif /* INC_UART_STATS_HPP_ */
@@ -0,0 +1,75 @@
+#ifndef INC_UART_TX_SERVICE_HPP_
+#define INC_UART_TX_SERVICE_HPP_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "stm32f4xx_hal.h"
+#include "cmsis_os.h"
+#include "semphr.h"
+#ifdef __cplusplus
+}
+#endif
+
+#include<memory>
+#include "response_writer.hpp"
+#include "common_variables.hpp"
+#include "uart_stats.hpp"
+
+// Non-blocking transmit path for one UART. Any task enqueues into one of two
+// rings and returns; DMA drains them in chunks of at most
+// UART_TX_DMA_CHUNK_SIZE, always taking the interactive ring first. A write is
+// queued whole or not at all, so messages from different tasks never mix.
+class UartTxService : public IByteSink {
+private:
+    static const uint8_t LATENCY_MARKERS = 8; // power of two
+
+    struct Ring {
+        std::unique_ptr<uint8_t[]> buffer;
+        uint32_t size;  // power of two
+        uint32_t head;  // free-running count of bytes written
+        uint32_t tail;  // free-running count of bytes sent
+        // Sampled write() completions for latency: ring position + cycle count
+        uint32_t markerEnd[LATENCY_MARKERS];
+        uint32_t markerCycles[LATENCY_MARKERS];
+        uint8_t markerHead;
+        uint8_t markerTail;
+    };
+
+    UART_HandleTypeDef* huart;
+    Ring rings[2];
+    bool busy;
+    uint8_t activeRing;
+    uint32_t inFlight;
+    SemaphoreHandle_t spaceAvailable;
+    UartTxStats stats;
+
+    void startNext();
+    void retireMarkers(uint8_t ringIndex);
+
+public:
+    UartTxService(UART_HandleTypeDef* uart, size_t interactiveSize, size_t bulkSize);
+    ~UartTxService();
+
+    void init(bool flowControl = false);
+
+    // Returns size when queued, 0 when dropped. timeout 0 never blocks.
+    size_t write(const uint8_t* data, size_t size, TxPriority priority = TxPriority::BULK, TickType_t timeout = 0);
+
+    // IByteSink, used by ResponseWriter: bulk, waits up to CLI_TX_TIMEOUT_MS
+    void transmit(const uint8_t* data, size_t size) override;
+
+    // Waits until everything queued has been sent
+    bool flush(TickType_t timeout);
+
+    // Interrupt context
+    void handleTxComplete();
+    void handleError();
+
+    uint32_t getDepth(TxPriority priority) const;
+    UartTxStats getStats() const;
+    UART_HandleTypeDef* getHandle() const { return huart; }
+};
+
+
+#endif /* INC_UART_TX_SERVICE_HPP_ */
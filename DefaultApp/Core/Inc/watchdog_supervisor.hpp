@@ -0,0 +1,92 @@
+#ifndef INC_WATCHDOG_SUPERVISOR_HPP_
+#define INC_WATCHDOG_SUPERVISOR_HPP_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include<stdint.h>
+#include<stddef.h>
+#include "stm32f4xx_hal.h"
+#ifdef __cplusplus
+}
+#endif
+
+#include "common_variables.hpp"
+
+// Written to .noinit RAM just before a deliberate watchdog reset
+struct WatchdogResetRecord {
+    uint32_t magic;
+    char task[16];      // first task found past its deadline, "?" if unknown
+    uint32_t overdueMs;
+    uint32_t upTimeMs;
+    uint32_t resetCount; // consecutive watchdog resets
+};
+
+// Independent watchdog refreshed only while every registered task keeps
+// checking in. Each task checks in at least once per deadline; the check-in
+// is a single tick store, so it can sit on any hot path. SystemMonitor calls
+// supervise() once a second: it refreshes the IWDG when all tasks are within
+// their deadline, otherwise it records the offender and stops refreshing,
+// and the IWDG resets the MCU WATCHDOG_TIMEOUT_MS later. A hung scheduler
+// never reaches supervise() and resets the same way, without a record.
+class WatchdogSupervisor {
+public:
+    static const int INVALID_ID = -1;
+
+    // Reads and clears the reset cause; call once early at boot
+    static void init();
+    // Starts the IWDG; from here on it can only be stopped by a reset
+    static void start();
+
+    static int registerTask(const char* name, uint32_t deadlineMs);
+    static void setEnabled(int id, bool enabled);
+    static void setDeadline(int id, uint32_t deadlineMs);
+
+    // IWDG period, applied at once when already started; false outside
+    // WATCHDOG_MIN_TIMEOUT_MS..WATCHDOG_MAX_TIMEOUT_MS
+    static bool setTimeout(uint32_t timeoutMs);
+    static uint32_t getTimeout() { return timeoutMs; }
+
+    // Holds the IWDG period at no less than periodMs until release(), for
+    // flash erases that stall the CPU while the IWDG keeps counting
+    static void stretch(uint32_t periodMs);
+    static void release() { stretch(0); }
+
+    static void checkIn(int id) {
+        if (id >= 0) {
+            slots[id].lastCheckIn = HAL_GetTick();
+        }
+    }
+
+    static bool supervise();
+
+    // Record left by the previous run when it ended in a watchdog reset
+    static bool wasWatchdogReset() { return watchdogReset; }
+    static const WatchdogResetRecord& getLastReset() { return lastReset; }
+
+private:
+    struct Slot {
+        const char* name;
+        volatile uint32_t deadlineMs;
+        volatile uint32_t lastCheckIn;
+        volatile bool enabled;
+    };
+
+    static const uint32_t RECORD_MAGIC = 0x57444F47; // "WDOG"
+    static const uint32_t LSI_KHZ = 32;
+
+    static Slot slots[WATCHDOG_MAX_TASKS];
+    static size_t slotCount;
+    static IWDG_HandleTypeDef hiwdg;
+    static uint32_t timeoutMs;
+    static uint32_t stretchMs;
+    static bool started;
+    static bool expired;
+    static bool watchdogReset;
+    static WatchdogResetRecord lastReset;
+
+    static void configure();
+};
+
+
+#endif /* INC_WATCHDOG_SUPERVISOR_HPP_ */
@@ -1,4 +1,5 @@
 #include "Application.hpp"
+#include "hw_crc.hpp"
 
 Application::Application(SPI_HandleTypeDef* spi, UART_HandleTypeDef* uartCLI, UART_HandleTypeDef* uartLog)
     : hspi(spi), huartCLI(uartCLI), huartLog(uartLog), isInitialized(false), isRunning(false) {
@@ -16,40 +17,92 @@ void Application::init() {
     registerSensors();
 
     isInitialized = true;
+    BootProfile::mark(BOOT_PHASE_APP_INIT);
 }
 
 void Application::initializeHardware() {
     // Hardware initialization would be done in main.c
-    // This is just a placeholder for any additional setup
+    // Start the cycle counter before any component takes a timestamp
+    HighResClock::init();
+    HwCrc::init();
+    WatchdogSupervisor::init();
+    CrashDump::init();
+    FirmwareUpdate::init();
+    BootProfile::init();
 }
 
 void Application::initializeComponents() {
+    // UART transmit paths first, everything below writes through them
+    cliTx = std::make_unique<UartTxService>(huartCLI, CLI_TX_INTERACTIVE_SIZE, CLI_TX_BULK_SIZE);
+    cliTx->init();
+    logTx = std::make_unique<UartTxService>(huartLog, LOG_TX_INTERACTIVE_SIZE, LOG_TX_BULK_SIZE);
+    logTx->init(LOG_UART_FLOW_CONTROL);
+
+    // Allocations until the scheduler starts are charged to the module
+    // being constructed; afterwards to the allocating task's module
+    HeapStats::setInitModule(HeapModule::logger);
+
     // Create logger first
     logger = std::unique_ptr<SystemLogger>(SystemLogger::getInstance());
-    logger->init(huartLog);
+    logger->init(logTx.get());
 
+    HeapStats::setInitModule(HeapModule::config);
     // Create configuration manager
     configManager = std::make_unique<ConfigManager>();
     configManager->init();
 
+    HeapStats::setInitModule(HeapModule::storage);
     // Create data storage
     dataStorage = std::make_unique<DataStorage>();
 
+    HeapStats::setInitModule(HeapModule::sensor);
     // Create sensor manager
     sensorManager = std::make_unique<SensorManager>(hspi);
     sensorManager->init();
 
+    HeapStats::setInitModule(HeapModule::cli);
     // Create CLI manager
-    cliManager = std::make_unique<CLIManager>(huartCLI, sensorManager.get());
+    cliManager = std::make_unique<CLIManager>(huartCLI, cliTx.get(), sensorManager.get());
     cliManager->init();
 
+    HeapStats::setInitModule(HeapModule::protocol);
+    // Binary protocol shares the CLI UART
+    binaryProtocol = std::make_unique<BinaryProtocol>(cliManager.get(), sensorManager.get(),
+                                                      configManager.get(), dataStorage.get());
+    cliManager->setFrameHandler(binaryProtocol.get());
+
+    HeapStats::setInitModule(HeapModule::stream);
+    sensorStreamer = std::make_unique<SensorStreamer>(cliManager.get(), binaryProtocol.get());
+    sensorStreamer->init();
+    cliManager->registerCommand("stream", std::make_unique<StreamCommand>(sensorStreamer.get()));
+    cliManager->registerCommand("history", std::make_unique<HistoryCommand>(dataStorage.get(), binaryProtocol.get()));
+    cliManager->registerCommand("top", std::make_unique<TopCommand>());
+    cliManager->registerCommand("stack", std::make_unique<StackCommand>());
+    cliManager->registerCommand("heap", std::make_unique<HeapCommand>());
+    cliManager->registerCommand("latency", std::make_unique<LatencyCommand>());
+    cliManager->registerCommand("trace", std::make_unique<TraceCommand>());
+    cliManager->registerCommand("crash", std::make_unique<CrashCommand>());
+    cliManager->registerCommand("boot", std::make_unique<BootCommand>());
+    cliManager->registerCommand("metrics", std::make_unique<MetricsCommand>(binaryProtocol.get()));
+    cliManager->registerCommand("queues", std::make_unique<QueuesCommand>());
+
+    HeapStats::setInitModule(HeapModule::monitor);
     // Create system monitor
     systemMonitor = std::make_unique<SystemMonitor>(sensorManager.get(), cliManager.get());
     systemMonitor->init();
 
+    // Settings applied while running, delivered by the config task
+    configManager->subscribe(sensorManager.get(), ConfigKeys::sensorReadInterval);
+    configManager->subscribe(logger.get(), ConfigKeys::logLevel);
+    configManager->subscribe(systemMonitor.get(), ConfigKeys::watchdogTimeout);
+    cliManager->registerCommand("config", std::make_unique<ConfigCommand>(configManager.get()));
+
     // Set up observer relationships
     //Design Pattern Observer.
     sensorManager->addObserver(cliManager.get());//climanger pointer receive inform when sensor manager have a changing
+    sensorManager->addObserver(sensorStreamer.get());
+    sensorManager->addObserver(dataStorage.get());
+    HeapStats::setInitModule(HeapModule::app);
 
     logger->log(LogLevel::info, "Application components initialized", "APP");
 }
@@ -83,10 +136,8 @@ void Application::run() {
 void Application::startComponents() {
     sensorManager->start();
     systemMonitor->start();
-
-    // Set system configuration
-    const SystemConfig& config = configManager->getConfig();
-    sensorManager->setReadInterval(config.sensorReadInterval);
+    // Its first pass applies the loaded config to the subscribers
+    configManager->start();
 }
 
 void Application::stop() {
@@ -100,9 +151,26 @@ void Application::stop() {
     isRunning = false;
 }
 
-void Application::handleUARTInterrupt(UART_HandleTypeDef* huart, uint8_t* data, uint16_t size) {
-    if (huart == huartCLI) {
-        cliManager->handleUARTData(data, size);
+void Application::handleUARTRxEvent(UART_HandleTypeDef* huart, uint16_t position) {
+    if (huart == huartCLI && cliManager) {
+        cliManager->handleRxEvent(position);
+    }
+}
+
+void Application::handleUARTTxComplete(UART_HandleTypeDef* huart) {
+    if (huart == huartCLI && cliTx) {
+        cliTx->handleTxComplete();
+    } else if (huart == huartLog && logTx) {
+        logTx->handleTxComplete();
+    }
+}
+
+void Application::handleUARTError(UART_HandleTypeDef* huart) {
+    if (huart == huartCLI && cliManager) {
+        cliManager->handleRxError();
+        cliTx->handleError();
+    } else if (huart == huartLog && logTx) {
+        logTx->handleError();
     }
 }
 
@@ -0,0 +1,325 @@
+#include "binary_protocol.hpp"
+#include "cli_manager.hpp"
+#include "config_manager.hpp"
+#include "data_buffer.hpp"
+#include "hw_crc.hpp"
+#include "metrics.hpp"
+#include<string.h>
+
+BinaryProtocol::BinaryProtocol(CLIManager* cli, SensorManager* sensorMgr, ConfigManager* configMgr, DataStorage* storage)
+    : cliManager(cli), sensorManager(sensorMgr), configManager(configMgr), dataStorage(storage), pushSequence(0) {
+
+	osSemaphoreDef(frameMutexDef);
+	frameMutex = osSemaphoreCreate(osSemaphore(frameMutexDef), 1);
+}
+
+BinaryProtocol::~BinaryProtocol() {
+    vSemaphoreDelete(frameMutex);
+}
+
+void BinaryProtocol::toWire(const SensorData& data, WireSample& sample) {
+    sample.sensorId = data.sensorId;
+    sample.type = (uint8_t)data.type;
+    sample.flags = data.isValid ? 0x01 : 0x00;
+    sample.reserved = 0;
+    sample.timestamp = data.timestamp;
+    sample.value = data.value;
+}
+
+bool BinaryProtocol::sendFrame(MessageType type, uint8_t sequence, const void* payload, size_t length) {
+    if (length > PROTOCOL_MAX_PAYLOAD) return false;
+
+    if (xSemaphoreTake(frameMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return false;
+    }
+
+    txFrame[0] = (uint8_t)type;
+    txFrame[1] = sequence;
+    if (length > 0) {
+        memcpy(&txFrame[HEADER_SIZE], payload, length);
+    }
+    uint32_t crc = HwCrc::compute(txFrame, HEADER_SIZE + length);
+    memcpy(&txFrame[HEADER_SIZE + length], &crc, CRC_SIZE);
+
+    txEncoded[0] = 0;
+    size_t encoded = Cobs::encode(txFrame, HEADER_SIZE + length + CRC_SIZE, &txEncoded[1]);
+    txEncoded[encoded + 1] = 0;
+
+    cliManager->transmit(txEncoded, encoded + 2);
+    stats.framesSent++;
+
+    xSemaphoreGive(frameMutex);
+    return true;
+}
+
+bool BinaryProtocol::publishSamples(const SensorData* samples, size_t count) {
+    if (count == 0 || count > SAMPLES_PER_FRAME) return false;
+
+    WireSample wire[SAMPLES_PER_FRAME];
+    for (size_t i = 0; i < count; i++) {
+        toWire(samples[i], wire[i]);
+    }
+    return sendFrame(MessageType::SENSOR_PUSH, pushSequence++, wire, count * sizeof(WireSample));
+}
+
+void BinaryProtocol::handleFrame(const uint8_t* frame, size_t frameLength) {
+    // Invalid COBS arrives with length 0
+    if (frameLength < HEADER_SIZE + CRC_SIZE || frameLength > MAX_FRAME_SIZE) {
+        stats.malformedFrames++;
+        return; // nothing trustworthy to answer to
+    }
+
+    uint8_t sequence = frame[1];
+    size_t payloadLength = frameLength - HEADER_SIZE - CRC_SIZE;
+    const uint8_t* payload = &frame[HEADER_SIZE];
+
+    uint32_t receivedCrc;
+    memcpy(&receivedCrc, &frame[HEADER_SIZE + payloadLength], CRC_SIZE);
+    if (HwCrc::compute(frame, HEADER_SIZE + payloadLength) != receivedCrc) {
+        stats.crcErrors++;
+        sendNack(sequence, NackReason::BAD_CRC);
+        return;
+    }
+
+    stats.framesReceived++;
+
+    switch ((MessageType)frame[0]) {
+    case MessageType::PING:
+        // Payload is echoed back, hosts use it to measure round trips
+        sendFrame(MessageType::PONG, sequence, payload, payloadLength);
+        break;
+    case MessageType::GET_STATUS:
+        sendStatus(sequence);
+        break;
+    case MessageType::GET_SENSORS:
+        sendSensors(sequence);
+        break;
+    case MessageType::GET_HISTORY:
+        handleHistoryRequest(sequence, payload, payloadLength);
+        break;
+    case MessageType::GET_CONFIG:
+        sendConfig(sequence);
+        break;
+    case MessageType::SET_CONFIG:
+        setConfig(sequence, payload, payloadLength);
+        break;
+    case MessageType::GET_METRICS:
+        handleMetricsRequest(sequence, payload, payloadLength);
+        break;
+    case MessageType::GET_BOOT:
+        sendBootState(sequence);
+        break;
+    case MessageType::UPDATE_BEGIN:
+    case MessageType::UPDATE_DATA:
+    case MessageType::UPDATE_END:
+        handleUpdate((MessageType)frame[0], sequence, payload, payloadLength);
+        break;
+    default:
+        sendNack(sequence, NackReason::UNKNOWN_TYPE);
+        break;
+    }
+}
+
+void BinaryProtocol::sendNack(uint8_t sequence, NackReason reason) {
+    uint8_t payload = (uint8_t)reason;
+    sendFrame(MessageType::NACK, sequence, &payload, 1);
+}
+
+void BinaryProtocol::sendStatus(uint8_t sequence) {
+    const SystemStatus& status = cliManager->getSystemStatus();
+    const UartRxStats& rx = cliManager->getRxStats();
+
+    WireStatus wire;
+    wire.state = (uint8_t)status.state;
+    wire.cpuUsage = (uint8_t)status.cpuUsage;
+    wire.reserved = 0;
+    wire.upTime = status.upTime;
+    wire.freeHeap = status.freeHeap;
+    wire.totalSensors = status.totalSensors;
+    wire.activeSensors = status.activeSensors;
+    wire.errorCount = status.errorCount;
+    wire.rxBytes = rx.bytesReceived;
+    wire.rxDropped = rx.droppedBytes;
+    wire.rxOverruns = rx.hardwareOverruns;
+    wire.framesReceived = stats.framesReceived;
+    wire.frameErrors = stats.crcErrors + stats.malformedFrames + rx.frameOverflows + rx.frameTimeouts;
+
+    sendFrame(MessageType::STATUS, sequence, &wire, sizeof(wire));
+}
+
+void BinaryProtocol::sendSensors(uint8_t sequence) {
+    std::vector<SensorData> allData = sensorManager->getAllSensorData();
+
+    WireSample wire[SAMPLES_PER_FRAME];
+    size_t count = allData.size() < SAMPLES_PER_FRAME ? allData.size() : SAMPLES_PER_FRAME;
+    for (size_t i = 0; i < count; i++) {
+        toWire(allData[i], wire[i]);
+    }
+    sendFrame(MessageType::SENSOR_SAMPLES, sequence, wire, count * sizeof(WireSample));
+}
+
+void BinaryProtocol::handleHistoryRequest(uint8_t sequence, const uint8_t* payload, size_t length) {
+    WireHistoryRequest request;
+    if (length != sizeof(request)) {
+        sendNack(sequence, NackReason::BAD_LENGTH);
+        return;
+    }
+    memcpy(&request, payload, sizeof(request));
+    sendHistory(sequence, request);
+}
+
+uint32_t BinaryProtocol::sendHistory(uint8_t sequence, const WireHistoryRequest& request) {
+    // Every block answers the same request, so they share its sequence number;
+    // an empty history still gets one (empty, last) block
+    uint8_t block[PROTOCOL_MAX_PAYLOAD];
+    SensorData samples[HISTORY_SAMPLES_PER_FRAME];
+    WireHistoryHeader header;
+    uint32_t remaining = request.maxEntries > 0 ? request.maxEntries : UINT32_MAX;
+
+    // Samples already overwritten are skipped; the host sees the jump in
+    // firstSequence
+    uint32_t position = request.fromSequence;
+    uint32_t oldest = dataStorage->getSensorFirstSequence();
+    if ((int32_t)(position - oldest) < 0) position = oldest;
+
+    do {
+        size_t wanted = remaining < HISTORY_SAMPLES_PER_FRAME ? remaining : HISTORY_SAMPLES_PER_FRAME;
+        size_t count = 0;
+
+        // Blocks are filled from several bounded reads of the ring
+        header.firstSequence = position;
+        while (count < wanted && position != dataStorage->getSensorNextSequence()) {
+            uint32_t before = position;
+            count += dataStorage->readSensorHistory(position, request.sensorId, &samples[count], nullptr, wanted - count);
+            if (position == before) break; // storage busy
+        }
+        remaining -= count;
+
+        header.nextSequence = position;
+        header.flags = (remaining == 0 || position == dataStorage->getSensorNextSequence()) ? HISTORY_FLAG_LAST : 0;
+        memcpy(block, &header, sizeof(header));
+
+        WireSample* wire = reinterpret_cast<WireSample*>(&block[sizeof(header)]);
+        for (size_t i = 0; i < count; i++) {
+            toWire(samples[i], wire[i]);
+        }
+
+        if (!sendFrame(MessageType::HISTORY, sequence, block, sizeof(header) + count * sizeof(WireSample))) {
+            break;
+        }
+    } while (!(header.flags & HISTORY_FLAG_LAST));
+
+    return position;
+}
+
+void BinaryProtocol::handleMetricsRequest(uint8_t sequence, const uint8_t* payload, size_t length) {
+    WireMetricsRequest request;
+    if (length != sizeof(request)) {
+        sendNack(sequence, NackReason::BAD_LENGTH);
+        return;
+    }
+    memcpy(&request, payload, sizeof(request));
+    sendMetrics(sequence, request);
+}
+
+void BinaryProtocol::sendMetrics(uint8_t sequence, const WireMetricsRequest& request) {
+    uint8_t block[PROTOCOL_MAX_PAYLOAD];
+    WireMetricsHeader header;
+    bool describe = request.flags & METRICS_FLAG_DESCRIBE;
+    size_t index = request.firstIndex;
+    size_t total = Metrics::getCount();
+
+    do {
+        header.firstIndex = (uint8_t)index;
+        size_t used = Metrics::encode(index, describe, &block[sizeof(header)], sizeof(block) - sizeof(header));
+        header.count = (uint8_t)(index - header.firstIndex);
+        header.total = (uint8_t)total;
+        header.flags = (describe ? METRICS_FLAG_DESCRIBE : 0) | (index >= total ? METRICS_FLAG_LAST : 0);
+        memcpy(block, &header, sizeof(header));
+
+        if (!sendFrame(MessageType::METRICS, sequence, block, sizeof(header) + used) || header.count == 0) {
+            break;
+        }
+    } while (!(header.flags & METRICS_FLAG_LAST));
+}
+
+void BinaryProtocol::sendBootState(uint8_t sequence) {
+    WireBootState wire = {};
+    wire.runningSlot = (uint8_t)FirmwareUpdate::getRunningSlot();
+    wire.updateState = (uint8_t)FirmwareUpdate::getState();
+    wire.nextOffset = FirmwareUpdate::getNextOffset();
+    for (int i = 0; i < BOOT_SLOT_COUNT; i++) {
+        SlotInfo slot;
+        FirmwareUpdate::readSlot(i, slot);
+        wire.slots[i].version = slot.version;
+        wire.slots[i].sequence = slot.sequence;
+        wire.slots[i].flags = (slot.hasImage ? SLOT_FLAG_IMAGE : 0) | (slot.sequenced ? SLOT_FLAG_SEQUENCED : 0) |
+                              (slot.confirmed ? SLOT_FLAG_CONFIRMED : 0) | (slot.rejected ? SLOT_FLAG_REJECTED : 0);
+        wire.slots[i].attempts = (uint8_t)slot.attempts;
+    }
+    sendFrame(MessageType::BOOT_STATE, sequence, &wire, sizeof(wire));
+}
+
+void BinaryProtocol::handleUpdate(MessageType type, uint8_t sequence, const uint8_t* payload, size_t length) {
+    UpdateResult result = UpdateResult::BAD_LENGTH;
+    bool reboot = false;
+
+    if (type == MessageType::UPDATE_BEGIN && length == sizeof(uint32_t)) {
+        uint32_t imageLength;
+        memcpy(&imageLength, payload, sizeof(imageLength));
+        result = FirmwareUpdate::begin(imageLength);
+    } else if (type == MessageType::UPDATE_DATA && length > sizeof(uint32_t)) {
+        uint32_t offset;
+        memcpy(&offset, payload, sizeof(offset));
+        result = FirmwareUpdate::write(offset, payload + sizeof(offset), length - sizeof(offset));
+    } else if (type == MessageType::UPDATE_END && length == sizeof(WireUpdateEnd)) {
+        WireUpdateEnd request;
+        memcpy(&request, payload, sizeof(request));
+        result = FirmwareUpdate::finish();
+        reboot = result == UpdateResult::OK && (request.flags & UPDATE_FLAG_REBOOT);
+    }
+
+    WireUpdateStatus wire = {};
+    wire.result = (uint8_t)result;
+    wire.slot = (uint8_t)FirmwareUpdate::getTargetSlot();
+    wire.nextOffset = FirmwareUpdate::getNextOffset();
+    sendFrame(MessageType::UPDATE_STATUS, sequence, &wire, sizeof(wire));
+
+    if (reboot) {
+        SystemLogger::getInstance()->log(LogLevel::info, "Rebooting into the update", "UPDATE");
+        HAL_Delay(100); // Allow the status and log to be sent
+        HAL_NVIC_SystemReset();
+    }
+}
+
+void BinaryProtocol::sendConfig(uint8_t sequence) {
+    SystemConfig config = configManager->getConfig();
+
+    WireConfig wire = {};
+    wire.sensorReadInterval = config.sensorReadInterval;
+    wire.logLevel = config.logLevel;
+    wire.watchdogTimeout = config.watchdogTimeout;
+    wire.maxSensors = config.maxSensors;
+    wire.autoStart = config.autoStart ? 1 : 0;
+    strncpy(wire.deviceName, config.deviceName, sizeof(wire.deviceName));
+
+    sendFrame(MessageType::CONFIG, sequence, &wire, sizeof(wire));
+}
+
+void BinaryProtocol::setConfig(uint8_t sequence, const uint8_t* payload, size_t length) {
+    WireConfigSet request;
+    if (length != sizeof(request)) {
+        sendNack(sequence, NackReason::BAD_LENGTH);
+        return;
+    }
+    memcpy(&request, payload, sizeof(request));
+
+    // ConfigKey values are the schema tags; the schema range-checks
+    const ConfigField* field = ConfigSchema::find(request.key);
+    if (!field || field->type == ConfigType::TEXT || !configManager->setValue(*field, request.value)) {
+        sendNack(sequence, NackReason::BAD_VALUE);
+        return;
+    }
+
+    sendConfig(sequence);
+}
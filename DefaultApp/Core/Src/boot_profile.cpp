@@ -0,0 +1,75 @@
+#include "boot_profile.hpp"
+#include<stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "stm32f4xx_hal.h"
+#ifdef __cplusplus
+}
+#endif
+
+Gauge BootProfile::bootTimeUs;
+
+void BootProfile::init() {
+    Metrics::add("boot_time_us", "Reset to first sensor sample, bootloader included", bootTimeUs);
+}
+
+void BootProfile::stamp(BootPhase phase) {
+    boot_timing_mark(phase, SystemCoreClock);
+    if (phase == BOOT_PHASE_FIRST_SAMPLE && marked(phase)) {
+        bootTimeUs.set((int32_t)phaseUs(phase));
+    }
+}
+
+const char* BootProfile::phaseName(BootPhase phase) {
+    switch (phase) {
+    case BOOT_PHASE_RESET:        return "reset";
+    case BOOT_PHASE_LOADER_INIT:  return "bootloader init";
+    case BOOT_PHASE_VERIFIED:     return "image verified";
+    case BOOT_PHASE_JUMP:         return "jump";
+    case BOOT_PHASE_SYSTEM_INIT:  return "SystemInit";
+    case BOOT_PHASE_APP_INIT:     return "Application::init";
+    case BOOT_PHASE_FIRST_SAMPLE: return "first sample";
+    default:                      return "?";
+    }
+}
+
+void BootProfile::summarize(char* buffer, size_t size) {
+    if (!marked(BOOT_PHASE_FIRST_SAMPLE)) {
+        snprintf(buffer, size, "Boot time not recorded");
+        return;
+    }
+    uint32_t total = phaseUs(BOOT_PHASE_FIRST_SAMPLE);
+    if (marked(BOOT_PHASE_RESET) && marked(BOOT_PHASE_JUMP)) {
+        uint32_t loader = phaseUs(BOOT_PHASE_JUMP);
+        snprintf(buffer, size, "Boot to first sample %lu.%lu ms, bootloader %lu.%lu ms%s",
+                (unsigned long)(total / 1000), (unsigned long)(total % 1000 / 100),
+                (unsigned long)(loader / 1000), (unsigned long)(loader % 1000 / 100),
+                fastBoot() ? " (fast)" : "");
+    } else {
+        // Started without the bootloader, or from its menu
+        snprintf(buffer, size, "SystemInit to first sample %lu.%lu ms",
+                (unsigned long)(total / 1000), (unsigned long)(total % 1000 / 100));
+    }
+}
+
+void BootProfile::describe(ResponseWriter& out) {
+    if (!boot_timing_valid()) {
+        out.write("Boot phases: not recorded\r\n");
+        return;
+    }
+    out.print("Boot phases%s:\r\n", fastBoot() ? " (fast bootloader path)" : "");
+    uint32_t previous = 0;
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        BootPhase phase = (BootPhase)i;
+        if (!marked(phase)) {
+            out.print("  %-18s        -\r\n", phaseName(phase));
+            continue;
+        }
+        uint32_t us = phaseUs(phase);
+        out.print("  %-18s %5lu.%03lu ms  +%lu us\r\n", phaseName(phase),
+                  (unsigned long)(us / 1000), (unsigned long)(us % 1000), (unsigned long)(us - previous));
+        previous = us;
+    }
+}
@@ -0,0 +1,65 @@
+#include "cli_dispatcher.hpp"
+#include "high_res_clock.hpp"
+
+static const uint32_t COMMAND_TIME_BOUNDS_US[] = {100, 1000, 10000, 100000, 1000000};
+
+CommandDispatcher::CommandDispatcher()
+    : commandTime(COMMAND_TIME_BOUNDS_US, std::size(COMMAND_TIME_BOUNDS_US)) {
+    for (std::atomic<ICLICommand*>& command : commands) {
+        command.store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+bool CommandDispatcher::registerCommand(std::string_view name, std::unique_ptr<ICLICommand> command) {
+    int slot = commandTable.lookup(name);
+    if (slot < 0 || command == nullptr) {
+        return false;
+    }
+
+    ICLICommand* empty = nullptr;
+    if (!commands[slot].compare_exchange_strong(empty, command.get(), std::memory_order_release)) {
+        return false;
+    }
+    owned[slot] = std::move(command);
+    return true;
+}
+
+void CommandDispatcher::dispatch(std::string_view line, ResponseWriter& out) {
+    if (commandLine.tokenize(line) == 0) {
+        out.write("> ");
+        return;
+    }
+
+    std::string_view commandName = commandLine.name();
+
+    if (commandLine.overflowed()) {
+        out.print("Too many arguments (max %u)\r\n> ", (unsigned)(CommandLine::MAX_TOKENS - 1));
+        return;
+    }
+
+    int slot = commandTable.lookup(commandName);
+    ICLICommand* command = slot >= 0 ? commands[slot].load(std::memory_order_acquire) : nullptr;
+
+    commandCount.inc();
+    if (command != nullptr) {
+        uint32_t started = HighResClock::cycles();
+        command->execute(commandLine.args(), out);
+        commandTime.observe(HighResClock::cyclesToUs(HighResClock::cycles() - started));
+    } else {
+        out.write("Unknown command: ");
+        out.write(commandName);
+        out.write("\r\n");
+    }
+    out.write("> ");
+}
+
+void CommandDispatcher::writeHelp(ResponseWriter& out) const {
+    out.write("Available commands:\r\n");
+    for (std::string_view name : CLI_COMMAND_NAMES) {
+        ICLICommand* command = commands[commandTable.lookup(name)].load(std::memory_order_acquire);
+        if (command != nullptr) {
+            out.write("  ");
+            out.write(command->getHelp());
+        }
+    }
+}
@@ -1,17 +1,20 @@
 #include "cli_manager.hpp"
+#include "binary_protocol.hpp"
 #include "cmsis_os.h"
-#include<sstream>
 #include"common_variables.hpp"
+#include "stack_monitor.hpp"
+#include "heap_stats.hpp"
+#include "watchdog_supervisor.hpp"
+#include "latency_trace.hpp"
+#include "high_res_clock.hpp"
 
-CLIManager::CLIManager(UART_HandleTypeDef* uart, SensorManager* sensorMgr)
-    : huart(uart), sensorManager(sensorMgr) {
+CLIManager::CLIManager(UART_HandleTypeDef* uart, UartTxService* tx, SensorManager* sensorMgr)
+    : cliTaskId(nullptr), commandTaskId(nullptr), watchdogId(WatchdogSupervisor::INVALID_ID),
+      commandWatchdogId(WatchdogSupervisor::INVALID_ID), systemErrors(nullptr), huart(uart), txService(tx), sensorManager(sensorMgr), dmaReadPosition(0),
+      inputLength(0), inputOverflow(false), commandQueue("cli commands", CLI_COMMAND_QUEUE_SIZE),
+      frameHandler(nullptr), frameLength(0), frameState(FrameState::TEXT), lastInputTick(0) {
 
-	osMessageQDef(cliQueueDef, CLI_CMD_QUEUE_SIZE, uint32_t);
-	cliCommandQueue = osMessageCreate(osMessageQ(cliQueueDef), NULL);
-
-	osSemaphoreDef(cliMutexDef);
-
-	cliMutex = osSemaphoreCreate(osSemaphore(cliMutexDef), 1);
+	rxStream = xStreamBufferCreate(CLI_RX_STREAM_SIZE, 1);
 
     // Initialize system status
     systemStatus.state = SystemState::IDLE;
@@ -24,20 +27,34 @@ CLIManager::CLIManager(UART_HandleTypeDef* uart, SensorManager* sensorMgr)
 }
 
 CLIManager::~CLIManager() {
-    osMessageDelete(cliCommandQueue);
-    osMutexDelete(cliMutex);
+    HAL_UART_DMAStop(huart);
+    vStreamBufferDelete(rxStream);
 }
 
 void CLIManager::init() {
     // Register default commands
-    registerCommand("help", std::make_unique<HelpCommand>(this));
+    registerCommand("help", std::make_unique<HelpCommand>(&dispatcher));
     registerCommand("status", std::make_unique<StatusCommand>(this));
     registerCommand("reset", std::make_unique<ResetCommand>());
     registerCommand("sensors", std::make_unique<SensorsCommand>(sensorManager));
 
-    // Create CLI task
-    osThreadDef(cliTaskDef, cliTask, osPriorityNormal, 1, 512);
+    // The input task runs above the sensor and logger tasks so the RX stream
+    // is drained at full line rate; commands run below it
+    osThreadDef(cliTaskDef, cliTask, osPriorityAboveNormal, 1, CLI_TASK_STACK_WORDS);
     cliTaskId = osThreadCreate(osThread(cliTaskDef), this);
+    StackMonitor::watch(cliTaskId, CLI_TASK_STACK_WORDS);
+    HeapStats::tagTask(cliTaskId, HeapModule::cli);
+    watchdogId = WatchdogSupervisor::registerTask("cli", WATCHDOG_TASK_DEADLINE_MS);
+
+    osThreadDef(cliCommandTaskDef, commandTask, osPriorityNormal, 1, CLI_COMMAND_STACK_WORDS);
+    commandTaskId = osThreadCreate(osThread(cliCommandTaskDef), this);
+    StackMonitor::watch(commandTaskId, CLI_COMMAND_STACK_WORDS);
+    HeapStats::tagTask(commandTaskId, HeapModule::cli);
+    commandWatchdogId = WatchdogSupervisor::registerTask("cli cmd", WATCHDOG_TASK_DEADLINE_MS);
+    Metrics::add("cli_commands_total", "Command lines executed", dispatcher.getCommandCount());
+    Metrics::add("cli_command_duration_us", "Time to run a command, output included", dispatcher.getCommandTime());
+
+    startReception();
 
     // Send welcome message
     sendResponse("STM32F411 Sensor Gateway v1.0\r\nType 'help' for available commands.\r\n> ");
@@ -45,95 +62,239 @@ void CLIManager::init() {
     SystemLogger::getInstance()->log(LogLevel::info, "CLI Manager initialized", "CLI_MGR");
 }
 
-void CLIManager::registerCommand(const std::string& name, std::unique_ptr<ICLICommand> command) {
-    if (xSemaphoreTake(cliMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        commands[name] = std::move(command);
-        xSemaphoreGive(cliMutex);
+bool CLIManager::registerCommand(std::string_view name, std::unique_ptr<ICLICommand> command) {
+    if (!dispatcher.registerCommand(name, std::move(command))) {
+        SystemLogger::getInstance()->log(LogLevel::error, "Command not in CLI_COMMAND_NAMES or already registered: " + std::string(name), "CLI_MGR");
+        return false;
     }
+    return true;
 }
 
 void CLIManager::cliTask(const void* parameter) {
     CLIManager* cliManager = static_cast<CLIManager*>(const_cast<void*>(parameter));
-    CLICommand cmd;
+    uint8_t chunk[32];
 
     while (true) {
-        if (xQueueReceive(cliManager->cliCommandQueue, &cmd, portMAX_DELAY) == pdTRUE) {
-            cliManager->processCommand(cmd.command);
+        WatchdogSupervisor::checkIn(cliManager->watchdogId);
+        size_t received = xStreamBufferReceive(cliManager->rxStream, chunk, sizeof(chunk), pdMS_TO_TICKS(100));
+        if (received > 0) {
+            cliManager->processInput(chunk, received);
+        } else {
+            cliManager->expireFrame(HAL_GetTick());
         }
-
-        cliManager->updateSystemStatus();
-        vTaskDelay(pdMS_TO_TICKS(100));
     }
 }
 
-void CLIManager::processCommand(const std::string& commandLine) {
-    std::vector<std::string> tokens = parseCommand(commandLine);
+void CLIManager::commandTask(const void* parameter) {
+    CLIManager* cliManager = static_cast<CLIManager*>(const_cast<void*>(parameter));
+    CommandRequest request;
+    uint32_t lastStatusUpdate = 0;
+
+    while (true) {
+        WatchdogSupervisor::checkIn(cliManager->commandWatchdogId);
+        if (cliManager->commandQueue.receive(request, pdMS_TO_TICKS(100))) {
+            if (request.kind == CommandRequest::Kind::LINE) {
+                cliManager->processCommand(std::string_view((const char*)request.data, request.length));
+            } else if (cliManager->frameHandler != nullptr) {
+                cliManager->frameHandler->handleFrame(request.data, request.length);
+            }
+        }
 
-    if (tokens.empty()) {
-        sendResponse("> ");
-        return;
+        // Read by the status command, so it is kept on this task
+        if (HAL_GetTick() - lastStatusUpdate >= 100) {
+            cliManager->updateSystemStatus();
+            lastStatusUpdate = HAL_GetTick();
+        }
     }
+}
+
+void CLIManager::startReception() {
+    if (huart == nullptr) return;
 
-    std::string commandName = tokens[0];
-    std::vector<std::string> parameters(tokens.begin() + 1, tokens.end());
-
-    if (xSemaphoreTake(cliMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        auto it = commands.find(commandName);
-        if (it != commands.end()) {
-//            try {
-                std::string response = it->second->execute(parameters);
-                sendResponse(response);
-//            } catch (const std::exception& e) {
-//                sendResponse("Error executing command: " + std::string(e.what()) + "\r\n");
-//                SystemLogger::getInstance()->logError("CLI command error: " + std::string(e.what()), "CLI");
-//            }
+    dmaReadPosition = 0;
+    HAL_UARTEx_ReceiveToIdle_DMA(huart, dmaRxBuffer, sizeof(dmaRxBuffer));
+}
+
+void CLIManager::handleRxEvent(uint16_t position) {
+    // position is the DMA write index; it equals the buffer size on the
+    // transfer-complete event and wraps to 0 afterwards
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+    if (position != dmaReadPosition) {
+        size_t first, second;
+        if (position > dmaReadPosition) {
+            first = position - dmaReadPosition;
+            second = 0;
         } else {
-            sendResponse("Unknown command: " + commandName + "\r\n");
+            first = sizeof(dmaRxBuffer) - dmaReadPosition;
+            second = position;
         }
-        xSemaphoreGive(cliMutex);
+
+        size_t sent = xStreamBufferSendFromISR(rxStream, &dmaRxBuffer[dmaReadPosition], first, &higherPriorityTaskWoken);
+        if (second > 0) {
+            sent += xStreamBufferSendFromISR(rxStream, dmaRxBuffer, second, &higherPriorityTaskWoken);
+        }
+
+        rxStats.bytesReceived += first + second;
+        rxStats.droppedBytes += first + second - sent;
+        dmaReadPosition = position == sizeof(dmaRxBuffer) ? 0 : position;
+    }
+
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+void CLIManager::handleRxError() {
+    uint32_t error = huart->ErrorCode;
+    if (error & HAL_UART_ERROR_ORE) rxStats.hardwareOverruns++;
+    if (error & HAL_UART_ERROR_FE) rxStats.framingErrors++;
+    if (error & HAL_UART_ERROR_NE) rxStats.noiseErrors++;
+
+    // Overrun and DMA errors abort the transfer; restart the circular receive
+    startReception();
+}
+
+// Never waits: input keeps flowing while the queue is full, the line is
+// dropped and counted instead
+void CLIManager::queueCommand(std::string_view line) {
+    CommandRequest request;
+    request.kind = CommandRequest::Kind::LINE;
+    request.length = (uint16_t)line.size();
+    memcpy(request.data, line.data(), line.size());
+    if (!commandQueue.send(request, 0)) {
+        rxStats.commandsDropped++;
+        echo("Busy, command dropped\r\n> ");
+    }
+}
+
+void CLIManager::queueFrame() {
+    // A frame never decodes longer than its encoding, so it fits request.data
+    CommandRequest request;
+    request.kind = CommandRequest::Kind::FRAME;
+    request.length = (uint16_t)Cobs::decode(frameBuffer, frameLength, request.data);
+    if (!commandQueue.send(request, 0)) {
+        // Nothing is written into the binary stream; the host times out and resends
+        rxStats.commandsDropped++;
+    }
+}
+
+void CLIManager::processCommand(std::string_view line) {
+    ResponseWriter out(*this);
+    dispatcher.dispatch(line, out);
+}
+
+void CLIManager::sendResponse(std::string_view response) {
+    transmit((const uint8_t*)response.data(), response.length());
+}
+
+void CLIManager::transmit(const uint8_t* data, size_t size) {
+    // Long exports keep the command task busy for seconds; progress counts
+    // as alive. Other tasks push samples through here too and must not.
+    if (osThreadGetId() == commandTaskId) {
+        WatchdogSupervisor::checkIn(commandWatchdogId);
     }
+    if (txService != nullptr) {
+        txService->transmit(data, size);
+    }
+}
 
-    sendResponse("> ");
+void CLIManager::echo(std::string_view text) {
+    // Interactive ring: goes out ahead of queued command output, never waits
+    if (txService != nullptr && !text.empty()) {
+        txService->write((const uint8_t*)text.data(), text.size(), TxPriority::INTERACTIVE);
+    }
 }
 
-std::vector<std::string> CLIManager::parseCommand(const std::string& commandLine) {
-    std::vector<std::string> tokens;
-    std::istringstream iss(commandLine);
-    std::string token;
+// Returns true when the byte belonged to a binary frame
+bool CLIManager::processFrameByte(uint8_t byte) {
+    if (frameState == FrameState::TEXT) {
+        if (byte != 0) return false;
+        frameState = FrameState::FRAME;
+        frameLength = 0;
+        return true;
+    }
+
+    if (frameState == FrameState::DISCARD) {
+        if (byte == 0) {
+            frameState = FrameState::TEXT;
+        }
+        return true;
+    }
 
-    while (iss >> token) {
-        tokens.push_back(token);
+    if (byte != 0) {
+        if (frameLength < sizeof(frameBuffer)) {
+            frameBuffer[frameLength++] = byte;
+        } else {
+            // No valid frame is this long; the closing 0x00 was lost
+            rxStats.frameOverflows++;
+            frameState = FrameState::DISCARD;
+        }
+        return true;
     }
 
-    return tokens;
+    // Back-to-back delimiters are not a frame, keep waiting for one
+    if (frameLength == 0) return true;
+
+    queueFrame();
+    frameState = FrameState::TEXT;
+    return true;
 }
 
-void CLIManager::sendResponse(const std::string& response) {
-    if (huart != nullptr) {
-        HAL_UART_Transmit(huart, (uint8_t*)response.c_str(), response.length(), HAL_MAX_DELAY);
+// Gives up on a frame whose sender went quiet before the closing 0x00; a
+// discarded frame was already counted as an overflow
+void CLIManager::expireFrame(uint32_t now) {
+    if (frameState != FrameState::TEXT && now - lastInputTick >= CLI_FRAME_IDLE_TIMEOUT_MS) {
+        if (frameState == FrameState::FRAME) {
+            rxStats.frameTimeouts++;
+        }
+        frameState = FrameState::TEXT;
     }
 }
 
-void CLIManager::handleUARTData(uint8_t* data, uint16_t size) {
-    for (uint16_t i = 0; i < size; i++) {
+void CLIManager::processInput(const uint8_t* data, size_t size) {
+    uint32_t now = HAL_GetTick();
+    expireFrame(now);
+    lastInputTick = now;
+
+    // Echo is collected per chunk and sent once, not byte by byte
+    char echoBuffer[64];
+    size_t echoLength = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        if (processFrameByte(data[i])) {
+            continue;
+        }
+
         char ch = data[i];
 
         if (ch == '\r' || ch == '\n') {
-            if (!inputBuffer.empty()) {
-                CLICommand cmd(inputBuffer);
-                xQueueSend(cliCommandQueue, &cmd, 0);
-                inputBuffer.clear();
+            echo(std::string_view(echoBuffer, echoLength));
+            echoLength = 0;
+            if (inputLength > 0) {
+                echo("\r\n");
+                queueCommand(std::string_view(inputBuffer, inputLength));
+                inputLength = 0;
             }
+            inputOverflow = false;
         } else if (ch == '\b' || ch == 127) { // Backspace
-            if (!inputBuffer.empty()) {
-                inputBuffer.pop_back();
-                sendResponse("\b \b");
+            if (inputLength > 0) {
+                inputLength--;
+                if (echoLength + 3 <= sizeof(echoBuffer)) {
+                    memcpy(&echoBuffer[echoLength], "\b \b", 3);
+                    echoLength += 3;
+                }
+            }
+        } else if (inputLength < CLI_MAX_LINE_LENGTH) {
+            inputBuffer[inputLength++] = ch;
+            if (echoLength < sizeof(echoBuffer)) {
+                echoBuffer[echoLength++] = ch;
             }
-        } else if (inputBuffer.length() < MAX_INPUT_LENGTH) {
-            inputBuffer += ch;
-            sendResponse(std::string(1, ch)); // Echo character
+        } else if (!inputOverflow) {
+            inputOverflow = true;
+            rxStats.lineOverflows++;
         }
     }
+
+    echo(std::string_view(echoBuffer, echoLength));
 }
 
 void CLIManager::updateSystemStatus() {
@@ -141,19 +302,16 @@ void CLIManager::updateSystemStatus() {
     systemStatus.freeHeap = xPortGetFreeHeapSize();
     systemStatus.activeSensors = sensorManager->getActiveSensorCount();
     systemStatus.state = SystemState::RUNNING;
-
-    // Calculate CPU usage (simplified)
-    static uint32_t lastIdleTicks = 0;
-    uint32_t currentIdleTicks = xTaskGetIdleRunTimeCounter();
-    uint32_t totalTicks = xTaskGetTickCount();
-
-    if (totalTicks > 0) {
-        systemStatus.cpuUsage = 100.0f * (1.0f - (float)(currentIdleTicks - lastIdleTicks) / (float)totalTicks);
+    if (systemErrors == nullptr) {
+        systemErrors = Metrics::findCounter("system_errors_total");
     }
-    lastIdleTicks = currentIdleTicks;
+    systemStatus.errorCount = systemErrors ? systemErrors->get() : 0;
+    // Non-idle share of the last TaskStats window, sampled by SystemMonitor
+    systemStatus.cpuUsage = TaskStats::getShortCpuLoad() / 10.0f;
 }
 
 void CLIManager::update(const SensorData& data) {
     // Handle sensor data updates if needed
     // This is called when sensor data is available
+    LATENCY_SAMPLE(CLI_UPDATE, data);
 }
@@ -0,0 +1,149 @@
+#include "config_codec.hpp"
+#include<string.h>
+
+// Version 0: the packed struct the first flash store wrote
+#pragma pack(push, 1)
+struct ConfigLayoutV0 {
+    uint32_t sensorReadInterval;
+    uint32_t logLevel;
+    uint32_t watchdogTimeout;
+    uint32_t maxSensors;
+    uint8_t autoStart;
+    char deviceName[16]; // NUL-padded
+};
+#pragma pack(pop)
+
+size_t ConfigCodec::encode(const SystemConfig& config, uint8_t* buffer, size_t size, const SystemConfig* base) {
+    if (size < HEADER_SIZE) return 0;
+    buffer[0] = FORMAT_MARKER;
+    buffer[1] = SCHEMA_VERSION;
+    size_t used = HEADER_SIZE;
+
+    size_t count;
+    const ConfigField* fields = ConfigSchema::fields(count);
+    for (size_t i = 0; i < count; i++) {
+        const ConfigField& field = fields[i];
+        if (base && ConfigSchema::equal(*base, config, field)) continue;
+
+        uint8_t value[4];
+        const uint8_t* bytes = value;
+        size_t length;
+        if (field.type == ConfigType::TEXT) {
+            const char* text = ConfigSchema::getText(config, field);
+            bytes = reinterpret_cast<const uint8_t*>(text);
+            length = strnlen(text, field.size);
+        } else {
+            uint32_t number = ConfigSchema::getNumber(config, field);
+            length = 0;
+            do {
+                value[length++] = (uint8_t)number;
+                number >>= 8;
+            } while (number != 0);
+        }
+
+        if (used + 2 + length > size) return 0;
+        buffer[used++] = field.tag;
+        buffer[used++] = (uint8_t)length;
+        memcpy(&buffer[used], bytes, length);
+        used += length;
+    }
+    return used;
+}
+
+ConfigDecodeResult ConfigCodec::decode(const uint8_t* data, size_t length, SystemConfig& config) {
+    // Decoded into a copy so a malformed record changes nothing
+    SystemConfig decoded = config;
+    ConfigDecodeResult result = {};
+    bool ok = false;
+
+    if (length >= HEADER_SIZE && data[0] == FORMAT_MARKER) {
+        ok = decodeTlv(data, length, decoded, result);
+    }
+    if (length == sizeof(ConfigLayoutV0) && (!ok || result.rejected > 0)) {
+        // Version 0 has no marker; its first byte can still look like one,
+        // and the rest can then pass as TLV. encode() never writes a value
+        // that fails its check, so a TLV reading with rejected fields loses
+        // to a version 0 reading without any.
+        SystemConfig legacy = config;
+        ConfigDecodeResult legacyResult = {};
+        if (decodeVersion0(data, length, legacy, legacyResult) && (!ok || legacyResult.rejected == 0)) {
+            decoded = legacy;
+            result = legacyResult;
+            ok = true;
+        }
+    }
+
+    result.ok = ok;
+    if (ok) config = decoded;
+    return result;
+}
+
+bool ConfigCodec::decodeTlv(const uint8_t* data, size_t length, SystemConfig& config, ConfigDecodeResult& result) {
+    result.version = data[1];
+    size_t offset = HEADER_SIZE;
+
+    while (offset < length) {
+        if (offset + 2 > length) return false;
+        uint8_t tag = data[offset];
+        size_t valueLength = data[offset + 1];
+        const uint8_t* value = &data[offset + 2];
+        offset += 2 + valueLength;
+        if (offset > length) return false;
+
+        const ConfigField* field = ConfigSchema::find(tag);
+        if (!field) {
+            result.skipped++;
+        } else if (applyField(config, *field, value, valueLength)) {
+            result.applied++;
+        } else {
+            result.rejected++;
+        }
+    }
+    return true;
+}
+
+bool ConfigCodec::applyField(SystemConfig& config, const ConfigField& field, const uint8_t* value, size_t length) {
+    if (field.type == ConfigType::TEXT) {
+        return ConfigSchema::setText(config, field, reinterpret_cast<const char*>(value), length);
+    }
+    if (length == 0 || length > 4) return false;
+
+    uint32_t number = 0;
+    for (size_t i = 0; i < length; i++) {
+        number |= (uint32_t)value[i] << (8 * i);
+    }
+    return ConfigSchema::setNumber(config, field, number);
+}
+
+bool ConfigCodec::decodeVersion0(const uint8_t* data, size_t length, SystemConfig& config, ConfigDecodeResult& result) {
+    ConfigLayoutV0 stored;
+    if (length != sizeof(stored)) return false;
+    memcpy(&stored, data, sizeof(stored));
+
+    // Version 0 was written without range checks
+    const uint32_t numbers[][2] = {
+        { 1, stored.sensorReadInterval },
+        { 2, stored.logLevel },
+        { 3, stored.watchdogTimeout },
+        { 4, stored.maxSensors },
+        { 5, stored.autoStart },
+    };
+    for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+        const ConfigField* field = ConfigSchema::find((uint8_t)numbers[i][0]);
+        if (field && ConfigSchema::setNumber(config, *field, numbers[i][1])) {
+            result.applied++;
+        } else {
+            result.rejected++;
+        }
+    }
+
+    const ConfigField* name = ConfigSchema::find(6);
+    if (name && ConfigSchema::setText(config, *name, stored.deviceName, sizeof(stored.deviceName))) {
+        result.applied++;
+    } else {
+        result.rejected++;
+    }
+
+    result.version = 0;
+    return true;
+}
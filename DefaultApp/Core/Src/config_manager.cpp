@@ -1,8 +1,16 @@
 #include "config_manager.hpp"
 #include "cmsis_os.h"
 #include "system_logger.hpp"
+#include "high_res_clock.hpp"
+#include "watchdog_supervisor.hpp"
+#include "stack_monitor.hpp"
+#include "heap_stats.hpp"
+#include<string.h>
+#include<stdio.h>
 
-ConfigManager::ConfigManager() {
+ConfigManager::ConfigManager()
+    : checkpointDue(true), subscriptionCount(0), configTaskId(nullptr),
+      watchdogId(WatchdogSupervisor::INVALID_ID), store(flash, CONFIG_FLASH_ADDRESS, CONFIG_FLASH_ADDRESS + CONFIG_SECTOR_SIZE, CONFIG_SECTOR_SIZE) {
     configMutex = xSemaphoreCreateMutex();
 }
 
@@ -11,20 +19,80 @@ ConfigManager::~ConfigManager() {
 }
 
 void ConfigManager::init() {
-    if (!loadFromFlash()) {
+    uint32_t started = HighResClock::cycles();
+    bool loaded = loadFromFlash();
+    uint32_t elapsedUs = HighResClock::cyclesToUs(HighResClock::cycles() - started);
+
+    if (loaded) {
+        const ConfigStoreStats& stats = store.getStats();
+        char message[80];
+        snprintf(message, sizeof(message), "Loaded config #%lu (+%lu deltas) from sector %d in %lu us",
+                (unsigned long)stats.sequence, (unsigned long)stats.deltas, stats.activeSector,
+                (unsigned long)elapsedUs);
+        SystemLogger::getInstance()->log(LogLevel::info, message, "CONFIG");
+    } else {
         // Use default configuration
         SystemLogger::getInstance()->log(LogLevel::warning, "Using default configuration", "CONFIG");
     }
     SystemLogger::getInstance()->log(LogLevel::info, "Configuration Manager initialized", "CONFIG");
 }
 
-const SystemConfig& ConfigManager::getConfig() const {
-    return config;
+void ConfigManager::start() {
+    osThreadDef(configTaskDef, configTask, osPriorityBelowNormal, 1, CONFIG_TASK_STACK_WORDS);
+    configTaskId = osThreadCreate(osThread(configTaskDef), this);
+    StackMonitor::watch(configTaskId, CONFIG_TASK_STACK_WORDS);
+    HeapStats::tagTask(configTaskId, HeapModule::config);
+    watchdogId = WatchdogSupervisor::registerTask("config", WATCHDOG_TASK_DEADLINE_MS);
+}
+
+bool ConfigManager::subscribe(IObserver<ConfigChange>* observer, uint32_t keys) {
+    if (subscriptionCount >= CONFIG_MAX_SUBSCRIBERS) return false;
+    subscriptions[subscriptionCount++] = { observer, keys };
+    return true;
+}
+
+// Caller holds configMutex, or runs before the scheduler
+void ConfigManager::publish() {
+    snapshot.publish(config);
+    if (configTaskId) {
+        xTaskNotifyGive(configTaskId);
+    }
+}
+
+void ConfigManager::configTask(const void* parameter) {
+    ConfigManager* manager = static_cast<ConfigManager*>(const_cast<void*>(parameter));
+    uint32_t forcedKeys = UINT32_MAX;
+
+    while (true) {
+        WatchdogSupervisor::checkIn(manager->watchdogId);
+        manager->deliverChanges(forcedKeys);
+        forcedKeys = 0;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(WATCHDOG_TASK_DEADLINE_MS / 2));
+    }
+}
+
+void ConfigManager::deliverChanges(uint32_t forcedKeys) {
+    ConfigChange change;
+    change.config = snapshot.read();
+    change.changedKeys = ConfigSchema::diff(delivered, change.config) | forcedKeys;
+    delivered = change.config;
+    if (change.changedKeys == 0) return;
+
+    for (size_t i = 0; i < subscriptionCount; i++) {
+        if (subscriptions[i].keys & change.changedKeys) {
+            subscriptions[i].observer->update(change);
+        }
+    }
+}
+
+SystemConfig ConfigManager::getConfig() const {
+    return snapshot.read();
 }
 
 void ConfigManager::setConfig(const SystemConfig& newConfig) {
     if (xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
         config = newConfig;
+        publish();
         osSemaphoreRelease(configMutex);
         SystemLogger::getInstance()->log(LogLevel::info, "Configuration updated", "CONFIG");
     }
@@ -33,22 +101,178 @@ void ConfigManager::setConfig(const SystemConfig& newConfig) {
 void ConfigManager::resetToDefault() {
     if (xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
         config = SystemConfig();
+        publish();
         osSemaphoreRelease(configMutex);
         SystemLogger::getInstance()->log(LogLevel::info, "Configuration reset to default", "CONFIG");
     }
 }
 
+bool ConfigManager::saveConfig() {
+    bool saved = false;
+    if (xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        saved = saveToFlash();
+        osSemaphoreRelease(configMutex);
+    }
+
+    if (saved) {
+        SystemLogger::getInstance()->log(LogLevel::info, "Configuration saved", "CONFIG");
+    } else {
+        SystemLogger::getInstance()->log(LogLevel::error, "Configuration save failed", "CONFIG");
+    }
+    return saved;
+}
+
+bool ConfigManager::loadConfig() {
+    bool loaded = false;
+    if (xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        loaded = loadFromFlash();
+        osSemaphoreRelease(configMutex);
+    }
+    return loaded;
+}
+
+void ConfigManager::setSensorReadInterval(uint32_t interval) {
+    if (xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        config.sensorReadInterval = interval;
+        publish();
+        osSemaphoreRelease(configMutex);
+    }
+}
+
+void ConfigManager::setLogLevel(uint32_t level) {
+    if (xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        config.logLevel = level;
+        publish();
+        osSemaphoreRelease(configMutex);
+    }
+}
+
+void ConfigManager::setWatchdogTimeout(uint32_t timeout) {
+    if (xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        config.watchdogTimeout = timeout;
+        publish();
+        osSemaphoreRelease(configMutex);
+    }
+}
+
+void ConfigManager::setMaxSensors(uint32_t maxSensors) {
+    if (xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        config.maxSensors = maxSensors;
+        publish();
+        osSemaphoreRelease(configMutex);
+    }
+}
+
+void ConfigManager::setAutoStart(bool autoStart) {
+    if (xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        config.autoStart = autoStart;
+        publish();
+        osSemaphoreRelease(configMutex);
+    }
+}
+
+void ConfigManager::setDeviceName(const std::string& name) {
+    if (xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        // Longer names are cut to the field's capacity
+        const ConfigField* field = ConfigSchema::find("deviceName");
+        if (field) {
+            size_t length = name.size() < field->max ? name.size() : field->max;
+            ConfigSchema::setText(config, *field, name.c_str(), length);
+        }
+        publish();
+        osSemaphoreRelease(configMutex);
+    }
+}
+
+bool ConfigManager::setValue(const ConfigField& field, uint32_t value) {
+    bool applied = false;
+    if (xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        applied = ConfigSchema::setNumber(config, field, value);
+        if (applied) {
+            publish();
+        }
+        osSemaphoreRelease(configMutex);
+    }
+    return applied;
+}
+
+bool ConfigManager::setText(const ConfigField& field, const char* text, size_t length) {
+    bool applied = false;
+    if (xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        applied = ConfigSchema::setText(config, field, text, length);
+        if (applied) {
+            publish();
+        }
+        osSemaphoreRelease(configMutex);
+    }
+    return applied;
+}
+
+SystemConfig ConfigManager::getSavedConfig() {
+    SystemConfig saved;
+    if (xSemaphoreTake(configMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        saved = persisted;
+        osSemaphoreRelease(configMutex);
+    }
+    return saved;
+}
+
+static_assert(ConfigCodec::MAX_SIZE <= CONFIG_STORE_MAX_PAYLOAD, "config record larger than the store allows");
+
+// Caller holds configMutex
 bool ConfigManager::saveToFlash() {
-    // Implement flash save logic
-    // This would involve erasing the flash sector and writing the config
-    // For now, return true as placeholder
+    uint8_t record[ConfigCodec::MAX_SIZE];
+
+    // Only the keys that changed, until the chain is as long as a load
+    // should replay or the stored records need rewriting
+    bool delta = !checkpointDue && store.getStats().deltas < CONFIG_STORE_MAX_DELTAS;
+    size_t length = 0;
+    if (delta) {
+        length = ConfigCodec::encode(config, record, sizeof(record), &persisted);
+        if (length == ConfigCodec::HEADER_SIZE) return true; // nothing changed
+        delta = length != 0 && store.fits(length);
+    }
+    if (!delta) {
+        length = ConfigCodec::encode(config, record, sizeof(record));
+    }
+    if (length == 0 || !store.write(record, length, delta)) return false;
+
+    persisted = config;
+    checkpointDue = false;
     return true;
 }
 
+// Caller holds configMutex, or runs before the scheduler
 bool ConfigManager::loadFromFlash() {
-    // Implement flash load logic
-    // This would involve reading from flash and validating checksum
-    // For now, return false to use defaults
-    return false;
-}
+    checkpointDue = true;
+    if (!store.mount()) return false;
 
+    SystemConfig loaded;
+    uint32_t rejected = 0;
+    uint32_t malformed = 0;
+    bool older = false;
+    size_t applied = store.replay([&](const uint8_t* payload, size_t length) {
+        ConfigDecodeResult result = ConfigCodec::decode(payload, length, loaded);
+        if (!result.ok) {
+            malformed++;
+            return;
+        }
+        rejected += result.rejected;
+        older |= result.version < ConfigCodec::SCHEMA_VERSION;
+    });
+    if (applied == 0 || applied == malformed) return false;
+
+    if (rejected != 0 || malformed != 0) {
+        char message[64];
+        snprintf(message, sizeof(message), "Config: %lu values rejected, %lu records malformed",
+                (unsigned long)rejected, (unsigned long)malformed);
+        SystemLogger::getInstance()->log(LogLevel::warning, message, "CONFIG");
+    }
+
+    config = loaded;
+    persisted = loaded;
+    publish();
+    // Rewritten as a checkpoint in the current version on the next save
+    checkpointDue = older || malformed != 0;
+    return true;
+}
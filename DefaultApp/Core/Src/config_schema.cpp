@@ -0,0 +1,93 @@
+#include "config_schema.hpp"
+#include<string.h>
+
+#define CONFIG_DEFAULT_U32(name, value) name = value;
+#define CONFIG_DEFAULT_BOOL(name, value) name = (value) != 0;
+#define CONFIG_DEFAULT_TEXT(name, value) strncpy(name, value, sizeof(name) - 1);
+#define CONFIG_DEFAULT(tag, name, type, value, min, max) CONFIG_DEFAULT_##type(name, value)
+
+SystemConfig::SystemConfig() {
+    // Zeroed first so text fields are NUL-padded and copies compare equal
+    memset(static_cast<void*>(this), 0, sizeof(*this));
+    CONFIG_SCHEMA(CONFIG_DEFAULT)
+}
+
+#define CONFIG_FIELD(tag, name, type, value, min, max) \
+    { tag, ConfigType::type, offsetof(SystemConfig, name), sizeof(SystemConfig::name), min, max, #name },
+
+static const ConfigField FIELDS[] = {
+    CONFIG_SCHEMA(CONFIG_FIELD)
+};
+
+static const size_t FIELD_COUNT = sizeof(FIELDS) / sizeof(FIELDS[0]);
+
+const ConfigField* ConfigSchema::find(uint8_t tag) {
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (FIELDS[i].tag == tag) return &FIELDS[i];
+    }
+    return nullptr;
+}
+
+const ConfigField* ConfigSchema::find(std::string_view name) {
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (name == FIELDS[i].name) return &FIELDS[i];
+    }
+    return nullptr;
+}
+
+const ConfigField* ConfigSchema::fields(size_t& count) {
+    count = FIELD_COUNT;
+    return FIELDS;
+}
+
+bool ConfigSchema::setNumber(SystemConfig& config, const ConfigField& field, uint32_t value) {
+    if (field.type == ConfigType::TEXT || value < field.min || value > field.max) return false;
+
+    uint8_t* member = reinterpret_cast<uint8_t*>(&config) + field.offset;
+    if (field.type == ConfigType::BOOL) {
+        *reinterpret_cast<bool*>(member) = value != 0;
+    } else {
+        memcpy(member, &value, sizeof(value));
+    }
+    return true;
+}
+
+bool ConfigSchema::setText(SystemConfig& config, const ConfigField& field, const char* text, size_t length) {
+    length = strnlen(text, length);
+    if (field.type != ConfigType::TEXT || length < field.min || length > field.max) return false;
+
+    char* member = reinterpret_cast<char*>(&config) + field.offset;
+    memset(member, 0, field.size);
+    memcpy(member, text, length);
+    return true;
+}
+
+uint32_t ConfigSchema::getNumber(const SystemConfig& config, const ConfigField& field) {
+    const uint8_t* member = reinterpret_cast<const uint8_t*>(&config) + field.offset;
+    if (field.type == ConfigType::BOOL) return *reinterpret_cast<const bool*>(member) ? 1 : 0;
+    if (field.type == ConfigType::TEXT) return 0;
+
+    uint32_t value;
+    memcpy(&value, member, sizeof(value));
+    return value;
+}
+
+const char* ConfigSchema::getText(const SystemConfig& config, const ConfigField& field) {
+    if (field.type != ConfigType::TEXT) return "";
+    return reinterpret_cast<const char*>(&config) + field.offset;
+}
+
+bool ConfigSchema::equal(const SystemConfig& a, const SystemConfig& b, const ConfigField& field) {
+    if (field.type == ConfigType::TEXT) {
+        return strncmp(getText(a, field), getText(b, field), field.size) == 0;
+    }
+    return getNumber(a, field) == getNumber(b, field);
+}
+
+uint32_t ConfigSchema::diff(const SystemConfig& a, const SystemConfig& b) {
+    uint32_t keys = 0;
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (!equal(a, b, FIELDS[i])) keys |= 1u << FIELDS[i].tag;
+    }
+    return keys;
+}
@@ -0,0 +1,218 @@
+#include "config_store.hpp"
+#include "hw_crc.hpp"
+#include<string.h>
+
+ConfigStore::ConfigStore(IFlashDevice& device, uint32_t firstSector, uint32_t secondSector, uint32_t size)
+    : flash(device), sectorSize(size), generation(0), writeOffset(0), segmentCount(0) {
+    sectors[0] = firstSector;
+    sectors[1] = secondSector;
+    stats = ConfigStoreStats();
+    stats.activeSector = -1;
+    stats.sectorSize = size;
+}
+
+uint32_t ConfigStore::word(int sector, uint32_t offset) const {
+    uint32_t value;
+    memcpy(&value, flash.data(sectors[sector] + offset), sizeof(value));
+    return value;
+}
+
+bool ConfigStore::readHeader(int sector, SectorHeader& header) const {
+    memcpy(&header, flash.data(sectors[sector]), sizeof(header));
+    return header.magic == SECTOR_MAGIC &&
+           header.crc == HwCrc::compute(reinterpret_cast<const uint8_t*>(&header), offsetof(SectorHeader, crc));
+}
+
+bool ConfigStore::recordValid(int sector, uint32_t offset) const {
+    uint32_t crcOffset = offset + recordSize(recordLength(sector, offset)) - 4;
+    return word(sector, crcOffset) == HwCrc::compute(flash.data(sectors[sector] + offset), crcOffset - offset);
+}
+
+void ConfigStore::scan(int sector, ScanResult& result) const {
+    // Only headers are read on the way; CRCs are checked for the last few
+    // complete records, newest first, until a checkpoint validates
+    uint32_t complete[SCAN_HISTORY];
+    size_t completeCount = 0;
+    uint32_t offset = sizeof(SectorHeader);
+    result = ScanResult();
+
+    while (offset + RECORD_OVERHEAD <= sectorSize) {
+        uint32_t first = word(sector, offset);
+        if (first == ERASED) break;
+
+        uint32_t length = (first >> 16) & LENGTH_MASK;
+        if ((first & 0xFFFF) != RECORD_MAGIC || length > CONFIG_STORE_MAX_PAYLOAD ||
+            offset + recordSize(length) > sectorSize) {
+            // A half-programmed first word; nothing after it can be trusted
+            offset = sectorSize;
+            break;
+        }
+
+        if (word(sector, offset + recordSize(length) - 4) != ERASED) {
+            complete[completeCount % SCAN_HISTORY] = offset;
+            completeCount++;
+            result.records++;
+            result.sequence = word(sector, offset + 4);
+        }
+        offset += recordSize(length);
+    }
+    result.freeOffset = offset < sectorSize ? offset : sectorSize;
+
+    size_t candidates = completeCount < SCAN_HISTORY ? completeCount : SCAN_HISTORY;
+    for (size_t i = 0; i < candidates; i++) {
+        uint32_t candidate = complete[(completeCount - 1 - i) % SCAN_HISTORY];
+        bool delta = (word(sector, candidate) >> 16) & RECORD_DELTA;
+        if (!delta && recordValid(sector, candidate)) {
+            result.checkpoint = candidate;
+            return;
+        }
+        result.after++;
+    }
+    result.after = 0;
+}
+
+bool ConfigStore::mount() {
+    SectorHeader headers[2];
+    bool valid[2];
+    for (int i = 0; i < 2; i++) {
+        valid[i] = readHeader(i, headers[i]);
+        stats.eraseCount[i] = valid[i] ? headers[i].eraseCount : 0;
+    }
+
+    int active = -1;
+    if (valid[0] && valid[1]) {
+        active = (int32_t)(headers[1].generation - headers[0].generation) > 0 ? 1 : 0;
+    } else if (valid[0] || valid[1]) {
+        active = valid[0] ? 0 : 1;
+    }
+
+    segmentCount = 0;
+    stats.activeSector = active;
+    stats.records = 0;
+    stats.usedBytes = 0;
+    stats.deltas = 0;
+    if (active < 0) return false;
+
+    generation = (int32_t)headers[active].generation;
+    ScanResult current;
+    scan(active, current);
+    writeOffset = current.freeOffset;
+    stats.records = current.records;
+    stats.usedBytes = writeOffset;
+    stats.sequence = current.sequence;
+
+    if (current.checkpoint != 0) {
+        segments[0] = { active, current.checkpoint, writeOffset };
+        segmentCount = 1;
+        stats.deltas = current.after;
+    } else if (valid[1 - active]) {
+        // The checkpoint that opened the active sector is corrupt; the
+        // previous sector still has the config from before the swap
+        ScanResult previous;
+        scan(1 - active, previous);
+        if (previous.checkpoint != 0) {
+            segments[0] = { 1 - active, previous.checkpoint, previous.freeOffset };
+            segments[1] = { active, sizeof(SectorHeader), writeOffset };
+            segmentCount = 2;
+            stats.deltas = previous.after + current.records;
+            if (current.records == 0) stats.sequence = previous.sequence;
+        }
+    }
+
+    return segmentCount > 0;
+}
+
+bool ConfigStore::appendRecord(int sector, uint32_t offset, const void* payload, size_t length,
+                               uint32_t sequence, bool delta) {
+    uint32_t record[(RECORD_OVERHEAD + CONFIG_STORE_MAX_PAYLOAD + 3) / 4];
+    size_t words = recordSize(length) / 4;
+
+    memset(record, 0xFF, words * 4);
+    record[0] = ((uint32_t)(length | (delta ? RECORD_DELTA : 0)) << 16) | RECORD_MAGIC;
+    record[1] = sequence;
+    memcpy(&record[2], payload, length);
+    record[words - 1] = HwCrc::compute(reinterpret_cast<const uint8_t*>(record), (words - 1) * 4);
+
+    // Header and payload first, the CRC word commits the record
+    uint32_t address = sectors[sector] + offset;
+    if (!flash.program(address, record, words - 1)) return false;
+    if (!flash.program(address + (words - 1) * 4, &record[words - 1], 1)) return false;
+    return memcmp(flash.data(address), record, words * 4) == 0;
+}
+
+bool ConfigStore::commitHeader(int sector, uint32_t eraseCount) {
+    SectorHeader header;
+    header.magic = SECTOR_MAGIC;
+    header.generation = (uint32_t)(generation + 1);
+    header.eraseCount = eraseCount;
+    header.crc = HwCrc::compute(reinterpret_cast<const uint8_t*>(&header), offsetof(SectorHeader, crc));
+
+    if (!flash.program(sectors[sector], reinterpret_cast<const uint32_t*>(&header), sizeof(header) / 4)) {
+        return false;
+    }
+    generation++;
+    return true;
+}
+
+bool ConfigStore::fits(size_t length) const {
+    return stats.activeSector >= 0 && writeOffset + recordSize(length) <= sectorSize;
+}
+
+bool ConfigStore::write(const void* payload, size_t length, bool delta) {
+    if (length > CONFIG_STORE_MAX_PAYLOAD) return false;
+    if (delta && (segmentCount == 0 || !fits(length))) return false;
+
+    uint32_t sequence = stats.sequence + 1;
+    int active = stats.activeSector;
+
+    if (fits(length)) {
+        uint32_t offset = writeOffset;
+        // Whatever happens, those words are no longer erased
+        writeOffset += recordSize(length);
+        stats.usedBytes = writeOffset;
+        if (!appendRecord(active, offset, payload, length, sequence, delta)) return false;
+        stats.records++;
+
+        if (delta) {
+            segments[segmentCount - 1].to = writeOffset;
+            stats.deltas++;
+        } else {
+            segments[0] = { active, offset, writeOffset };
+            segmentCount = 1;
+            stats.deltas = 0;
+        }
+    } else {
+        // Full or never formatted: start over in the other sector
+        int next = active < 0 ? 0 : 1 - active;
+        uint32_t eraseCount = stats.eraseCount[next] + 1;
+        if (!flash.eraseSector(sectors[next])) return false;
+        stats.eraseCount[next] = eraseCount;
+        if (!appendRecord(next, sizeof(SectorHeader), payload, length, sequence, false)) return false;
+        if (!commitHeader(next, eraseCount)) return false;
+
+        active = next;
+        stats.activeSector = active;
+        writeOffset = sizeof(SectorHeader) + recordSize(length);
+        stats.usedBytes = writeOffset;
+        stats.records = 1;
+        segments[0] = { active, sizeof(SectorHeader), writeOffset };
+        segmentCount = 1;
+        stats.deltas = 0;
+    }
+
+    stats.sequence = sequence;
+    return true;
+}
+
+bool ConfigStore::format() {
+    for (int i = 0; i < 2; i++) {
+        if (!flash.eraseSector(sectors[i])) return false;
+        stats.eraseCount[i]++;
+    }
+    stats.activeSector = -1;
+    stats.records = 0;
+    stats.usedBytes = 0;
+    stats.deltas = 0;
+    segmentCount = 0;
+    return true;
+}
@@ -0,0 +1,185 @@
+#include "crash_dump.hpp"
+#include<string.h>
+#include<stddef.h>
+#include<stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "stm32f4xx_hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#ifdef __cplusplus
+}
+#endif
+
+static const uint32_t CRASH_MAGIC = 0xDEADC0DE;
+
+// Survives the reset; the startup code only clears .bss
+static CrashRecord crashRecord __attribute__((section(".noinit")));
+
+bool CrashDump::valid = false;
+
+static uint32_t checksumOf(const CrashRecord& record) {
+    // Plain software sum: runs in fault context, where the CRC unit's
+    // scheduler lock is not an option
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(&record);
+    size_t count = offsetof(CrashRecord, checksum) / sizeof(uint32_t);
+    uint32_t sum = 0x811C9DC5;
+    for (size_t i = 0; i < count; i++) {
+        sum = ((sum << 5) | (sum >> 27)) ^ words[i];
+    }
+    return sum;
+}
+
+static bool recordValid() {
+    return crashRecord.magic == CRASH_MAGIC && crashRecord.checksum == checksumOf(crashRecord);
+}
+
+static void beginRecord(CrashReason reason) {
+    uint32_t count = recordValid() ? crashRecord.crashCount + 1 : 1;
+    memset(&crashRecord, 0, sizeof(crashRecord));
+    crashRecord.magic = CRASH_MAGIC;
+    crashRecord.reason = reason;
+    crashRecord.crashCount = count;
+    crashRecord.exception = __get_IPSR();
+    crashRecord.cfsr = SCB->CFSR;
+    crashRecord.hfsr = SCB->HFSR;
+    crashRecord.mmfar = SCB->MMFAR;
+    crashRecord.bfar = SCB->BFAR;
+    crashRecord.upTimeMs = HAL_GetTick();
+}
+
+static void recordTask(const char* task) {
+    // pxCurrentTCB is only meaningful once the scheduler runs
+    if (!task && xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+        task = pcTaskGetName(NULL);
+    }
+    strncpy(crashRecord.task, task ? task : "-", sizeof(crashRecord.task) - 1);
+}
+
+static void finishAndReset() __attribute__((noreturn));
+static void finishAndReset() {
+    crashRecord.checksum = checksumOf(crashRecord);
+    __DSB();
+    NVIC_SystemReset();
+    while (1) {}
+}
+
+extern "C" void crashDumpFault(uint32_t* frame, uint32_t excReturn) {
+    __disable_irq();
+    beginRecord(CRASH_FAULT);
+
+    // On the main stack the handler prologue may have pushed a word or two
+    // before CRASH_DUMP_FAULT_ENTRY; the stacked xPSR always has the Thumb bit
+    if ((excReturn & 4) == 0) {
+        for (int skip = 0; skip < 4 && !(frame[7] & (1UL << 24)); skip++) {
+            frame++;
+        }
+    }
+
+    crashRecord.r0 = frame[0];
+    crashRecord.r1 = frame[1];
+    crashRecord.r2 = frame[2];
+    crashRecord.r3 = frame[3];
+    crashRecord.r12 = frame[4];
+    crashRecord.lr = frame[5];
+    crashRecord.pc = frame[6];
+    crashRecord.xpsr = frame[7];
+    crashRecord.excReturn = excReturn;
+
+    // Bit 4 clear: the frame carries FPU state too
+    uint32_t* above = frame + ((excReturn & 0x10) ? 8 : 26);
+    crashRecord.sp = (uint32_t)above;
+    // A fault during stacking can leave the pointer outside RAM
+    if ((uint32_t)above >= SRAM1_BASE && (uint32_t)(above + CRASH_STACK_WORDS) <= SRAM1_BASE + 0x20000) {
+        memcpy(crashRecord.stack, above, sizeof(crashRecord.stack));
+    }
+
+    recordTask(NULL);
+    finishAndReset();
+}
+
+extern "C" void crashDumpSoftware(CrashReason reason, const char* task) {
+    __disable_irq();
+    beginRecord(reason);
+    crashRecord.lr = (uint32_t)__builtin_return_address(0);
+    crashRecord.sp = __get_PSP();
+    recordTask(task);
+    finishAndReset();
+}
+
+void CrashDump::init() {
+    valid = recordValid();
+
+    SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk | SCB_SHCSR_BUSFAULTENA_Msk | SCB_SHCSR_USGFAULTENA_Msk;
+}
+
+const CrashRecord& CrashDump::get() {
+    return crashRecord;
+}
+
+void CrashDump::clear() {
+    crashRecord.magic = 0;
+    valid = false;
+}
+
+const char* CrashDump::exceptionName(uint32_t exception) {
+    switch (exception) {
+        case 3:  return "HardFault";
+        case 4:  return "MemManage";
+        case 5:  return "BusFault";
+        case 6:  return "UsageFault";
+        default: return "exception";
+    }
+}
+
+void CrashDump::summarize(char* buffer, size_t size) {
+    const CrashRecord& record = crashRecord;
+    switch ((CrashReason)record.reason) {
+        case CRASH_FAULT:
+            snprintf(buffer, size, "%s in %s pc=%08lx lr=%08lx cfsr=%08lx (#%lu)",
+                    exceptionName(record.exception), record.task,
+                    (unsigned long)record.pc, (unsigned long)record.lr,
+                    (unsigned long)record.cfsr, (unsigned long)record.crashCount);
+            break;
+        case CRASH_MALLOC_FAILED:
+            snprintf(buffer, size, "RTOS heap exhausted in %s lr=%08lx (#%lu)",
+                    record.task, (unsigned long)record.lr, (unsigned long)record.crashCount);
+            break;
+        case CRASH_STACK_OVERFLOW:
+            snprintf(buffer, size, "Stack overflow in %s (#%lu)",
+                    record.task, (unsigned long)record.crashCount);
+            break;
+        default:
+            snprintf(buffer, size, "Unknown crash record");
+            break;
+    }
+}
+
+void CrashDump::write(ResponseWriter& out) {
+    if (!valid) {
+        out.write("No crash recorded\r\n");
+        return;
+    }
+
+    const CrashRecord& record = crashRecord;
+    char summary[96];
+    summarize(summary, sizeof(summary));
+    out.print("%s\r\n", summary);
+    out.print("  at %lu ms uptime, task %s\r\n", (unsigned long)record.upTimeMs, record.task);
+    if (record.reason != CRASH_FAULT) return;
+
+    out.print("  r0 %08lx r1 %08lx r2 %08lx r3 %08lx\r\n",
+            (unsigned long)record.r0, (unsigned long)record.r1, (unsigned long)record.r2, (unsigned long)record.r3);
+    out.print("  r12 %08lx lr %08lx pc %08lx xpsr %08lx\r\n",
+            (unsigned long)record.r12, (unsigned long)record.lr, (unsigned long)record.pc, (unsigned long)record.xpsr);
+    out.print("  cfsr %08lx hfsr %08lx mmfar %08lx bfar %08lx exc_return %08lx\r\n",
+            (unsigned long)record.cfsr, (unsigned long)record.hfsr, (unsigned long)record.mmfar,
+            (unsigned long)record.bfar, (unsigned long)record.excReturn);
+    out.print("  stack @%08lx:", (unsigned long)record.sp);
+    for (size_t i = 0; i < CRASH_STACK_WORDS; i++) {
+        out.print("%s %08lx", (i % 8 == 0 && i > 0) ? "\r\n                 " : "", (unsigned long)record.stack[i]);
+    }
+    out.write("\r\n");
+}
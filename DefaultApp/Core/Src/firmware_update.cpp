@@ -0,0 +1,226 @@
+#include "firmware_update.hpp"
+#include "image_header.h"
+#include "hw_crc.hpp"
+#include "system_logger.hpp"
+#include "watchdog_supervisor.hpp"
+#include<stdio.h>
+#include<string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "stm32f4xx_hal.h"
+#include "cmsis_os.h"
+#ifdef __cplusplus
+}
+#endif
+
+static const uint32_t RAM_START = 0x20000000;
+static const uint32_t RAM_END = 0x20020000;
+
+InternalFlash FirmwareUpdate::flash;
+int FirmwareUpdate::runningSlot = 0;
+UpdateState FirmwareUpdate::state = UpdateState::IDLE;
+uint32_t FirmwareUpdate::length = 0;
+uint32_t FirmwareUpdate::nextOffset = 0;
+
+void FirmwareUpdate::init() {
+    // SystemInit pointed VTOR at the table this image was linked with
+    runningSlot = SCB->VTOR == BOOT_SLOT_B_ADDRESS ? 1 : 0;
+}
+
+bool FirmwareUpdate::isTrial() {
+    const volatile BootTrailer* running = trailer(runningSlot);
+    return sequenceValid(running) && running->confirmed == BOOT_WORD_ERASED;
+}
+
+bool FirmwareUpdate::confirm() {
+    if (!isTrial()) return true;
+    return programWord(&trailer(runningSlot)->confirmed, BOOT_MARK);
+}
+
+void FirmwareUpdate::readSlot(int slot, SlotInfo& info) {
+    const ImageHeader* header = reinterpret_cast<const ImageHeader*>(slotAddress(slot) + IMAGE_HEADER_OFFSET);
+    const volatile BootTrailer* t = trailer(slot);
+
+    info.hasImage = header->magic == IMAGE_MAGIC;
+    info.version = info.hasImage ? header->version : 0;
+    info.sequenced = sequenceValid(t);
+    info.sequence = info.sequenced ? t->sequence : 0;
+    info.confirmed = t->confirmed != BOOT_WORD_ERASED;
+    info.rejected = t->rejected != BOOT_WORD_ERASED;
+    info.attempts = 0;
+    while (info.attempts < BOOT_MAX_ATTEMPTS && t->attempts[info.attempts] != BOOT_WORD_ERASED) {
+        info.attempts++;
+    }
+}
+
+UpdateResult FirmwareUpdate::begin(uint32_t imageLength) {
+    if (isTrial()) return UpdateResult::BAD_STATE;
+    if (imageLength < IMAGE_HEADER_OFFSET + sizeof(ImageHeader) || imageLength > BOOT_IMAGE_MAX_SIZE ||
+        (imageLength & 3) != 0) {
+        return UpdateResult::BAD_LENGTH;
+    }
+
+    state = UpdateState::IDLE;
+    char message[64];
+    snprintf(message, sizeof(message), "Erasing slot %s for a %lu byte image",
+            slotName(getTargetSlot()), (unsigned long)imageLength);
+    SystemLogger::getInstance()->log(LogLevel::info, message, "UPDATE");
+    if (!eraseSlot(getTargetSlot())) return UpdateResult::FLASH_ERROR;
+
+    length = imageLength;
+    nextOffset = 0;
+    state = UpdateState::RECEIVING;
+    return UpdateResult::OK;
+}
+
+UpdateResult FirmwareUpdate::write(uint32_t offset, const uint8_t* data, size_t size) {
+    if (state != UpdateState::RECEIVING) return UpdateResult::BAD_STATE;
+    if (size == 0 || (size & 3) != 0 || offset + size > length) return UpdateResult::BAD_LENGTH;
+    if (offset != nextOffset) {
+        // A resend after a lost reply; anything else is a gap
+        return offset + size <= nextOffset ? UpdateResult::OK : UpdateResult::BAD_OFFSET;
+    }
+
+    // Payloads sit unaligned in the frame buffer
+    uint32_t words[16];
+    for (size_t done = 0; done < size; done += sizeof(words)) {
+        size_t chunk = size - done < sizeof(words) ? size - done : sizeof(words);
+        memcpy(words, data + done, chunk);
+        if (!flash.program(slotAddress(getTargetSlot()) + offset + done, words, chunk / 4)) {
+            state = UpdateState::IDLE;
+            return UpdateResult::FLASH_ERROR;
+        }
+    }
+    nextOffset += size;
+    return UpdateResult::OK;
+}
+
+UpdateResult FirmwareUpdate::finish() {
+    if (state != UpdateState::RECEIVING || nextOffset != length) return UpdateResult::BAD_STATE;
+
+    // The data cache may still hold target words read before they were programmed
+    __HAL_FLASH_DATA_CACHE_DISABLE();
+    __HAL_FLASH_DATA_CACHE_RESET();
+    __HAL_FLASH_DATA_CACHE_ENABLE();
+
+    int target = getTargetSlot();
+    if (!imageValid(target)) {
+        state = UpdateState::IDLE;
+        return UpdateResult::BAD_IMAGE;
+    }
+
+    // begin erased the target trailer; the check word is the switch
+    const volatile BootTrailer* running = trailer(runningSlot);
+    uint32_t sequence = sequenceValid(running) ? running->sequence + 1 : 1;
+    const volatile BootTrailer* next = trailer(target);
+    if (!programWord(&next->sequence, sequence) || !programWord(&next->sequenceCheck, ~sequence)) {
+        state = UpdateState::IDLE;
+        return UpdateResult::FLASH_ERROR;
+    }
+    state = UpdateState::READY;
+
+    const ImageHeader* header = reinterpret_cast<const ImageHeader*>(slotAddress(target) + IMAGE_HEADER_OFFSET);
+    char message[64];
+    snprintf(message, sizeof(message), "Slot %s v%lu.%lu.%lu boots on the next reset", slotName(target),
+            (unsigned long)(header->version >> 16), (unsigned long)((header->version >> 8) & 0xFF),
+            (unsigned long)(header->version & 0xFF));
+    SystemLogger::getInstance()->log(LogLevel::info, message, "UPDATE");
+    return UpdateResult::OK;
+}
+
+static_assert(WATCHDOG_ERASE_TIMEOUT_MS <= WATCHDOG_MAX_TIMEOUT_MS, "slot erase outlasts the longest IWDG period");
+
+bool FirmwareUpdate::eraseSlot(int slot) {
+    // A sector at a time, other tasks run in between. Each erase stalls the
+    // whole CPU, ticks included, for up to FLASH_SLOT_ERASE_WORST_MS per
+    // slot while the IWDG keeps counting, so the period is held long enough
+    // whatever the config sets it to.
+    WatchdogSupervisor::stretch(WATCHDOG_ERASE_TIMEOUT_MS);
+    bool erased = true;
+    uint32_t end = slotAddress(slot) + slotSize(slot);
+    uint32_t address = slotAddress(slot);
+    while (erased && address < end) {
+        erased = flash.eraseSector(address);
+        // 16 KB sectors below 0x08010000, then one of 64 KB, then 128 KB
+        address += address < 0x08010000 ? 0x4000 : (address < 0x08020000 ? 0x10000 : 0x20000);
+        osDelay(1);
+    }
+    WatchdogSupervisor::release();
+    return erased;
+}
+
+bool FirmwareUpdate::programWord(const volatile uint32_t* word, uint32_t value) {
+    return flash.program((uint32_t)word, &value, 1);
+}
+
+bool FirmwareUpdate::imageValid(int slot) {
+    // What image_check.c in the bootloader checks before it jumps
+    uint32_t address = slotAddress(slot);
+    const ImageHeader* header = reinterpret_cast<const ImageHeader*>(address + IMAGE_HEADER_OFFSET);
+    const uint32_t* vectors = reinterpret_cast<const uint32_t*>(address);
+    const uint32_t headerEnd = IMAGE_HEADER_OFFSET + sizeof(ImageHeader);
+
+    if (header->magic != IMAGE_MAGIC || header->length != length) return false;
+    if (vectors[0] <= RAM_START || vectors[0] > RAM_END || (vectors[0] & 3) != 0) return false;
+    // An image linked for the other slot fails here
+    uint32_t entry = header->entry & ~1u;
+    if (header->entry != vectors[1] || (header->entry & 1) == 0 ||
+        entry < address + headerEnd || entry >= address + length) {
+        return false;
+    }
+    return HwCrc::compute(reinterpret_cast<const uint8_t*>(address), length,
+                          IMAGE_HEADER_OFFSET, sizeof(ImageHeader)) == header->crc;
+}
+
+const char* FirmwareUpdate::resultName(UpdateResult result) {
+    switch (result) {
+    case UpdateResult::OK:          return "ok";
+    case UpdateResult::BAD_STATE:   return "bad state";
+    case UpdateResult::BAD_LENGTH:  return "bad length";
+    case UpdateResult::BAD_OFFSET:  return "bad offset";
+    case UpdateResult::FLASH_ERROR: return "flash error";
+    case UpdateResult::BAD_IMAGE:   return "bad image";
+    }
+    return "unknown";
+}
+
+void FirmwareUpdate::describe(ResponseWriter& out) {
+    for (int slot = 0; slot < BOOT_SLOT_COUNT; slot++) {
+        SlotInfo info;
+        readSlot(slot, info);
+        out.print("Slot %s%s: ", slotName(slot), slot == runningSlot ? " (running)" : "");
+        if (info.hasImage) {
+            out.print("v%lu.%lu.%lu", info.version >> 16, (info.version >> 8) & 0xFF, info.version & 0xFF);
+        } else {
+            out.write("no image");
+        }
+        if (info.sequenced) {
+            out.print(", sequence %lu", info.sequence);
+        }
+        if (info.rejected) {
+            out.write(", rejected");
+        } else if (info.sequenced && !info.confirmed) {
+            out.print(", on trial, %lu of %d boots used", info.attempts, BOOT_MAX_ATTEMPTS);
+        } else if (info.sequenced) {
+            out.write(", confirmed");
+        }
+        out.write("\r\n");
+    }
+
+    switch (state) {
+    case UpdateState::IDLE:
+        out.print("Update: idle, the next one goes to slot %s\r\n", slotName(getTargetSlot()));
+        break;
+    case UpdateState::RECEIVING:
+        out.print("Update: slot %s, %lu of %lu bytes\r\n", slotName(getTargetSlot()), nextOffset, length);
+        break;
+    case UpdateState::READY:
+        out.print("Update: slot %s verified, boots on the next reset\r\n", slotName(getTargetSlot()));
+        break;
+    }
+    if (isTrial()) {
+        out.print("Confirms itself after %lu ms without errors, or `boot confirm`\r\n", (unsigned long)BOOT_CONFIRM_DELAY_MS);
+    }
+}
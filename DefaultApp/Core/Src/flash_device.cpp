@@ -0,0 +1,65 @@
+#include "flash_device.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "stm32f4xx_hal.h"
+#ifdef __cplusplus
+}
+#endif
+
+int InternalFlash::sectorNumber(uint32_t sectorAddress) {
+    // 4 x 16 KB, 1 x 64 KB, 3 x 128 KB
+    static const uint32_t SECTOR_STARTS[] = {
+        0x08000000, 0x08004000, 0x08008000, 0x0800C000,
+        0x08010000, 0x08020000, 0x08040000, 0x08060000
+    };
+    for (int i = 0; i < (int)(sizeof(SECTOR_STARTS) / sizeof(SECTOR_STARTS[0])); i++) {
+        if (SECTOR_STARTS[i] == sectorAddress) return i;
+    }
+    return -1;
+}
+
+bool InternalFlash::eraseSector(uint32_t sectorAddress) {
+    int sector = sectorNumber(sectorAddress);
+    if (sector < 0) return false;
+
+    FLASH_EraseInitTypeDef erase = {};
+    erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+    erase.Sector = (uint32_t)sector;
+    erase.NbSectors = 1;
+    erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+    uint32_t failedSector = 0;
+
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+                           FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+    HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &failedSector);
+    HAL_FLASH_Lock();
+    return status == HAL_OK;
+}
+
+bool InternalFlash::program(uint32_t address, const uint32_t* words, size_t count) {
+    HAL_StatusTypeDef status = HAL_OK;
+
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+                           FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+    for (size_t i = 0; i < count && status == HAL_OK; i++) {
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address + i * 4, words[i]);
+    }
+    HAL_FLASH_Lock();
+    flushDataCache();
+    return status == HAL_OK;
+}
+
+void InternalFlash::flushDataCache() {
+    // The ART data cache can still hold the words as they read before
+    // programming, and a read-back would compare against those. Erase goes
+    // through HAL_FLASHEx_Erase, which flushes the caches itself.
+    if (FLASH->ACR & FLASH_ACR_DCEN) {
+        __HAL_FLASH_DATA_CACHE_DISABLE();
+        __HAL_FLASH_DATA_CACHE_RESET();
+        __HAL_FLASH_DATA_CACHE_ENABLE();
+    }
+}
@@ -0,0 +1,201 @@
+#include "heap_stats.hpp"
+#include<new>
+#include<stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "stm32f4xx_hal.h"
+#ifdef __cplusplus
+}
+#endif
+
+HeapUsage HeapStats::total = {};
+HeapUsage HeapStats::modules[(size_t)HeapModule::COUNT] = {};
+HeapUsage HeapStats::rtos = {};
+HeapModule HeapStats::initModule = HeapModule::app;
+uint32_t HeapStats::failures = 0;
+uint32_t HeapStats::corruptions = 0;
+
+static const char* const MODULE_NAMES[(size_t)HeapModule::COUNT] = {
+    "other", "app", "sensor", "cli", "logger", "protocol", "stream", "storage", "config", "monitor"
+};
+
+const char* HeapStats::moduleName(HeapModule module) {
+    return module < HeapModule::COUNT ? MODULE_NAMES[(size_t)module] : "?";
+}
+
+void HeapStats::tagTask(TaskHandle_t task, HeapModule module) {
+    // The task number is free for application use with the trace facility on
+    if (task) {
+        vTaskSetTaskNumber(task, (UBaseType_t)module);
+    }
+}
+
+HeapModule HeapStats::currentModule() {
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        return initModule;
+    }
+    UBaseType_t tag = uxTaskGetTaskNumber(xTaskGetCurrentTaskHandle());
+    return tag < (UBaseType_t)HeapModule::COUNT ? (HeapModule)tag : HeapModule::other;
+}
+
+// Callers mask interrupts; a critical section would not work before the
+// scheduler starts
+void HeapStats::add(HeapUsage& usage, uint32_t size) {
+    usage.liveBytes += size;
+    if (usage.liveBytes > usage.peakBytes) {
+        usage.peakBytes = usage.liveBytes;
+    }
+    usage.allocations++;
+}
+
+void HeapStats::remove(HeapUsage& usage, uint32_t size) {
+    usage.liveBytes -= size;
+    usage.frees++;
+}
+
+void* HeapStats::allocate(size_t size) {
+    AllocationHeader* header = static_cast<AllocationHeader*>(malloc(sizeof(AllocationHeader) + size));
+    HeapModule module = currentModule();
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (header) {
+        header->size = size;
+        header->module = (uint16_t)module;
+        header->magic = HEADER_MAGIC;
+        add(total, size);
+        add(modules[(size_t)module], size);
+    } else {
+        failures++;
+    }
+    __set_PRIMASK(primask);
+
+    return header ? header + 1 : nullptr;
+}
+
+void HeapStats::release(void* pointer) {
+    if (!pointer) return;
+    AllocationHeader* header = static_cast<AllocationHeader*>(pointer) - 1;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool valid = header->magic == HEADER_MAGIC && header->module < (uint16_t)HeapModule::COUNT;
+    if (valid) {
+        remove(total, header->size);
+        remove(modules[header->module], header->size);
+        header->magic = 0;
+    } else {
+        corruptions++;
+    }
+    __set_PRIMASK(primask);
+
+    // A block without the magic was freed already, is not ours or had its
+    // header overwritten. Handing it to free() would corrupt the malloc
+    // arena, so it is counted and leaked instead.
+    if (valid) {
+        free(header);
+    }
+}
+
+void HeapStats::rtosAllocated(void* pointer, size_t blockSize) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (pointer) {
+        add(rtos, blockSize);
+    } else {
+        failures++;
+    }
+    __set_PRIMASK(primask);
+}
+
+void HeapStats::rtosFreed(void* /*pointer*/, size_t blockSize) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    remove(rtos, blockSize);
+    __set_PRIMASK(primask);
+}
+
+HeapUsage HeapStats::getTotal() {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    HeapUsage usage = total;
+    __set_PRIMASK(primask);
+    return usage;
+}
+
+HeapUsage HeapStats::getModule(HeapModule module) {
+    HeapUsage usage = {};
+    if (module >= HeapModule::COUNT) return usage;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    usage = modules[(size_t)module];
+    __set_PRIMASK(primask);
+    return usage;
+}
+
+RtosHeapUsage HeapStats::getRtosHeap() {
+    RtosHeapUsage result;
+    HeapStats_t heap;
+    vPortGetHeapStats(&heap); // walks the free list with the scheduler suspended
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    result.usage = rtos;
+    __set_PRIMASK(primask);
+
+    result.freeBytes = heap.xAvailableHeapSpaceInBytes;
+    result.minimumEverFree = heap.xMinimumEverFreeBytesRemaining;
+    result.largestFreeBlock = heap.xSizeOfLargestFreeBlockInBytes;
+    result.freeBlocks = heap.xNumberOfFreeBlocks;
+    return result;
+}
+
+extern "C" void heapTraceMalloc(void* pointer, size_t size) {
+    HeapStats::rtosAllocated(pointer, size);
+}
+
+extern "C" void heapTraceFree(void* pointer, size_t size) {
+    HeapStats::rtosFreed(pointer, size);
+}
+
+extern "C" void vApplicationMallocFailedHook(void);
+
+// Global allocation operators; every std container comes through here
+void* operator new(size_t size) {
+    void* pointer = HeapStats::allocate(size);
+    if (!pointer) {
+        vApplicationMallocFailedHook(); // does not return
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return HeapStats::allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return HeapStats::allocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    HeapStats::release(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    HeapStats::release(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    HeapStats::release(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    HeapStats::release(pointer);
+}
@@ -0,0 +1,72 @@
+#include "high_res_clock.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "stm32f4xx_hal.h"
+#ifdef __cplusplus
+}
+#endif
+
+static uint32_t readCycleCounter() {
+    return DWT->CYCCNT;
+}
+
+static uint32_t readTick() {
+    return HAL_GetTick();
+}
+
+HighResClock::CycleSource HighResClock::source = readCycleCounter;
+HighResClock::MillisSource HighResClock::millis = nullptr;
+uint32_t HighResClock::frequency = 1000000;
+uint32_t HighResClock::cyclesPerUs = 1;
+uint32_t HighResClock::lastCycles = 0;
+uint32_t HighResClock::lastMillis = 0;
+uint64_t HighResClock::total = 0;
+
+void HighResClock::init() {
+    // Trace must be enabled before the DWT unit accepts writes. The count is
+    // not reset: it has been running since the bootloader and times the boot
+    // (boot_timing.h).
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    setSource(readCycleCounter, HAL_RCC_GetHCLKFreq(), readTick);
+}
+
+void HighResClock::setSource(CycleSource cycleSource, uint32_t frequencyHz, MillisSource millisSource) {
+    source = cycleSource;
+    millis = millisSource;
+    frequency = frequencyHz;
+    cyclesPerUs = frequencyHz >= 1000000 ? frequencyHz / 1000000 : 1;
+    lastCycles = source();
+    lastMillis = millis ? millis() : 0;
+    // The count keeps its 32-bit value, which is the boot time so far
+    total = lastCycles;
+}
+
+uint64_t HighResClock::now() {
+    // Extension state is shared by tasks and ISRs; the masked section is a
+    // handful of instructions
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t current = source();
+    uint64_t elapsed = (uint32_t)(current - lastCycles);
+    lastCycles = current;
+    if (millis) {
+        // Whole wraps the counter alone cannot show, rounded to the nearest;
+        // the tick stalls during flash erases, so it only ever adds wraps
+        uint32_t ms = millis();
+        uint64_t expected = (uint64_t)(ms - lastMillis) * (frequency / 1000);
+        lastMillis = ms;
+        if (expected > elapsed + 0x80000000u) {
+            elapsed += ((expected - elapsed + 0x80000000u) >> 32) << 32;
+        }
+    }
+    total += elapsed;
+    uint64_t result = total;
+
+    __set_PRIMASK(primask);
+    return result;
+}
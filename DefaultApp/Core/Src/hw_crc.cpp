@@ -0,0 +1,57 @@
+#include "hw_crc.hpp"
+#include<string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "stm32f4xx_hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#ifdef __cplusplus
+}
+#endif
+
+void HwCrc::init() {
+    __HAL_RCC_CRC_CLK_ENABLE();
+}
+
+uint32_t HwCrc::compute(const uint8_t* data, size_t length) {
+    // One CRC unit is shared by every task; no ISR uses it, so holding off
+    // the scheduler is enough and interrupts keep running
+    vTaskSuspendAll();
+
+    CRC->CR = CRC_CR_RESET;
+    feed(data, length);
+    uint32_t result = CRC->DR;
+
+    xTaskResumeAll();
+    return result;
+}
+
+uint32_t HwCrc::compute(const uint8_t* data, size_t length, size_t skipOffset, size_t skipLength) {
+    vTaskSuspendAll();
+
+    CRC->CR = CRC_CR_RESET;
+    feed(data, skipOffset);
+    feed(data + skipOffset + skipLength, length - skipOffset - skipLength);
+    uint32_t result = CRC->DR;
+
+    xTaskResumeAll();
+    return result;
+}
+
+void HwCrc::feed(const uint8_t* data, size_t length) {
+    size_t words = length / 4;
+    for (size_t i = 0; i < words; i++) {
+        uint32_t word;
+        memcpy(&word, &data[i * 4], 4); // data may be unaligned
+        CRC->DR = word;
+    }
+
+    size_t tail = length & 3;
+    if (tail > 0) {
+        uint32_t word = 0;
+        memcpy(&word, &data[words * 4], tail);
+        CRC->DR = word;
+    }
+}
@@ -0,0 +1,106 @@
+#include "latency_trace.hpp"
+#include<string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "stm32f4xx_hal.h"
+#ifdef __cplusplus
+}
+#endif
+
+#if LATENCY_TRACE_ENABLED
+LatencyTrace::Histogram LatencyTrace::histograms[(size_t)LatencyStage::COUNT];
+#endif
+
+static const char* const STAGE_NAMES[(size_t)LatencyStage::COUNT] = {
+    "sensor read", "enqueue", "dequeue", "cli update", "stream update", "storage update", "stream tx"
+};
+
+const char* LatencyTrace::stageName(LatencyStage stage) {
+    return stage < LatencyStage::COUNT ? STAGE_NAMES[(size_t)stage] : "?";
+}
+
+// Values below SUB_BUCKETS get a bucket each; above that, each power of two
+// is split into SUB_BUCKETS linear steps
+size_t LatencyTrace::bucketOf(uint32_t us) {
+    if (us < SUB_BUCKETS) return us;
+
+    uint32_t octave = 31 - __builtin_clz(us); // >= 2
+    if (octave >= LATENCY_MAX_OCTAVE + 1) return BUCKETS - 1;
+    uint32_t sub = (us >> (octave - 2)) & (SUB_BUCKETS - 1);
+    return SUB_BUCKETS + (octave - 2) * SUB_BUCKETS + sub;
+}
+
+uint32_t LatencyTrace::bucketUpperBound(size_t bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    if (bucket == BUCKETS - 1) return UINT32_MAX; // open ended, capped by the max
+
+    uint32_t octave = (bucket - SUB_BUCKETS) / SUB_BUCKETS + 2;
+    uint32_t sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+    uint32_t step = 1UL << (octave - 2);
+    return (1UL << octave) + (sub + 1) * step - 1;
+}
+
+void LatencyTrace::record(LatencyStage stage, uint32_t us) {
+#if LATENCY_TRACE_ENABLED
+    if (stage >= LatencyStage::COUNT) return;
+    Histogram& histogram = histograms[(size_t)stage];
+    size_t bucket = bucketOf(us);
+
+    // Stages are recorded from several tasks
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    histogram.buckets[bucket]++;
+    histogram.count++;
+    if (us > histogram.maxUs) histogram.maxUs = us;
+    __set_PRIMASK(primask);
+#endif
+}
+
+LatencySummary LatencyTrace::summarize(LatencyStage stage) {
+    LatencySummary summary = {};
+#if LATENCY_TRACE_ENABLED
+    if (stage >= LatencyStage::COUNT) return summary;
+
+    static Histogram copy; // only the CLI task summarizes
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    copy = histograms[(size_t)stage];
+    __set_PRIMASK(primask);
+
+    summary.count = copy.count;
+    summary.maxUs = copy.maxUs;
+    if (copy.count == 0) return summary;
+
+    // Nearest-rank percentiles
+    uint32_t p50Rank = (copy.count + 1) / 2;
+    uint32_t p99Rank = (uint32_t)(((uint64_t)copy.count * 99 + 99) / 100);
+    uint32_t seen = 0;
+    bool havePercentile50 = false;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += copy.buckets[i];
+        if (!havePercentile50 && seen >= p50Rank) {
+            summary.p50Us = bucketUpperBound(i);
+            havePercentile50 = true;
+        }
+        if (seen >= p99Rank) {
+            summary.p99Us = bucketUpperBound(i);
+            break;
+        }
+    }
+    // No percentile exceeds the max
+    if (summary.p50Us > summary.maxUs) summary.p50Us = summary.maxUs;
+    if (summary.p99Us > summary.maxUs) summary.p99Us = summary.maxUs;
+#endif
+    return summary;
+}
+
+void LatencyTrace::reset() {
+#if LATENCY_TRACE_ENABLED
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memset(histograms, 0, sizeof(histograms));
+    __set_PRIMASK(primask);
+#endif
+}
@@ -24,7 +24,9 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-
+#include "crash_dump.hpp"
+#include "image_header.h"
+#include "boot_timing.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -52,6 +54,9 @@ SPI_HandleTypeDef hspi1;
 
 UART_HandleTypeDef huart1;
 UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart1_rx;
+DMA_HandleTypeDef hdma_usart1_tx;
+DMA_HandleTypeDef hdma_usart2_tx;
 
 //osThreadId sensorTaskHandle;
 //osThreadId CLITaskHandle;
@@ -59,12 +64,18 @@ UART_HandleTypeDef huart2;
 /* USER CODE BEGIN PV */
 // Global application instance
 std::unique_ptr<Application> app;
+
+// Checked by the bootloader; length, crc and entry are stamped after the build
+extern "C" const ImageHeader imageHeader __attribute__((section(".image_header"), used)) = {
+    IMAGE_MAGIC, FIRMWARE_VERSION, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF}
+};
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 void PeriphCommonClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_I2C1_Init(void);
 static void MX_I2S2_Init(void);
 static void MX_I2S3_Init(void);
@@ -82,33 +93,36 @@ static void MX_USART1_UART_Init(void);
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
 extern "C" void vApplicationStackOverflowHook( osThreadId taskHandle, char *pcTaskName) {
-    // Handle stack overflow
-    while(1) {
-        HAL_GPIO_TogglePin(GPIOC, GPIO_PIN_13); // Toggle LED
-        HAL_Delay(100);
-    }
+    // The TCB may be what got overwritten; record the name FreeRTOS passed
+    crashDumpSoftware(CRASH_STACK_OVERFLOW, pcTaskName);
 }
 
 //process : Allocating Dynamic memory in Freertos failure
 extern "C" void vApplicationMallocFailedHook(void) {
-    // Handle malloc failure
-    while(1) {
-        HAL_GPIO_TogglePin(GPIOC, GPIO_PIN_13);
-        HAL_Delay(50);
-    }
+    // Recorded and reset; the next boot reports it through `crash`
+    crashDumpSoftware(CRASH_MALLOC_FAILED, NULL);
 }
 
 // UART interrupt callbacks
-//automatically call when finish receive signal from uart
-extern "C" void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart) {
-    static uint8_t rxData[1];
+// Called on DMA half/full transfer and on UART IDLE line, with the current
+// write position inside the circular receive buffer
+extern "C" void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
+    if (app) {
+        app->handleUARTRxEvent(huart, Size);
+    }
+}
 
+// Called when a DMA transmit chunk has left the UART
+extern "C" void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
     if (app) {
-        app->handleUARTInterrupt(huart, rxData, 1);
+        app->handleUARTTxComplete(huart);
     }
+}
 
-    // Continue receiving
-    HAL_UART_Receive_IT(huart, rxData, 1);
+extern "C" void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+    if (app) {
+        app->handleUARTError(huart);
+    }
 }
 /* USER CODE END 0 */
 
@@ -139,11 +153,12 @@ int main(void)
   PeriphCommonClock_Config();
 
   /* USER CODE BEGIN SysInit */
-
+  boot_timing_clock(SystemCoreClock);
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_I2C1_Init();
   MX_I2S2_Init();
   MX_I2S3_Init();
@@ -156,9 +171,6 @@ int main(void)
    // Initialize and start application
    app->init();
    app->run();
-
-   uint8_t rxData[1];
-   HAL_UART_Receive_IT(&huart2, rxData, 1);
   /* USER CODE END 2 */
 
   /* USER CODE BEGIN RTOS_MUTEX */
@@ -432,7 +444,7 @@ static void MX_USART1_UART_Init(void)
 
   /* USER CODE END USART1_Init 1 */
   huart1.Instance = USART1;
-  huart1.Init.BaudRate = 115200;
+  huart1.Init.BaudRate = 921600;
   huart1.Init.WordLength = UART_WORDLENGTH_8B;
   huart1.Init.StopBits = UART_STOPBITS_1;
   huart1.Init.Parity = UART_PARITY_NONE;
@@ -482,6 +494,29 @@ static void MX_USART2_UART_Init(void)
 
 }
 
+/**
+  * Enable DMA controller clock
+  */
+static void MX_DMA_Init(void)
+{
+
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  /* DMA1_Stream6_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+  /* DMA2_Stream2_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA2_Stream2_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream2_IRQn);
+  /* DMA2_Stream7_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA2_Stream7_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream7_IRQn);
+
+}
+
 /**
   * @brief GPIO Initialization Function
   * @param None
@@ -0,0 +1,137 @@
+#include "metrics.hpp"
+#include<string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "FreeRTOS.h"
+#include "task.h"
+#ifdef __cplusplus
+}
+#endif
+
+Metrics::Entry Metrics::entries[METRICS_MAX];
+size_t Metrics::count = 0;
+
+bool Metrics::add(const char* name, const char* help, MetricType type, void* metric) {
+    bool added = false;
+
+    vTaskSuspendAll();
+    if (count < METRICS_MAX) {
+        Entry& entry = entries[count];
+        entry.name = name;
+        entry.help = help;
+        entry.type = type;
+        entry.metric = metric;
+        count++;
+        added = true;
+    }
+    xTaskResumeAll();
+    return added;
+}
+
+bool Metrics::add(const char* name, const char* help, Counter& counter) {
+    return add(name, help, MetricType::COUNTER, &counter);
+}
+
+bool Metrics::add(const char* name, const char* help, Gauge& gauge) {
+    return add(name, help, MetricType::GAUGE, &gauge);
+}
+
+bool Metrics::add(const char* name, const char* help, Histogram& histogram) {
+    return add(name, help, MetricType::HISTOGRAM, &histogram);
+}
+
+const Counter* Metrics::findCounter(const char* name) {
+    for (size_t i = 0; i < count; i++) {
+        if (entries[i].type == MetricType::COUNTER && strcmp(entries[i].name, name) == 0) {
+            return static_cast<const Counter*>(entries[i].metric);
+        }
+    }
+    return nullptr;
+}
+
+void Metrics::writeText(ResponseWriter& out) {
+    static const char* const TYPE_NAMES[] = {"counter", "gauge", "histogram"};
+
+    for (size_t i = 0; i < count; i++) {
+        const Entry& entry = entries[i];
+        out.print("# HELP %s %s\r\n", entry.name, entry.help);
+        out.print("# TYPE %s %s\r\n", entry.name, TYPE_NAMES[(int)entry.type]);
+
+        switch (entry.type) {
+        case MetricType::COUNTER:
+            out.print("%s %lu\r\n", entry.name, (unsigned long)static_cast<Counter*>(entry.metric)->get());
+            break;
+        case MetricType::GAUGE:
+            out.print("%s %ld\r\n", entry.name, (long)static_cast<Gauge*>(entry.metric)->get());
+            break;
+        case MetricType::HISTOGRAM: {
+            const Histogram& histogram = *static_cast<Histogram*>(entry.metric);
+            uint32_t cumulative = 0;
+            for (size_t b = 0; b < histogram.getBoundCount(); b++) {
+                cumulative += histogram.getBucket(b);
+                out.print("%s_bucket{le=\"%lu\"} %lu\r\n", entry.name,
+                        (unsigned long)histogram.getBound(b), (unsigned long)cumulative);
+            }
+            cumulative += histogram.getBucket(histogram.getBoundCount());
+            out.print("%s_bucket{le=\"+Inf\"} %lu\r\n", entry.name, (unsigned long)cumulative);
+            out.print("%s_sum %lu\r\n", entry.name, (unsigned long)histogram.getSum());
+            out.print("%s_count %lu\r\n", entry.name, (unsigned long)cumulative);
+            break;
+        }
+        }
+    }
+    out.write("# EOF\r\n");
+}
+
+static uint8_t* putWord(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+    return out + 4;
+}
+
+size_t Metrics::encode(size_t& index, bool describe, uint8_t* buffer, size_t size) {
+    uint8_t* out = buffer;
+
+    for (; index < count; index++) {
+        const Entry& entry = entries[index];
+        const Histogram* histogram = entry.type == MetricType::HISTOGRAM ? static_cast<Histogram*>(entry.metric) : nullptr;
+
+        size_t values;
+        size_t nameLength = 0;
+        if (describe) {
+            values = histogram ? histogram->getBoundCount() : 0;
+            nameLength = strlen(entry.name);
+            if (nameLength > 255) nameLength = 255;
+        } else {
+            values = histogram ? histogram->getBoundCount() + 2 : 1;
+        }
+
+        size_t recordSize = 2 + values * 4 + (describe ? 1 + nameLength : 0);
+        if ((size_t)(out - buffer) + recordSize > size) break;
+
+        *out++ = (uint8_t)entry.type;
+        *out++ = (uint8_t)values;
+        if (describe) {
+            for (size_t b = 0; b < values; b++) {
+                out = putWord(out, histogram->getBound(b));
+            }
+            *out++ = (uint8_t)nameLength;
+            memcpy(out, entry.name, nameLength);
+            out += nameLength;
+        } else if (histogram) {
+            for (size_t b = 0; b <= histogram->getBoundCount(); b++) {
+                out = putWord(out, histogram->getBucket(b));
+            }
+            out = putWord(out, histogram->getSum());
+        } else if (entry.type == MetricType::COUNTER) {
+            out = putWord(out, static_cast<Counter*>(entry.metric)->get());
+        } else {
+            out = putWord(out, (uint32_t)static_cast<Gauge*>(entry.metric)->get());
+        }
+    }
+    return out - buffer;
+}
@@ -0,0 +1,120 @@
+#include "monitored_queue.hpp"
+#include "system_logger.hpp"
+#include<stdio.h>
+
+QueueMonitor* QueueMonitor::monitors[QUEUE_MONITOR_MAX];
+size_t QueueMonitor::count = 0;
+
+QueueMonitor::QueueMonitor(const char* queueName, uint32_t queueCapacity, size_t slotSize)
+    : name(queueName), capacity(queueCapacity), highWater(0), sentCount(0), failureCount(0),
+      receivedCount(0), blockedUs(0), residencyUs(0), lastReceived(0), lastResidencyUs(0),
+      lastFailures(0), windowResidencyUs(0), fullSeconds(0), saturated(false) {
+
+    handle = xQueueCreate(queueCapacity, slotSize);
+    if (!handle) return;
+    vQueueAddToRegistry(handle, queueName);
+
+    vTaskSuspendAll();
+    if (count < QUEUE_MONITOR_MAX) {
+        monitors[count++] = this;
+    }
+    xTaskResumeAll();
+}
+
+QueueMonitor::~QueueMonitor() {
+    vTaskSuspendAll();
+    for (size_t i = 0; i < count; i++) {
+        if (monitors[i] == this) {
+            monitors[i] = monitors[--count];
+            break;
+        }
+    }
+    xTaskResumeAll();
+
+    if (handle) {
+        vQueueUnregisterQueue(handle);
+        vQueueDelete(handle);
+    }
+}
+
+void QueueMonitor::recordSend(bool sent, uint32_t blockedCycles) {
+    if (blockedCycles > 0) {
+        blockedUs.fetch_add(HighResClock::cyclesToUs(blockedCycles), std::memory_order_relaxed);
+    }
+    if (!sent) {
+        failureCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    sentCount.fetch_add(1, std::memory_order_relaxed);
+
+    // No critical section, so it is usable from ISRs as well
+    uint32_t depth = uxQueueMessagesWaitingFromISR(handle);
+    uint32_t peak = highWater.load(std::memory_order_relaxed);
+    while (depth > peak && !highWater.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) {
+    }
+}
+
+void QueueMonitor::recordReceive(uint32_t enqueuedCycles) {
+    receivedCount.fetch_add(1, std::memory_order_relaxed);
+    residencyUs.fetch_add(HighResClock::cyclesToUs(HighResClock::cycles() - enqueuedCycles), std::memory_order_relaxed);
+}
+
+void QueueMonitor::checkOne(size_t& newlySaturated) {
+    // Windows are deltas of free-running counters, so wrap-around is harmless
+    uint32_t received = receivedCount.load(std::memory_order_relaxed);
+    uint32_t residency = residencyUs.load(std::memory_order_relaxed);
+    uint32_t failures = failureCount.load(std::memory_order_relaxed);
+
+    uint32_t receivedInWindow = received - lastReceived;
+    if (receivedInWindow > 0) {
+        windowResidencyUs = (residency - lastResidencyUs) / receivedInWindow;
+    }
+    bool rejected = failures != lastFailures;
+    lastReceived = received;
+    lastResidencyUs = residency;
+    lastFailures = failures;
+
+    uint32_t depth = uxQueueMessagesWaiting(handle);
+    if (rejected || depth * 100 >= capacity * QUEUE_SATURATION_PERCENT) {
+        fullSeconds++;
+    } else {
+        fullSeconds = 0;
+        saturated = false;
+    }
+
+    if (!saturated && fullSeconds >= QUEUE_SATURATION_SECONDS) {
+        saturated = true;
+        newlySaturated++;
+
+        char message[80];
+        snprintf(message, sizeof(message), "Queue saturated: %s %lu/%lu, %lu send failures",
+                name, (unsigned long)depth, (unsigned long)capacity, (unsigned long)failures);
+        SystemLogger::getInstance()->log(LogLevel::warning, message, "QUEUE");
+    }
+}
+
+size_t QueueMonitor::check() {
+    size_t newlySaturated = 0;
+    for (size_t i = 0; i < count; i++) {
+        monitors[i]->checkOne(newlySaturated);
+    }
+    return newlySaturated;
+}
+
+size_t QueueMonitor::report(QueueHealth* out, size_t maxQueues) {
+    size_t n = count < maxQueues ? count : maxQueues;
+    for (size_t i = 0; i < n; i++) {
+        const QueueMonitor& queue = *monitors[i];
+        out[i].name = queue.name;
+        out[i].capacity = queue.capacity;
+        out[i].waiting = queue.waiting();
+        out[i].highWater = queue.highWater.load(std::memory_order_relaxed);
+        out[i].sent = queue.sentCount.load(std::memory_order_relaxed);
+        out[i].sendFailures = queue.failureCount.load(std::memory_order_relaxed);
+        out[i].received = queue.receivedCount.load(std::memory_order_relaxed);
+        out[i].blockedUs = queue.blockedUs.load(std::memory_order_relaxed);
+        out[i].residencyUs = queue.windowResidencyUs;
+        out[i].saturated = queue.saturated;
+    }
+    return n;
+}
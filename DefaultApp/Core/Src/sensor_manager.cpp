@@ -1,4 +1,9 @@
 #include "sensor_manager.hpp"
+#include "stack_monitor.hpp"
+#include "heap_stats.hpp"
+#include "watchdog_supervisor.hpp"
+#include "latency_trace.hpp"
+#include "boot_profile.hpp"
 #include "common_variables.hpp"
 
 /* Note:  HAL_SPI_Transmit or same function only can be used at cpp but not header file hpp)
@@ -41,10 +46,13 @@ bool TemperatureSensor::init() {
      if (!isActive) return SensorData();
 
      uint8_t data[2];
+     LATENCY_BEGIN(readStart);
      if (spiReceive(data, 2) == HAL_OK) {
+         uint64_t timestamp = HighResClock::nowUs(); // sample time = end of SPI transfer
+         LATENCY_SPAN(SENSOR_READ, readStart);
          float temperature = ((data[0] << 8) | data[1]) * 0.0625f; // Example conversion
          lastReadTime = HAL_GetTick();
-         return SensorData(SensorType::TEMPERATURE, lastReadTime, temperature, sensorId);
+         return SensorData(SensorType::TEMPERATURE, timestamp, temperature, sensorId);
      }
 
      SystemLogger::getInstance()->log(LogLevel::error, "Temperature sensor read failed", "TEMP_SENSOR");
@@ -62,10 +70,8 @@ bool TemperatureSensor::init() {
  }
 
 SensorManager::SensorManager(SPI_HandleTypeDef* spi)
-    : hspi(spi), readInterval(1000), isRunning(false) {
-
-	osMessageQDef(sensorDataQueueDef, SENSOR_DATA_QUEUE_SIZE, uint32_t);
-	sensorDataQueue = osMessageCreate(osMessageQ(sensorDataQueueDef), NULL);
+    : sensorDataQueue("sensor data", SENSOR_DATA_QUEUE_SIZE), sensorTimer(nullptr), hspi(spi), readInterval(1000), isRunning(false),
+      taskWatchdogId(WatchdogSupervisor::INVALID_ID), readWatchdogId(WatchdogSupervisor::INVALID_ID) {
 
 	osSemaphoreDef(sensoMutexDef);
 	sensorMutex = osSemaphoreCreate(osSemaphore(sensoMutexDef), 1);
@@ -74,11 +80,9 @@ SensorManager::SensorManager(SPI_HandleTypeDef* spi)
 
 SensorManager::~SensorManager() {
     stop();
-    osMessageDelete(sensorDataQueue);
     osSemaphoreRelease(sensorMutex);
 }
 
-void StartSensorTask(void const *argument);
 void SensorManager::init() {
     // Initialize all sensors
     for (auto& sensor : sensors) {
@@ -90,8 +94,17 @@ void SensorManager::init() {
                               pdTRUE, this, sensorTimerCallback);
 
     // Create sensor task
-    osThreadDef(sensoTaskDef, StartSensorTask, osPriorityNormal, 1, 512);
-    sensorTaskId = osThreadCreate(osThread(sensoTaskDef), nullptr);
+    osThreadDef(sensoTaskDef, sensorTask, osPriorityNormal, 1, SENSOR_TASK_STACK_WORDS);
+    sensorTaskId = osThreadCreate(osThread(sensoTaskDef), this);
+    StackMonitor::watch(sensorTaskId, SENSOR_TASK_STACK_WORDS);
+    HeapStats::tagTask(sensorTaskId, HeapModule::sensor);
+
+    taskWatchdogId = WatchdogSupervisor::registerTask("sensor", WATCHDOG_TASK_DEADLINE_MS);
+    readWatchdogId = WatchdogSupervisor::registerTask("sensor read", readInterval + WATCHDOG_TASK_DEADLINE_MS);
+    WatchdogSupervisor::setEnabled(readWatchdogId, false); // until start()
+
+    Metrics::add("sensor_samples_total", "Valid samples read by the sensor timer", samplesRead);
+    Metrics::add("sensor_read_errors_total", "Reads of active sensors that failed", readErrors);
 
     SystemLogger::getInstance()->log(LogLevel::info, "Sensor Manager initialized", "SENSOR_MGR");
 }
@@ -99,15 +112,41 @@ void SensorManager::init() {
 void SensorManager::start() {
     isRunning = true;
     xTimerStart(sensorTimer, 0);
+    WatchdogSupervisor::setEnabled(readWatchdogId, true);
     SystemLogger::getInstance()->log(LogLevel::info, "Sensor Manager started", "SENSOR_MGR");
 }
 
 void SensorManager::stop() {
     isRunning = false;
+    WatchdogSupervisor::setEnabled(readWatchdogId, false);
     xTimerStop(sensorTimer, 0);
     SystemLogger::getInstance()->log(LogLevel::info,"Sensor Manager stopped", "SENSOR_MGR");
 }
 
+void SensorManager::setReadInterval(uint32_t interval) {
+    if (interval == 0 || interval == readInterval) return;
+
+    readInterval = interval;
+    WatchdogSupervisor::setDeadline(readWatchdogId, interval + WATCHDOG_TASK_DEADLINE_MS);
+    if (sensorTimer) {
+        // Changing the period also starts a dormant timer
+        xTimerChangePeriod(sensorTimer, pdMS_TO_TICKS(interval), pdMS_TO_TICKS(100));
+        if (!isRunning) {
+            xTimerStop(sensorTimer, pdMS_TO_TICKS(100));
+        }
+    }
+
+    char message[48];
+    snprintf(message, sizeof(message), "Read interval %lu ms", (unsigned long)interval);
+    SystemLogger::getInstance()->log(LogLevel::info, message, "SENSOR_MGR");
+}
+
+void SensorManager::update(const ConfigChange& change) {
+    if (change.changedKeys & ConfigKeys::sensorReadInterval) {
+        setReadInterval(change.config.sensorReadInterval);
+    }
+}
+
 void SensorManager::addSensor(std::unique_ptr<ISensor> sensor) {
     if (xSemaphoreTake(sensorMutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
         sensors.push_back(std::move(sensor));
@@ -116,10 +155,11 @@ void SensorManager::addSensor(std::unique_ptr<ISensor> sensor) {
     }
 }
 
-void SensorManager::sensorTask(void* parameter) {
-    SensorManager* manager = static_cast<SensorManager*>(parameter);
+void SensorManager::sensorTask(const void* parameter) {
+    SensorManager* manager = static_cast<SensorManager*>(const_cast<void*>(parameter));
 
     while (true) {
+        WatchdogSupervisor::checkIn(manager->taskWatchdogId);
         if (manager->isRunning) {
             manager->processSensorData();
         }
@@ -129,15 +169,21 @@ void SensorManager::sensorTask(void* parameter) {
 
 void SensorManager::sensorTimerCallback(TimerHandle_t xTimer) {
     SensorManager* manager = static_cast<SensorManager*>(pvTimerGetTimerID(xTimer));
+    WatchdogSupervisor::checkIn(manager->readWatchdogId);
 
     if (xSemaphoreTake(manager->sensorMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
         for (auto& sensor : manager->sensors) {
             if (sensor->getActive()) {
                 SensorData data = sensor->readData();
                 if (data.isValid) {
-                    SensorData* dataPtr = new SensorData(data);  // cấp phát vùng nhớ để truyền vào queue
-                    osMessagePut(manager->sensorDataQueue, (uint32_t)dataPtr, 0);
+                    BootProfile::mark(BOOT_PHASE_FIRST_SAMPLE);
+                    manager->samplesRead.inc();
+                    // Timer task must not block; a full queue counts as a send failure
+                    manager->sensorDataQueue.send(data, 0);
+                    LATENCY_SAMPLE(ENQUEUE, data);
                     manager->notifyObservers(data);
+                } else {
+                    manager->readErrors.inc();
                 }
             }
         }
@@ -146,12 +192,12 @@ void SensorManager::sensorTimerCallback(TimerHandle_t xTimer) {
 }
 
 void SensorManager::processSensorData() {
-    osEvent evt = osMessageGet(sensorDataQueue, 0);
-    if (evt.status == osEventMessage) {
+    SensorData data;
+    if (sensorDataQueue.receive(data, 0)) {
         // Process sensor data
-    	SensorData* data = (SensorData*)evt.value.p;
+        LATENCY_SAMPLE(DEQUEUE, data);
         char buffer[100];
-        snprintf(buffer, sizeof(buffer), "Sensor %d: %d", data->sensorId, data->value);
+        snprintf(buffer, sizeof(buffer), "Sensor %d: %d", data.sensorId, data.value);
         SystemLogger::getInstance()->log(LogLevel::debug, buffer, "SENSOR_DATA");
     }
 }
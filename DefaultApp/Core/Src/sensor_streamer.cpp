@@ -0,0 +1,232 @@
+#include "sensor_streamer.hpp"
+#include "stack_monitor.hpp"
+#include "heap_stats.hpp"
+#include "watchdog_supervisor.hpp"
+#include "latency_trace.hpp"
+#include "cli_manager.hpp"
+#include<string.h>
+#include<stdio.h>
+#include<iterator>
+
+static const uint32_t FRAME_SAMPLES_BOUNDS[] = {1, 2, 4, 8, 12};
+
+SensorStreamer::SensorStreamer(CLIManager* cli, BinaryProtocol* binaryProtocol)
+    : cliManager(cli), protocol(binaryProtocol), sampleQueue("stream", STREAM_QUEUE_SIZE), streamTaskId(nullptr), watchdogId(WatchdogSupervisor::INVALID_ID),
+      frameSamples(FRAME_SAMPLES_BOUNDS, std::size(FRAME_SAMPLES_BOUNDS)), active(false), rateIntervalUs(0),
+      batchCount(0), batchStarted(0) {
+    for (auto& state : sensorState) state = SensorState();
+}
+
+SensorStreamer::~SensorStreamer() {
+    unsubscribe();
+}
+
+void SensorStreamer::init() {
+    osThreadDef(streamTaskDef, streamTask, osPriorityBelowNormal, 1, STREAM_TASK_STACK_WORDS);
+    streamTaskId = osThreadCreate(osThread(streamTaskDef), this);
+    StackMonitor::watch(streamTaskId, STREAM_TASK_STACK_WORDS);
+    HeapStats::tagTask(streamTaskId, HeapModule::stream);
+    watchdogId = WatchdogSupervisor::registerTask("stream", WATCHDOG_TASK_DEADLINE_MS);
+    Metrics::add("stream_frame_samples", "Samples per stream frame; small frames mean the batch timeout fired", frameSamples);
+
+    SystemLogger::getInstance()->log(LogLevel::info, "Sensor Streamer initialized", "STREAM");
+}
+
+void SensorStreamer::subscribe(const StreamSubscription& newSubscription) {
+    uint32_t interval = newSubscription.rateHz > 0 ? 1000000UL / newSubscription.rateHz : 0;
+
+    taskENTER_CRITICAL();
+    rateIntervalUs = interval;
+    subscription = newSubscription;
+    if (subscription.batchSize == 0) subscription.batchSize = 1;
+    if (subscription.batchSize > BinaryProtocol::SAMPLES_PER_FRAME) {
+        subscription.batchSize = BinaryProtocol::SAMPLES_PER_FRAME;
+    }
+    for (auto& state : sensorState) state = SensorState();
+    stats = StreamStats();
+    active = true;
+    taskEXIT_CRITICAL();
+}
+
+void SensorStreamer::unsubscribe() {
+    taskENTER_CRITICAL();
+    active = false;
+    taskEXIT_CRITICAL();
+}
+
+StreamSubscription SensorStreamer::getSubscription() const {
+    taskENTER_CRITICAL();
+    StreamSubscription current = subscription;
+    taskEXIT_CRITICAL();
+    return current;
+}
+
+// Decimation: decides whether a sample is forwarded at all
+bool SensorStreamer::accept(const SensorData& data) {
+    SensorState& state = sensorState[data.sensorId];
+
+    if (state.hasSent) {
+        if (subscription.mode == StreamMode::RATE) {
+            if (data.timestamp - state.lastTimestamp < rateIntervalUs) return false;
+        } else {
+            float delta = data.value - state.lastValue;
+            if (delta < 0) delta = -delta;
+            if (delta <= subscription.deadband) return false;
+        }
+    }
+
+    state.hasSent = true;
+    state.lastTimestamp = data.timestamp;
+    state.lastValue = data.value;
+    return true;
+}
+
+void SensorStreamer::update(const SensorData& data) {
+    if (!data.isValid || data.sensorId >= MAX_SENSOR_ID) return;
+    LATENCY_SAMPLE(STREAM_UPDATE, data);
+
+    taskENTER_CRITICAL();
+    bool wanted = active && (subscription.sensorMask & (1UL << data.sensorId));
+    bool forward = wanted && accept(data);
+    BackPressurePolicy policy = subscription.policy;
+    if (wanted) {
+        stats.samplesIn++;
+        if (!forward) stats.samplesFiltered++;
+    }
+    taskEXIT_CRITICAL();
+
+    if (!forward) return;
+
+    if (sampleQueue.send(data, 0)) return;
+
+    // Link is behind; the queue is full
+    taskENTER_CRITICAL();
+    if (policy == BackPressurePolicy::AGGREGATE) {
+        SensorState& state = sensorState[data.sensorId];
+        state.overflowSum += data.value;
+        state.overflowCount++;
+        state.overflowLatest = data;
+        stats.samplesAggregated++;
+    } else {
+        stats.samplesDropped++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+void SensorStreamer::drainAggregates() {
+    StreamSubscription current = getSubscription();
+
+    for (uint8_t id = 0; id < MAX_SENSOR_ID; id++) {
+        taskENTER_CRITICAL();
+        SensorState& state = sensorState[id];
+        uint32_t count = state.overflowCount;
+        SensorData aggregate = state.overflowLatest;
+        if (count > 0) {
+            aggregate.value = state.overflowSum / count;
+            state.overflowSum = 0;
+            state.overflowCount = 0;
+        }
+        taskEXIT_CRITICAL();
+
+        if (count > 0) {
+            addToBatch(aggregate, current);
+        }
+    }
+}
+
+void SensorStreamer::addToBatch(const SensorData& data, const StreamSubscription& current) {
+    if (batchCount == 0) {
+        batchStarted = xTaskGetTickCount();
+    }
+    batch[batchCount++] = data;
+    if (batchCount >= current.batchSize) {
+        flushBatch(current);
+    }
+}
+
+void SensorStreamer::flushBatch(const StreamSubscription& current) {
+    if (batchCount == 0) return;
+
+    if (current.format == StreamFormat::BINARY) {
+        protocol->publishSamples(batch, batchCount);
+    } else {
+        sendText(batch, batchCount);
+    }
+#if LATENCY_TRACE_ENABLED
+    for (size_t i = 0; i < batchCount; i++) {
+        LATENCY_SAMPLE(STREAM_TX, batch[i]);
+    }
+#endif
+
+    frameSamples.observe(batchCount);
+    stats.samplesSent += batchCount;
+    stats.framesSent++;
+    batchCount = 0;
+}
+
+void SensorStreamer::sendText(const SensorData* samples, size_t count) {
+    static const size_t MAX_LINE = 48;
+    char buffer[160];
+    size_t length = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (length + MAX_LINE > sizeof(buffer)) {
+            cliManager->transmit((const uint8_t*)buffer, length);
+            length = 0;
+        }
+
+        // Fixed point, printf float support is not linked in
+        int32_t milli = (int32_t)(samples[i].value * 1000.0f);
+        uint32_t absMilli = milli < 0 ? -milli : milli;
+        int written = snprintf(&buffer[length], MAX_LINE,
+                "S%u %lu.%06lu %s%lu.%03lu\r\n",
+                samples[i].sensorId,
+                (unsigned long)(samples[i].timestamp / 1000000),
+                (unsigned long)(samples[i].timestamp % 1000000),
+                milli < 0 ? "-" : "",
+                (unsigned long)(absMilli / 1000),
+                (unsigned long)(absMilli % 1000));
+        if (written > 0) {
+            length += (size_t)written < MAX_LINE ? (size_t)written : MAX_LINE - 1;
+        }
+    }
+
+    cliManager->transmit((const uint8_t*)buffer, length);
+}
+
+void SensorStreamer::streamTask(const void* parameter) {
+    SensorStreamer* streamer = static_cast<SensorStreamer*>(const_cast<void*>(parameter));
+    const TickType_t batchTimeout = pdMS_TO_TICKS(STREAM_BATCH_TIMEOUT_MS);
+
+    while (true) {
+        WatchdogSupervisor::checkIn(streamer->watchdogId);
+        TickType_t wait = pdMS_TO_TICKS(100);
+        if (streamer->batchCount > 0) {
+            TickType_t age = xTaskGetTickCount() - streamer->batchStarted;
+            wait = age < batchTimeout ? batchTimeout - age : 0;
+        }
+
+        SensorData data;
+        bool received = streamer->sampleQueue.receive(data, wait);
+        StreamSubscription current = streamer->getSubscription();
+
+        if (!streamer->active) {
+            streamer->batchCount = 0;
+            continue;
+        }
+
+        if (received) {
+            streamer->addToBatch(data, current);
+        }
+
+        // Aggregates go out once the backlog is cleared, so they follow the
+        // samples they were folded behind
+        if (streamer->sampleQueue.waiting() == 0) {
+            streamer->drainAggregates();
+        }
+
+        if (streamer->batchCount > 0 && xTaskGetTickCount() - streamer->batchStarted >= batchTimeout) {
+            streamer->flushBatch(current);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#include "stack_monitor.hpp"
+#include "system_logger.hpp"
+#include<stdio.h>
+
+StackMonitor::WatchedStack StackMonitor::stacks[STACK_MONITOR_MAX_TASKS];
+size_t StackMonitor::count = 0;
+
+void StackMonitor::watch(TaskHandle_t task, uint32_t stackWords) {
+    if (!task) return;
+
+    vTaskSuspendAll();
+    if (count < STACK_MONITOR_MAX_TASKS) {
+        WatchedStack& entry = stacks[count];
+        entry.task = task;
+        entry.stackWords = stackWords;
+        entry.minFreeWords = stackWords;
+        entry.warned = false;
+        count++;
+    }
+    xTaskResumeAll();
+}
+
+size_t StackMonitor::check() {
+    size_t newWarnings = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        WatchedStack& entry = stacks[i];
+        // Scans the unused part of the stack for the fill pattern
+        uint32_t freeWords = uxTaskGetStackHighWaterMark(entry.task);
+        if (freeWords < entry.minFreeWords) {
+            entry.minFreeWords = freeWords;
+        }
+
+        if (!entry.warned && entry.minFreeWords * 100 < entry.stackWords * STACK_WARN_PERCENT) {
+            entry.warned = true;
+            newWarnings++;
+
+            char message[64];
+            snprintf(message, sizeof(message), "Stack low: %s %lu/%lu words free",
+                    pcTaskGetName(entry.task), (unsigned long)entry.minFreeWords, (unsigned long)entry.stackWords);
+            SystemLogger::getInstance()->log(LogLevel::warning, message, "STACK");
+        }
+    }
+    return newWarnings;
+}
+
+uint32_t StackMonitor::recommend(uint32_t stackWords, uint32_t minFreeWords) {
+    uint32_t used = stackWords - minFreeWords;
+    uint32_t words = used + used / 4 + STACK_MARGIN_WORDS;
+    words = (words + 15) & ~15u; // 64-byte steps
+    return words < configMINIMAL_STACK_SIZE ? configMINIMAL_STACK_SIZE : words;
+}
+
+size_t StackMonitor::report(StackBudget* out, size_t maxTasks) {
+    size_t n = count < maxTasks ? count : maxTasks;
+    for (size_t i = 0; i < n; i++) {
+        out[i].name = pcTaskGetName(stacks[i].task);
+        out[i].stackWords = stacks[i].stackWords;
+        out[i].minFreeWords = stacks[i].minFreeWords;
+        out[i].recommendedWords = recommend(stacks[i].stackWords, stacks[i].minFreeWords);
+    }
+    return n;
+}
@@ -1,17 +1,19 @@
 #include "system_logger.hpp"
+#include "stack_monitor.hpp"
+#include "heap_stats.hpp"
+#include "watchdog_supervisor.hpp"
 
-SystemLogger::SystemLogger(){
+SystemLogger::SystemLogger() : logQueue("log", LOG_QUEUE_SIZE) {
 
 	instance = nullptr;
 
-	//initial Uart handle
-	this->huart = nullptr;
+	//initial Uart TX path
+	this->txService = nullptr;
+	this->watchdogId = WatchdogSupervisor::INVALID_ID;
+	// Everything until the config task delivers the configured level
+	this->minLevel = LogLevel::debug;
 
 
-	//initial Message queue handle
-	osMessageQDef(logQueueDef, 10, char*);
-	this->logQueue = osMessageCreate(osMessageQ(logQueueDef), NULL);
-
 	//initial binary semaphore handle
 	osSemaphoreDef(logMutexDef);
 	this->logMutex = osSemaphoreCreate(osSemaphore(logMutexDef), 1);
@@ -26,61 +28,82 @@ SystemLogger* SystemLogger:: getInstance(){
 
 void SystemLogger::loggerTask(const void* parameter){
     SystemLogger* logger = static_cast<SystemLogger*>(const_cast<void*>(parameter));
-//	LogMessage msg;
+	LogRecord record;
 
 	while (true) {
-		osEvent evt = osMessageGet(logger->logQueue, osWaitForever);
-		if (evt.status == osEventMessage) {
-			logger->processLogMessage(*((LogMessage*)evt.value.p));
+		// Wakes up at least once a second to check in with the watchdog
+		WatchdogSupervisor::checkIn(logger->watchdogId);
+		if (logger->logQueue.receive(record, pdMS_TO_TICKS(1000))) {
+			logger->processLogMessage(record);
 		}
 	}
 }
 
-void SystemLogger::init(UART_HandleTypeDef* uart){
-	this->huart = uart;
+void SystemLogger::init(UartTxService* tx){
+	this->txService = tx;
 
-	osThreadDef(loggerThreadDef, loggerTask, osPriorityNormal, 0, 128);
+	osThreadDef(loggerThreadDef, loggerTask, osPriorityNormal, 0, LOGGER_TASK_STACK_WORDS);
 	this->loggerTaskHandle = osThreadCreate(osThread(loggerThreadDef), this);
+	StackMonitor::watch(this->loggerTaskHandle, LOGGER_TASK_STACK_WORDS);
+	HeapStats::tagTask(this->loggerTaskHandle, HeapModule::logger);
+	this->watchdogId = WatchdogSupervisor::registerTask("logger", WATCHDOG_TASK_DEADLINE_MS);
+	Metrics::add("log_messages_total", "Messages passed to SystemLogger::log", this->messagesLogged);
 
 }
 
 
-void SystemLogger::processLogMessage(const LogMessage& message){
-	if(huart == NULL) return;
+void SystemLogger::processLogMessage(const LogRecord& message){
+	if(txService == NULL) return;
 	if(osSemaphoreWait(this->logMutex, pdMS_TO_TICKS(1000)) == osOK){
 		std::string formattedMsg = formatLogMessage(message);
-        HAL_UART_Transmit(huart,
-                          (uint8_t*)formattedMsg.c_str(),
-                          formattedMsg.length(),
-                          HAL_MAX_DELAY);
+		// Bulk, no wait: when the link is behind, log lines are dropped and counted
+		txService->write((const uint8_t*)formattedMsg.c_str(), formattedMsg.length(), TxPriority::BULK);
 		osSemaphoreRelease(this->logMutex);
 	}
 }
 
-std::string SystemLogger::formatLogMessage(const LogMessage& msg){
+std::string SystemLogger::formatLogMessage(const LogRecord& msg){
     std::string levelStr;
     switch (msg.level) {
         case LogLevel::debug:    levelStr = "DEBUG"; break;
         case LogLevel::info:     levelStr = "INFO"; break;
         case LogLevel::warning:  levelStr = "WARN"; break;
         case LogLevel::error:    levelStr = "ERROR"; break;
+        case LogLevel::critical: levelStr = "CRIT"; break;
         default: break;
     }
 
+    // newlib-nano has no %llu, print the microsecond timestamp as seconds.micros
     char buffer[256];
-    snprintf(buffer, sizeof(buffer), "[%lu] [%s] [%s] %s\r\n",
-             msg.timestamp, levelStr.c_str(), msg.module.c_str(), msg.message.c_str());
+    snprintf(buffer, sizeof(buffer), "[%lu.%06lu] [%s] [%s] %s\r\n",
+             (unsigned long)(msg.timestamp / 1000000), (unsigned long)(msg.timestamp % 1000000),
+             levelStr.c_str(), msg.module, msg.message);
     return std::string(buffer);
 }
 
-void SystemLogger::log(LogLevel level, const std::string& message, const std::string& module){
-	LogMessage mgs(level, message, module);
-
-	osStatus status = osMessagePut(this->logQueue, (uint32_t)&mgs, osWaitForever);
-	if (status != osOK) {
-	    // assuming queue always not full
+void SystemLogger::update(const ConfigChange& change){
+	if (change.changedKeys & ConfigKeys::logLevel) {
+		setLevel((LogLevel)change.config.logLevel);
 	}
 }
 
+void SystemLogger::log(LogLevel level, const std::string& message, const std::string& module){
+	this->messagesLogged.inc();
+	if (level < this->minLevel) return;
+
+	LogRecord record;
+	record.level = level;
+	record.timestamp = HighResClock::nowUs();
+	strncpy(record.module, module.c_str(), sizeof(record.module) - 1);
+	record.module[sizeof(record.module) - 1] = '\0';
+	strncpy(record.message, message.c_str(), sizeof(record.message) - 1);
+	record.message[sizeof(record.message) - 1] = '\0';
+
+	// Before the scheduler runs nothing drains the queue, so never wait then;
+	// a full queue drops the line and shows up as a send failure
+	TickType_t wait = xTaskGetSchedulerState() == taskSCHEDULER_RUNNING ? pdMS_TO_TICKS(LOG_QUEUE_WAIT_MS) : 0;
+	this->logQueue.send(record, wait);
+}
+
 
 
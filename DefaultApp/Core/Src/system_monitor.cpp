@@ -1,8 +1,9 @@
 #include "system_monitor.hpp"
+#include<stdio.h>
 
 SystemMonitor::SystemMonitor(SensorManager* sensorMgr, CLIManager* cliMgr)
-    : sensorManager(sensorMgr), cliManager(cliMgr), errorCount(0),
-      lastHeartbeat(0), systemHealthy(true) {
+    : watchdogId(WatchdogSupervisor::INVALID_ID), sensorManager(sensorMgr), cliManager(cliMgr),
+      systemHealthy(true), bootConfirmTried(false), bootTimeReported(false) {
 	osMutexDef(myMutex);
     systemMutex = osMutexCreate(osMutex(myMutex));
     logger = SystemLogger::getInstance();
@@ -14,69 +15,147 @@ SystemMonitor::~SystemMonitor() {
 }
 
 void SystemMonitor::init() {
-
-    // Create watchdog timer (5 second timeout)
-    osTimerDef(watchdogTimerDef,  watchdogTimerCallback);
-    watchdogTimer = osTimerCreate(osTimer(watchdogTimerDef), osTimerPeriodic, this);
+    if (WatchdogSupervisor::wasWatchdogReset()) {
+        const WatchdogResetRecord& record = WatchdogSupervisor::getLastReset();
+        char message[80];
+        snprintf(message, sizeof(message), "Watchdog reset #%lu: %s overdue %lu ms at %lu ms uptime",
+                (unsigned long)record.resetCount, record.task,
+                (unsigned long)record.overdueMs, (unsigned long)record.upTimeMs);
+        logger->log(LogLevel::critical, message, "WATCHDOG");
+    }
+    if (CrashDump::available()) {
+        // Kept until `crash clear`, so it is reported on every boot until read
+        char message[96];
+        CrashDump::summarize(message, sizeof(message));
+        logger->log(LogLevel::critical, message, "CRASH");
+    }
+    if (FirmwareUpdate::isTrial()) {
+        SlotInfo slot;
+        FirmwareUpdate::readSlot(FirmwareUpdate::getRunningSlot(), slot);
+        char message[64];
+        snprintf(message, sizeof(message), "Slot %s on trial, boot %lu of %d",
+                FirmwareUpdate::slotName(FirmwareUpdate::getRunningSlot()),
+                (unsigned long)slot.attempts, BOOT_MAX_ATTEMPTS);
+        logger->log(LogLevel::warning, message, "BOOT");
+    }
 
     // Create watchdog task
-    osThreadDef(watchdogTaskDef, watchdogTask, osPriorityNormal, 1, 512);
+    osThreadDef(watchdogTaskDef, watchdogTask, osPriorityNormal, 1, MONITOR_TASK_STACK_WORDS);
     watchdogTaskHandle = osThreadCreate(osThread(watchdogTaskDef), this);
+    StackMonitor::watch(watchdogTaskHandle, MONITOR_TASK_STACK_WORDS);
+    HeapStats::tagTask(watchdogTaskHandle, HeapModule::monitor);
+    watchdogId = WatchdogSupervisor::registerTask("monitor", WATCHDOG_TASK_DEADLINE_MS);
 
+    Metrics::add("system_errors_total", "Errors reported to SystemMonitor, queue saturation alarms included", errorCount);
+    Metrics::add("rtos_heap_free_bytes", "FreeRTOS heap free", freeHeap);
+    Metrics::add("rtos_heap_min_free_bytes", "FreeRTOS heap low-water mark", minFreeHeap);
+    Metrics::add("cpu_load_permille", "Non-idle CPU time over the last second", cpuLoad);
 
 
     logger->log(LogLevel::info, "System Monitor initialized", "SYS_MON");
 }
 
+void SystemMonitor::update(const ConfigChange& change) {
+    if (!(change.changedKeys & ConfigKeys::watchdogTimeout)) return;
+
+    char message[48];
+    if (WatchdogSupervisor::setTimeout(change.config.watchdogTimeout)) {
+        snprintf(message, sizeof(message), "Watchdog timeout %lu ms", (unsigned long)change.config.watchdogTimeout);
+        logger->log(LogLevel::info, message, "SYS_MON");
+    } else {
+        snprintf(message, sizeof(message), "Watchdog timeout %lu ms not supported", (unsigned long)change.config.watchdogTimeout);
+        logger->log(LogLevel::warning, message, "SYS_MON");
+    }
+}
+
 void SystemMonitor::start() {
-    osTimerStart(watchdogTimer, 0);
-    heartbeat();
+    WatchdogSupervisor::start();
     logger->log(LogLevel::info,"System Monitor started", "SYS_MON");
 }
 
 void SystemMonitor::stop() {
-    xTimerStop(watchdogTimer, 0);
+    // The IWDG cannot be stopped; the monitor task keeps supervising
     logger->log(LogLevel::info, "System Monitor stopped", "SYS_MON");
 }
 
-void SystemMonitor::heartbeat() {
-    lastHeartbeat = HAL_GetTick();
-}
-
 void SystemMonitor::reportError(const std::string& error) {
     if (osSemaphoreWait(systemMutex, pdMS_TO_TICKS(1000)) == osOK) {
-        errorCount++;
-        systemHealthy = false;
-        logger->log(LogLevel::error, "System error reported: " + error, "SYS_MON");
+        reportErrorLocked(error);
         osSemaphoreRelease(systemMutex);
     }
 }
 
+// systemMutex is not recursive; code already holding it reports through here
+void SystemMonitor::reportErrorLocked(const std::string& error) {
+    errorCount.inc();
+    systemHealthy = false;
+    logger->log(LogLevel::error, "System error reported: " + error, "SYS_MON");
+}
+
 void SystemMonitor::watchdogTask(const void* parameter) {
     SystemMonitor* monitor = static_cast<SystemMonitor*>(const_cast<void*>(parameter));
+    // The scheduler creates the idle and timer tasks when it starts; static, see freertos.c
+    StackMonitor::watch(xTaskGetIdleTaskHandle(), configMINIMAL_STACK_SIZE);
+    StackMonitor::watch(xTimerGetTimerDaemonTaskHandle(), configTIMER_TASK_STACK_DEPTH);
 
     while (true) {
         monitor->checkSystemHealth();
+        WatchdogSupervisor::checkIn(monitor->watchdogId);
+        monitor->confirmBoot(WatchdogSupervisor::supervise());
+        monitor->reportBootTime();
+        HighResClock::now(); // keep the 64-bit cycle extension ahead of CYCCNT wrap
+        TaskStats::sample();
+        monitor->cpuLoad.set(TaskStats::getShortCpuLoad());
         osDelay(pdMS_TO_TICKS(1000));
     }
 }
 
-void SystemMonitor::watchdogTimerCallback(const void* parameter) {
-	SystemMonitor* monitor = static_cast<SystemMonitor*>(const_cast<void*>(parameter));
-
-    uint32_t currentTime = HAL_GetTick();
-    if (currentTime - monitor->lastHeartbeat > 10000) { // 10 second timeout
-        monitor->logger->log(LogLevel::critical, "Watchdog timeout - system reset required", "WATCHDOG");
-        monitor->handleSystemError();
+void SystemMonitor::confirmBoot(bool supervised) {
+    // A new image is good once every task kept its deadline and nothing
+    // reported an error for BOOT_CONFIRM_DELAY_MS; otherwise the next reset
+    // counts as another trial boot
+    if (bootConfirmTried || !FirmwareUpdate::isTrial()) return;
+    if (!supervised || !systemHealthy || errorCount.get() > 0 || HAL_GetTick() < BOOT_CONFIRM_DELAY_MS) return;
+
+    bootConfirmTried = true;
+    const char* slot = FirmwareUpdate::slotName(FirmwareUpdate::getRunningSlot());
+    char message[48];
+    if (FirmwareUpdate::confirm()) {
+        snprintf(message, sizeof(message), "Slot %s confirmed", slot);
+        logger->log(LogLevel::info, message, "BOOT");
+    } else {
+        snprintf(message, sizeof(message), "Slot %s confirm failed", slot);
+        logger->log(LogLevel::error, message, "BOOT");
     }
 }
 
+void SystemMonitor::reportBootTime() {
+    // Once, after the sensor timer marked the first sample
+    if (bootTimeReported || !BootProfile::marked(BOOT_PHASE_FIRST_SAMPLE)) return;
+
+    bootTimeReported = true;
+    char message[80];
+    BootProfile::summarize(message, sizeof(message));
+    logger->log(LogLevel::info, message, "BOOT");
+}
+
 void SystemMonitor::checkSystemHealth() {
     if (osSemaphoreWait(systemMutex, pdMS_TO_TICKS(1000)) == osOK) {
         // Check heap memory
-        uint32_t freeHeap = xPortGetFreeHeapSize();
-        if (freeHeap < 1024) { // Less than 1KB free
-            reportError("Low memory warning");
+        uint32_t heapFree = xPortGetFreeHeapSize();
+        freeHeap.set(heapFree);
+        minFreeHeap.set(xPortGetMinimumEverFreeHeapSize());
+        if (heapFree < 1024) { // Less than 1KB free
+            reportErrorLocked("Low memory warning");
+        }
+
+        StackMonitor::check();
+
+        // Each queue that newly stays full counts as one error
+        size_t saturated = QueueMonitor::check();
+        if (saturated > 0) {
+            errorCount.inc(saturated);
+            systemHealthy = false;
         }
 
 //        // Check task states
@@ -85,33 +164,10 @@ void SystemMonitor::checkSystemHealth() {
 //        }
 
         // Reset system health if no recent errors
-        if (errorCount == 0) {
+        if (errorCount.get() == 0) {
             systemHealthy = true;
         }
 
         osSemaphoreRelease(systemMutex);
     }
-
-    heartbeat();
-}
-
-void SystemMonitor::handleSystemError() {
-    logger->log(LogLevel::critical, "Handling system error", "SYS_MON");
-
-    // Try to recover
-    if (sensorManager) {
-        sensorManager->resetAllSensors();
-    }
-
-    // If too many errors, reset system
-    if (errorCount > 10) {
-        resetSystem();
-    }
 }
-
-void SystemMonitor::resetSystem() {
-    logger->log(LogLevel::critical, "System reset initiated", "SYS_MON");
-    HAL_Delay(100);
-    HAL_NVIC_SystemReset();
-}
-
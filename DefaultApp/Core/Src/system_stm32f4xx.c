@@ -46,6 +46,7 @@
 
 
 #include "stm32f4xx.h"
+#include "boot_timing.h"
 
 #if !defined  (HSE_VALUE) 
   #define HSE_VALUE    ((uint32_t)25000000) /*!< Default value of the External oscillator in Hz */
@@ -91,7 +92,7 @@
 /*!< Uncomment the following line if you need to relocate the vector table
      anywhere in Flash or Sram, else the vector table is kept at the automatic
      remap of boot address selected */
-/* #define USER_VECT_TAB_ADDRESS */
+#define USER_VECT_TAB_ADDRESS
 
 #if defined(USER_VECT_TAB_ADDRESS)
 /*!< Uncomment the following line if you need to relocate your vector Table
@@ -104,10 +105,9 @@
 #define VECT_TAB_BASE_ADDRESS   FLASH_BASE      /*!< Vector Table base address field.
                                                      This value must be a multiple of 0x200. */
 #endif /* VECT_TAB_SRAM */
-#if !defined(VECT_TAB_OFFSET)
-#define VECT_TAB_OFFSET         0x00000000U     /*!< Vector Table offset field.
-                                                     This value must be a multiple of 0x200. */
-#endif /* VECT_TAB_OFFSET */
+/* The table is wherever the linker script put it: slot A or slot B, see
+   boot_control.h. g_pfnVectors is defined in the startup file. */
+extern uint32_t g_pfnVectors[];
 #endif /* USER_VECT_TAB_ADDRESS */
 /******************************************************************************/
 
@@ -177,8 +177,17 @@ void SystemInit(void)
 
   /* Configure the Vector Table location -------------------------------------*/
 #if defined(USER_VECT_TAB_ADDRESS)
-  SCB->VTOR = VECT_TAB_BASE_ADDRESS | VECT_TAB_OFFSET; /* Vector Table Relocation in Internal SRAM */
+  SCB->VTOR = (uint32_t)g_pfnVectors; /* Vector Table Relocation in Internal FLASH, slot A or B */
 #endif /* USER_VECT_TAB_ADDRESS */
+
+  /* Boot timing: runs before .data is copied, so no SystemCoreClock yet; the
+     bootloader hands over on HSI. Without a bootloader record, e.g. started
+     by a debugger, the timing starts here. */
+  if (!boot_timing_valid())
+  {
+    boot_timing_start(HSI_VALUE);
+  }
+  boot_timing_mark(BOOT_PHASE_SYSTEM_INIT, HSI_VALUE);
 }
 
 /**
@@ -0,0 +1,101 @@
+#include "task_stats.hpp"
+#include<string.h>
+
+TaskStatus_t TaskStats::status[TaskStats::MAX_TASKS];
+TaskStats::TaskHistory TaskStats::history[TaskStats::MAX_TASKS];
+uint32_t TaskStats::totals[TaskStats::HISTORY];
+size_t TaskStats::head = 0;
+size_t TaskStats::samples = 0;
+
+TaskLoad TaskStats::loads[TaskStats::MAX_TASKS];
+size_t TaskStats::loadCount = 0;
+uint16_t TaskStats::shortCpuLoad = 0;
+uint16_t TaskStats::longCpuLoad = 0;
+
+TaskStats::TaskHistory* TaskStats::findHistory(UBaseType_t taskNumber) {
+    for (size_t i = 0; i < MAX_TASKS; i++) {
+        if (history[i].taskNumber == taskNumber) {
+            return &history[i];
+        }
+    }
+    return nullptr;
+}
+
+uint16_t TaskStats::perMille(uint32_t part, uint32_t whole) {
+    if (whole == 0) return 0;
+    uint32_t result = (uint32_t)(((uint64_t)part * 1000 + whole / 2) / whole);
+    return result > 1000 ? 1000 : (uint16_t)result;
+}
+
+void TaskStats::sample() {
+    uint32_t totalRunTime = 0;
+    UBaseType_t count = uxTaskGetSystemState(status, MAX_TASKS, &totalRunTime);
+    if (count == 0) return; // more tasks than MAX_TASKS
+
+    head = (head + 1) % HISTORY;
+    totals[head] = totalRunTime;
+    if (samples < HISTORY) samples++;
+
+    // Slots of tasks that no longer exist are released; new tasks start from
+    // a zero counter, which is what their run-time counter started at
+    bool seen[MAX_TASKS] = {};
+    for (UBaseType_t i = 0; i < count; i++) {
+        TaskHistory* entry = findHistory(status[i].xTaskNumber);
+        if (!entry) {
+            entry = findHistory(0);
+            if (!entry) continue;
+            entry->taskNumber = status[i].xTaskNumber;
+            memset(entry->counters, 0, sizeof(entry->counters));
+        }
+        entry->counters[head] = status[i].ulRunTimeCounter;
+        seen[entry - history] = true;
+    }
+    for (size_t i = 0; i < MAX_TASKS; i++) {
+        if (!seen[i]) history[i].taskNumber = 0;
+    }
+
+    // Until the history fills up the windows cover what there is
+    size_t shortBack = samples - 1 < TASK_STATS_SHORT_WINDOW ? samples - 1 : TASK_STATS_SHORT_WINDOW;
+    size_t longBack = samples - 1 < TASK_STATS_LONG_WINDOW ? samples - 1 : TASK_STATS_LONG_WINDOW;
+    size_t shortStart = (head + HISTORY - shortBack) % HISTORY;
+    size_t longStart = (head + HISTORY - longBack) % HISTORY;
+    // Counters are raw CYCCNT deltas; unsigned subtraction absorbs one wrap
+    uint32_t shortTotal = totals[head] - totals[shortStart];
+    uint32_t longTotal = totals[head] - totals[longStart];
+
+    TaskHandle_t idle = xTaskGetIdleTaskHandle();
+    uint16_t idleShort = 1000;
+    uint16_t idleLong = 1000;
+
+    vTaskSuspendAll();
+    loadCount = 0;
+    for (UBaseType_t i = 0; i < count; i++) {
+        TaskHistory* entry = findHistory(status[i].xTaskNumber);
+        if (!entry) continue;
+
+        TaskLoad& load = loads[loadCount++];
+        strncpy(load.name, status[i].pcTaskName, sizeof(load.name) - 1);
+        load.name[sizeof(load.name) - 1] = '\0';
+        load.state = status[i].eCurrentState;
+        load.priority = status[i].uxCurrentPriority;
+        load.stackFreeBytes = status[i].usStackHighWaterMark * sizeof(StackType_t);
+        load.shortLoad = perMille(entry->counters[head] - entry->counters[shortStart], shortTotal);
+        load.longLoad = perMille(entry->counters[head] - entry->counters[longStart], longTotal);
+
+        if (status[i].xHandle == idle) {
+            idleShort = load.shortLoad;
+            idleLong = load.longLoad;
+        }
+    }
+    shortCpuLoad = shortBack > 0 ? 1000 - idleShort : 0;
+    longCpuLoad = longBack > 0 ? 1000 - idleLong : 0;
+    xTaskResumeAll();
+}
+
+size_t TaskStats::snapshot(TaskLoad* out, size_t maxTasks) {
+    vTaskSuspendAll();
+    size_t count = loadCount < maxTasks ? loadCount : maxTasks;
+    memcpy(out, loads, count * sizeof(TaskLoad));
+    xTaskResumeAll();
+    return count;
+}
@@ -0,0 +1,121 @@
+#include "trace_recorder.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+#include "stm32f4xx_hal.h"
+#include "task.h"
+#ifdef __cplusplus
+}
+#endif
+
+static_assert((TRACE_BUFFER_EVENTS & (TRACE_BUFFER_EVENTS - 1)) == 0, "TRACE_BUFFER_EVENTS must be a power of two");
+
+static TraceRecord traceBuffer[TRACE_BUFFER_EVENTS];
+static volatile uint32_t traceHead = 0;  // free running
+static volatile bool traceRunning = false;
+static bool traceOneShot = false;
+static uint32_t traceLost = 0;           // events not recorded in one-shot mode
+
+// Queue numbers are handed out at creation so events can name their queue
+static QueueHandle_t traceQueues[TRACE_MAX_QUEUES];
+static uint32_t traceQueueCount = 0;
+
+extern "C" void traceRecord(uint8_t event, uint8_t task, uint16_t arg) {
+    if (!traceRunning) return;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t head = traceHead;
+    if (traceOneShot && head >= TRACE_BUFFER_EVENTS) {
+        traceRunning = false;
+        traceLost++;
+    } else {
+        TraceRecord& record = traceBuffer[head & (TRACE_BUFFER_EVENTS - 1)];
+        record.cycles = DWT->CYCCNT;
+        record.event = event;
+        record.task = task;
+        record.arg = arg;
+        traceHead = head + 1;
+    }
+    __set_PRIMASK(primask);
+}
+
+extern "C" void traceRecordIsr(uint8_t event) {
+    traceRecord(event, 0, (uint16_t)(__get_IPSR() - 16));
+}
+
+extern "C" unsigned long traceQueueCreated(void* queue) {
+    // Called from queue creation, possibly before the scheduler starts
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t number = ++traceQueueCount;
+    if (number <= TRACE_MAX_QUEUES) {
+        traceQueues[number - 1] = (QueueHandle_t)queue;
+    }
+    __set_PRIMASK(primask);
+    return number;
+}
+
+void TraceRecorder::start(bool oneShot) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    traceHead = 0;
+    traceLost = 0;
+    traceOneShot = oneShot;
+    traceRunning = true;
+    __set_PRIMASK(primask);
+}
+
+void TraceRecorder::stop() {
+    traceRunning = false;
+}
+
+bool TraceRecorder::isRunning() {
+    return traceRunning;
+}
+
+size_t TraceRecorder::getCount() {
+    uint32_t head = traceHead;
+    return head < TRACE_BUFFER_EVENTS ? head : TRACE_BUFFER_EVENTS;
+}
+
+uint32_t TraceRecorder::getLost() {
+    // In ring mode everything older than one buffer was overwritten
+    uint32_t head = traceHead;
+    return traceOneShot ? traceLost : (head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0);
+}
+
+void TraceRecorder::dump(ResponseWriter& out) {
+    bool wasRunning = traceRunning;
+    traceRunning = false;
+
+    uint32_t head = traceHead;
+    size_t count = getCount();
+    out.print("# trace hz=%lu events=%u lost=%lu\r\n",
+            (unsigned long)HAL_RCC_GetHCLKFreq(), (unsigned)count, (unsigned long)getLost());
+
+    // Names for the numbers used in the events
+    static TaskStatus_t tasks[TASK_STATS_MAX_TASKS]; // only the CLI task dumps
+    uint32_t totalRunTime;
+    UBaseType_t taskCount = uxTaskGetSystemState(tasks, TASK_STATS_MAX_TASKS, &totalRunTime);
+    for (UBaseType_t i = 0; i < taskCount; i++) {
+        out.print("# task %lu %s\r\n", (unsigned long)tasks[i].xTaskNumber, tasks[i].pcTaskName);
+    }
+    uint32_t queueCount = traceQueueCount < TRACE_MAX_QUEUES ? traceQueueCount : TRACE_MAX_QUEUES;
+    for (uint32_t i = 0; i < queueCount; i++) {
+        const char* name = pcQueueGetName(traceQueues[i]);
+        out.print("# queue %lu %s\r\n", (unsigned long)(i + 1), name ? name : "-");
+    }
+
+    // Oldest first: cycles event task arg, hex
+    for (uint32_t i = head - count; i != head; i++) {
+        const TraceRecord& record = traceBuffer[i & (TRACE_BUFFER_EVENTS - 1)];
+        out.print("%08lx %02x %02x %04x\r\n", (unsigned long)record.cycles, record.event, record.task, record.arg);
+    }
+    out.write("# end\r\n");
+
+    if (wasRunning && !traceOneShot) {
+        traceRunning = true;
+    }
+}
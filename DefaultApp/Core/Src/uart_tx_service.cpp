@@ -0,0 +1,204 @@
+#include "uart_tx_service.hpp"
+#include "high_res_clock.hpp"
+#include<string.h>
+
+static uint32_t roundUpPowerOfTwo(size_t value) {
+    uint32_t size = 16;
+    while (size < value) size <<= 1;
+    return size;
+}
+
+UartTxService::UartTxService(UART_HandleTypeDef* uart, size_t interactiveSize, size_t bulkSize)
+    : huart(uart), busy(false), activeRing(0), inFlight(0) {
+
+    size_t sizes[2] = { interactiveSize, bulkSize };
+    for (int i = 0; i < 2; i++) {
+        rings[i].size = roundUpPowerOfTwo(sizes[i]);
+        rings[i].buffer = std::make_unique<uint8_t[]>(rings[i].size);
+        rings[i].head = 0;
+        rings[i].tail = 0;
+        rings[i].markerHead = 0;
+        rings[i].markerTail = 0;
+    }
+
+    spaceAvailable = xSemaphoreCreateBinary();
+}
+
+UartTxService::~UartTxService() {
+    HAL_UART_AbortTransmit(huart);
+    vSemaphoreDelete(spaceAvailable);
+}
+
+void UartTxService::init(bool flowControl) {
+    if (flowControl && huart->Init.HwFlowCtl == UART_HWCONTROL_NONE) {
+        // Re-run the MSP so the CTS/RTS pins get configured too
+        HAL_UART_DeInit(huart);
+        huart->Init.HwFlowCtl = UART_HWCONTROL_RTS_CTS;
+        HAL_UART_Init(huart);
+    }
+}
+
+size_t UartTxService::write(const uint8_t* data, size_t size, TxPriority priority, TickType_t timeout) {
+    uint8_t index = (uint8_t)priority;
+    Ring& ring = rings[index];
+
+    if (size == 0) return 0;
+    if (size > ring.size) {
+        stats.bytesDropped[index] += size;
+        return 0;
+    }
+
+    // Nothing can free space before the scheduler runs
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        timeout = 0;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    while (true) {
+        taskENTER_CRITICAL();
+        uint32_t used = ring.head - ring.tail;
+        if (ring.size - used >= size) {
+            uint32_t offset = ring.head & (ring.size - 1);
+            uint32_t first = ring.size - offset;
+            if (first > size) first = size;
+            memcpy(&ring.buffer[offset], data, first);
+            memcpy(&ring.buffer[0], data + first, size - first);
+            ring.head += size;
+
+            stats.bytesQueued[index] += size;
+            if (used + size > stats.peakDepth[index]) {
+                stats.peakDepth[index] = used + size;
+            }
+
+            uint8_t nextMarker = (ring.markerHead + 1) & (LATENCY_MARKERS - 1);
+            if (nextMarker != ring.markerTail) {
+                ring.markerEnd[ring.markerHead] = ring.head;
+                ring.markerCycles[ring.markerHead] = HighResClock::cycles();
+                ring.markerHead = nextMarker;
+            }
+
+            if (!busy) {
+                startNext();
+            }
+            taskEXIT_CRITICAL();
+            return size;
+        }
+        taskEXIT_CRITICAL();
+
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            taskENTER_CRITICAL();
+            stats.bytesDropped[index] += size;
+            taskEXIT_CRITICAL();
+            return 0;
+        }
+        xSemaphoreTake(spaceAvailable, timeout - elapsed);
+    }
+}
+
+void UartTxService::transmit(const uint8_t* data, size_t size) {
+    // Larger blocks than the bulk ring go out piecewise
+    uint32_t limit = rings[(uint8_t)TxPriority::BULK].size;
+    while (size > 0) {
+        size_t piece = size < limit ? size : limit;
+        if (write(data, piece, TxPriority::BULK, pdMS_TO_TICKS(CLI_TX_TIMEOUT_MS)) == 0) {
+            return;
+        }
+        data += piece;
+        size -= piece;
+    }
+}
+
+bool UartTxService::flush(TickType_t timeout) {
+    TickType_t start = xTaskGetTickCount();
+    while (getDepth(TxPriority::INTERACTIVE) + getDepth(TxPriority::BULK) > 0) {
+        if (xTaskGetTickCount() - start >= timeout) {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+// Caller holds a critical section
+void UartTxService::startNext() {
+    for (uint8_t index = 0; index < 2; index++) {
+        Ring& ring = rings[index];
+        uint32_t pending = ring.head - ring.tail;
+        if (pending == 0) continue;
+
+        // DMA reads straight from the ring, up to the wrap point
+        uint32_t offset = ring.tail & (ring.size - 1);
+        uint32_t chunk = ring.size - offset;
+        if (chunk > pending) chunk = pending;
+        if (chunk > UART_TX_DMA_CHUNK_SIZE) chunk = UART_TX_DMA_CHUNK_SIZE;
+
+        activeRing = index;
+        inFlight = chunk;
+        busy = true;
+        if (HAL_UART_Transmit_DMA(huart, &ring.buffer[offset], chunk) != HAL_OK) {
+            // Retried by the next write()
+            busy = false;
+            stats.errors++;
+        }
+        return;
+    }
+}
+
+void UartTxService::retireMarkers(uint8_t ringIndex) {
+    Ring& ring = rings[ringIndex];
+    uint32_t now = HighResClock::cycles();
+
+    while (ring.markerTail != ring.markerHead &&
+           (int32_t)(ring.tail - ring.markerEnd[ring.markerTail]) >= 0) {
+        uint32_t latency = HighResClock::cyclesToUs(now - ring.markerCycles[ring.markerTail]);
+        if (latency > stats.maxLatencyUs[ringIndex]) {
+            stats.maxLatencyUs[ringIndex] = latency;
+        }
+        stats.totalLatencyUs[ringIndex] += latency;
+        stats.latencySamples[ringIndex]++;
+        ring.markerTail = (ring.markerTail + 1) & (LATENCY_MARKERS - 1);
+    }
+}
+
+void UartTxService::handleTxComplete() {
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    UBaseType_t savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+
+    if (busy) {
+        rings[activeRing].tail += inFlight;
+        stats.bytesSent += inFlight;
+        stats.dmaTransfers++;
+        retireMarkers(activeRing);
+        busy = false;
+    }
+    startNext();
+
+    taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus);
+
+    xSemaphoreGiveFromISR(spaceAvailable, &higherPriorityTaskWoken);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+void UartTxService::handleError() {
+    // Only a DMA transmit error ends a transfer early; that chunk is lost
+    if (!busy || huart->gState != HAL_UART_STATE_READY) return;
+
+    UBaseType_t savedInterruptStatus = taskENTER_CRITICAL_FROM_ISR();
+    stats.errors++;
+    taskEXIT_CRITICAL_FROM_ISR(savedInterruptStatus);
+
+    handleTxComplete();
+}
+
+uint32_t UartTxService::getDepth(TxPriority priority) const {
+    const Ring& ring = rings[(uint8_t)priority];
+    return ring.head - ring.tail;
+}
+
+UartTxStats UartTxService::getStats() const {
+    taskENTER_CRITICAL();
+    UartTxStats snapshot = stats;
+    taskEXIT_CRITICAL();
+    return snapshot;
+}
@@ -0,0 +1,151 @@
+#include "watchdog_supervisor.hpp"
+#include "system_logger.hpp"
+#include<string.h>
+#include<stdio.h>
+
+// Survives the reset; the startup code only clears .bss
+static WatchdogResetRecord resetRecord __attribute__((section(".noinit")));
+
+WatchdogSupervisor::Slot WatchdogSupervisor::slots[WATCHDOG_MAX_TASKS];
+size_t WatchdogSupervisor::slotCount = 0;
+IWDG_HandleTypeDef WatchdogSupervisor::hiwdg;
+uint32_t WatchdogSupervisor::timeoutMs = WATCHDOG_TIMEOUT_MS;
+uint32_t WatchdogSupervisor::stretchMs = 0;
+bool WatchdogSupervisor::started = false;
+bool WatchdogSupervisor::expired = false;
+bool WatchdogSupervisor::watchdogReset = false;
+WatchdogResetRecord WatchdogSupervisor::lastReset;
+
+void WatchdogSupervisor::init() {
+    watchdogReset = __HAL_RCC_GET_FLAG(RCC_FLAG_IWDGRST) != 0;
+    __HAL_RCC_CLEAR_RESET_FLAGS();
+
+    if (watchdogReset) {
+        if (resetRecord.magic == RECORD_MAGIC) {
+            lastReset = resetRecord;
+            lastReset.task[sizeof(lastReset.task) - 1] = '\0';
+        } else {
+            // Scheduler hang: nothing recorded, but the count was carried over
+            uint32_t count = resetRecord.resetCount;
+            memset(&lastReset, 0, sizeof(lastReset));
+            strcpy(lastReset.task, "?");
+            lastReset.resetCount = count;
+        }
+        lastReset.resetCount++;
+    } else {
+        memset(&lastReset, 0, sizeof(lastReset));
+    }
+
+    // Carry the count over in case the next reset leaves no record
+    resetRecord = lastReset;
+    resetRecord.magic = 0;
+}
+
+void WatchdogSupervisor::start() {
+    // Let the debugger halt the core without a reset
+    __HAL_DBGMCU_FREEZE_IWDG();
+    configure();
+    started = true;
+}
+
+static_assert(WATCHDOG_TIMEOUT_MS >= WATCHDOG_MIN_TIMEOUT_MS, "default IWDG period shorter than the refresh gap allows");
+
+bool WatchdogSupervisor::setTimeout(uint32_t timeout) {
+    // Below the minimum the IWDG would expire between two healthy
+    // supervise() calls and reset the MCU in a loop
+    if (timeout < WATCHDOG_MIN_TIMEOUT_MS || timeout > WATCHDOG_MAX_TIMEOUT_MS) return false;
+
+    timeoutMs = timeout;
+    if (started) {
+        configure();
+    }
+    return true;
+}
+
+void WatchdogSupervisor::stretch(uint32_t periodMs) {
+    stretchMs = periodMs > WATCHDOG_MAX_TIMEOUT_MS ? WATCHDOG_MAX_TIMEOUT_MS : periodMs;
+    if (started) {
+        configure();
+    }
+}
+
+void WatchdogSupervisor::configure() {
+    uint32_t periodMs = stretchMs > timeoutMs ? stretchMs : timeoutMs;
+
+    // LSI is ~32 kHz; the finest prescaler whose 12-bit reload still covers
+    // the period
+    static const uint32_t prescalers[][2] = {
+        { 4, IWDG_PRESCALER_4 }, { 8, IWDG_PRESCALER_8 }, { 16, IWDG_PRESCALER_16 },
+        { 32, IWDG_PRESCALER_32 }, { 64, IWDG_PRESCALER_64 }, { 128, IWDG_PRESCALER_128 },
+        { 256, IWDG_PRESCALER_256 },
+    };
+
+    size_t i = 0;
+    while (i + 1 < sizeof(prescalers) / sizeof(prescalers[0]) &&
+           periodMs * LSI_KHZ / prescalers[i][0] > 0xFFF) {
+        i++;
+    }
+    uint32_t reload = periodMs * LSI_KHZ / prescalers[i][0];
+
+    // Re-running the init while the IWDG counts only rewrites PR and RLR
+    // and reloads the counter
+    hiwdg.Instance = IWDG;
+    hiwdg.Init.Prescaler = prescalers[i][1];
+    hiwdg.Init.Reload = reload > 0xFFF ? 0xFFF : reload;
+    HAL_IWDG_Init(&hiwdg);
+}
+
+int WatchdogSupervisor::registerTask(const char* name, uint32_t deadlineMs) {
+    if (slotCount >= WATCHDOG_MAX_TASKS) {
+        return INVALID_ID;
+    }
+
+    Slot& slot = slots[slotCount];
+    slot.name = name;
+    slot.deadlineMs = deadlineMs;
+    slot.lastCheckIn = HAL_GetTick();
+    slot.enabled = true;
+    return (int)slotCount++;
+}
+
+void WatchdogSupervisor::setDeadline(int id, uint32_t deadlineMs) {
+    if (id < 0 || (size_t)id >= slotCount) return;
+    slots[id].deadlineMs = deadlineMs;
+}
+
+void WatchdogSupervisor::setEnabled(int id, bool enabled) {
+    if (id < 0 || (size_t)id >= slotCount) return;
+
+    // The deadline restarts when supervision resumes
+    slots[id].lastCheckIn = HAL_GetTick();
+    slots[id].enabled = enabled;
+}
+
+bool WatchdogSupervisor::supervise() {
+    if (expired) return false;
+
+    uint32_t now = HAL_GetTick();
+    for (size_t i = 0; i < slotCount; i++) {
+        const Slot& slot = slots[i];
+        uint32_t elapsed = now - slot.lastCheckIn;
+        if (!slot.enabled || elapsed <= slot.deadlineMs) continue;
+
+        // Latch: no more refreshes, the IWDG takes it from here
+        expired = true;
+        resetRecord.magic = RECORD_MAGIC;
+        strncpy(resetRecord.task, slot.name, sizeof(resetRecord.task) - 1);
+        resetRecord.task[sizeof(resetRecord.task) - 1] = '\0';
+        resetRecord.overdueMs = elapsed - slot.deadlineMs;
+        resetRecord.upTimeMs = now;
+        resetRecord.resetCount = lastReset.resetCount;
+
+        char message[64];
+        snprintf(message, sizeof(message), "Task %s missed check-in by %lu ms, resetting",
+                slot.name, (unsigned long)resetRecord.overdueMs);
+        SystemLogger::getInstance()->log(LogLevel::critical, message, "WATCHDOG");
+        return false;
+    }
+
+    HAL_IWDG_Refresh(&hiwdg);
+    return true;
+}
@@ -0,0 +1,31 @@
+#ifndef TESTS_CHECK_HPP_
+#define TESTS_CHECK_HPP_
+
+#include<stdio.h>
+
+// Minimal assertions for the host tests: a failed CHECK prints where and
+// what, the test carries on, and main() returns checkResult().
+inline int& checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: FAIL: %s\n", __FILE__, __LINE__, #condition); \
+            checkFailures()++; \
+        } \
+    } while (0)
+
+inline int checkResult(const char* name) {
+    if (checkFailures()) {
+        printf("%s: %d check(s) failed\n", name, checkFailures());
+        return 1;
+    }
+    printf("%s: PASS\n", name);
+    return 0;
+}
+
+
+#endif /* TESTS_CHECK_HPP_ */
@@ -0,0 +1,216 @@
+// Allocations and latency of CLI command dispatch on the host.
+//
+// Runs the dispatcher the command task runs (cli_dispatcher.cpp) with the
+// real help, status and config commands; only the status and config sources
+// behind them are fakes. Linked with heap_stats.cpp, so operator new goes
+// through HeapStats as on the target, and this thread is tagged as the CLI,
+// so the counters read here are the ones the heap command shows. Dispatch
+// must not allocate; the run fails if it does.
+
+#include<stdlib.h>
+#include<string.h>
+#include<chrono>
+#include "check.hpp"
+#include "cli_dispatcher.hpp"
+#include "status_command.hpp"
+#include "config_command.hpp"
+#include "heap_stats.hpp"
+#include "high_res_clock.hpp"
+
+BaseType_t stubSchedulerState = taskSCHEDULER_NOT_STARTED;
+UBaseType_t stubTaskNumber = 0;
+DWT_Type stubDwt;
+CoreDebug_Type stubCoreDebug;
+uint32_t stubTick;
+uint32_t stubHclk;
+
+extern "C" void vApplicationMallocFailedHook(void) {
+    printf("malloc failed\n");
+    abort();
+}
+
+// Nanoseconds, so command durations land in the histogram in real units
+static uint32_t hostCycles() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Keeps the last response for the checks; the timed runs only count bytes
+class CaptureSink : public IByteSink {
+public:
+    char text[4096];
+    size_t length = 0;
+    size_t bytes = 0;
+
+    void transmit(const uint8_t* data, size_t size) override {
+        bytes += size;
+        size_t room = sizeof(text) - 1 - length;
+        size_t copied = size < room ? size : room;
+        memcpy(&text[length], data, copied);
+        length += copied;
+        text[length] = '\0';
+    }
+
+    void clear() { length = 0; text[0] = '\0'; }
+    bool contains(const char* part) const { return strstr(text, part) != nullptr; }
+};
+
+class FakeStatus : public IStatusSource {
+public:
+    SystemStatus status;
+    UartRxStats rx;
+    UartTxStats tx;
+    WatchdogResetRecord reset;
+
+    FakeStatus() : reset{0, "sensor", 250, 123456, 1} {
+        status.state = SystemState::RUNNING;
+        status.upTime = 86400000;
+        status.activeSensors = 3;
+        status.totalSensors = 4;
+        rx.bytesReceived = 1048576;
+        tx.bytesQueued[0] = 4096;
+        tx.bytesQueued[1] = 65536;
+        tx.latencySamples[1] = 16;
+        tx.totalLatencyUs[1] = 4800;
+    }
+
+    const SystemStatus& getSystemStatus() const override { return status; }
+    const UartRxStats& getRxStats() const override { return rx; }
+    UartTxStats getTxStats() const override { return tx; }
+    const WatchdogResetRecord* getLastWatchdogReset() const override { return &reset; }
+};
+
+class FakeConfig : public IConfigEditor {
+public:
+    SystemConfig running;
+    SystemConfig saved;
+
+    SystemConfig getConfig() const override { return running; }
+    SystemConfig getSavedConfig() override { return saved; }
+    bool setValue(const ConfigField& field, uint32_t value) override {
+        return ConfigSchema::setNumber(running, field, value);
+    }
+    bool setText(const ConfigField& field, const char* text, size_t length) override {
+        return ConfigSchema::setText(running, field, text, length);
+    }
+    bool saveConfig() override {
+        saved = running;
+        return true;
+    }
+};
+
+static CommandDispatcher dispatcher;
+static FakeStatus statusSource;
+static FakeConfig configSource;
+
+static void testTokenizer() {
+    CommandLine commandLine;
+    // Every documented command fits; one token more than fits is refused
+    // rather than cut short
+    CHECK(commandLine.tokenize("stream all change batch 5 deadband 100 text aggregate") == 9);
+    CHECK(!commandLine.overflowed());
+    CHECK(commandLine.tokenize("stream 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15") == CommandLine::MAX_TOKENS);
+    CHECK(!commandLine.overflowed());
+    commandLine.tokenize("stream 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16");
+    CHECK(commandLine.overflowed());
+}
+
+static void run(std::string_view line, CaptureSink& sink) {
+    ResponseWriter out(sink);
+    dispatcher.dispatch(line, out);
+}
+
+static void testResponses() {
+    CaptureSink sink;
+    run("help", sink);
+    CHECK(sink.contains("  help - Show available commands"));
+    CHECK(sink.contains("  status - "));
+    CHECK(sink.contains("  config [get"));
+    CHECK(!sink.contains("  reset - ")); // not registered here
+
+    sink.clear();
+    run("status", sink);
+    CHECK(sink.contains("State: RUNNING"));
+    CHECK(sink.contains("task sensor overdue 250 ms"));
+    CHECK(sink.contains("latency avg 300 us"));
+
+    run("config set logLevel 3", sink);
+    sink.clear();
+    run("config get logLevel", sink);
+    CHECK(strncmp(sink.text, "logLevel ", 9) == 0);
+    CHECK(sink.contains(" 3\r\n> "));
+
+    sink.clear();
+    run("nosuchcommand a b", sink);
+    CHECK(strcmp(sink.text, "Unknown command: nosuchcommand\r\n> ") == 0);
+
+    sink.clear();
+    run("stream 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16", sink);
+    CHECK(sink.contains("Too many arguments"));
+
+    // A name can be taken once, and only from CLI_COMMAND_NAMES
+    CHECK(!dispatcher.registerCommand("help", std::make_unique<HelpCommand>(&dispatcher)));
+    CHECK(!dispatcher.registerCommand("nosuchcommand", std::make_unique<HelpCommand>(&dispatcher)));
+}
+
+static void benchmark() {
+    static const std::string_view lines[] = {
+        "help",
+        "status",
+        "config get",
+        "config get deviceName",
+        "config set sensorReadInterval 500",
+        "nosuchcommand a b",
+    };
+    const int iterations = 20000;
+    CaptureSink sink;
+
+    printf("%-36s %8s %8s %10s %10s\n", "command", "allocs", "cli", "bytes", "ns/cmd");
+    for (std::string_view line : lines) {
+        run(line, sink); // warm up
+        sink.clear();
+        sink.bytes = 0;
+
+        HeapUsage totalBefore = HeapStats::getTotal();
+        HeapUsage cliBefore = HeapStats::getModule(HeapModule::cli);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            sink.length = 0;
+            run(line, sink);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        uint32_t allocations = HeapStats::getTotal().allocations - totalBefore.allocations;
+        uint32_t cliAllocations = HeapStats::getModule(HeapModule::cli).allocations - cliBefore.allocations;
+
+        double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+        printf("%-36.*s %8.2f %8.2f %10zu %10.1f\n", (int)line.size(), line.data(),
+                (double)allocations / iterations, (double)cliAllocations / iterations,
+                sink.bytes / iterations, ns);
+        CHECK(allocations == 0);
+    }
+
+    // Every timed line but the unknown one went through the command histogram
+    Histogram& commandTime = dispatcher.getCommandTime();
+    uint32_t observed = 0;
+    for (size_t i = 0; i <= commandTime.getBoundCount(); i++) {
+        observed += commandTime.getBucket(i);
+    }
+    CHECK(dispatcher.getCommandCount().get() > observed);
+    CHECK(observed >= 5u * (iterations + 1));
+}
+
+int main() {
+    HighResClock::setSource(hostCycles, 1000000000);
+    dispatcher.registerCommand("help", std::make_unique<HelpCommand>(&dispatcher));
+    dispatcher.registerCommand("status", std::make_unique<StatusCommand>(&statusSource));
+    dispatcher.registerCommand("config", std::make_unique<ConfigCommand>(&configSource));
+
+    // From here on allocations are charged to the CLI, as on the command task
+    stubSchedulerState = taskSCHEDULER_RUNNING;
+    HeapStats::tagTask(xTaskGetCurrentTaskHandle(), HeapModule::cli);
+
+    testTokenizer();
+    testResponses();
+    benchmark();
+    return checkResult("cli_dispatch_bench");
+}
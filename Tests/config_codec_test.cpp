@@ -0,0 +1,255 @@
+// ConfigCodec: TLV round trips and deltas, range checks, unknown tags from a
+// newer schema, malformed records, and migration of version 0 records.
+
+#include<string.h>
+#include "check.hpp"
+#include "config_codec.hpp"
+
+static bool same(const SystemConfig& a, const SystemConfig& b) {
+    return ConfigSchema::diff(a, b) == 0;
+}
+
+static SystemConfig changedConfig() {
+    SystemConfig config;
+    config.sensorReadInterval = 250;
+    config.logLevel = 3;
+    config.watchdogTimeout = 8000;
+    config.maxSensors = 200;
+    config.autoStart = false;
+    ConfigSchema::setText(config, *ConfigSchema::find("deviceName"), "gw-lab-07", 9);
+    return config;
+}
+
+static void testRoundTrip() {
+    uint8_t buffer[ConfigCodec::MAX_SIZE];
+    SystemConfig written = changedConfig();
+    size_t length = ConfigCodec::encode(written, buffer, sizeof(buffer));
+    CHECK(length > ConfigCodec::HEADER_SIZE);
+    CHECK(buffer[0] == ConfigCodec::FORMAT_MARKER);
+    CHECK(buffer[1] == ConfigCodec::SCHEMA_VERSION);
+
+    SystemConfig loaded;
+    ConfigDecodeResult result = ConfigCodec::decode(buffer, length, loaded);
+    CHECK(result.ok);
+    CHECK(result.version == ConfigCodec::SCHEMA_VERSION);
+    CHECK(result.applied == 6);
+    CHECK(result.skipped == 0 && result.rejected == 0);
+    CHECK(same(loaded, written));
+    CHECK(memcmp(&loaded, &written, sizeof(loaded)) == 0); // text padding included
+
+    // Numbers take as few bytes as they need
+    SystemConfig small;
+    small.sensorReadInterval = 1;
+    length = ConfigCodec::encode(small, buffer, sizeof(buffer));
+    CHECK(buffer[2] == 1 && buffer[3] == 1 && buffer[4] == 1);
+}
+
+// Every field at its minimum and maximum survives a round trip, and a
+// config with everything at its widest fits in MAX_SIZE exactly or less
+static void testLimits() {
+    size_t count;
+    const ConfigField* fields = ConfigSchema::fields(count);
+    SystemConfig low;
+    SystemConfig high;
+    char longest[64];
+    memset(longest, 'x', sizeof(longest));
+    for (size_t i = 0; i < count; i++) {
+        const ConfigField& field = fields[i];
+        if (field.type == ConfigType::TEXT) {
+            CHECK(ConfigSchema::setText(low, field, longest, field.min));
+            CHECK(ConfigSchema::setText(high, field, longest, field.max));
+            CHECK(!ConfigSchema::setText(high, field, longest, field.max + 1));
+        } else {
+            CHECK(ConfigSchema::setNumber(low, field, field.min));
+            CHECK(ConfigSchema::setNumber(high, field, field.max));
+            CHECK(!ConfigSchema::setNumber(high, field, field.max + 1));
+            if (field.min > 0) CHECK(!ConfigSchema::setNumber(low, field, field.min - 1));
+        }
+    }
+
+    uint8_t buffer[ConfigCodec::MAX_SIZE + 8];
+    for (const SystemConfig* config : {&low, &high}) {
+        size_t length = ConfigCodec::encode(*config, buffer, sizeof(buffer));
+        CHECK(length != 0 && length <= ConfigCodec::MAX_SIZE);
+        SystemConfig loaded;
+        CHECK(ConfigCodec::decode(buffer, length, loaded).ok);
+        CHECK(same(loaded, *config));
+    }
+
+    size_t full = ConfigCodec::encode(high, buffer, sizeof(buffer));
+    CHECK(ConfigCodec::encode(high, buffer, full) == full);
+    CHECK(ConfigCodec::encode(high, buffer, full - 1) == 0);
+}
+
+static void testDelta() {
+    uint8_t buffer[ConfigCodec::MAX_SIZE];
+    SystemConfig base = changedConfig();
+    CHECK(ConfigCodec::encode(base, buffer, sizeof(buffer), &base) == ConfigCodec::HEADER_SIZE);
+
+    SystemConfig next = base;
+    next.logLevel = 0;
+    ConfigSchema::setText(next, *ConfigSchema::find("deviceName"), "renamed", 7);
+    size_t length = ConfigCodec::encode(next, buffer, sizeof(buffer), &base);
+    CHECK(length == ConfigCodec::HEADER_SIZE + 2 + 1 + 2 + 7);
+
+    // A delta applies on top of whatever it is decoded onto
+    SystemConfig loaded = base;
+    ConfigDecodeResult result = ConfigCodec::decode(buffer, length, loaded);
+    CHECK(result.ok && result.applied == 2);
+    CHECK(same(loaded, next));
+}
+
+// A record from a newer schema: tags this build does not know are skipped,
+// the rest still applies
+static void testUnknownTags() {
+    const uint8_t record[] = {
+        ConfigCodec::FORMAT_MARKER, 2,
+        1, 2, 0xF4, 0x01,           // sensorReadInterval 500
+        200, 3, 'n', 'e', 'w',      // unknown
+        2, 1, 4,                    // logLevel 4
+        201, 0,                     // unknown, empty
+        6, 3, 'a', 'b', 'c',        // deviceName
+    };
+    SystemConfig loaded;
+    ConfigDecodeResult result = ConfigCodec::decode(record, sizeof(record), loaded);
+    CHECK(result.ok);
+    CHECK(result.version == 2);
+    CHECK(result.applied == 3);
+    CHECK(result.skipped == 2);
+    CHECK(result.rejected == 0);
+    CHECK(loaded.sensorReadInterval == 500);
+    CHECK(loaded.logLevel == 4);
+    CHECK(strcmp(loaded.deviceName, "abc") == 0);
+}
+
+// Known tags with a bad value or length are rejected one by one
+static void testRejected() {
+    const uint8_t record[] = {
+        ConfigCodec::FORMAT_MARKER, 1,
+        2, 1, 9,                    // logLevel 9, max 4
+        4, 5, 1, 0, 0, 0, 0,        // maxSensors in 5 bytes
+        1, 0,                       // sensorReadInterval, no bytes
+        6, 0,                       // deviceName, empty
+        5, 1, 0,                    // autoStart false, fine
+    };
+    SystemConfig loaded;
+    SystemConfig defaults;
+    ConfigDecodeResult result = ConfigCodec::decode(record, sizeof(record), loaded);
+    CHECK(result.ok);
+    CHECK(result.applied == 1);
+    CHECK(result.rejected == 4);
+    CHECK(loaded.logLevel == defaults.logLevel);
+    CHECK(loaded.maxSensors == defaults.maxSensors);
+    CHECK(loaded.sensorReadInterval == defaults.sensorReadInterval);
+    CHECK(strcmp(loaded.deviceName, defaults.deviceName) == 0);
+    CHECK(loaded.autoStart == false);
+}
+
+// A record cut short changes nothing at all
+static void testMalformed() {
+    uint8_t buffer[ConfigCodec::MAX_SIZE];
+    SystemConfig written = changedConfig();
+    size_t length = ConfigCodec::encode(written, buffer, sizeof(buffer));
+
+    for (size_t cut = 0; cut < length; cut++) {
+        SystemConfig loaded;
+        SystemConfig before = loaded;
+        ConfigDecodeResult result = ConfigCodec::decode(buffer, cut, loaded);
+        // Cutting between fields leaves a valid record with fewer fields
+        bool boundary = cut >= ConfigCodec::HEADER_SIZE;
+        for (size_t offset = ConfigCodec::HEADER_SIZE; boundary && offset < cut; offset += 2 + buffer[offset + 1]) {
+            boundary = offset + 2 + buffer[offset + 1] <= cut;
+        }
+        CHECK(result.ok == boundary);
+        if (!result.ok) CHECK(memcmp(&loaded, &before, sizeof(loaded)) == 0);
+    }
+}
+
+// Version 0, the packed struct of the first flash store
+#pragma pack(push, 1)
+struct LayoutV0 {
+    uint32_t sensorReadInterval;
+    uint32_t logLevel;
+    uint32_t watchdogTimeout;
+    uint32_t maxSensors;
+    uint8_t autoStart;
+    char deviceName[16];
+};
+#pragma pack(pop)
+
+static void testMigration() {
+    LayoutV0 old = {};
+    old.sensorReadInterval = 2000;
+    old.logLevel = 2;
+    old.watchdogTimeout = 6000;
+    old.maxSensors = 12;
+    old.autoStart = 0;
+    memcpy(old.deviceName, "old-name-1234567", 16); // full width, no NUL
+
+    SystemConfig loaded;
+    ConfigDecodeResult result = ConfigCodec::decode(reinterpret_cast<const uint8_t*>(&old), sizeof(old), loaded);
+    CHECK(result.ok);
+    CHECK(result.version == 0);
+    CHECK(result.applied == 6 && result.rejected == 0);
+    CHECK(loaded.sensorReadInterval == 2000);
+    CHECK(loaded.logLevel == 2);
+    CHECK(loaded.watchdogTimeout == 6000);
+    CHECK(loaded.maxSensors == 12);
+    CHECK(loaded.autoStart == false);
+    CHECK(strcmp(loaded.deviceName, "old-name-1234567") == 0);
+
+    // Rewritten as TLV, it reads back the same
+    uint8_t buffer[ConfigCodec::MAX_SIZE];
+    size_t length = ConfigCodec::encode(loaded, buffer, sizeof(buffer));
+    SystemConfig again;
+    result = ConfigCodec::decode(buffer, length, again);
+    CHECK(result.ok && result.version == ConfigCodec::SCHEMA_VERSION);
+    CHECK(same(again, loaded));
+
+    // Version 0 had no range checks; bad values keep their defaults
+    old.logLevel = 9;
+    old.maxSensors = 0;
+    SystemConfig defaults;
+    SystemConfig partial;
+    result = ConfigCodec::decode(reinterpret_cast<const uint8_t*>(&old), sizeof(old), partial);
+    CHECK(result.ok && result.version == 0);
+    CHECK(result.applied == 4 && result.rejected == 2);
+    CHECK(partial.logLevel == defaults.logLevel);
+    CHECK(partial.maxSensors == defaults.maxSensors);
+    CHECK(partial.sensorReadInterval == 2000);
+
+    // A version 0 record that starts with the marker byte by chance
+    old = LayoutV0();
+    old.sensorReadInterval = 0x01C5; // first byte 0xC5
+    old.logLevel = 1;
+    old.watchdogTimeout = 5000;
+    old.maxSensors = 10;
+    old.autoStart = 1;
+    memcpy(old.deviceName, "marker", 6);
+    SystemConfig marker;
+    result = ConfigCodec::decode(reinterpret_cast<const uint8_t*>(&old), sizeof(old), marker);
+    CHECK(result.ok && result.version == 0);
+    CHECK(marker.sensorReadInterval == 0x01C5);
+    CHECK(strcmp(marker.deviceName, "marker") == 0);
+
+    // ...while a TLV record of the same length stays TLV
+    SystemConfig sameLength;
+    ConfigSchema::setText(sameLength, *ConfigSchema::find("deviceName"), "twelve-chars", 12);
+    length = ConfigCodec::encode(sameLength, buffer, sizeof(buffer));
+    CHECK(length == sizeof(LayoutV0));
+    SystemConfig tlv;
+    result = ConfigCodec::decode(buffer, length, tlv);
+    CHECK(result.ok && result.version == ConfigCodec::SCHEMA_VERSION);
+    CHECK(same(tlv, sameLength));
+}
+
+int main() {
+    testRoundTrip();
+    testLimits();
+    testDelta();
+    testUnknownTags();
+    testRejected();
+    testMalformed();
+    testMigration();
+    return checkResult("config_codec_test");
+}
@@ -0,0 +1,244 @@
+// ConfigStore on a simulated flash: round trip, delta chains across sector
+// swaps, a power cut at every programmed word and erase of a save sequence,
+// and the erase count per save.
+//
+// The saver mirrors ConfigManager::saveToFlash: a checkpoint after every
+// mount and whenever the chain reaches CONFIG_STORE_MAX_DELTAS or no longer
+// fits, otherwise a delta with only the changed values.
+
+#include<stdlib.h>
+#include "check.hpp"
+#include "sim_flash.hpp"
+#include "config_store.hpp"
+
+static const uint32_t SECTOR_A = 0x08040000;
+static const uint32_t SECTOR_SIZE = 2048; // small, so a few saves fill a sector
+static const size_t VALUES = 24;
+
+static const uint32_t TAG_CHECKPOINT = 0x54504B43;
+static const uint32_t TAG_DELTA = 0x41544C44;
+
+struct State {
+    uint32_t values[VALUES];
+    bool operator==(const State& other) const { return memcmp(values, other.values, sizeof(values)) == 0; }
+};
+
+// Payload: tag word, then every value (checkpoint) or index/value pairs (delta)
+static size_t encode(const State& state, const State* since, uint32_t* out) {
+    size_t words = 1;
+    if (since == nullptr) {
+        out[0] = TAG_CHECKPOINT;
+        for (size_t i = 0; i < VALUES; i++) out[words++] = state.values[i];
+    } else {
+        out[0] = TAG_DELTA;
+        for (size_t i = 0; i < VALUES; i++) {
+            if (state.values[i] != since->values[i]) {
+                out[words++] = (uint32_t)i;
+                out[words++] = state.values[i];
+            }
+        }
+    }
+    return words * 4;
+}
+
+static bool load(ConfigStore& store, State& state) {
+    if (!store.mount()) return false;
+    State loaded = {};
+    bool malformed = false;
+    size_t applied = store.replay([&](const uint8_t* payload, size_t length) {
+        uint32_t words[CONFIG_STORE_MAX_PAYLOAD / 4];
+        memcpy(words, payload, length);
+        size_t count = length / 4;
+        if (words[0] == TAG_CHECKPOINT && count == VALUES + 1) {
+            memcpy(loaded.values, &words[1], sizeof(loaded.values));
+        } else if (words[0] == TAG_DELTA && count % 2 == 1) {
+            for (size_t i = 1; i < count; i += 2) {
+                if (words[i] >= VALUES) malformed = true;
+                else loaded.values[words[i]] = words[i + 1];
+            }
+        } else {
+            malformed = true;
+        }
+    });
+    if (applied == 0 || malformed) return false;
+    state = loaded;
+    return true;
+}
+
+class Saver {
+public:
+    explicit Saver(ConfigStore& configStore) : store(configStore), checkpointDue(true), persisted() {}
+
+    void mounted(const State& state) {
+        persisted = state;
+        checkpointDue = true;
+    }
+
+    bool save(const State& state) {
+        uint32_t record[CONFIG_STORE_MAX_PAYLOAD / 4];
+        bool delta = !checkpointDue && store.getStats().deltas < CONFIG_STORE_MAX_DELTAS;
+        size_t length = 0;
+        if (delta) {
+            length = encode(state, &persisted, record);
+            if (length == 4) return true;
+            delta = store.fits(length);
+        }
+        if (!delta) {
+            length = encode(state, nullptr, record);
+        }
+        if (!store.write(record, length, delta)) return false;
+        persisted = state;
+        checkpointDue = false;
+        return true;
+    }
+
+private:
+    ConfigStore& store;
+    bool checkpointDue;
+    State persisted;
+};
+
+// Deterministic sequence of edits; step n changes one or two values
+static State stateAt(int step) {
+    State state = {};
+    for (int n = 1; n <= step; n++) {
+        state.values[(n * 7) % VALUES] = (uint32_t)n * 2654435761u;
+        if (n % 3 == 0) state.values[(n * 5 + 1) % VALUES] = (uint32_t)n;
+    }
+    return state;
+}
+
+static void testRoundTrip() {
+    SimFlash flash(SECTOR_A, SECTOR_SIZE, 2);
+    ConfigStore store(flash, SECTOR_A, SECTOR_A + SECTOR_SIZE, SECTOR_SIZE);
+    State state;
+    CHECK(!load(store, state)); // blank flash, nothing stored
+
+    Saver saver(store);
+    State written = stateAt(5);
+    CHECK(saver.save(written));
+
+    ConfigStore reboot(flash, SECTOR_A, SECTOR_A + SECTOR_SIZE, SECTOR_SIZE);
+    CHECK(load(reboot, state));
+    CHECK(state == written);
+    CHECK(reboot.getStats().records == 1);
+    CHECK(reboot.getStats().deltas == 0);
+}
+
+// Every save is checked from a fresh mount, across many sector swaps
+static void testChains() {
+    SimFlash flash(SECTOR_A, SECTOR_SIZE, 2);
+    ConfigStore store(flash, SECTOR_A, SECTOR_A + SECTOR_SIZE, SECTOR_SIZE);
+    Saver saver(store);
+    uint32_t maxDeltas = 0;
+
+    for (int step = 1; step <= 300; step++) {
+        State written = stateAt(step);
+        CHECK(saver.save(written));
+
+        ConfigStore reboot(flash, SECTOR_A, SECTOR_A + SECTOR_SIZE, SECTOR_SIZE);
+        State loaded;
+        CHECK(load(reboot, loaded));
+        CHECK(loaded == written);
+        CHECK(reboot.getStats().sequence == store.getStats().sequence);
+        if (reboot.getStats().deltas > maxDeltas) maxDeltas = reboot.getStats().deltas;
+    }
+    CHECK(maxDeltas == CONFIG_STORE_MAX_DELTAS);
+    CHECK(flash.eraseCount(0) + flash.eraseCount(1) > 4); // the sectors swapped
+}
+
+// Cuts power at every word program and erase of a run of saves. After the
+// reboot the config is the one before the interrupted save or the one it
+// was writing, never anything else, and saving goes on from there.
+static void testPowerCuts() {
+    const int SAVES = 60;
+    const int PREFILL = 20;
+
+    // Operations a clean run takes, to know how far the cut point must go
+    SimFlash reference(SECTOR_A, SECTOR_SIZE, 2);
+    long totalOperations;
+    {
+        ConfigStore store(reference, SECTOR_A, SECTOR_A + SECTOR_SIZE, SECTOR_SIZE);
+        Saver saver(store);
+        for (int step = 1; step <= PREFILL + SAVES; step++) saver.save(stateAt(step));
+        totalOperations = (long)reference.programmedWords() + reference.eraseCount(0) + reference.eraseCount(1);
+    }
+
+    int cuts = 0;
+    int landedOld = 0;
+    int landedNew = 0;
+    for (long cutAt = 0; cutAt < totalOperations; cutAt++) {
+        SimFlash flash(SECTOR_A, SECTOR_SIZE, 2);
+        int step = 1;
+        {
+            ConfigStore store(flash, SECTOR_A, SECTOR_A + SECTOR_SIZE, SECTOR_SIZE);
+            Saver saver(store);
+            for (; step <= PREFILL; step++) saver.save(stateAt(step));
+
+            // Prefill took a fixed number of operations; cut inside the rest
+            long prefill = (long)flash.programmedWords() + flash.eraseCount(0) + flash.eraseCount(1);
+            if (cutAt < prefill) continue;
+            flash.cutPowerAfter(cutAt - prefill);
+            for (; step <= PREFILL + SAVES; step++) {
+                if (!saver.save(stateAt(step))) break;
+            }
+        }
+        if (flash.isPowered()) continue; // cut point past the end of the run
+        cuts++;
+
+        flash.powerOn();
+        ConfigStore reboot(flash, SECTOR_A, SECTOR_A + SECTOR_SIZE, SECTOR_SIZE);
+        State loaded;
+        bool ok = load(reboot, loaded);
+        CHECK(ok);
+        bool old = ok && loaded == stateAt(step - 1);
+        bool next = ok && loaded == stateAt(step);
+        CHECK(old || next);
+        if (!(old || next)) {
+            printf("  cut at operation %ld, save %d\n", cutAt, step);
+            continue;
+        }
+        landedOld += old;
+        landedNew += next && !old;
+
+        // The store keeps working after the cut
+        Saver saver(reboot);
+        saver.mounted(loaded);
+        for (int more = step + 1; more <= step + 12; more++) {
+            CHECK(saver.save(stateAt(more)));
+        }
+        ConfigStore again(flash, SECTOR_A, SECTOR_A + SECTOR_SIZE, SECTOR_SIZE);
+        CHECK(load(again, loaded));
+        CHECK(loaded == stateAt(step + 12));
+    }
+
+    printf("  %d power cuts: %d kept the previous config, %d the new one\n", cuts, landedOld, landedNew);
+    CHECK(cuts > 100);
+}
+
+// Wear: erases per save, and both sectors take their share
+static void testWear() {
+    SimFlash flash(SECTOR_A, SECTOR_SIZE, 2);
+    ConfigStore store(flash, SECTOR_A, SECTOR_A + SECTOR_SIZE, SECTOR_SIZE);
+    Saver saver(store);
+    const int SAVES = 2000;
+    for (int step = 1; step <= SAVES; step++) {
+        CHECK(saver.save(stateAt(step)));
+    }
+
+    uint32_t a = flash.eraseCount(0);
+    uint32_t b = flash.eraseCount(1);
+    CHECK((a > b ? a - b : b - a) <= 1);
+    CHECK(store.getStats().eraseCount[0] == a);
+    CHECK(store.getStats().eraseCount[1] == b);
+    printf("  %d saves: %u + %u erases, %.1f saves per erase, %.1f words programmed per save\n",
+           SAVES, a, b, (double)SAVES / (a + b), (double)flash.programmedWords() / SAVES);
+}
+
+int main() {
+    testRoundTrip();
+    testChains();
+    testPowerCuts();
+    testWear();
+    return checkResult("config_store_test");
+}
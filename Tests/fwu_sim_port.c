@@ -0,0 +1,80 @@
+/*
+ * fwu_sim_port.c
+ *
+ * Host port for the bootloader's fw_update.c, built into a shared library
+ * that Tools/fw_upload.py sim loads with ctypes. Every fwu_port_* call goes
+ * to a function the simulation registers, which models the UART, the flash
+ * and the time they take.
+ */
+
+#include "fw_update.h"
+
+typedef struct {
+	size_t (*read)(uint8_t* data, size_t size);
+	void (*write)(const uint8_t* data, size_t length);
+	uint32_t (*max_baud)(void);
+	bool (*set_baud)(uint32_t baud);
+	uint32_t (*millis)(void);
+	uint32_t (*crc)(const uint8_t* data, size_t length);
+	bool (*erase)(uint32_t address, uint32_t length);
+	bool (*program)(uint32_t address, const uint32_t* words, size_t count);
+	uint8_t (*verify)(uint32_t address, uint32_t slotSize);
+	bool (*activate)(uint32_t address);
+	void (*reset)(void);
+} FwuSimPorts;
+
+static FwuSimPorts ports;
+
+void fwu_sim_set_ports(const FwuSimPorts* simPorts){
+	ports = *simPorts;
+}
+
+void fwu_port_open(void){
+}
+
+void fwu_port_close(void){
+}
+
+size_t fwu_port_read(uint8_t* data, size_t size){
+	return ports.read(data, size);
+}
+
+void fwu_port_write(const uint8_t* data, size_t length){
+	ports.write(data, length);
+}
+
+uint32_t fwu_port_max_baud(void){
+	return ports.max_baud();
+}
+
+bool fwu_port_set_baud(uint32_t baud){
+	return ports.set_baud(baud);
+}
+
+uint32_t fwu_port_millis(void){
+	return ports.millis();
+}
+
+uint32_t fwu_port_crc(const uint8_t* data, size_t length){
+	return ports.crc(data, length);
+}
+
+bool fwu_port_erase(uint32_t address, uint32_t length){
+	return ports.erase(address, length);
+}
+
+bool fwu_port_program(uint32_t address, const uint32_t* words, size_t count){
+	return ports.program(address, words, count);
+}
+
+uint8_t fwu_port_verify(uint32_t address, uint32_t slotSize){
+	return ports.verify(address, slotSize);
+}
+
+bool fwu_port_activate(uint32_t address){
+	return ports.activate(address);
+}
+
+void fwu_port_reset(void){
+	ports.reset();
+}
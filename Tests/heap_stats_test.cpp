@@ -0,0 +1,109 @@
+// HeapStats accounting around allocate/release, and that a block it did not
+// hand out, or already took back, is counted and never passed to free().
+// Linked with heap_stats.cpp, so operator new/delete in this file go through
+// HeapStats as they do on the target.
+
+#include<stdlib.h>
+#include<string.h>
+#include "check.hpp"
+#include "heap_stats.hpp"
+
+BaseType_t stubSchedulerState = taskSCHEDULER_NOT_STARTED;
+UBaseType_t stubTaskNumber = 0;
+
+extern "C" void vApplicationMallocFailedHook(void) {
+    printf("malloc failed\n");
+    abort();
+}
+
+static void testAccounting() {
+    HeapStats::setInitModule(HeapModule::sensor);
+    HeapUsage totalBefore = HeapStats::getTotal();
+    HeapUsage sensorBefore = HeapStats::getModule(HeapModule::sensor);
+
+    void* a = HeapStats::allocate(100);
+    void* b = HeapStats::allocate(28);
+    CHECK(a != nullptr && b != nullptr);
+    CHECK(((uintptr_t)a & 7) == 0); // header keeps 8-byte alignment
+    memset(a, 0x55, 100);
+
+    HeapUsage sensor = HeapStats::getModule(HeapModule::sensor);
+    CHECK(sensor.liveBytes == sensorBefore.liveBytes + 128);
+    CHECK(sensor.peakBytes >= sensor.liveBytes);
+    CHECK(sensor.allocations == sensorBefore.allocations + 2);
+    CHECK(HeapStats::getTotal().liveBytes == totalBefore.liveBytes + 128);
+
+    HeapStats::release(a);
+    HeapStats::release(b);
+    sensor = HeapStats::getModule(HeapModule::sensor);
+    CHECK(sensor.liveBytes == sensorBefore.liveBytes);
+    CHECK(sensor.frees == sensorBefore.frees + 2);
+    CHECK(HeapStats::getTotal().liveBytes == totalBefore.liveBytes);
+
+    HeapStats::setInitModule(HeapModule::app);
+}
+
+static void testTaskTag() {
+    stubSchedulerState = taskSCHEDULER_RUNNING;
+    HeapStats::tagTask(xTaskGetCurrentTaskHandle(), HeapModule::cli);
+    uint32_t before = HeapStats::getModule(HeapModule::cli).liveBytes;
+
+    int* value = new int(7);
+    CHECK(HeapStats::getModule(HeapModule::cli).liveBytes == before + sizeof(int));
+    delete value;
+    CHECK(HeapStats::getModule(HeapModule::cli).liveBytes == before);
+
+    // An out of range task number is charged to "other"
+    stubTaskNumber = 200;
+    before = HeapStats::getModule(HeapModule::other).liveBytes;
+    void* p = HeapStats::allocate(16);
+    CHECK(HeapStats::getModule(HeapModule::other).liveBytes == before + 16);
+    HeapStats::release(p);
+
+    stubSchedulerState = taskSCHEDULER_NOT_STARTED;
+    stubTaskNumber = 0;
+}
+
+static void testDoubleRelease() {
+    void* p = HeapStats::allocate(64);
+    HeapUsage total = HeapStats::getTotal();
+    uint32_t corruptions = HeapStats::getCorruptions();
+
+    HeapStats::release(p);
+    CHECK(HeapStats::getCorruptions() == corruptions);
+    // The second release finds no magic: counted, accounting untouched, and
+    // the C library would abort here had the block gone to free() twice
+    HeapStats::release(p);
+    CHECK(HeapStats::getCorruptions() == corruptions + 1);
+    CHECK(HeapStats::getTotal().liveBytes == total.liveBytes - 64);
+    CHECK(HeapStats::getTotal().frees == total.frees + 1);
+}
+
+static void testForeignPointer() {
+    // Memory HeapStats never handed out, e.g. a stray delete of a static
+    alignas(8) static uint8_t notFromHeap[32] = {};
+    HeapUsage total = HeapStats::getTotal();
+    uint32_t corruptions = HeapStats::getCorruptions();
+
+    HeapStats::release(notFromHeap + 8);
+    CHECK(HeapStats::getCorruptions() == corruptions + 1);
+    CHECK(HeapStats::getTotal().liveBytes == total.liveBytes);
+    CHECK(HeapStats::getTotal().frees == total.frees);
+
+    // A header overwritten by an underrun of the block before it
+    uint8_t* p = static_cast<uint8_t*>(HeapStats::allocate(24));
+    memset(p - 8, 0xEE, 8);
+    HeapStats::release(p);
+    CHECK(HeapStats::getCorruptions() == corruptions + 2);
+
+    HeapStats::release(nullptr);
+    CHECK(HeapStats::getCorruptions() == corruptions + 2);
+}
+
+int main() {
+    testAccounting();
+    testTaskTag();
+    testDoubleRelease();
+    testForeignPointer();
+    return checkResult("heap_stats_test");
+}
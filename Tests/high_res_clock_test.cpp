@@ -0,0 +1,112 @@
+// HighResClock's 64-bit extension of a 32-bit cycle counter, on a fake
+// source stepped across 0xFFFFFFFF: one wrap between calls, several wraps
+// between calls recovered from the millisecond tick, and the DWT path that
+// init() sets up.
+
+#include "check.hpp"
+#include "high_res_clock.hpp"
+#include "stm32f4xx_hal.h"
+
+DWT_Type stubDwt;
+CoreDebug_Type stubCoreDebug;
+uint32_t stubTick;
+uint32_t stubHclk = 96000000;
+
+static const uint32_t FREQUENCY = 96000000; // cycles per second, as on the target
+static const uint64_t WRAP = 1ull << 32;
+
+// The time the fake source stands for; the counter and tick are its low bits
+static uint64_t trueCycles;
+// Milliseconds the tick fell behind, as when a flash erase stalls it
+static uint32_t tickLag;
+
+static uint32_t fakeCycles() { return (uint32_t)trueCycles; }
+static uint32_t fakeMillis() { return (uint32_t)(trueCycles / (FREQUENCY / 1000)) - tickLag; }
+
+static void testSingleWraps() {
+    trueCycles = 0xFFFFF000u;
+    HighResClock::setSource(fakeCycles, FREQUENCY);
+    CHECK(HighResClock::now() == trueCycles);
+
+    // Steps of under one wrap, across 0xFFFFFFFF several times
+    uint64_t last = 0;
+    bool monotonic = true, exact = true;
+    for (int i = 0; i < 1000; i++) {
+        trueCycles += 0x10000000u + (uint32_t)i * 977;
+        uint64_t now = HighResClock::now();
+        monotonic = monotonic && now > last;
+        exact = exact && now == trueCycles;
+        last = now;
+    }
+    CHECK(monotonic);
+    CHECK(exact);
+    CHECK(trueCycles > 50 * WRAP);
+
+    // A new source starts from its 32-bit count: right up to and just past
+    // the wrap
+    trueCycles = 3 * WRAP - 1;
+    HighResClock::setSource(fakeCycles, FREQUENCY);
+    CHECK(HighResClock::now() == 0xFFFFFFFFu);
+    trueCycles += 1;
+    CHECK(HighResClock::now() == WRAP);
+    // Just under a full wrap between calls still counts
+    trueCycles += WRAP - 1;
+    CHECK(HighResClock::now() == 2 * WRAP - 1);
+}
+
+static void testMissedWraps() {
+    trueCycles = 12345;
+    HighResClock::setSource(fakeCycles, FREQUENCY, fakeMillis);
+
+    // Several wraps (~44.7 s each) between calls, and the counter ending up
+    // below, above and equal to where it was
+    static const uint64_t gaps[] = { 3 * WRAP, 2 * WRAP + 100, 5 * WRAP - 100, WRAP, WRAP + 1, 7, 40 * WRAP + 0x7FFFFFFF };
+    uint64_t last = HighResClock::now();
+    for (uint64_t gap : gaps) {
+        trueCycles += gap;
+        uint64_t now = HighResClock::now();
+        CHECK(now == trueCycles);
+        CHECK(now > last);
+        last = now;
+    }
+
+    // The tick stalls during flash erases, a few seconds at most; that must
+    // neither add a wrap nor lose one
+    tickLag = 3000;
+    trueCycles += 2 * WRAP + 5;
+    CHECK(HighResClock::now() == trueCycles);
+    trueCycles += 1000;
+    CHECK(HighResClock::now() == trueCycles);
+    tickLag = 6000;
+    trueCycles += WRAP - 10;
+    CHECK(HighResClock::now() == trueCycles);
+    tickLag = 0;
+}
+
+static void testDwt() {
+    // init() reads DWT->CYCCNT and HAL_GetTick at the HCLK frequency
+    stubDwt.CYCCNT = 0xFFFFFF00u;
+    stubTick = 0;
+    HighResClock::init();
+    CHECK(stubDwt.CTRL & DWT_CTRL_CYCCNTENA_Msk);
+    CHECK(HighResClock::getFrequency() == stubHclk);
+    uint64_t start = HighResClock::now();
+    CHECK(start == 0xFFFFFF00u);
+
+    stubDwt.CYCCNT = 0x100; // one wrap, 512 cycles later
+    CHECK(HighResClock::now() == start + 512);
+
+    // Ten seconds short of 3 wraps later
+    uint64_t later = start + 512 + 3 * WRAP - 10ull * stubHclk;
+    stubDwt.CYCCNT = (uint32_t)later;
+    stubTick = (uint32_t)((later - start) / (stubHclk / 1000));
+    CHECK(HighResClock::now() == later);
+    CHECK(HighResClock::nowUs() == later / (stubHclk / 1000000));
+}
+
+int main() {
+    testSingleWraps();
+    testMissedWraps();
+    testDwt();
+    return checkResult("high_res_clock_test");
+}
@@ -0,0 +1,46 @@
+// HwCrc in software for the host tests: same polynomial, init and word
+// feeding as the STM32 CRC unit (see hw_crc.hpp), so records written by a
+// host test check out the same way they would on the target.
+
+#include "hw_crc.hpp"
+#include<string.h>
+
+static uint32_t crcRegister;
+
+void HwCrc::init() {}
+
+static void crcWord(uint32_t word) {
+    crcRegister ^= word;
+    for (int bit = 0; bit < 32; bit++) {
+        crcRegister = (crcRegister & 0x80000000u) ? (crcRegister << 1) ^ 0x04C11DB7u : crcRegister << 1;
+    }
+}
+
+uint32_t HwCrc::compute(const uint8_t* data, size_t length) {
+    crcRegister = 0xFFFFFFFFu;
+    feed(data, length);
+    return crcRegister;
+}
+
+uint32_t HwCrc::compute(const uint8_t* data, size_t length, size_t skipOffset, size_t skipLength) {
+    crcRegister = 0xFFFFFFFFu;
+    feed(data, skipOffset);
+    feed(data + skipOffset + skipLength, length - skipOffset - skipLength);
+    return crcRegister;
+}
+
+void HwCrc::feed(const uint8_t* data, size_t length) {
+    size_t words = length / 4;
+    for (size_t i = 0; i < words; i++) {
+        uint32_t word;
+        memcpy(&word, &data[i * 4], 4);
+        crcWord(word);
+    }
+
+    size_t tail = length & 3;
+    if (tail > 0) {
+        uint32_t word = 0;
+        memcpy(&word, &data[words * 4], tail);
+        crcWord(word);
+    }
+}
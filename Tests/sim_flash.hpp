@@ -0,0 +1,99 @@
+#ifndef TESTS_SIM_FLASH_HPP_
+#define TESTS_SIM_FLASH_HPP_
+
+#include<stdint.h>
+#include<string.h>
+#include<vector>
+#include "flash_device.hpp"
+
+// NOR flash in host memory with the rules the config store relies on:
+// erase sets a sector to 0xFF, programming can only clear bits, words are
+// 4-byte aligned. Counts erases per sector for wear figures.
+//
+// A power cut can be scheduled after a number of programmed words or
+// erases. The operation in flight is left half done (a word with only some
+// of its bits cleared, a sector only partly erased), it reports failure,
+// and every later operation fails until powerOn().
+class SimFlash : public IFlashDevice {
+public:
+    SimFlash(uint32_t baseAddress, uint32_t sectorBytes, size_t sectorCount)
+        : base(baseAddress), sectorSize(sectorBytes), memory(sectorBytes * sectorCount, 0xFF),
+          erases(sectorCount, 0), wordsProgrammed(0), cutAfter(-1), powered(true), seed(12345) {}
+
+    bool eraseSector(uint32_t sectorAddress) override {
+        if (!powered || sectorAddress < base || (sectorAddress - base) % sectorSize != 0 ||
+            sectorAddress - base >= memory.size()) {
+            return false;
+        }
+        uint8_t* sector = &memory[sectorAddress - base];
+        erases[(sectorAddress - base) / sectorSize]++;
+        if (tick()) {
+            for (uint32_t i = 0; i < sectorSize; i++) {
+                if (random() & 1) sector[i] = 0xFF;
+            }
+            return false;
+        }
+        memset(sector, 0xFF, sectorSize);
+        return true;
+    }
+
+    bool program(uint32_t address, const uint32_t* words, size_t count) override {
+        if (!powered || (address & 3) != 0 || address < base || address - base + count * 4 > memory.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < count; i++) {
+            uint8_t* target = &memory[address - base + i * 4];
+            uint32_t current;
+            memcpy(&current, target, 4);
+            uint32_t next = current & words[i];
+            bool cut = tick();
+            if (cut) {
+                next = current & (words[i] | random()); // some of the bits made it
+            }
+            memcpy(target, &next, 4);
+            wordsProgrammed++;
+            if (cut) return false;
+        }
+        return true;
+    }
+
+    const uint8_t* data(uint32_t address) const override {
+        return &memory[address - base];
+    }
+
+    // The operation after `operations` more word programs or erases loses power
+    void cutPowerAfter(long operations) { cutAfter = operations; }
+    void powerOn() { powered = true; cutAfter = -1; }
+    bool isPowered() const { return powered; }
+
+    uint32_t eraseCount(size_t sector) const { return erases[sector]; }
+    uint64_t programmedWords() const { return wordsProgrammed; }
+
+private:
+    uint32_t base;
+    uint32_t sectorSize;
+    std::vector<uint8_t> memory;
+    std::vector<uint32_t> erases;
+    uint64_t wordsProgrammed;
+    long cutAfter;
+    bool powered;
+    uint32_t seed;
+
+    // True when this operation is the one that loses power
+    bool tick() {
+        if (cutAfter < 0) return false;
+        if (cutAfter-- > 0) return false;
+        powered = false;
+        return true;
+    }
+
+    uint32_t random() {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    }
+};
+
+
+#endif /* TESTS_SIM_FLASH_HPP_ */
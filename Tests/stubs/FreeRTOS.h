@@ -0,0 +1,46 @@
+/*
+ * Host stand-in for the FreeRTOS kernel: just the types and calls the code
+ * under test uses. Scheduler state and the current task's number are plain
+ * variables a test can set.
+ */
+
+#ifndef TESTS_STUBS_FREERTOS_H_
+#define TESTS_STUBS_FREERTOS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define taskSCHEDULER_SUSPENDED   0
+#define taskSCHEDULER_NOT_STARTED 1
+#define taskSCHEDULER_RUNNING     2
+
+typedef struct {
+    size_t xAvailableHeapSpaceInBytes;
+    size_t xSizeOfLargestFreeBlockInBytes;
+    size_t xSizeOfSmallestFreeBlockInBytes;
+    size_t xNumberOfFreeBlocks;
+    size_t xMinimumEverFreeBytesRemaining;
+    size_t xNumberOfSuccessfulAllocations;
+    size_t xNumberOfSuccessfulFrees;
+} HeapStats_t;
+
+extern BaseType_t stubSchedulerState;
+extern UBaseType_t stubTaskNumber;
+
+static inline BaseType_t xTaskGetSchedulerState(void) { return stubSchedulerState; }
+static inline TaskHandle_t xTaskGetCurrentTaskHandle(void) { return (TaskHandle_t)&stubTaskNumber; }
+static inline UBaseType_t uxTaskGetTaskNumber(TaskHandle_t task) { (void)task; return stubTaskNumber; }
+static inline void vTaskSetTaskNumber(TaskHandle_t task, UBaseType_t number) { (void)task; stubTaskNumber = number; }
+static inline void vPortGetHeapStats(HeapStats_t* stats) { memset(stats, 0, sizeof(*stats)); }
+
+#endif /* TESTS_STUBS_FREERTOS_H_ */
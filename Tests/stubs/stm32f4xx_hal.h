@@ -0,0 +1,33 @@
+/*
+ * Host stand-in for the HAL: interrupt masking is a no-op on the host, and
+ * the DWT, tick and clock readings are variables a test can set.
+ */
+
+#ifndef TESTS_STUBS_STM32F4XX_HAL_H_
+#define TESTS_STUBS_STM32F4XX_HAL_H_
+
+#include <stdint.h>
+
+static inline uint32_t __get_PRIMASK(void) { return 0; }
+static inline void __set_PRIMASK(uint32_t primask) { (void)primask; }
+static inline void __disable_irq(void) {}
+
+typedef struct { void* Instance; } IWDG_HandleTypeDef;
+
+typedef struct { uint32_t CTRL; uint32_t CYCCNT; } DWT_Type;
+typedef struct { uint32_t DEMCR; } CoreDebug_Type;
+// Defined by the tests that link code reading them
+extern DWT_Type stubDwt;
+extern CoreDebug_Type stubCoreDebug;
+extern uint32_t stubTick;
+extern uint32_t stubHclk;
+
+#define DWT (&stubDwt)
+#define CoreDebug (&stubCoreDebug)
+#define DWT_CTRL_CYCCNTENA_Msk 1u
+#define CoreDebug_DEMCR_TRCENA_Msk (1u << 24)
+
+static inline uint32_t HAL_GetTick(void) { return stubTick; }
+static inline uint32_t HAL_RCC_GetHCLKFreq(void) { return stubHclk; }
+
+#endif /* TESTS_STUBS_STM32F4XX_HAL_H_ */
@@ -0,0 +1,6 @@
+#ifndef TESTS_STUBS_TASK_H_
+#define TESTS_STUBS_TASK_H_
+
+#include "FreeRTOS.h"
+
+#endif /* TESTS_STUBS_TASK_H_ */
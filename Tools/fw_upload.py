@@ -0,0 +1,588 @@
+#!/usr/bin/env python3
+"""Firmware update over the bootloader UART (USART2).
+
+Hold the user button through reset to get the bootloader menu; the
+uploader sends 'u' itself. Frames are [0x5A][type][seq][len][payload][crc32]
+(see fw_update.h). DATA blocks are pipelined: up to a window of blocks is in
+flight. Each ACK carries the first missing block and a bitmap of the blocks
+after it, so only lost blocks are resent. The image must be stamped
+(image_tool.py stamp). The bootloader writes the slot it would not boot
+(see boot_control.h) and names it in INFO; given both builds, the uploader
+sends the one linked for that slot.
+
+    fw_upload.py -p /dev/ttyUSB0 upload DefaultApp.bin             fastest baud rate that passes a probe
+    fw_upload.py -p /dev/ttyUSB0 upload DefaultApp.bin DefaultApp_B.bin
+    fw_upload.py -p /dev/ttyUSB0 upload DefaultApp.bin --baud 921600
+    fw_upload.py sim --size 100000 --error-rate 1e-5               fw_update.c on a simulated link and flash, no hardware
+"""
+
+import argparse
+import ctypes
+import os
+import random
+import struct
+import subprocess
+import sys
+import time
+
+from gateway_protocol import crc32_stm32
+import image_tool
+
+SYNC = 0x5A
+HELLO, BAUD, START, DATA, END, BOOT = 0x01, 0x02, 0x03, 0x04, 0x05, 0x06
+ACK, NAK, INFO, RESULT = 0x81, 0x82, 0x83, 0x84
+NAK_SEQUENCE, NAK_LENGTH, NAK_STATE, NAK_BAUD, NAK_FLASH = range(1, 6)
+NAK_NAMES = {NAK_SEQUENCE: "sequence", NAK_LENGTH: "length", NAK_STATE: "state",
+             NAK_BAUD: "baud", NAK_FLASH: "flash"}
+ACK_BITMAP = struct.Struct("<I")
+BITMAP_BLOCKS = 32
+
+HEADER = struct.Struct("<BBHH")
+INFO_FMT = struct.Struct("<HHB3xIII")
+RESULT_FMT = struct.Struct("<B3xIIII")
+DEFAULT_BAUD = 115200
+BAUD_CANDIDATES = (3000000, 2000000, 1500000, 1000000, 921600, 460800, 230400)
+BAUD_CONFIRM_S = 1.0  # FWU_BAUD_CONFIRM_MS
+PROBE_FRAMES = 4
+ERASE_TIMEOUT_S = 20.0
+ACK_MARGIN_S = 0.03  # programming a block plus USB serial latency
+FLASH_BASE = 0x08000000
+
+
+class UploadError(Exception):
+    pass
+
+
+def build_frame(frame_type, seq, payload=b""):
+    body = struct.pack("<BHH", frame_type, seq, len(payload)) + payload
+    return bytes([SYNC]) + body + struct.pack("<I", crc32_stm32(body))
+
+
+class FrameParser:
+    """Byte-at-a-time parser, the same state machine as fw_update.c."""
+
+    def __init__(self, max_payload=1024):
+        self.max_payload = max_payload
+        self.frame = None
+        self.frames = []
+        self.crc_errors = 0
+
+    def feed_byte(self, byte):
+        """Returns "frame", "crc" or None; complete frames queue up in self.frames."""
+        if self.frame is None:
+            if byte == SYNC:
+                self.frame = bytearray()
+            return None
+        frame = self.frame
+        frame.append(byte)
+        if len(frame) < 5:
+            return None
+        length = frame[3] | frame[4] << 8
+        if length > self.max_payload:
+            self.frame = None
+            return None
+        if len(frame) < 5 + length + 4:
+            return None
+        self.frame = None
+        crc = struct.unpack_from("<I", frame, 5 + length)[0]
+        if crc != crc32_stm32(frame[:5 + length]):
+            self.crc_errors += 1
+            return "crc"
+        self.frames.append((frame[0], frame[1] | frame[2] << 8, bytes(frame[5:5 + length])))
+        return "frame"
+
+    def feed(self, data):
+        for byte in data:
+            self.feed_byte(byte)
+
+
+class SerialLink:
+    def __init__(self, port):
+        import serial  # pyserial, only needed when talking to hardware
+        self.serial = serial.Serial(port, DEFAULT_BAUD, timeout=0.1)
+
+    def now(self):
+        return time.monotonic()
+
+    def sleep(self, seconds):
+        time.sleep(seconds)
+
+    def write(self, data):
+        self.serial.write(data)
+
+    def read(self, timeout):
+        self.serial.timeout = timeout
+        return self.serial.read(self.serial.in_waiting or 1)
+
+    def set_baud(self, baud):
+        self.serial.flush()
+        self.serial.baudrate = baud
+        self.serial.reset_input_buffer()
+
+
+class Uploader:
+    def __init__(self, link, log=print):
+        self.link = link
+        self.log = log
+        self.parser = FrameParser()
+        self.baud = DEFAULT_BAUD
+        self.info = None
+
+    def read_frame(self, timeout):
+        deadline = self.link.now() + timeout
+        while not self.parser.frames:
+            remaining = deadline - self.link.now()
+            if remaining <= 0:
+                return None
+            self.parser.feed(self.link.read(remaining))
+        return self.parser.frames.pop(0)
+
+    def request(self, frame_type, payload, expect, timeout=0.5, retries=3):
+        """Send a control frame, return the payload of the `expect` reply, or None."""
+        for _ in range(retries):
+            self.link.write(build_frame(frame_type, 0, payload))
+            deadline = self.link.now() + timeout
+            while True:
+                frame = self.read_frame(max(0.0, deadline - self.link.now()))
+                if frame is None:
+                    break
+                reply_type, _, reply = frame
+                if reply_type == expect:
+                    return reply
+                if reply_type == NAK:
+                    raise UploadError("NAK %s" % NAK_NAMES.get(reply[0], reply[0]))
+        return None
+
+    def connect(self):
+        self.link.write(b"u")  # menu key; ignored when the update already runs
+        reply = self.request(HELLO, b"", INFO, retries=10)
+        if reply is None:
+            raise UploadError("no answer from the bootloader; hold the user button through reset")
+        version, block, window, max_baud, slot, slot_size = INFO_FMT.unpack(reply)
+        self.info = dict(version=version, block=block, window=window, max_baud=max_baud,
+                         slot=slot, slot_size=slot_size)
+        return self.info
+
+    def probe(self, rng):
+        """Full-size frames at the new rate; one loss in PROBE_FRAMES is tolerated."""
+        failures = 0
+        for _ in range(PROBE_FRAMES):
+            payload = bytes(rng.getrandbits(8) for _ in range(self.info["block"]))
+            if self.request(HELLO, payload, INFO, timeout=0.2, retries=1) is None:
+                failures += 1
+        return failures <= 1
+
+    def negotiate(self, candidates):
+        """Move both ends to the fastest candidate that passes the probe."""
+        rng = random.Random(0)
+        for baud in candidates:
+            if baud > self.info["max_baud"] or baud <= DEFAULT_BAUD:
+                continue
+            try:
+                if self.request(BAUD, struct.pack("<I", baud), ACK) is None:
+                    continue
+            except UploadError:
+                continue
+            self.link.set_baud(baud)
+            # A second BAUD at the new rate commits it; otherwise the bootloader falls back
+            if self.probe(rng) and self.request(BAUD, struct.pack("<I", baud), ACK, timeout=0.2) is not None:
+                self.baud = baud
+                return baud
+            self.log("%d baud unreliable, trying slower" % baud)
+            self.link.sleep(BAUD_CONFIRM_S)
+            self.link.set_baud(DEFAULT_BAUD)
+            self.parser = FrameParser()
+        return DEFAULT_BAUD
+
+    def upload(self, image, window=None):
+        block = self.info["block"]
+        window = min(window or self.info["window"], self.info["window"])
+        blocks = (len(image) + block - 1) // block
+        start = self.link.now()
+        if self.request(START, struct.pack("<I", len(image)), ACK, timeout=ERASE_TIMEOUT_S, retries=2) is None:
+            raise UploadError("no answer to START")
+
+        # Selective repeat. The link keeps order, so once a block is known to
+        # have arrived, every block sent before it and still unacknowledged
+        # was lost. Only a lost last block in flight waits for the timeout.
+        frame_time = (block + 10) * 10 / self.baud
+        ack_timeout = (window + 1) * frame_time + ACK_MARGIN_S
+        base = next_new = 0
+        outstanding = {}  # block -> serial of its latest transmission
+        lost = []
+        done = [False] * blocks
+        serial = stalls = resent = 0
+        transfer_start = self.link.now()
+        while base < blocks:
+            while len(outstanding) < window and (lost or (next_new < blocks and next_new < base + BITMAP_BLOCKS)):
+                if lost:
+                    index = lost.pop(0)
+                    resent += 1
+                else:
+                    index = next_new
+                    next_new += 1
+                self.link.write(build_frame(DATA, index, image[index * block:(index + 1) * block]))
+                outstanding[index] = serial
+                serial += 1
+            frame = self.read_frame(ack_timeout)
+            if frame is None:
+                stalls += 1
+                if stalls > 20:
+                    raise UploadError("no progress at block %d" % base)
+                lost = sorted(set(lost) | set(outstanding))
+                outstanding.clear()
+                continue
+            frame_type, seq, payload = frame
+            if frame_type == NAK:
+                reason = payload[0] if payload else 0
+                raise UploadError("NAK %s at block %d" % (NAK_NAMES.get(reason, reason), seq))
+            if frame_type != ACK or len(payload) != ACK_BITMAP.size:
+                continue
+            bitmap = ACK_BITMAP.unpack(payload)[0]
+            for index in range(base, min(seq, blocks)):
+                done[index] = True
+            for bit in range(BITMAP_BLOCKS):
+                if bitmap >> bit & 1 and seq + 1 + bit < blocks:
+                    done[seq + 1 + bit] = True
+            newest = -1
+            for index in [index for index in outstanding if done[index]]:
+                newest = max(newest, outstanding.pop(index))
+            for index in [index for index, sent_at in outstanding.items() if sent_at < newest]:
+                del outstanding[index]
+                lost.append(index)
+            lost = sorted(index for index in set(lost) if not done[index])
+            if seq > base:
+                stalls = 0
+            base = max(base, seq)
+        transfer = self.link.now() - transfer_start
+
+        reply = self.request(END, b"", RESULT, timeout=1.0)
+        if reply is None:
+            raise UploadError("no answer to END")
+        status, length, erase_ms, transfer_ms, crc_errors = RESULT_FMT.unpack(reply)
+        return dict(status=status, length=length, blocks=blocks, window=window, baud=self.baud,
+                    erase_ms=erase_ms, transfer_ms=transfer_ms, crc_errors=crc_errors, resent=resent,
+                    host_transfer=transfer, total=self.link.now() - start)
+
+    def boot(self):
+        return self.request(BOOT, b"", ACK) is not None
+
+
+def report(stats, log=print):
+    line_rate = stats["baud"] / 10
+    device_rate = stats["length"] / max(stats["transfer_ms"], 1) * 1000
+    log("%d bytes in %d blocks at %d baud, window %d" % (stats["length"], stats["blocks"], stats["baud"], stats["window"]))
+    log("erase %d ms, transfer %d ms: %.1f KB/s, %.0f%% of the line rate"
+        % (stats["erase_ms"], stats["transfer_ms"], device_rate / 1024, 100 * device_rate / line_rate))
+    log("image %s, %d frames failed the CRC, %d blocks resent, %.2f s in total"
+        % (image_tool.STATUS_NAMES[stats["status"]], stats["crc_errors"], stats["resent"], stats["total"]))
+
+
+class SimFlash:
+    """STM32F411 flash: sector erase, programming only clears bits. Typical x32 timings."""
+    BASE = FLASH_BASE
+    SECTORS = ([(FLASH_BASE + i * 0x4000, 0x4000) for i in range(4)] + [(FLASH_BASE + 0x10000, 0x10000)]
+               + [(FLASH_BASE + 0x20000 + i * 0x20000, 0x20000) for i in range(3)])
+    ERASE_S = {0x4000: 0.25, 0x10000: 0.55, 0x20000: 1.0}
+    WORD_PROGRAM_S = 16e-6
+
+    def __init__(self, rng):
+        self.mem = bytearray(rng.getrandbits(8) for _ in range(0x80000))  # an old image
+
+    def erase(self, address, length):
+        seconds = 0.0
+        for start, size in self.SECTORS:
+            if start < address + length and address < start + size:
+                self.mem[start - self.BASE:start - self.BASE + size] = b"\xFF" * size
+                seconds += self.ERASE_S[size]
+        return seconds
+
+    def program(self, address, data):
+        offset = address - self.BASE
+        for i, byte in enumerate(data):
+            self.mem[offset + i] &= byte
+        return len(data) // 4 * self.WORD_PROGRAM_S
+
+
+class FwuSimPorts(ctypes.Structure):
+    """FwuSimPorts in Tests/fwu_sim_port.c."""
+    _fields_ = [
+        ("read", ctypes.CFUNCTYPE(ctypes.c_size_t, ctypes.c_void_p, ctypes.c_size_t)),
+        ("write", ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.c_size_t)),
+        ("max_baud", ctypes.CFUNCTYPE(ctypes.c_uint32)),
+        ("set_baud", ctypes.CFUNCTYPE(ctypes.c_bool, ctypes.c_uint32)),
+        ("millis", ctypes.CFUNCTYPE(ctypes.c_uint32)),
+        ("crc", ctypes.CFUNCTYPE(ctypes.c_uint32, ctypes.c_void_p, ctypes.c_size_t)),
+        ("erase", ctypes.CFUNCTYPE(ctypes.c_bool, ctypes.c_uint32, ctypes.c_uint32)),
+        ("program", ctypes.CFUNCTYPE(ctypes.c_bool, ctypes.c_uint32, ctypes.c_void_p, ctypes.c_size_t)),
+        ("verify", ctypes.CFUNCTYPE(ctypes.c_uint8, ctypes.c_uint32, ctypes.c_uint32)),
+        ("activate", ctypes.CFUNCTYPE(ctypes.c_bool, ctypes.c_uint32)),
+        ("reset", ctypes.CFUNCTYPE(None)),
+    ]
+
+
+def load_state_machine(path=None):
+    """The bootloader's fw_update.c built for the host, rebuilt when it changed."""
+    if path is None:
+        tests = os.path.join(os.path.dirname(os.path.abspath(__file__)), os.pardir, "Tests")
+        subprocess.run(["make", "-s", "-C", tests, "build/libfw_update_sim.so"], check=True)
+        path = os.path.join(tests, "build", "libfw_update_sim.so")
+    lib = ctypes.CDLL(os.path.abspath(path))
+    lib.fw_update_open.argtypes = [ctypes.c_uint32, ctypes.c_uint32]
+    lib.fw_update_poll.restype = ctypes.c_bool
+    lib.fwu_sim_set_ports.argtypes = [ctypes.POINTER(FwuSimPorts)]
+    return lib
+
+
+class SimDevice:
+    """fw_update.c itself on USART2 with PCLK1 at 24 MHz, timed in simulated seconds.
+
+    The state machine is the bootloader's own code; only the fwu_port_*
+    functions are modelled here, and each advances the simulated time by
+    what the hardware would take.
+    """
+    PCLK1 = 24000000
+    RING = 8192
+    FRAME_CPU_S = 30e-6  # CRC and bookkeeping per frame
+
+    def __init__(self, link, rng, lib, slot=image_tool.DEFAULT_ADDRESS, slot_size=image_tool.DEFAULT_SLOT_SIZE):
+        self.link = link
+        self.flash = SimFlash(rng)
+        self.time = 0.0
+        self.baud = DEFAULT_BAUD
+        self.inbox = None
+        self.activated = None
+        self.resets = 0
+        # Kept referenced: C holds the callback pointers
+        self.ports = FwuSimPorts(*(kind(getattr(self, "port_" + name)) for name, kind in FwuSimPorts._fields_))
+        self.lib = lib
+        lib.fwu_sim_set_ports(ctypes.byref(self.ports))
+        lib.fw_update_open(slot, slot_size)
+
+    def receive(self, byte):
+        self.inbox = byte
+        self.lib.fw_update_poll()
+
+    def port_read(self, data, size):
+        if self.inbox is None or size == 0:
+            return 0
+        ctypes.memmove(data, bytes([self.inbox]), 1)
+        self.inbox = None
+        return 1
+
+    def port_write(self, data, length):
+        frame = ctypes.string_at(data, length)
+        self.time += length * 10 / self.baud  # blocking transmit
+        self.link.to_host.append((self.time, frame, self.baud))
+
+    def port_max_baud(self):
+        return self.PCLK1 // 16
+
+    def port_set_baud(self, baud):
+        brr = (self.PCLK1 + baud // 2) // baud
+        if brr < 16 or brr > 0xFFFF or abs(self.PCLK1 // brr - baud) > baud // 50:
+            return False
+        self.baud = baud
+        return True
+
+    def port_millis(self):
+        return int(self.time * 1000) & 0xFFFFFFFF
+
+    def port_crc(self, data, length):
+        self.time += self.FRAME_CPU_S
+        return crc32_stm32(ctypes.string_at(data, length))
+
+    def port_erase(self, address, length):
+        self.time += self.flash.erase(address, length)
+        return True
+
+    def port_program(self, address, words, count):
+        self.time += self.flash.program(address, ctypes.string_at(words, count * 4))
+        return True
+
+    def port_verify(self, address, slot_size):
+        slot = bytes(self.flash.mem[address - SimFlash.BASE:address - SimFlash.BASE + slot_size])
+        return image_tool.verify(slot, address, slot_size)[0]
+
+    def port_activate(self, address):
+        self.activated = address
+        return True
+
+    def port_reset(self):
+        self.resets += 1
+
+
+class SimLink:
+    """Uploader <-> SimDevice over a simulated UART with bit errors.
+
+    Above `link_max_baud` the byte error rate rises to 1%, like a USB-UART
+    bridge pushed past what it handles.
+    """
+
+    def __init__(self, lib, error_rate=0.0, link_max_baud=2000000, seed=1):
+        self.rng = random.Random(seed)
+        self.error_rate = error_rate
+        self.link_max_baud = link_max_baud
+        self.device = SimDevice(self, self.rng, lib)
+        self.clock = 0.0
+        self.baud = DEFAULT_BAUD
+        self.tx_free = 0.0
+        self.to_device = []  # [start, seconds per byte, data, baud]
+        self.position = (0, 0)
+        self.to_host = []    # (time complete, data, baud)
+
+    def now(self):
+        return self.clock
+
+    def sleep(self, seconds):
+        self.clock += seconds
+
+    def set_baud(self, baud):
+        self.baud = baud
+
+    def corrupt(self, data, baud):
+        rate = self.error_rate if baud <= self.link_max_baud else 0.01
+        data = bytearray(data)
+        for i in range(len(data)):
+            if self.rng.random() < rate:
+                data[i] ^= 1 << self.rng.randrange(8)
+        return bytes(data)
+
+    def write(self, data):
+        start = max(self.clock, self.tx_free)
+        byte_time = 10 / self.baud
+        self.tx_free = start + len(data) * byte_time
+        self.to_device.append((start, byte_time, self.corrupt(data, self.baud), self.baud))
+
+    def read(self, timeout):
+        deadline = self.clock + timeout
+        self.run_device(deadline)
+        if self.to_host and self.to_host[0][0] <= deadline:
+            done, data, baud = self.to_host.pop(0)
+            self.clock = max(self.clock, done)
+            if baud != self.baud:
+                return bytes(self.rng.getrandbits(8) for _ in data)
+            return self.corrupt(data, baud)
+        self.clock = deadline
+        return b""
+
+    def run_device(self, until):
+        device = self.device
+        segment, index = self.position
+        while segment < len(self.to_device):
+            start, byte_time, data, baud = self.to_device[segment]
+            arrival = start + (index + 1) * byte_time
+            if arrival > until:
+                break
+            device.time = max(device.time, arrival)
+            byte = data[index] if baud == device.baud else self.rng.getrandbits(8)
+            index += 1
+            if index == len(data):
+                segment, index = segment + 1, 0
+            busy = device.time
+            device.receive(byte)
+            if device.time > busy:
+                segment, index = self.overrun(segment, index, device.time)
+        self.position = (segment, index)
+
+    def overrun(self, segment, index, now):
+        """Bytes beyond the DMA ring while the device was busy are lost."""
+        backlog = []
+        for k in range(segment, len(self.to_device)):
+            start, byte_time, data, _ = self.to_device[k]
+            first = index if k == segment else 0
+            arrived = min(len(data), max(0, int((now - start) / byte_time)))
+            if arrived > first:
+                backlog.append((k, first, arrived))
+        excess = sum(arrived - first for _, first, arrived in backlog) - SimDevice.RING
+        while excess > 0 and backlog:
+            k, first, arrived = backlog.pop(0)
+            skipped = min(excess, arrived - first)
+            excess -= skipped
+            segment, index = k, first + skipped
+            if index == len(self.to_device[k][2]):
+                segment, index = k + 1, 0
+        return segment, index
+
+
+def simulate(lib, size, baud, error_rate, window, link_max_baud, seed, log=print):
+    image = image_tool.stamp(image_tool.make_image(size, seed=seed))
+    link = SimLink(lib, error_rate, link_max_baud, seed)
+    uploader = Uploader(link, log)
+    info = uploader.connect()
+    uploader.negotiate(BAUD_CANDIDATES if baud is None else (baud,))
+    stats = uploader.upload(image, window)
+    written = link.device.flash.mem[info["slot"] - SimFlash.BASE:][:len(image)]
+    assert bytes(written) == image, "flash content differs from the image"
+    assert stats["status"] == image_tool.OK, image_tool.STATUS_NAMES[stats["status"]]
+    assert link.device.activated == info["slot"], "image verified but not made the next to boot"
+    assert uploader.boot() and link.device.resets == 1
+    return stats
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-p", "--port", help="serial port of the bootloader UART (USART2)")
+    sub = parser.add_subparsers(dest="command", required=True)
+    upload = sub.add_parser("upload")
+    upload.add_argument("image", nargs="+", help="stamped .bin, or one per slot")
+    upload.add_argument("--baud", type=int, help="default: fastest that passes a probe")
+    upload.add_argument("--window", type=int, help="blocks in flight, at most what the bootloader offers")
+    upload.add_argument("--no-boot", action="store_true", help="stay in the bootloader afterwards")
+    sim = sub.add_parser("sim")
+    sim.add_argument("--size", type=int, default=100000)
+    sim.add_argument("--baud", type=int, help="default: negotiate")
+    sim.add_argument("--error-rate", type=float, default=1e-5, help="per byte, each direction")
+    sim.add_argument("--window", type=int)
+    sim.add_argument("--link-max-baud", type=int, default=1000000, help="fastest rate the simulated bridge handles")
+    sim.add_argument("--seed", type=int, default=1)
+    sim.add_argument("--lib", help="host build of fw_update.c; default: built with make -C Tests")
+    args = parser.parse_args()
+
+    if args.command == "sim":
+        if args.size < 2048:
+            parser.error("--size must be at least 2048 to hold a vector table and header")
+        lib = load_state_machine(args.lib)
+        stats = simulate(lib, args.size, args.baud, args.error_rate, args.window, args.link_max_baud, args.seed)
+        report(stats)
+        # The same transfer stop-and-wait, to show what the pipelining buys
+        single = simulate(lib, args.size, stats["baud"], args.error_rate, 1, args.link_max_baud, args.seed,
+                          log=lambda *_: None)
+        print("window 1: transfer %d ms, %.1fx slower" % (single["transfer_ms"],
+                                                          single["transfer_ms"] / max(stats["transfer_ms"], 1)))
+        return 0
+
+    if not args.port:
+        parser.error("--port is required for %s" % args.command)
+    images = []
+    for path in args.image:
+        with open(path, "rb") as f:
+            images.append((path, f.read()))
+    uploader = Uploader(SerialLink(args.port))
+    try:
+        info = uploader.connect()
+        image, problems = None, []
+        for path, data in images:
+            status, _ = image_tool.verify(data, info["slot"], info["slot_size"])
+            if status == image_tool.OK:
+                image = data
+                break
+            problems.append("%s: %s" % (path, image_tool.STATUS_NAMES[status]))
+        if image is None:
+            raise UploadError("no image for slot 0x%08X (%s), not uploading" % (info["slot"], "; ".join(problems)))
+        baud = uploader.negotiate(BAUD_CANDIDATES if args.baud is None else (args.baud,))
+        print("bootloader protocol %d, slot 0x%08X, %d baud" % (info["version"], info["slot"], baud))
+        stats = uploader.upload(image, args.window)
+        report(stats)
+        if stats["status"] != image_tool.OK:
+            return 1
+        if not args.no_boot and not uploader.boot():
+            raise UploadError("no answer to BOOT")
+    except UploadError as e:
+        print("update failed: %s" % e, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,607 @@
+#!/usr/bin/env python3
+"""Host side of the SensorGateway binary protocol.
+
+Frames travel on the CLI UART as 0x00 <COBS(frame)> 0x00 where frame is
+[type][sequence][payload][crc32 little-endian]; see binary_protocol.hpp.
+The CRC matches the STM32 CRC unit (HwCrc).
+
+    gateway_protocol.py bench                 offline loopback: text vs binary
+    gateway_protocol.py -p /dev/ttyUSB0 status
+    gateway_protocol.py -p /dev/ttyUSB0 ping --count 1000
+    gateway_protocol.py -p /dev/ttyUSB0 metrics
+    gateway_protocol.py -p /dev/ttyUSB0 stream --seconds 10   after 'stream ...' on the CLI
+    gateway_protocol.py stream-sim --sensors 2 --hz 1000 --batch 15
+    gateway_protocol.py -p /dev/ttyUSB0 boot
+    gateway_protocol.py -p /dev/ttyUSB0 update DefaultApp.bin DefaultApp_B.bin   while the gateway runs
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+PING, GET_STATUS, GET_SENSORS, GET_HISTORY, GET_CONFIG, SET_CONFIG, GET_METRICS = 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07
+GET_BOOT, UPDATE_BEGIN, UPDATE_DATA, UPDATE_END = 0x08, 0x09, 0x0A, 0x0B
+PONG, STATUS, SENSOR_SAMPLES, HISTORY, CONFIG, METRICS = 0x81, 0x82, 0x83, 0x84, 0x85, 0x86
+BOOT_STATE, UPDATE_STATUS = 0x87, 0x88
+SENSOR_PUSH, NACK = 0xC0, 0xFF
+
+CONFIG_KEYS = {
+    "sensorReadInterval": 1,
+    "logLevel": 2,
+    "watchdogTimeout": 3,
+    "maxSensors": 4,
+    "autoStart": 5,
+}
+
+SAMPLE = struct.Struct("<BBBxQf")
+STATUS_FMT = struct.Struct("<BBxxIIIIIIIIII")
+HISTORY_HEADER = struct.Struct("<IIB")
+HISTORY_REQUEST = struct.Struct("<IIB")
+HISTORY_FLAG_LAST = 0x01
+ALL_SENSORS = 0xFF
+CONFIG_FMT = struct.Struct("<IIIIB16s")
+METRICS_REQUEST = struct.Struct("<BB")
+METRICS_HEADER = struct.Struct("<BBBB")
+METRICS_FLAG_DESCRIBE, METRICS_FLAG_LAST = 0x01, 0x80
+COUNTER, GAUGE, HISTOGRAM = 0, 1, 2
+MAX_PAYLOAD = 240
+
+SLOT_ADDRESSES = (0x08004000, 0x08020000)  # boot_control.h
+SLOT_NAMES = ("A", "B")
+IMAGE_MAX_SIZE = 0x1BF00
+BOOT_STATE_HEADER = struct.Struct("<BBxxI")
+SLOT_STATE = struct.Struct("<IIBBxx")
+SLOT_FLAG_IMAGE, SLOT_FLAG_SEQUENCED, SLOT_FLAG_CONFIRMED, SLOT_FLAG_REJECTED = 0x01, 0x02, 0x04, 0x08
+UPDATE_STATES = ("idle", "receiving", "ready")
+UPDATE_STATUS_FMT = struct.Struct("<BBxxI")
+UPDATE_FLAG_REBOOT = 0x01
+UPDATE_OK, UPDATE_BAD_OFFSET = 0, 3
+UPDATE_RESULTS = ("ok", "bad state", "bad length", "bad offset", "flash error", "bad image")
+UPDATE_CHUNK = MAX_PAYLOAD - 4
+ERASE_TIMEOUT = 5.0  # a 128 KB sector takes up to 2 s
+
+
+def _crc_table():
+    table = []
+    for i in range(256):
+        crc = i << 24
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x04C11DB7) if crc & 0x80000000 else (crc << 1)
+        table.append(crc & 0xFFFFFFFF)
+    return table
+
+
+_CRC_TABLE = _crc_table()
+
+
+def crc32_stm32(data):
+    """CRC-32/MPEG-2 over little-endian words, tail zero-padded."""
+    data = bytes(data) + b"\0" * (-len(data) % 4)
+    crc = 0xFFFFFFFF
+    for i in range(0, len(data), 4):
+        # Each word enters most significant byte first
+        for byte in (data[i + 3], data[i + 2], data[i + 1], data[i]):
+            crc = ((crc << 8) & 0xFFFFFFFF) ^ _CRC_TABLE[(crc >> 24) ^ byte]
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray(b"\0")
+    code_pos, code = 0, 1
+    for byte in data:
+        if byte == 0:
+            out[code_pos] = code
+            code_pos, code = len(out), 1
+            out.append(0)
+        else:
+            out.append(byte)
+            code += 1
+            if code == 0xFF:
+                out[code_pos] = code
+                code_pos, code = len(out), 1
+                out.append(0)
+    out[code_pos] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("invalid COBS")
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def build_frame(msg_type, sequence, payload=b""):
+    body = bytes([msg_type, sequence & 0xFF]) + payload
+    return b"\0" + cobs_encode(body + struct.pack("<I", crc32_stm32(body))) + b"\0"
+
+
+def parse_frame(encoded):
+    """Returns (type, sequence, payload) or raises ValueError."""
+    frame = cobs_decode(encoded)
+    if len(frame) < 6:
+        raise ValueError("short frame")
+    body, (crc,) = frame[:-4], struct.unpack("<I", frame[-4:])
+    if crc32_stm32(body) != crc:
+        raise ValueError("bad CRC")
+    return body[0], body[1], body[2:]
+
+
+def unpack_samples(payload):
+    return [dict(sensor=s, type=t, valid=bool(f & 1), timestamp_us=ts, value=v)
+            for s, t, f, ts, v in SAMPLE.iter_unpack(payload)]
+
+
+def parse_metric_records(payload, describe):
+    """Metrics::encode records -> [(type, [uint32], name or None)]."""
+    records, offset = [], 0
+    while offset < len(payload):
+        kind, count = payload[offset], payload[offset + 1]
+        numbers = list(struct.unpack_from("<%dI" % count, payload, offset + 2))
+        offset += 2 + 4 * count
+        name = None
+        if describe:
+            length = payload[offset]
+            name = payload[offset + 1:offset + 1 + length].decode(errors="replace")
+            offset += 1 + length
+        records.append((kind, numbers, name))
+    return records
+
+
+class StreamDemux:
+    """Splits the UART byte stream into text and binary frames."""
+
+    def __init__(self):
+        self.text = bytearray()
+        self.frame = bytearray()
+        self.in_frame = False
+
+    def feed(self, data):
+        frames = []
+        for byte in data:
+            if not self.in_frame:
+                if byte == 0:
+                    self.in_frame, self.frame = True, bytearray()
+                else:
+                    self.text.append(byte)
+            elif byte != 0:
+                self.frame.append(byte)
+            elif self.frame:
+                frames.append(bytes(self.frame))
+                self.in_frame = False
+        return frames
+
+
+def frame_wire_size(payload_len):
+    frame = 2 + payload_len + 4
+    return frame + frame // 254 + 1 + 2
+
+
+def stream_sim(sensors, sensor_hz, rate_hz, batch, queue_size, baudrate, policy,
+               batch_timeout=0.05, seconds=10.0, step=1e-4):
+    """Time-stepped model of SensorStreamer: decimation -> bounded queue ->
+    batching stream task -> blocking UART transmit. Returns a stats dict."""
+    period = 1.0 / sensor_hz
+    interval = 1.0 / rate_hz if rate_hz else 0.0
+    next_sample = [i * period / sensors for i in range(sensors)]
+    last_sent = [-1e9] * sensors
+    aggregate = [0] * sensors
+    queue = 0
+    pending = 0
+    batch_started = None
+    link_free_at = 0.0
+    st = dict(produced=0, forwarded=0, dropped=0, aggregated=0, sent=0, frames=0, wire_bytes=0)
+
+    t = 0.0
+    while t < seconds:
+        for s in range(sensors):
+            while next_sample[s] <= t:
+                st["produced"] += 1
+                if next_sample[s] - last_sent[s] >= interval:
+                    last_sent[s] = next_sample[s]
+                    st["forwarded"] += 1
+                    if queue < queue_size:
+                        queue += 1
+                    elif policy == "aggregate":
+                        aggregate[s] += 1
+                        st["aggregated"] += 1
+                    else:
+                        st["dropped"] += 1
+                next_sample[s] += period
+
+        # Stream task runs whenever the blocking transmit has returned
+        while t >= link_free_at:
+            if queue:
+                queue -= 1
+                pending += 1
+            elif any(aggregate):
+                s = next(i for i, n in enumerate(aggregate) if n)
+                aggregate[s] = 0
+                pending += 1
+            if pending and batch_started is None:
+                batch_started = t
+            if pending and (pending >= batch or t - batch_started >= batch_timeout):
+                size = frame_wire_size(pending * SAMPLE.size)
+                link_free_at = t + size * 10.0 / baudrate
+                st["sent"] += pending
+                st["frames"] += 1
+                st["wire_bytes"] += size
+                pending, batch_started = 0, None
+                continue
+            if not queue:
+                break
+        t += step
+    return st
+
+
+def run_stream_sim(args):
+    print("sensors %d x %d Hz, decimated to %s Hz, batch %d, queue %d, %d baud, %s"
+          % (args.sensors, args.hz, args.rate or "all", args.batch, args.queue, args.baudrate, args.policy))
+    st = stream_sim(args.sensors, args.hz, args.rate, args.batch, args.queue, args.baudrate,
+                    args.policy, seconds=args.seconds)
+    seconds = args.seconds
+    print("produced   %8.0f samples/s" % (st["produced"] / seconds))
+    print("forwarded  %8.0f samples/s after decimation" % (st["forwarded"] / seconds))
+    print("delivered  %8.0f samples/s in %.0f frames/s, %.1f wire bytes/sample, link %.0f%% busy"
+          % (st["sent"] / seconds, st["frames"] / seconds, st["wire_bytes"] / max(st["sent"], 1),
+             100.0 * st["wire_bytes"] * 10 / args.baudrate / seconds))
+    print("dropped    %8.0f samples/s, aggregated %.0f samples/s" %
+          (st["dropped"] / seconds, st["aggregated"] / seconds))
+
+
+def listen_stream(gateway, seconds):
+    """Counts SENSOR_PUSH traffic started with the CLI 'stream' command."""
+    samples = frames = gaps = 0
+    last_seq = None
+    deadline = time.monotonic() + seconds
+    while time.monotonic() < deadline:
+        for encoded in gateway.demux.feed(gateway.serial.read(4096)):
+            try:
+                msg_type, seq, payload = parse_frame(encoded)
+            except ValueError:
+                continue
+            if msg_type != SENSOR_PUSH:
+                continue
+            if last_seq is not None and seq != (last_seq + 1) & 0xFF:
+                gaps += 1
+            last_seq = seq
+            frames += 1
+            samples += len(payload) // SAMPLE.size
+    print("%.0f samples/s in %.0f frames/s, %d sequence gaps" % (samples / seconds, frames / seconds, gaps))
+
+
+class Gateway:
+    def __init__(self, port, baudrate=921600, timeout=1.0):
+        import serial  # pyserial, only needed when talking to hardware
+        self.serial = serial.Serial(port, baudrate, timeout=0.05)
+        self.timeout = timeout
+        self.demux = StreamDemux()
+        self.sequence = 0
+        self.pushes = []
+
+    def request(self, msg_type, payload=b"", responses=1):
+        self.sequence = (self.sequence + 1) & 0xFF
+        self.serial.write(build_frame(msg_type, self.sequence, payload))
+        replies = []
+        deadline = time.monotonic() + self.timeout
+        while len(replies) < responses and time.monotonic() < deadline:
+            for encoded in self.demux.feed(self.serial.read(512)):
+                try:
+                    reply = parse_frame(encoded)
+                except ValueError:
+                    continue
+                if reply[0] == SENSOR_PUSH:
+                    self.pushes.append(reply)
+                elif reply[1] == self.sequence:
+                    if reply[0] == NACK:
+                        raise RuntimeError("NACK reason %d" % reply[2][0])
+                    replies.append(reply)
+                    # Multi-frame replies only time out when the link goes quiet
+                    deadline = time.monotonic() + self.timeout
+                    if reply[0] == HISTORY and HISTORY_HEADER.unpack_from(reply[2])[2] & HISTORY_FLAG_LAST:
+                        responses = len(replies)
+                    if reply[0] == METRICS and METRICS_HEADER.unpack_from(reply[2])[3] & METRICS_FLAG_LAST:
+                        responses = len(replies)
+        if len(replies) < responses:
+            raise TimeoutError("no reply to type 0x%02x" % msg_type)
+        return replies
+
+    def ping(self, payload=b""):
+        return self.request(PING, payload)[0][2]
+
+    def status(self):
+        fields = STATUS_FMT.unpack(self.request(GET_STATUS)[0][2])
+        names = ("state", "cpuUsage", "upTime", "freeHeap", "totalSensors", "activeSensors",
+                 "errorCount", "rxBytes", "rxDropped", "rxOverruns", "framesReceived", "frameErrors")
+        return dict(zip(names, fields))
+
+    def sensors(self):
+        return unpack_samples(self.request(GET_SENSORS)[0][2])
+
+    def history(self, from_sequence=0, sensor=ALL_SENSORS, max_entries=0):
+        """Returns (samples, resume_sequence); pass resume_sequence back in to
+        continue an interrupted export without repeating samples."""
+        samples = []
+        resume = from_sequence
+        payload = HISTORY_REQUEST.pack(from_sequence, max_entries, sensor)
+        for _, _, reply in self.request(GET_HISTORY, payload, responses=1 << 16):
+            _, resume, _ = HISTORY_HEADER.unpack_from(reply)
+            samples += unpack_samples(reply[HISTORY_HEADER.size:])
+        return samples, resume
+
+    def metrics(self):
+        """Returns [dict(name, type, value)]; histograms get bounds, buckets
+        (not cumulative, the last one unbounded) and sum instead of value."""
+        described = []
+        for _, _, reply in self.request(GET_METRICS, METRICS_REQUEST.pack(0, METRICS_FLAG_DESCRIBE), responses=256):
+            described += parse_metric_records(reply[METRICS_HEADER.size:], describe=True)
+        values = []
+        for _, _, reply in self.request(GET_METRICS, METRICS_REQUEST.pack(0, 0), responses=256):
+            values += parse_metric_records(reply[METRICS_HEADER.size:], describe=False)
+
+        metrics = []
+        for (kind, bounds, name), (_, numbers, _) in zip(described, values):
+            if kind == HISTOGRAM:
+                metrics.append(dict(name=name, type=kind, bounds=bounds, buckets=numbers[:-1], sum=numbers[-1]))
+            else:
+                value = numbers[0] - (1 << 32) if kind == GAUGE and numbers[0] & 0x80000000 else numbers[0]
+                metrics.append(dict(name=name, type=kind, value=value))
+        return metrics
+
+    def config(self):
+        return self._unpack_config(self.request(GET_CONFIG)[0][2])
+
+    def set_config(self, key, value):
+        payload = struct.pack("<BI", CONFIG_KEYS[key], value)
+        return self._unpack_config(self.request(SET_CONFIG, payload)[0][2])
+
+    def boot_state(self):
+        payload = self.request(GET_BOOT)[0][2]
+        running, update_state, next_offset = BOOT_STATE_HEADER.unpack_from(payload)
+        slots = []
+        for version, sequence, flags, attempts in SLOT_STATE.iter_unpack(payload[BOOT_STATE_HEADER.size:]):
+            slots.append(dict(version=version, sequence=sequence, attempts=attempts,
+                              image=bool(flags & SLOT_FLAG_IMAGE), sequenced=bool(flags & SLOT_FLAG_SEQUENCED),
+                              confirmed=bool(flags & SLOT_FLAG_CONFIRMED), rejected=bool(flags & SLOT_FLAG_REJECTED)))
+        return dict(running=running, update=UPDATE_STATES[update_state], next_offset=next_offset, slots=slots)
+
+    def _update_request(self, msg_type, payload):
+        result, slot, next_offset = UPDATE_STATUS_FMT.unpack(self.request(msg_type, payload)[0][2])
+        return result, slot, next_offset
+
+    def update(self, images, reboot=True, log=print):
+        """Writes the image linked for the slot not running while the gateway
+        keeps working, then reboots into it on trial. images is a list of
+        (name, bytes); the one that verifies for the target slot is sent."""
+        import image_tool
+        target = 1 - self.boot_state()["running"]
+        image = None
+        for name, data in images:
+            if image_tool.verify(data, SLOT_ADDRESSES[target], IMAGE_MAX_SIZE)[0] == image_tool.OK:
+                image = data
+                log("slot %s: %s, %d bytes" % (SLOT_NAMES[target], name, len(data)))
+                break
+        if image is None:
+            raise RuntimeError("no image linked for slot %s" % SLOT_NAMES[target])
+
+        # BEGIN only erases, so it is simply sent again after a lost reply
+        timeout, self.timeout = self.timeout, ERASE_TIMEOUT
+        try:
+            for attempt in range(3):
+                try:
+                    result, _, _ = self._update_request(UPDATE_BEGIN, struct.pack("<I", len(image)))
+                    break
+                except TimeoutError:
+                    if attempt == 2:
+                        raise
+        finally:
+            self.timeout = timeout
+        if result != UPDATE_OK:
+            raise RuntimeError("UPDATE_BEGIN: %s" % UPDATE_RESULTS[result])
+
+        # Stop and wait: the device programs each chunk before it answers
+        start = time.monotonic()
+        offset = 0
+        while offset < len(image):
+            payload = struct.pack("<I", offset) + image[offset:offset + UPDATE_CHUNK]
+            try:
+                result, _, next_offset = self._update_request(UPDATE_DATA, payload)
+            except TimeoutError:
+                continue  # resent; a chunk already written is accepted again
+            if result == UPDATE_BAD_OFFSET:
+                offset = next_offset
+            elif result != UPDATE_OK:
+                raise RuntimeError("UPDATE_DATA at %d: %s" % (offset, UPDATE_RESULTS[result]))
+            else:
+                offset = next_offset
+        elapsed = time.monotonic() - start
+        log("%d bytes in %.1f s, %.1f KB/s" % (len(image), elapsed, len(image) / 1024 / max(elapsed, 1e-3)))
+
+        # A second END would find the update finished, so after a timeout
+        # END is only resent while the device is still receiving
+        for _ in range(3):
+            try:
+                result, _, _ = self._update_request(UPDATE_END, bytes([UPDATE_FLAG_REBOOT if reboot else 0]))
+                if result != UPDATE_OK:
+                    raise RuntimeError("UPDATE_END: %s" % UPDATE_RESULTS[result])
+                break
+            except TimeoutError:
+                try:
+                    if self.boot_state()["update"] != "receiving":
+                        break
+                except TimeoutError:
+                    break  # rebooting
+        if not reboot:
+            if self.boot_state()["update"] != "ready":
+                raise RuntimeError("UPDATE_END: no answer and the update is not ready")
+            log("slot %s boots on the next reset" % SLOT_NAMES[target])
+            return
+
+        # Downtime: from the reboot request to the first answer of the new image
+        reset = time.monotonic()
+        while True:
+            try:
+                state = self.boot_state()
+                break
+            except (TimeoutError, RuntimeError):
+                if time.monotonic() - reset > 30:
+                    raise TimeoutError("no answer after the reboot")
+        if state["running"] != target:
+            raise RuntimeError("still running slot %s" % SLOT_NAMES[state["running"]])
+        slot = state["slots"][target]
+        log("running slot %s after %.1f s, %s" % (SLOT_NAMES[state["running"]], time.monotonic() - reset,
+                                                  "on trial" if slot["sequenced"] and not slot["confirmed"]
+                                                  else "confirmed"))
+
+    @staticmethod
+    def _unpack_config(payload):
+        interval, level, watchdog, max_sensors, auto_start, name = CONFIG_FMT.unpack(payload)
+        return dict(sensorReadInterval=interval, logLevel=level, watchdogTimeout=watchdog,
+                    maxSensors=max_sensors, autoStart=bool(auto_start),
+                    deviceName=name.rstrip(b"\0").decode(errors="replace"))
+
+
+def bench(samples_total=20000):
+    """Loopback comparison of the text 'sensors' output and binary frames."""
+    samples = [(1 + i % 2, 0, 1, 1000000 + i * 1000, 20.0 + (i % 100) * 0.0625)
+               for i in range(samples_total)]
+
+    # Text: what SensorsCommand prints, parsed back the way a scraper would
+    start = time.perf_counter()
+    text = "".join("  Sensor %d (TEMP): %.4f [%d.%06d]\r\n" % (s, v, ts // 1000000, ts % 1000000)
+                   for s, _, _, ts, v in samples).encode()
+    parsed = 0
+    for line in text.decode().splitlines():
+        head, _, stamp = line.partition("[")
+        float(head.split(":")[1])
+        float(stamp.rstrip("]"))
+        parsed += 1
+    text_time = time.perf_counter() - start
+
+    # Binary: SENSOR_PUSH frames of as many samples as fit, through the demux
+    per_frame = MAX_PAYLOAD // SAMPLE.size
+    start = time.perf_counter()
+    wire = bytearray()
+    for seq, i in enumerate(range(0, samples_total, per_frame)):
+        payload = b"".join(SAMPLE.pack(*s) for s in samples[i:i + per_frame])
+        wire += build_frame(SENSOR_PUSH, seq, payload)
+    decoded = 0
+    demux = StreamDemux()
+    for encoded in demux.feed(wire):
+        decoded += len(unpack_samples(parse_frame(encoded)[2]))
+    binary_time = time.perf_counter() - start
+
+    assert parsed == decoded == samples_total
+    print("samples:           %d" % samples_total)
+    print("text bytes/sample:   %.1f  (%.0f samples/s at 115200 baud)"
+          % (len(text) / samples_total, 11520 / (len(text) / samples_total)))
+    print("binary bytes/sample: %.1f  (%.0f samples/s at 115200 baud)"
+          % (len(wire) / samples_total, 11520 / (len(wire) / samples_total)))
+    print("host encode+decode:  text %.1f us/sample, binary %.1f us/sample (python, incl. software CRC)"
+          % (text_time * 1e6 / samples_total, binary_time * 1e6 / samples_total))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-p", "--port", help="serial port of the CLI UART")
+    parser.add_argument("-b", "--baudrate", type=int, default=921600)
+    sub = parser.add_subparsers(dest="command", required=True)
+    sub.add_parser("bench")
+    sim = sub.add_parser("stream-sim")
+    sim.add_argument("--sensors", type=int, default=2)
+    sim.add_argument("--hz", type=int, default=1000, help="sample rate per sensor")
+    sim.add_argument("--rate", type=int, default=0, help="stream decimation rate, 0 = every sample")
+    sim.add_argument("--batch", type=int, default=15)
+    sim.add_argument("--queue", type=int, default=16)
+    sim.add_argument("--policy", choices=("drop", "aggregate"), default="drop")
+    sim.add_argument("--seconds", type=float, default=5.0)
+    stream = sub.add_parser("stream")
+    stream.add_argument("--seconds", type=float, default=10.0)
+    ping = sub.add_parser("ping")
+    ping.add_argument("--count", type=int, default=1)
+    sub.add_parser("status")
+    sub.add_parser("sensors")
+    history = sub.add_parser("history")
+    history.add_argument("--max", type=int, default=0)
+    history.add_argument("--from", dest="from_sequence", type=int, default=0,
+                         help="resume sequence printed by a previous export")
+    history.add_argument("--sensor", type=int, default=ALL_SENSORS)
+    sub.add_parser("metrics")
+    sub.add_parser("config")
+    set_config = sub.add_parser("set")
+    set_config.add_argument("key", choices=sorted(CONFIG_KEYS))
+    set_config.add_argument("value", type=int)
+    sub.add_parser("boot")
+    update = sub.add_parser("update")
+    update.add_argument("image", nargs="+", help="stamped .bin per slot; the one for the free slot is sent")
+    update.add_argument("--no-reboot", action="store_true", help="boot the update on the next reset")
+    args = parser.parse_args()
+
+    if args.command == "bench":
+        bench()
+        return 0
+    if args.command == "stream-sim":
+        run_stream_sim(args)
+        return 0
+    if not args.port:
+        parser.error("--port is required for %s" % args.command)
+
+    gateway = Gateway(args.port, args.baudrate)
+    if args.command == "ping":
+        start = time.perf_counter()
+        for i in range(args.count):
+            gateway.ping(struct.pack("<I", i))
+        elapsed = time.perf_counter() - start
+        print("%d round trips, %.0f messages/s" % (args.count, args.count / elapsed))
+    elif args.command == "status":
+        print(gateway.status())
+    elif args.command == "sensors":
+        for sample in gateway.sensors():
+            print(sample)
+    elif args.command == "history":
+        samples, resume = gateway.history(args.from_sequence, args.sensor, args.max)
+        for sample in samples:
+            print(sample)
+        print("# next %d" % resume)
+    elif args.command == "stream":
+        listen_stream(gateway, args.seconds)
+    elif args.command == "metrics":
+        for metric in gateway.metrics():
+            if metric["type"] == HISTOGRAM:
+                labels = ["<=%d" % bound for bound in metric["bounds"]] + ["more"]
+                buckets = " ".join("%s:%d" % pair for pair in zip(labels, metric["buckets"]))
+                print("%-32s %s sum %d" % (metric["name"], buckets, metric["sum"]))
+            else:
+                print("%-32s %d" % (metric["name"], metric["value"]))
+    elif args.command == "config":
+        print(gateway.config())
+    elif args.command == "set":
+        print(gateway.set_config(args.key, args.value))
+    elif args.command == "boot":
+        state = gateway.boot_state()
+        for index, slot in enumerate(state["slots"]):
+            version = "v%d.%d.%d" % (slot["version"] >> 16, (slot["version"] >> 8) & 0xFF, slot["version"] & 0xFF)
+            status = ("rejected" if slot["rejected"] else "confirmed" if slot["confirmed"] else
+                      "on trial, %d boots used" % slot["attempts"] if slot["sequenced"] else "no sequence")
+            print("slot %s%s: %s, sequence %d, %s" % (SLOT_NAMES[index], " (running)" if index == state["running"] else "",
+                                                      version if slot["image"] else "no image", slot["sequence"], status))
+        print("update: %s, %d bytes received" % (state["update"], state["next_offset"]))
+    elif args.command == "update":
+        images = []
+        for path in args.image:
+            with open(path, "rb") as f:
+                images.append((path, f.read()))
+        gateway.update(images, reboot=not args.no_reboot)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
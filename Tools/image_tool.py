@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+"""Stamp and check SensorGateway firmware images for the bootloader.
+
+The application links an ImageHeader (image_header.h) 0x200 bytes into the
+image with magic and version set. After the build, `stamp` fills in length,
+CRC and entry point in the raw binary; the bootloader refuses any image
+whose header does not match. The CRC is the STM32 hardware CRC of the
+whole image with the 32-byte header left out.
+
+    arm-none-eabi-objcopy -O binary DefaultApp.elf DefaultApp.bin
+    image_tool.py stamp DefaultApp.bin               in place, or -o out.bin
+    image_tool.py verify DefaultApp.bin              same checks as the bootloader
+    image_tool.py verify DefaultApp_B.bin --address 0x08020000   built for slot B
+    image_tool.py selftest                           header generation and verification
+"""
+
+import argparse
+import random
+import struct
+import sys
+
+from gateway_protocol import crc32_stm32
+
+HEADER_OFFSET = 0x200
+HEADER = struct.Struct("<IIIII12x")
+MAGIC = 0x4D494753
+UNSTAMPED = 0xFFFFFFFF
+
+# Slots of boot_control.h; an image may use either slot but its boot trailer
+DEFAULT_ADDRESS = 0x08004000
+SLOT_B_ADDRESS = 0x08020000
+DEFAULT_SLOT_SIZE = 0x1BF00
+RAM_START, RAM_END = 0x20000000, 0x20020000
+
+# ImageStatus in the bootloader's image_check.h
+OK, NO_HEADER, BAD_LENGTH, BAD_STACK, BAD_ENTRY, BAD_CRC = range(6)
+STATUS_NAMES = ("ok", "no image header", "bad length", "bad stack pointer", "bad entry point", "CRC mismatch")
+
+
+class ImageError(Exception):
+    pass
+
+
+def image_crc(image):
+    header_end = HEADER_OFFSET + HEADER.size
+    return crc32_stm32(image[:HEADER_OFFSET] + image[header_end:])
+
+
+def format_version(version):
+    return "%d.%d.%d" % (version >> 16, (version >> 8) & 0xFF, version & 0xFF)
+
+
+def parse_version(text):
+    major, minor, patch = (int(part) for part in text.split("."))
+    return major << 16 | minor << 8 | patch
+
+
+def stamp(image, slot_size=DEFAULT_SLOT_SIZE, version=None):
+    """Return the image padded to whole words with its header filled in."""
+    image = bytearray(image) + b"\xFF" * (-len(image) % 4)
+    if len(image) < HEADER_OFFSET + HEADER.size:
+        raise ImageError("image is %d bytes, too short for a header" % len(image))
+    magic, linked_version, _, _, _ = HEADER.unpack_from(image, HEADER_OFFSET)
+    if magic != MAGIC:
+        raise ImageError("no header at 0x%X: is the image linked with the .image_header section?"
+                         % HEADER_OFFSET)
+    if len(image) > slot_size:
+        raise ImageError("image is %d bytes, the slot holds %d" % (len(image), slot_size))
+    entry = struct.unpack_from("<I", image, 4)[0]
+    HEADER.pack_into(image, HEADER_OFFSET, MAGIC, linked_version if version is None else version,
+                     len(image), 0, entry)
+    crc = image_crc(image)
+    HEADER.pack_into(image, HEADER_OFFSET, MAGIC, linked_version if version is None else version,
+                     len(image), crc, entry)
+    return bytes(image)
+
+
+def verify(image, address=DEFAULT_ADDRESS, slot_size=DEFAULT_SLOT_SIZE):
+    """Run the bootloader's checks on an image as it would sit in its slot.
+
+    `image` may be longer than the stamped length, like a dump of the whole slot.
+    Returns (status, header fields).
+    """
+    if len(image) < HEADER_OFFSET + HEADER.size:
+        return NO_HEADER, None
+    fields = HEADER.unpack_from(image, HEADER_OFFSET)
+    magic, _, length, crc, entry = fields
+    if magic != MAGIC:
+        return NO_HEADER, fields
+    if length < HEADER_OFFSET + HEADER.size or length > slot_size or length % 4 or length > len(image):
+        return BAD_LENGTH, fields
+    stack, reset = struct.unpack_from("<II", image, 0)
+    if not RAM_START < stack <= RAM_END or stack % 4:
+        return BAD_STACK, fields
+    code = entry & ~1
+    if (entry != reset or not entry & 1 or code < address + HEADER_OFFSET + HEADER.size
+            or code >= address + length):
+        return BAD_ENTRY, fields
+    if image_crc(image[:length]) != crc:
+        return BAD_CRC, fields
+    return OK, fields
+
+
+def make_image(size, address=DEFAULT_ADDRESS, seed=1):
+    """A linked but unstamped image: vector table, header, random code."""
+    rng = random.Random(seed)
+    image = bytearray(rng.getrandbits(8) for _ in range(size))
+    struct.pack_into("<II", image, 0, RAM_END, address + 0x401)
+    HEADER.pack_into(image, HEADER_OFFSET, MAGIC, 0x010203, UNSTAMPED, UNSTAMPED, UNSTAMPED)
+    return image
+
+
+def selftest():
+    """Header generation and verification against known-bad images."""
+    cases = 0
+
+    def check(name, image, expected, **kwargs):
+        nonlocal cases
+        status, _ = verify(image, **kwargs)
+        assert status == expected, "%s: %s, expected %s" % (name, STATUS_NAMES[status], STATUS_NAMES[expected])
+        cases += 1
+
+    # The CRC matches the bitwise definition of the STM32 unit (see hw_crc.hpp)
+    def reference_crc(data):
+        crc = 0xFFFFFFFF
+        for i in range(0, len(data), 4):
+            crc ^= struct.unpack_from("<I", data, i)[0]
+            for _ in range(32):
+                crc = ((crc << 1) ^ 0x04C11DB7 if crc & 0x80000000 else crc << 1) & 0xFFFFFFFF
+        return crc
+    sample = bytes(random.Random(7).getrandbits(8) for _ in range(256))
+    assert crc32_stm32(sample) == reference_crc(sample)
+
+    good = stamp(make_image(40000))
+    fields = HEADER.unpack_from(good, HEADER_OFFSET)
+    assert fields[0] == MAGIC and fields[1] == 0x010203 and fields[2] == 40000
+    assert fields[4] == DEFAULT_ADDRESS + 0x401
+    check("stamped", good, OK)
+    check("slot dump", good + b"\xFF" * 4096, OK)
+    assert stamp(good) == good, "restamping changes the image"
+
+    odd = stamp(make_image(40001))
+    assert len(odd) == 40004 and odd[-3:] == b"\xFF" * 3
+    check("padded to words", odd, OK)
+    assert HEADER.unpack_from(stamp(make_image(4096), version=parse_version("2.5.1")), HEADER_OFFSET)[1] == 0x020501
+
+    # Every byte outside the header is covered, a damaged crc field fails the compare
+    for offset in (0, 8, HEADER_OFFSET - 1, HEADER_OFFSET + HEADER.size, len(good) // 2, len(good) - 1):
+        damaged = bytearray(good)
+        damaged[offset] ^= 0x01
+        expected = BAD_CRC if offset >= 8 else (BAD_STACK if offset < 4 else BAD_ENTRY)
+        check("bit flip at %d" % offset, damaged, expected)
+    damaged = bytearray(good)
+    damaged[HEADER_OFFSET + 12] ^= 0x01
+    check("crc field", damaged, BAD_CRC)
+
+    check("erased slot", b"\xFF" * 4096, NO_HEADER)
+    check("unstamped", make_image(4096), BAD_LENGTH)
+    check("truncated", good[:-4], BAD_LENGTH)
+    check("larger than slot", stamp(make_image(8192), slot_size=8192), BAD_LENGTH, slot_size=4096)
+    try:
+        stamp(make_image(8192), slot_size=4096)
+        raise AssertionError("stamped an image larger than its slot")
+    except ImageError:
+        pass
+    try:
+        stamp(b"\xFF" * 4096)
+        raise AssertionError("stamped an image without a header")
+    except ImageError:
+        pass
+
+    stack = bytearray(make_image(4096))
+    struct.pack_into("<I", stack, 0, 0x20020004)
+    check("stack past RAM", stamp(stack), BAD_STACK)
+    entry = bytearray(make_image(4096))
+    struct.pack_into("<I", entry, 4, DEFAULT_ADDRESS + 0x10001)
+    check("entry outside image", stamp(entry), BAD_ENTRY)
+    struct.pack_into("<I", entry, 4, DEFAULT_ADDRESS + 0x400)
+    check("entry not thumb", stamp(entry), BAD_ENTRY)
+    check("wrong slot", good, BAD_ENTRY, address=SLOT_B_ADDRESS)
+    slot_b = stamp(make_image(4096, address=SLOT_B_ADDRESS))
+    check("slot B", slot_b, OK, address=SLOT_B_ADDRESS)
+    check("slot B image in slot A", slot_b, BAD_ENTRY)
+
+    print("selftest: %d cases passed" % cases)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+    stamp_cmd = sub.add_parser("stamp")
+    stamp_cmd.add_argument("image")
+    stamp_cmd.add_argument("-o", "--output", help="default: overwrite the input")
+    stamp_cmd.add_argument("--version", type=parse_version, help="major.minor.patch, default: as linked")
+    stamp_cmd.add_argument("--slot-size", type=lambda text: int(text, 0), default=DEFAULT_SLOT_SIZE)
+    verify_cmd = sub.add_parser("verify")
+    verify_cmd.add_argument("image")
+    verify_cmd.add_argument("--address", type=lambda text: int(text, 0), default=DEFAULT_ADDRESS)
+    verify_cmd.add_argument("--slot-size", type=lambda text: int(text, 0), default=DEFAULT_SLOT_SIZE)
+    sub.add_parser("selftest")
+    args = parser.parse_args()
+
+    if args.command == "selftest":
+        selftest()
+        return 0
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    if args.command == "stamp":
+        try:
+            image = stamp(image, args.slot_size, args.version)
+        except ImageError as e:
+            print("%s: %s" % (args.image, e), file=sys.stderr)
+            return 1
+        with open(args.output or args.image, "wb") as f:
+            f.write(image)
+        _, version, length, crc, entry = HEADER.unpack_from(image, HEADER_OFFSET)
+        print("v%s, %d bytes, crc 0x%08X, entry 0x%08X" % (format_version(version), length, crc, entry))
+        return 0
+
+    status, fields = verify(image, args.address, args.slot_size)
+    if status != OK:
+        print("%s: %s" % (args.image, STATUS_NAMES[status]))
+        return 1
+    _, version, length, crc, entry = fields
+    print("%s: ok, v%s, %d bytes, crc 0x%08X" % (args.image, format_version(version), length, crc))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
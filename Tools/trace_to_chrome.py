@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""Convert a `trace dump` from the SensorGateway CLI to Chrome trace JSON.
+
+The dump is text: '#' header lines naming tasks and queues, then one event
+per line as "<cycles> <event> <task> <arg>" in hex; see trace_recorder.hpp.
+Open the output in chrome://tracing or https://ui.perfetto.dev.
+
+    trace_to_chrome.py -i dump.txt -o trace.json
+    trace_to_chrome.py -p /dev/ttyUSB0 -o trace.json    runs 'trace dump' itself
+"""
+
+import argparse
+import json
+import sys
+import time
+
+# TraceEvent in trace_recorder.hpp
+TASK_SWITCHED_IN, TASK_SWITCHED_OUT = 1, 2
+QUEUE_SEND, QUEUE_SEND_FAILED, QUEUE_RECEIVE, QUEUE_RECEIVE_FAILED = 3, 4, 5, 6
+QUEUE_SEND_FROM_ISR, QUEUE_RECEIVE_FROM_ISR = 7, 8
+ISR_ENTER, ISR_EXIT = 9, 10
+
+QUEUE_EVENTS = {
+    QUEUE_SEND: "send",
+    QUEUE_SEND_FAILED: "send failed",
+    QUEUE_RECEIVE: "receive",
+    QUEUE_RECEIVE_FAILED: "receive failed",
+    QUEUE_SEND_FROM_ISR: "send from ISR",
+    QUEUE_RECEIVE_FROM_ISR: "receive from ISR",
+}
+
+PID = 1
+ISR_TID = 1000  # interrupts get their own row
+
+
+def parse_dump(lines):
+    """Returns (hz, tasks, queues, events) with cycle counts unwrapped."""
+    hz = 96000000
+    tasks, queues, events = {}, {}, []
+    last, high = None, 0
+    for line in lines:
+        line = line.strip()
+        if not line:
+            continue
+        if line.startswith("#"):
+            words = line[1:].split(None, 2)
+            if words and words[0] == "trace":
+                for word in words[1:]:
+                    for item in word.split():
+                        key, _, value = item.partition("=")
+                        if key == "hz":
+                            hz = int(value)
+            elif len(words) == 3 and words[0] == "task":
+                tasks[int(words[1])] = words[2]
+            elif len(words) == 3 and words[0] == "queue":
+                queues[int(words[1])] = words[2]
+            elif words and words[0] == "end":
+                break
+            continue
+        try:
+            cycles, event, task, arg = (int(field, 16) for field in line.split())
+        except ValueError:
+            continue  # CLI echo or prompt
+        # CYCCNT is 32 bits; events are never a whole wrap (~44 s) apart
+        if last is not None and cycles < last:
+            high += 1 << 32
+        last = cycles
+        events.append((high + cycles, event, task, arg))
+    return hz, tasks, queues, events
+
+
+def to_chrome(hz, tasks, queues, events):
+    def us(cycles):
+        return (cycles - origin) * 1e6 / hz
+
+    trace = [{"ph": "M", "pid": PID, "name": "process_name", "args": {"name": "SensorGateway"}},
+             {"ph": "M", "pid": PID, "tid": ISR_TID, "name": "thread_name", "args": {"name": "interrupts"}}]
+    for number, name in tasks.items():
+        trace.append({"ph": "M", "pid": PID, "tid": number, "name": "thread_name", "args": {"name": name}})
+    if not events:
+        return trace
+
+    origin = events[0][0]
+    running = None   # (task, start) of the task currently switched in
+    isr_stack = []
+    for cycles, event, task, arg in events:
+        if event == TASK_SWITCHED_IN:
+            running = (task, cycles)
+        elif event == TASK_SWITCHED_OUT:
+            if running and running[0] == task:
+                trace.append({"ph": "X", "pid": PID, "tid": task, "name": tasks.get(task, "task %d" % task),
+                              "ts": us(running[1]), "dur": us(cycles) - us(running[1])})
+            running = None
+        elif event == ISR_ENTER:
+            isr_stack.append((arg, cycles))
+        elif event == ISR_EXIT:
+            if isr_stack and isr_stack[-1][0] == arg:
+                irq, start = isr_stack.pop()
+                trace.append({"ph": "X", "pid": PID, "tid": ISR_TID, "name": "IRQ %d" % irq,
+                              "ts": us(start), "dur": us(cycles) - us(start)})
+        elif event in QUEUE_EVENTS:
+            in_isr = event in (QUEUE_SEND_FROM_ISR, QUEUE_RECEIVE_FROM_ISR)
+            tid = ISR_TID if in_isr or not running else running[0]
+            trace.append({"ph": "i", "s": "t", "pid": PID, "tid": tid, "ts": us(cycles),
+                          "name": "%s %s" % (QUEUE_EVENTS[event], queues.get(arg, "#%d" % arg))})
+    return trace
+
+
+def read_from_port(port, baudrate, timeout):
+    import serial  # pyserial, only needed when talking to hardware
+    with serial.Serial(port, baudrate, timeout=0.1) as link:
+        link.reset_input_buffer()
+        link.write(b"trace dump\r\n")
+        lines, pending = [], b""
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            pending += link.read(4096)
+            *complete, pending = pending.split(b"\n")
+            for raw in complete:
+                line = raw.decode("ascii", "replace").strip()
+                lines.append(line)
+                if line == "# end":
+                    return lines
+        raise TimeoutError("no '# end' from the gateway")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-i", "--input", help="saved dump, '-' for stdin")
+    parser.add_argument("-p", "--port", help="serial port of the CLI UART")
+    parser.add_argument("-b", "--baudrate", type=int, default=921600)
+    parser.add_argument("-o", "--output", default="trace.json")
+    parser.add_argument("--timeout", type=float, default=10.0)
+    args = parser.parse_args()
+
+    if args.port:
+        lines = read_from_port(args.port, args.baudrate, args.timeout)
+    elif args.input == "-":
+        lines = sys.stdin.read().splitlines()
+    elif args.input:
+        with open(args.input) as dump:
+            lines = dump.read().splitlines()
+    else:
+        parser.error("need --input or --port")
+        return 2
+
+    hz, tasks, queues, events = parse_dump(lines)
+    with open(args.output, "w") as out:
+        json.dump({"traceEvents": to_chrome(hz, tasks, queues, events), "displayTimeUnit": "ns"}, out)
+    print("%d events, %d tasks -> %s" % (len(events), len(tasks), args.output))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())